@@ -367,9 +367,9 @@ public:
             if (bitmap32[bucket_index] == 0x0) {
                 // Skip over completely empty bucket of size 32.
                 if (free_chunks == 0) {
-                    *start_of_free_chunks = bucket_index * 32;
+                    *start_of_free_chunks = bucket_index * 32 + start_bucket_bit;
                 }
-                free_chunks += 32;
+                free_chunks += 32 - start_bucket_bit;
                 if (free_chunks >= max_length) {
                     return max_length;
                 }
@@ -417,7 +417,9 @@ public:
         if (free_chunks < min_length) {
             size_t first_trailing_bit = (m_size / 32) * 32;
             size_t trailing_bits = size() % 32;
-            for (size_t i = 0; i < trailing_bits; ++i) {
+            // If the search started among the trailing bits, don't look before it.
+            size_t start_bit = start_bucket_index * 32 + start_bucket_bit;
+            for (size_t i = start_bit > first_trailing_bit ? start_bit - first_trailing_bit : 0; i < trailing_bits; ++i) {
                 if (!get(first_trailing_bit + i)) {
                     if (!free_chunks)
                         *start_of_free_chunks = first_trailing_bit + i;
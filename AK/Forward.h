@@ -118,6 +118,9 @@ class NonnullOwnPtrVector;
 template<typename T>
 class Optional;
 
+template<typename K, typename V>
+class RedBlackTree;
+
 template<typename T>
 struct RefPtrTraits;
 
@@ -177,6 +180,7 @@ using AK::OutputMemoryStream;
 using AK::OutputStream;
 using AK::OwnPtr;
 using AK::ReadonlyBytes;
+using AK::RedBlackTree;
 using AK::RefPtr;
 using AK::SharedBuffer;
 using AK::SinglyLinkedList;
@@ -0,0 +1,467 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Assertions.h>
+#include <AK/Optional.h>
+#include <AK/StdLibExtras.h>
+#include <AK/Types.h>
+
+namespace AK {
+
+// An ordered map from integral keys to values, kept balanced as a red-black tree.
+// Besides exact lookups, it can find the closest key on either side of a given
+// key, which makes it suitable for indexing non-overlapping address ranges.
+template<typename K, typename V>
+class RedBlackTree {
+    struct Node {
+        Node(K key, V&& value)
+            : key(key)
+            , value(move(value))
+        {
+        }
+
+        Node* parent { nullptr };
+        Node* left { nullptr };
+        Node* right { nullptr };
+        bool is_red { true };
+        K key;
+        V value;
+    };
+
+public:
+    template<typename NodeType, typename ElementType>
+    class IteratorImpl {
+    public:
+        bool operator==(const IteratorImpl& other) const { return m_node == other.m_node; }
+        bool operator!=(const IteratorImpl& other) const { return m_node != other.m_node; }
+
+        IteratorImpl& operator++()
+        {
+            m_node = RedBlackTree::successor(m_node);
+            return *this;
+        }
+
+        ElementType& operator*() { return m_node->value; }
+        ElementType* operator->() { return &m_node->value; }
+        K key() const { return m_node->key; }
+        bool is_end() const { return !m_node; }
+
+    private:
+        friend class RedBlackTree;
+        explicit IteratorImpl(NodeType* node)
+            : m_node(node)
+        {
+        }
+
+        NodeType* m_node { nullptr };
+    };
+
+    using Iterator = IteratorImpl<Node, V>;
+    using ConstIterator = IteratorImpl<const Node, const V>;
+
+    RedBlackTree() { }
+    ~RedBlackTree() { clear(); }
+
+    RedBlackTree(const RedBlackTree& other)
+        : m_root(clone_subtree(other.m_root, nullptr))
+        , m_size(other.m_size)
+    {
+    }
+
+    RedBlackTree(RedBlackTree&& other)
+        : m_root(exchange(other.m_root, nullptr))
+        , m_size(exchange(other.m_size, 0))
+    {
+    }
+
+    RedBlackTree& operator=(const RedBlackTree& other)
+    {
+        if (this != &other) {
+            clear();
+            m_root = clone_subtree(other.m_root, nullptr);
+            m_size = other.m_size;
+        }
+        return *this;
+    }
+
+    RedBlackTree& operator=(RedBlackTree&& other)
+    {
+        if (this != &other) {
+            clear();
+            m_root = exchange(other.m_root, nullptr);
+            m_size = exchange(other.m_size, 0);
+        }
+        return *this;
+    }
+
+    size_t size() const { return m_size; }
+    bool is_empty() const { return m_size == 0; }
+
+    void clear()
+    {
+        destroy_subtree(m_root);
+        m_root = nullptr;
+        m_size = 0;
+    }
+
+    void insert(K key, const V& value)
+    {
+        insert(key, V(value));
+    }
+
+    void insert(K key, V&& value)
+    {
+        Node* parent = nullptr;
+        Node** link = &m_root;
+        while (*link) {
+            parent = *link;
+            ASSERT(key != parent->key);
+            link = key < parent->key ? &parent->left : &parent->right;
+        }
+        auto* node = new Node(key, move(value));
+        node->parent = parent;
+        *link = node;
+        ++m_size;
+        insert_fixup(node);
+    }
+
+    V* find(K key) { return value_of(find_node(key)); }
+    const V* find(K key) const { return value_of(find_node(key)); }
+
+    // Returns the value with the largest key that is <= key.
+    V* find_largest_not_above(K key) { return value_of(find_largest_not_above_node(key)); }
+    const V* find_largest_not_above(K key) const { return value_of(find_largest_not_above_node(key)); }
+
+    // Returns the value with the smallest key that is >= key.
+    V* find_smallest_not_below(K key) { return value_of(find_smallest_not_below_node(key)); }
+    const V* find_smallest_not_below(K key) const { return value_of(find_smallest_not_below_node(key)); }
+
+    bool contains(K key) const { return find_node(key); }
+
+    Optional<V> take(K key)
+    {
+        auto* node = find_node(key);
+        if (!node)
+            return {};
+        V value = move(node->value);
+        remove_node(node);
+        return value;
+    }
+
+    bool remove(K key)
+    {
+        auto* node = find_node(key);
+        if (!node)
+            return false;
+        remove_node(node);
+        return true;
+    }
+
+    Iterator begin() { return Iterator(leftmost(m_root)); }
+    Iterator end() { return Iterator(nullptr); }
+    ConstIterator begin() const { return ConstIterator(leftmost(m_root)); }
+    ConstIterator end() const { return ConstIterator(nullptr); }
+
+    Iterator find_iterator(K key) { return Iterator(find_node(key)); }
+    Iterator find_smallest_not_below_iterator(K key) { return Iterator(find_smallest_not_below_node(key)); }
+
+private:
+    static V* value_of(Node* node) { return node ? &node->value : nullptr; }
+    static const V* value_of(const Node* node) { return node ? &node->value : nullptr; }
+
+    Node* find_node(K key) const
+    {
+        auto* node = m_root;
+        while (node && node->key != key)
+            node = key < node->key ? node->left : node->right;
+        return node;
+    }
+
+    Node* find_largest_not_above_node(K key) const
+    {
+        Node* candidate = nullptr;
+        auto* node = m_root;
+        while (node) {
+            if (node->key == key)
+                return node;
+            if (node->key < key) {
+                candidate = node;
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+        return candidate;
+    }
+
+    Node* find_smallest_not_below_node(K key) const
+    {
+        Node* candidate = nullptr;
+        auto* node = m_root;
+        while (node) {
+            if (node->key == key)
+                return node;
+            if (node->key > key) {
+                candidate = node;
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        return candidate;
+    }
+
+    template<typename NodeType>
+    static NodeType* leftmost(NodeType* node)
+    {
+        if (!node)
+            return nullptr;
+        while (node->left)
+            node = node->left;
+        return node;
+    }
+
+    template<typename NodeType>
+    static NodeType* successor(NodeType* node)
+    {
+        if (node->right)
+            return leftmost(node->right);
+        auto* parent = node->parent;
+        while (parent && node == parent->right) {
+            node = parent;
+            parent = parent->parent;
+        }
+        return parent;
+    }
+
+    static bool is_red(const Node* node) { return node && node->is_red; }
+
+    static Node* clone_subtree(const Node* node, Node* parent)
+    {
+        if (!node)
+            return nullptr;
+        auto* clone = new Node(node->key, V(node->value));
+        clone->parent = parent;
+        clone->is_red = node->is_red;
+        clone->left = clone_subtree(node->left, clone);
+        clone->right = clone_subtree(node->right, clone);
+        return clone;
+    }
+
+    static void destroy_subtree(Node* node)
+    {
+        while (node) {
+            destroy_subtree(node->right);
+            auto* left = node->left;
+            delete node;
+            node = left;
+        }
+    }
+
+    void rotate_left(Node* node)
+    {
+        auto* pivot = node->right;
+        node->right = pivot->left;
+        if (pivot->left)
+            pivot->left->parent = node;
+        replace_child(node, pivot);
+        pivot->left = node;
+        node->parent = pivot;
+    }
+
+    void rotate_right(Node* node)
+    {
+        auto* pivot = node->left;
+        node->left = pivot->right;
+        if (pivot->right)
+            pivot->right->parent = node;
+        replace_child(node, pivot);
+        pivot->right = node;
+        node->parent = pivot;
+    }
+
+    // Puts replacement (which may be null) where node used to hang off its parent.
+    void replace_child(Node* node, Node* replacement)
+    {
+        auto* parent = node->parent;
+        if (!parent)
+            m_root = replacement;
+        else if (node == parent->left)
+            parent->left = replacement;
+        else
+            parent->right = replacement;
+        if (replacement)
+            replacement->parent = parent;
+    }
+
+    void insert_fixup(Node* node)
+    {
+        while (is_red(node->parent)) {
+            auto* parent = node->parent;
+            auto* grandparent = parent->parent;
+            if (parent == grandparent->left) {
+                auto* uncle = grandparent->right;
+                if (is_red(uncle)) {
+                    parent->is_red = false;
+                    uncle->is_red = false;
+                    grandparent->is_red = true;
+                    node = grandparent;
+                    continue;
+                }
+                if (node == parent->right) {
+                    node = parent;
+                    rotate_left(node);
+                    parent = node->parent;
+                }
+                parent->is_red = false;
+                grandparent->is_red = true;
+                rotate_right(grandparent);
+            } else {
+                auto* uncle = grandparent->left;
+                if (is_red(uncle)) {
+                    parent->is_red = false;
+                    uncle->is_red = false;
+                    grandparent->is_red = true;
+                    node = grandparent;
+                    continue;
+                }
+                if (node == parent->left) {
+                    node = parent;
+                    rotate_right(node);
+                    parent = node->parent;
+                }
+                parent->is_red = false;
+                grandparent->is_red = true;
+                rotate_left(grandparent);
+            }
+        }
+        m_root->is_red = false;
+    }
+
+    void remove_node(Node* node)
+    {
+        Node* child;
+        Node* child_parent;
+        bool removed_black;
+
+        if (!node->left || !node->right) {
+            child = node->left ? node->left : node->right;
+            child_parent = node->parent;
+            removed_black = !node->is_red;
+            replace_child(node, child);
+        } else {
+            // Splice out the in-order successor and let it take the place of node.
+            auto* next = leftmost(node->right);
+            removed_black = !next->is_red;
+            child = next->right;
+            if (next->parent == node) {
+                child_parent = next;
+            } else {
+                child_parent = next->parent;
+                replace_child(next, child);
+                next->right = node->right;
+                next->right->parent = next;
+            }
+            replace_child(node, next);
+            next->left = node->left;
+            next->left->parent = next;
+            next->is_red = node->is_red;
+        }
+
+        delete node;
+        --m_size;
+
+        if (removed_black)
+            remove_fixup(child, child_parent);
+    }
+
+    void remove_fixup(Node* node, Node* parent)
+    {
+        while (node != m_root && !is_red(node)) {
+            if (node == parent->left) {
+                auto* sibling = parent->right;
+                if (is_red(sibling)) {
+                    sibling->is_red = false;
+                    parent->is_red = true;
+                    rotate_left(parent);
+                    sibling = parent->right;
+                }
+                if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                    sibling->is_red = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+                if (!is_red(sibling->right)) {
+                    sibling->left->is_red = false;
+                    sibling->is_red = true;
+                    rotate_right(sibling);
+                    sibling = parent->right;
+                }
+                sibling->is_red = parent->is_red;
+                parent->is_red = false;
+                sibling->right->is_red = false;
+                rotate_left(parent);
+            } else {
+                auto* sibling = parent->left;
+                if (is_red(sibling)) {
+                    sibling->is_red = false;
+                    parent->is_red = true;
+                    rotate_right(parent);
+                    sibling = parent->left;
+                }
+                if (!is_red(sibling->left) && !is_red(sibling->right)) {
+                    sibling->is_red = true;
+                    node = parent;
+                    parent = node->parent;
+                    continue;
+                }
+                if (!is_red(sibling->left)) {
+                    sibling->right->is_red = false;
+                    sibling->is_red = true;
+                    rotate_left(sibling);
+                    sibling = parent->left;
+                }
+                sibling->is_red = parent->is_red;
+                parent->is_red = false;
+                sibling->left->is_red = false;
+                rotate_right(parent);
+            }
+            node = m_root;
+        }
+        if (node)
+            node->is_red = false;
+    }
+
+    Node* m_root { nullptr };
+    size_t m_size { 0 };
+};
+
+}
+
+using AK::RedBlackTree;
@@ -224,6 +224,29 @@ TEST_CASE(find_longest_range_of_unset_bits_edge)
     EXPECT_EQ(result.value(), 32u);
 }
 
+TEST_CASE(find_next_range_of_unset_bits_from_middle_of_word)
+{
+    Bitmap bitmap(128, false);
+    size_t from = 37;
+    auto result = bitmap.find_next_range_of_unset_bits(from, 8, 8);
+    EXPECT_EQ(result.has_value(), true);
+    EXPECT_EQ(result.value(), 8u);
+    EXPECT_EQ(from, 37u);
+
+    from = 5;
+    result = bitmap.find_next_range_of_unset_bits(from);
+    EXPECT_EQ(result.has_value(), true);
+    EXPECT_EQ(result.value(), 123u);
+    EXPECT_EQ(from, 5u);
+
+    Bitmap short_bitmap(40, false);
+    from = 35;
+    result = short_bitmap.find_next_range_of_unset_bits(from, 5, 5);
+    EXPECT_EQ(result.has_value(), true);
+    EXPECT_EQ(result.value(), 5u);
+    EXPECT_EQ(from, 35u);
+}
+
 TEST_CASE(count_in_range)
 {
     Bitmap bitmap(256, false);
@@ -0,0 +1,176 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/TestSuite.h>
+
+#include <AK/NonnullOwnPtr.h>
+#include <AK/RedBlackTree.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+
+TEST_CASE(construct)
+{
+    RedBlackTree<int, int> empty;
+    EXPECT(empty.is_empty());
+    EXPECT_EQ(empty.size(), 0u);
+    EXPECT(empty.find(1) == nullptr);
+    EXPECT(empty.begin() == empty.end());
+}
+
+TEST_CASE(insert_and_find)
+{
+    RedBlackTree<u32, String> tree;
+    tree.insert(30, "thirty");
+    tree.insert(10, "ten");
+    tree.insert(20, "twenty");
+    EXPECT_EQ(tree.size(), 3u);
+    EXPECT_EQ(*tree.find(10), "ten");
+    EXPECT_EQ(*tree.find(20), "twenty");
+    EXPECT_EQ(*tree.find(30), "thirty");
+    EXPECT(tree.find(15) == nullptr);
+    EXPECT(tree.contains(20));
+    EXPECT(!tree.contains(25));
+}
+
+TEST_CASE(closest_keys)
+{
+    RedBlackTree<u32, u32> tree;
+    for (u32 key = 100; key <= 1000; key += 100)
+        tree.insert(key, key);
+
+    EXPECT(tree.find_largest_not_above(99) == nullptr);
+    EXPECT_EQ(*tree.find_largest_not_above(100), 100u);
+    EXPECT_EQ(*tree.find_largest_not_above(199), 100u);
+    EXPECT_EQ(*tree.find_largest_not_above(5000), 1000u);
+
+    EXPECT_EQ(*tree.find_smallest_not_below(0), 100u);
+    EXPECT_EQ(*tree.find_smallest_not_below(101), 200u);
+    EXPECT_EQ(*tree.find_smallest_not_below(1000), 1000u);
+    EXPECT(tree.find_smallest_not_below(1001) == nullptr);
+}
+
+TEST_CASE(iterates_in_order)
+{
+    RedBlackTree<int, int> tree;
+    int keys[] = { 5, 3, 8, 1, 4, 7, 9, 2, 6, 0 };
+    for (auto key : keys)
+        tree.insert(key, key * 10);
+
+    int expected = 0;
+    for (auto it = tree.begin(); it != tree.end(); ++it) {
+        EXPECT_EQ(it.key(), expected);
+        EXPECT_EQ(*it, expected * 10);
+        ++expected;
+    }
+    EXPECT_EQ(expected, 10);
+}
+
+TEST_CASE(remove_and_take)
+{
+    RedBlackTree<int, NonnullOwnPtr<int>> tree;
+    for (int i = 0; i < 10; ++i)
+        tree.insert(i, make<int>(i));
+
+    EXPECT(tree.remove(3));
+    EXPECT(!tree.remove(3));
+    auto taken = tree.take(7);
+    EXPECT(taken.has_value());
+    EXPECT_EQ(**taken, 7);
+    EXPECT(!tree.take(7).has_value());
+    EXPECT_EQ(tree.size(), 8u);
+
+    Vector<int> remaining;
+    for (auto& value : tree)
+        remaining.append(*value);
+    EXPECT_EQ(remaining.size(), 8u);
+    EXPECT_EQ(remaining[2], 2);
+    EXPECT_EQ(remaining[3], 4);
+    EXPECT_EQ(remaining[6], 8);
+}
+
+TEST_CASE(copy)
+{
+    RedBlackTree<int, int> tree;
+    for (int i = 0; i < 100; ++i)
+        tree.insert(i, i);
+
+    auto copy = tree;
+    tree.clear();
+    EXPECT(tree.is_empty());
+    EXPECT_EQ(copy.size(), 100u);
+    int expected = 0;
+    for (auto value : copy)
+        EXPECT_EQ(value, expected++);
+}
+
+TEST_CASE(many_random_operations)
+{
+    constexpr int key_space = 512;
+    bool present[key_space] {};
+    size_t present_count = 0;
+    RedBlackTree<int, int> tree;
+
+    u32 seed = 0x12345678;
+    auto next_random = [&] {
+        seed = seed * 1103515245 + 12345;
+        return (seed >> 16) % key_space;
+    };
+
+    for (int i = 0; i < 20000; ++i) {
+        int key = next_random();
+        if (present[key]) {
+            EXPECT(tree.remove(key));
+            present[key] = false;
+            --present_count;
+        } else {
+            tree.insert(key, key);
+            present[key] = true;
+            ++present_count;
+        }
+    }
+
+    EXPECT_EQ(tree.size(), present_count);
+
+    int last_present = -1;
+    for (int key = 0; key < key_space; ++key) {
+        EXPECT_EQ(tree.contains(key), present[key]);
+        if (present[key])
+            last_present = key;
+        auto* floor = tree.find_largest_not_above(key);
+        if (last_present < 0)
+            EXPECT(floor == nullptr);
+        else
+            EXPECT_EQ(*floor, last_present);
+    }
+
+    int previous = -1;
+    for (auto value : tree) {
+        EXPECT(value > previous);
+        previous = value;
+    }
+}
+
+TEST_MAIN(RedBlackTree)
@@ -30,6 +30,7 @@
 #include <AK/JsonObject.h>
 #include <AK/JsonValue.h>
 #include <AK/SharedBuffer.h>
+#include <AK/StringBuilder.h>
 #include <LibCore/File.h>
 #include <LibCore/ProcessStatisticsReader.h>
 #include <LibGUI/FileIconProvider.h>
@@ -121,6 +122,8 @@ String ProcessModel::column_name(int column) const
         return "CPU";
     case Column::Processor:
         return "Processor";
+    case Column::Affinity:
+        return "Affinity";
     case Column::Name:
         return "Name";
     case Column::Syscalls:
@@ -157,6 +160,22 @@ static String pretty_byte_size(size_t size)
     return String::formatted("{}K", size / 1024);
 }
 
+static String affinity_string(u32 affinity, size_t cpu_count)
+{
+    u32 all_cpus = cpu_count >= 32 ? 0xffffffff : (1u << cpu_count) - 1;
+    if ((affinity & all_cpus) == all_cpus)
+        return "All";
+    StringBuilder builder;
+    for (size_t cpu = 0; cpu < cpu_count; ++cpu) {
+        if (!(affinity & (1u << cpu)))
+            continue;
+        if (!builder.is_empty())
+            builder.append(',');
+        builder.appendf("%zu", cpu);
+    }
+    return builder.to_string();
+}
+
 GUI::Variant ProcessModel::data(const GUI::ModelIndex& index, GUI::ModelRole role) const
 {
     ASSERT(is_valid(index));
@@ -185,6 +204,7 @@ GUI::Variant ProcessModel::data(const GUI::ModelIndex& index, GUI::ModelRole rol
         case Column::PurgeableNonvolatile:
         case Column::CPU:
         case Column::Processor:
+        case Column::Affinity:
         case Column::Syscalls:
         case Column::InodeFaults:
         case Column::ZeroFaults:
@@ -242,6 +262,8 @@ GUI::Variant ProcessModel::data(const GUI::ModelIndex& index, GUI::ModelRole rol
             return thread.current_state.cpu_percent;
         case Column::Processor:
             return thread.current_state.cpu;
+        case Column::Affinity:
+            return thread.current_state.affinity;
         case Column::Name:
             return thread.current_state.name;
         case Column::Syscalls:
@@ -315,6 +337,8 @@ GUI::Variant ProcessModel::data(const GUI::ModelIndex& index, GUI::ModelRole rol
             return thread.current_state.cpu_percent;
         case Column::Processor:
             return thread.current_state.cpu;
+        case Column::Affinity:
+            return affinity_string(thread.current_state.affinity, m_cpus.size());
         case Column::Name:
             return thread.current_state.name;
         case Column::Syscalls:
@@ -393,6 +417,7 @@ void ProcessModel::update()
             state.ticks_user = thread.ticks_user;
             state.ticks_kernel = thread.ticks_kernel;
             state.cpu = thread.cpu;
+            state.affinity = thread.affinity;
             state.cpu_percent = 0;
             state.priority = thread.priority;
             state.effective_priority = thread.effective_priority;
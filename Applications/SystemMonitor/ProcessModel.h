@@ -51,6 +51,7 @@ public:
         Name,
         CPU,
         Processor,
+        Affinity,
         State,
         Priority,
         EffectivePriority,
@@ -125,6 +126,7 @@ private:
         String pledge;
         String veil;
         u32 cpu;
+        u32 affinity;
         u32 priority;
         u32 effective_priority;
         size_t amount_virtual;
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include "PerformanceCounterRecorder.h"
+#include <AK/Atomic.h>
+#include <AK/JsonObject.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+Optional<PerformanceCounterEvent> PerformanceCounterRecorder::event_from_name(const StringView& name)
+{
+    if (name == "cycles")
+        return PerformanceCounterEvent::Cycles;
+    if (name == "cache-misses")
+        return PerformanceCounterEvent::CacheMisses;
+    if (name == "branch-misses")
+        return PerformanceCounterEvent::BranchMisses;
+    return {};
+}
+
+const char* PerformanceCounterRecorder::event_type_name(PerformanceCounterEvent event)
+{
+    switch (event) {
+    case PerformanceCounterEvent::Cycles:
+        return "cycles";
+    case PerformanceCounterEvent::CacheMisses:
+        return "cache_miss";
+    case PerformanceCounterEvent::BranchMisses:
+        return "branch_miss";
+    }
+    return "unknown";
+}
+
+Result<NonnullOwnPtr<PerformanceCounterRecorder>, String> PerformanceCounterRecorder::start(pid_t pid, PerformanceCounterEvent event)
+{
+    int fd = open("/dev/perfcounters", O_RDWR | O_CLOEXEC);
+    if (fd < 0)
+        return String::formatted("Unable to open /dev/perfcounters: {}", strerror(errno));
+
+    auto recorder = adopt_own(*new PerformanceCounterRecorder(fd));
+
+    u32 processor_count = 0;
+    if (ioctl(fd, PERFCOUNTERS_IOCTL_GET_PROCESSOR_COUNT, &processor_count) < 0)
+        return String::formatted("Unable to get processor count: {}", strerror(errno));
+
+    PerformanceCounterConfiguration configuration { pid, event, 0 };
+    if (ioctl(fd, PERFCOUNTERS_IOCTL_START, &configuration) < 0) {
+        if (errno == ENOTSUP)
+            return String { "This CPU can't count that event" };
+        return String::formatted("Unable to start performance counters: {}", strerror(errno));
+    }
+    recorder->m_is_recording = true;
+
+    for (u32 cpu = 0; cpu < processor_count; ++cpu) {
+        auto* ring = mmap(nullptr, performance_counter_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, cpu * performance_counter_ring_size);
+        if (ring == MAP_FAILED)
+            return String::formatted("Unable to map samples of processor {}: {}", cpu, strerror(errno));
+        recorder->m_rings.append(static_cast<u8*>(ring));
+    }
+    return recorder;
+}
+
+PerformanceCounterRecorder::PerformanceCounterRecorder(int fd)
+    : m_fd(fd)
+{
+}
+
+PerformanceCounterRecorder::~PerformanceCounterRecorder()
+{
+    stop();
+    for (auto* ring : m_rings)
+        munmap(ring, performance_counter_ring_size);
+    close(m_fd);
+}
+
+void PerformanceCounterRecorder::collect()
+{
+    for (auto* ring : m_rings) {
+        auto& header = *reinterpret_cast<PerformanceCounterRingHeader*>(ring);
+        auto* samples = reinterpret_cast<const PerformanceCounterSample*>(ring + performance_counter_ring_samples_offset);
+
+        u32 head = AK::atomic_load(&header.head, AK::memory_order_acquire);
+        u32 tail = header.tail;
+        for (; tail != head; ++tail) {
+            auto& sample = samples[tail % performance_counter_ring_capacity];
+            JsonObject object;
+            object.set("type", event_type_name(sample.event));
+            object.set("tid", sample.tid);
+            object.set("timestamp", sample.timestamp);
+            JsonArray stack;
+            for (u32 i = 0; i < min(sample.stack_size, (u32)performance_counter_max_stack_frame_count); ++i)
+                stack.append(sample.stack[i]);
+            object.set("stack", move(stack));
+            m_events.append(move(object));
+        }
+        // Hand the slots back to the kernel only once we're done reading them.
+        AK::atomic_store(&header.tail, tail, AK::memory_order_release);
+    }
+}
+
+void PerformanceCounterRecorder::stop()
+{
+    if (!m_is_recording)
+        return;
+    m_is_recording = false;
+    ioctl(m_fd, PERFCOUNTERS_IOCTL_STOP, 0);
+    collect();
+    for (auto* ring : m_rings)
+        m_lost_sample_count += reinterpret_cast<const PerformanceCounterRingHeader*>(ring)->lost;
+}
@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/JsonArray.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/Optional.h>
+#include <AK/Result.h>
+#include <AK/Vector.h>
+#include <Kernel/API/PerformanceCounters.h>
+#include <sys/types.h>
+
+// Records a process with /dev/perfcounters, draining the per-processor rings into
+// profile events (in the same format as /proc/profile's) while it's running.
+class PerformanceCounterRecorder {
+public:
+    static Optional<PerformanceCounterEvent> event_from_name(const StringView&);
+    static const char* event_type_name(PerformanceCounterEvent);
+
+    static Result<NonnullOwnPtr<PerformanceCounterRecorder>, String> start(pid_t, PerformanceCounterEvent);
+    ~PerformanceCounterRecorder();
+
+    void collect();
+    void stop();
+
+    const JsonArray& events() const { return m_events; }
+    u32 lost_sample_count() const { return m_lost_sample_count; }
+
+private:
+    explicit PerformanceCounterRecorder(int fd);
+
+    int m_fd { -1 };
+    bool m_is_recording { false };
+    Vector<u8*> m_rings;
+    JsonArray m_events;
+    u32 m_lost_sample_count { 0 };
+};
@@ -110,8 +110,15 @@ Profile::Profile(String executable_path, Vector<Event> events)
     m_model = ProfileModel::create(*this);
 
     for (auto& event : m_events) {
+        // Samples from the performance counters come after the rest, so the events aren't necessarily in order.
+        m_first_timestamp = min(m_first_timestamp, event.timestamp);
+        m_last_timestamp = max(m_last_timestamp, event.timestamp);
         m_deepest_stack_depth = max((u32)event.frames.size(), m_deepest_stack_depth);
+        if (event.type != "malloc" && event.type != "free" && !m_sample_types.contains_slow(event.type))
+            m_sample_types.append(event.type);
     }
+    if (m_sample_types.size() > 1)
+        m_sample_type_filter = m_sample_types.first();
 
     rebuild_tree();
 }
@@ -165,6 +172,9 @@ void Profile::rebuild_tree()
                 continue;
         }
 
+        if (!is_shown(event))
+            continue;
+
         if (event.type == "malloc" && !live_allocations.contains(event.ptr))
             continue;
 
@@ -252,7 +262,7 @@ void Profile::rebuild_tree()
     m_model->update();
 }
 
-Result<NonnullOwnPtr<Profile>, String> Profile::load_from_perfcore_file(const StringView& path)
+Result<NonnullOwnPtr<Profile>, String> Profile::load_from_perfcore_file(const StringView& path, const JsonArray& additional_events)
 {
     auto file = Core::File::construct(path);
     if (!file->open(Core::IODevice::ReadOnly))
@@ -280,12 +290,14 @@ Result<NonnullOwnPtr<Profile>, String> Profile::load_from_perfcore_file(const St
         return String { "Malformed profile (events is not an array)" };
 
     auto& perf_events = events_value.as_array();
-    if (perf_events.is_empty())
+    size_t perf_event_count = perf_events.values().size() + additional_events.values().size();
+    if (perf_event_count == 0)
         return String { "No events captured (targeted process was never on CPU)" };
 
     Vector<Event> events;
 
-    for (auto& perf_event_value : perf_events.values()) {
+    for (size_t event_index = 0; event_index < perf_event_count; ++event_index) {
+        auto& perf_event_value = event_index < perf_events.values().size() ? perf_events.values()[event_index] : additional_events.values()[event_index - perf_events.values().size()];
         auto& perf_event = perf_event_value.as_object();
 
         Event event;
@@ -357,6 +369,21 @@ void Profile::clear_timestamp_filter_range()
     rebuild_tree();
 }
 
+bool Profile::is_shown(const Event& event) const
+{
+    if (m_sample_type_filter.is_null())
+        return true;
+    return event.type == m_sample_type_filter;
+}
+
+void Profile::set_sample_type_filter(const String& type)
+{
+    if (m_sample_type_filter == type)
+        return;
+    m_sample_type_filter = type;
+    rebuild_tree();
+}
+
 void Profile::set_inverted(bool inverted)
 {
     if (m_inverted == inverted)
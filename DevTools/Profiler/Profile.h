@@ -129,7 +129,7 @@ private:
 
 class Profile {
 public:
-    static Result<NonnullOwnPtr<Profile>, String> load_from_perfcore_file(const StringView& path);
+    static Result<NonnullOwnPtr<Profile>, String> load_from_perfcore_file(const StringView& path, const JsonArray& additional_events = {});
     ~Profile();
 
     GUI::Model& model();
@@ -158,6 +158,13 @@ public:
 
     const Vector<Event>& events() const { return m_events; }
 
+    // The kinds of samples in this profile (timer samples, and one for each hardware counter
+    // that was recorded). When there's more than one, only one of them is shown at a time.
+    const Vector<String>& sample_types() const { return m_sample_types; }
+    const String& sample_type_filter() const { return m_sample_type_filter; }
+    void set_sample_type_filter(const String&);
+    bool is_shown(const Event&) const;
+
     u64 length_in_ms() const { return m_last_timestamp - m_first_timestamp; }
     u64 first_timestamp() const { return m_first_timestamp; }
     u64 last_timestamp() const { return m_last_timestamp; }
@@ -195,6 +202,8 @@ private:
     u64 m_last_timestamp { 0 };
 
     Vector<Event> m_events;
+    Vector<String> m_sample_types;
+    String m_sample_type_filter;
 
     bool m_has_timestamp_filter_range { false };
     u64 m_timestamp_filter_range_start { 0 };
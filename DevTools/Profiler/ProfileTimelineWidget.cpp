@@ -51,6 +51,9 @@ void ProfileTimelineWidget::paint_event(GUI::PaintEvent& event)
     float frame_height = (float)frame_inner_rect().height() / (float)m_profile.deepest_stack_depth();
 
     for (auto& event : m_profile.events()) {
+        if (!m_profile.is_shown(event))
+            continue;
+
         u64 t = event.timestamp - m_profile.first_timestamp();
         int x = (int)((float)t * column_width);
         int cw = max(1, (int)column_width);
@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include "PerformanceCounterRecorder.h"
 #include "Profile.h"
 #include "ProfileTimelineWidget.h"
 #include <LibCore/ArgsParser.h>
@@ -33,6 +34,7 @@
 #include <LibCore/Timer.h>
 #include <LibGUI/AboutDialog.h>
 #include <LibGUI/Action.h>
+#include <LibGUI/ActionGroup.h>
 #include <LibGUI/Application.h>
 #include <LibGUI/BoxLayout.h>
 #include <LibGUI/Button.h>
@@ -51,28 +53,53 @@
 #include <stdio.h>
 #include <string.h>
 
-static bool generate_profile(pid_t specified_pid);
+static bool generate_profile(pid_t specified_pid, Optional<PerformanceCounterEvent>, JsonArray& counter_events);
+
+static String sample_type_title(const String& type)
+{
+    if (type == "sample")
+        return "Timer samples";
+    if (type == "cycles")
+        return "Cycles";
+    if (type == "cache_miss")
+        return "Cache misses";
+    if (type == "branch_miss")
+        return "Branch misses";
+    return type;
+}
 
 int main(int argc, char** argv)
 {
     Core::ArgsParser args_parser;
     int pid = 0;
+    const char* event_name = nullptr;
     args_parser.add_option(pid, "PID to profile", "pid", 'p', "PID");
+    args_parser.add_option(event_name, "Also sample on a hardware event (cycles, cache-misses or branch-misses)", "event", 'e', "event");
     args_parser.parse(argc, argv, false);
 
+    Optional<PerformanceCounterEvent> counter_event;
+    if (event_name) {
+        counter_event = PerformanceCounterRecorder::event_from_name(event_name);
+        if (!counter_event.has_value()) {
+            warnln("Unknown event: {}", event_name);
+            return 1;
+        }
+    }
+
     auto app = GUI::Application::construct(argc, argv);
     auto app_icon = GUI::Icon::default_icon("app-profiler");
 
     const char* path = nullptr;
+    JsonArray counter_events;
     if (argc != 2) {
-        if (!generate_profile(pid))
+        if (!generate_profile(pid, counter_event, counter_events))
             return 0;
         path = "/proc/profile";
     } else {
         path = argv[1];
     }
 
-    auto profile_or_error = Profile::load_from_perfcore_file(path);
+    auto profile_or_error = Profile::load_from_perfcore_file(path, counter_events);
     if (profile_or_error.is_error()) {
         GUI::MessageBox::show(nullptr, profile_or_error.error(), "Profiler", GUI::MessageBox::Type::Error);
         return 0;
@@ -89,7 +116,7 @@ int main(int argc, char** argv)
     main_widget.set_fill_with_background_color(true);
     main_widget.set_layout<GUI::VerticalBoxLayout>();
 
-    main_widget.add<ProfileTimelineWidget>(*profile);
+    auto& timeline_widget = main_widget.add<ProfileTimelineWidget>(*profile);
 
     auto& bottom_splitter = main_widget.add<GUI::VerticalSplitter>();
 
@@ -144,6 +171,21 @@ int main(int argc, char** argv)
     percent_action->set_checked(false);
     view_menu.add_action(percent_action);
 
+    GUI::ActionGroup sample_type_action_group;
+    sample_type_action_group.set_exclusive(true);
+    if (profile->sample_types().size() > 1) {
+        view_menu.add_separator();
+        for (auto& type : profile->sample_types()) {
+            auto action = GUI::Action::create_checkable(sample_type_title(type), [&, type](auto&) {
+                profile->set_sample_type_filter(type);
+                timeline_widget.update();
+            });
+            action->set_checked(type == profile->sample_type_filter());
+            sample_type_action_group.add_action(*action);
+            view_menu.add_action(*action);
+        }
+    }
+
     auto& help_menu = menubar->add_menu("Help");
     help_menu.add_action(GUI::Action::create("About", [&](auto&) {
         GUI::AboutDialog::show("Profiler", app_icon.bitmap_for_size(32), window);
@@ -155,7 +197,7 @@ int main(int argc, char** argv)
     return app->exec();
 }
 
-static bool prompt_to_stop_profiling(pid_t pid, const String& process_name)
+static bool prompt_to_stop_profiling(pid_t pid, const String& process_name, PerformanceCounterRecorder* recorder)
 {
     auto window = GUI::Window::construct();
     window->set_title(String::formatted("Profiling {}({})", process_name, pid));
@@ -173,6 +215,9 @@ static bool prompt_to_stop_profiling(pid_t pid, const String& process_name)
     clock.start();
     auto update_timer = Core::Timer::construct(100, [&] {
         timer_label.set_text(String::format("%.1f seconds", (float)clock.elapsed() / 1000.0f));
+        // Keep up with the kernel so its rings don't fill up and start dropping samples.
+        if (recorder)
+            recorder->collect();
     });
 
     auto& stop_button = widget.add<GUI::Button>("Stop");
@@ -185,7 +230,7 @@ static bool prompt_to_stop_profiling(pid_t pid, const String& process_name)
     return GUI::Application::the()->exec() == 0;
 }
 
-bool generate_profile(pid_t pid)
+bool generate_profile(pid_t pid, Optional<PerformanceCounterEvent> counter_event, JsonArray& counter_events)
 {
     if (!pid) {
         auto process_chooser = GUI::ProcessChooser::construct("Profiler", "Profile", Gfx::Bitmap::load_from_file("/res/icons/16x16/app-profiler.png"));
@@ -208,9 +253,27 @@ bool generate_profile(pid_t pid)
         return false;
     }
 
-    if (!prompt_to_stop_profiling(pid, process_name))
+    OwnPtr<PerformanceCounterRecorder> recorder;
+    if (counter_event.has_value()) {
+        auto recorder_or_error = PerformanceCounterRecorder::start(pid, counter_event.value());
+        if (recorder_or_error.is_error()) {
+            profiling_disable(pid);
+            GUI::MessageBox::show(nullptr, String::formatted("Unable to sample process {}({}): {}", process_name, pid, recorder_or_error.error()), "Profiler", GUI::MessageBox::Type::Error);
+            return false;
+        }
+        recorder = move(recorder_or_error.value());
+    }
+
+    if (!prompt_to_stop_profiling(pid, process_name, recorder.ptr()))
         return false;
 
+    if (recorder) {
+        recorder->stop();
+        if (recorder->lost_sample_count())
+            dbgln("Profiler: Lost {} samples", recorder->lost_sample_count());
+        counter_events = recorder->events();
+    }
+
     if (profiling_disable(pid) < 0) {
         return false;
     }
@@ -1773,7 +1773,8 @@ bool Emulator::find_malloc_symbols(const MmapRegion& libc_text)
     auto free_symbol = image.find_demangled_function("free");
     auto realloc_symbol = image.find_demangled_function("realloc");
     auto malloc_size_symbol = image.find_demangled_function("malloc_size");
-    if (!malloc_symbol.has_value() || !free_symbol.has_value() || !realloc_symbol.has_value() || !malloc_size_symbol.has_value())
+    auto malloc_thread_exit_symbol = image.find_demangled_function("__malloc_thread_exit");
+    if (!malloc_symbol.has_value() || !free_symbol.has_value() || !realloc_symbol.has_value() || !malloc_size_symbol.has_value() || !malloc_thread_exit_symbol.has_value())
         return false;
 
     m_malloc_symbol_start = malloc_symbol.value().value() + libc_text.base();
@@ -1784,6 +1785,8 @@ bool Emulator::find_malloc_symbols(const MmapRegion& libc_text)
     m_realloc_symbol_end = m_realloc_symbol_start + realloc_symbol.value().size();
     m_malloc_size_symbol_start = malloc_size_symbol.value().value() + libc_text.base();
     m_malloc_size_symbol_end = m_malloc_size_symbol_start + malloc_size_symbol.value().size();
+    m_malloc_thread_exit_symbol_start = malloc_thread_exit_symbol.value().value() + libc_text.base();
+    m_malloc_thread_exit_symbol_end = m_malloc_thread_exit_symbol_start + malloc_thread_exit_symbol.value().size();
     return true;
 }
 }
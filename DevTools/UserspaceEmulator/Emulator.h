@@ -191,6 +191,8 @@ private:
     FlatPtr m_free_symbol_end { 0 };
     FlatPtr m_malloc_size_symbol_start { 0 };
     FlatPtr m_malloc_size_symbol_end { 0 };
+    FlatPtr m_malloc_thread_exit_symbol_start { 0 };
+    FlatPtr m_malloc_thread_exit_symbol_end { 0 };
 
     sigset_t m_pending_signals { 0 };
     sigset_t m_signal_mask { 0 };
@@ -219,7 +221,8 @@ ALWAYS_INLINE bool Emulator::is_in_malloc_or_free() const
     return (m_cpu.base_eip() >= m_malloc_symbol_start && m_cpu.base_eip() < m_malloc_symbol_end)
         || (m_cpu.base_eip() >= m_free_symbol_start && m_cpu.base_eip() < m_free_symbol_end)
         || (m_cpu.base_eip() >= m_realloc_symbol_start && m_cpu.base_eip() < m_realloc_symbol_end)
-        || (m_cpu.base_eip() >= m_malloc_size_symbol_start && m_cpu.base_eip() < m_malloc_size_symbol_end);
+        || (m_cpu.base_eip() >= m_malloc_size_symbol_start && m_cpu.base_eip() < m_malloc_size_symbol_end)
+        || (m_cpu.base_eip() >= m_malloc_thread_exit_symbol_start && m_cpu.base_eip() < m_malloc_thread_exit_symbol_end);
 }
 
 ALWAYS_INLINE bool Emulator::is_in_loader_code() const
@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// /dev/perfcounters samples a process whenever a hardware performance counter overflows.
+// Every processor has its own ring of samples, which can be mmap()ed (shared, readable
+// and writable) from the device at offset cpu * performance_counter_ring_size.
+//
+// A ring starts with a PerformanceCounterRingHeader, and its samples start at
+// performance_counter_ring_samples_offset. Only the processor that owns the ring writes
+// head, and only the reader writes tail. Both only ever count up; a sample's slot is its
+// index modulo capacity. When the ring is full, new samples are dropped and counted in
+// lost instead of overwriting ones the reader hasn't seen yet.
+
+constexpr size_t performance_counter_ring_capacity = 2048;
+constexpr size_t performance_counter_ring_samples_offset = 4096;
+constexpr size_t performance_counter_max_stack_frame_count = 27;
+
+enum class PerformanceCounterEvent : u32 {
+    Cycles = 0,
+    CacheMisses,
+    BranchMisses,
+};
+
+struct PerformanceCounterConfiguration {
+    i32 pid;
+    PerformanceCounterEvent event;
+    // Take a sample every period events, or pick a sensible default if it's 0.
+    u32 period;
+};
+
+struct [[gnu::packed]] PerformanceCounterRingHeader {
+    // Written by the kernel.
+    u32 head;
+    u32 lost;
+    u32 capacity;
+    PerformanceCounterEvent event;
+    u8 padding1[48];
+    // Written by the reader. Kept on its own cache line so the two sides don't fight over it.
+    u32 tail;
+    u8 padding2[60];
+};
+
+struct [[gnu::packed]] PerformanceCounterSample {
+    PerformanceCounterEvent event;
+    i32 tid;
+    u64 timestamp;
+    u32 stack_size;
+    u32 stack[performance_counter_max_stack_frame_count];
+};
+
+constexpr size_t performance_counter_ring_size = performance_counter_ring_samples_offset + performance_counter_ring_capacity * sizeof(PerformanceCounterSample);
+
+static_assert(sizeof(PerformanceCounterRingHeader) <= performance_counter_ring_samples_offset);
+static_assert(sizeof(PerformanceCounterSample) == 128);
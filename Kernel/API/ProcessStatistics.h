@@ -0,0 +1,98 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// get_process_statistics() fills a buffer with a ProcessStatisticsHeader followed by
+// process_count processes. Each process is a ProcessStatisticsEntry, its strings (if it
+// has HasStrings set), and then thread_count threads. Each thread is a
+// ThreadStatisticsEntry followed by its name (if it has HasStrings set).
+// A string is a u16 length followed by that many bytes, without a terminator.
+//
+// Strings are only included for processes and threads that changed after the generation
+// the caller passes in, so readers that keep their previous snapshot around mostly just
+// get counters.
+
+struct [[gnu::packed]] ProcessStatisticsHeader {
+    u32 generation;
+    u32 process_count;
+};
+
+struct [[gnu::packed]] ProcessStatisticsEntry {
+    enum Flags : u32 {
+        HasStrings = 1 << 0,
+    };
+
+    u32 flags;
+    i32 pid;
+    i32 pgid;
+    i32 pgp;
+    i32 sid;
+    u32 uid;
+    u32 gid;
+    i32 ppid;
+    u32 nfds;
+    u64 amount_virtual;
+    u64 amount_resident;
+    u64 amount_shared;
+    u64 amount_dirty_private;
+    u64 amount_clean_inode;
+    u64 amount_purgeable_volatile;
+    u64 amount_purgeable_nonvolatile;
+    u32 thread_count;
+    // Followed by name, executable, tty, pledge and veil if HasStrings is set.
+};
+
+struct [[gnu::packed]] ThreadStatisticsEntry {
+    enum Flags : u32 {
+        HasStrings = 1 << 0,
+    };
+
+    u32 flags;
+    i32 tid;
+    u32 times_scheduled;
+    u32 ticks_user;
+    u32 ticks_kernel;
+    u32 syscall_count;
+    u32 inode_faults;
+    u32 zero_faults;
+    u32 cow_faults;
+    u32 swap_faults;
+    u32 unix_socket_read_bytes;
+    u32 unix_socket_write_bytes;
+    u32 ipv4_socket_read_bytes;
+    u32 ipv4_socket_write_bytes;
+    u32 file_read_bytes;
+    u32 file_write_bytes;
+    u32 cpu;
+    u32 affinity;
+    u32 priority;
+    u32 effective_priority;
+    char state[16];
+    // Followed by name if HasStrings is set.
+};
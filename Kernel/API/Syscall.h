@@ -37,6 +37,7 @@ constexpr int syscall_vector = 0x82;
 
 extern "C" {
 struct pollfd;
+struct epoll_event;
 struct timeval;
 struct timespec;
 struct sockaddr;
@@ -147,6 +148,8 @@ namespace Kernel {
     S(getpeername)            \
     S(sched_setparam)         \
     S(sched_getparam)         \
+    S(sched_setaffinity)      \
+    S(sched_getaffinity)      \
     S(fchown)                 \
     S(halt)                   \
     S(reboot)                 \
@@ -197,7 +200,14 @@ namespace Kernel {
     S(allocate_tls)           \
     S(prctl)                  \
     S(mremap)                 \
-    S(set_coredump_metadata)
+    S(set_coredump_metadata)  \
+    S(splice)                 \
+    S(epoll_create1)          \
+    S(epoll_ctl)              \
+    S(epoll_wait)             \
+    S(sendfile)               \
+    S(swapon)                 \
+    S(get_process_statistics)
 
 namespace Syscall {
 
@@ -327,7 +337,9 @@ struct SC_futex_params {
     const i32* userspace_address;
     int futex_op;
     i32 val;
-    const timespec* timeout;
+    const timespec* timeout; // For FUTEX_REQUEUE and FUTEX_CMP_REQUEUE, this is the number of waiters to requeue.
+    i32* userspace_address2;
+    i32 val3;
 };
 
 struct SC_setkeymap_params {
@@ -448,6 +460,41 @@ struct SC_set_coredump_metadata_params {
     StringArgument value;
 };
 
+struct SC_splice_params {
+    int fd_in;
+    int fd_out;
+    size_t length;
+    u32 flags;
+};
+
+struct SC_epoll_ctl_params {
+    int epfd;
+    int op;
+    int fd;
+    struct epoll_event* event;
+};
+
+struct SC_epoll_wait_params {
+    int epfd;
+    struct epoll_event* events;
+    int maxevents;
+    const struct timespec* timeout;
+    const u32* sigmask;
+};
+
+struct SC_sendfile_params {
+    int out_fd;
+    int in_fd;
+    ssize_t* offset;
+    size_t count;
+};
+
+struct SC_get_process_statistics_params {
+    u32 since_generation;
+    void* buffer;
+    size_t buffer_size;
+};
+
 void initialize();
 int sync();
 
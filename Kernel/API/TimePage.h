@@ -0,0 +1,61 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Types.h>
+
+// The kernel maps one read-only page into every process that mirrors its clocks, so that
+// clock_gettime() doesn't have to enter the kernel. Its address is passed to new programs
+// as the AT_TIME_PAGE auxiliary vector entry.
+//
+// Updates follow the kernel's own seqlock protocol: update1 is incremented before anything
+// else on the page changes, and update2 is set to the same value once everything has been
+// written. A reader loads update2 first and update1 after everything else; if the two match,
+// it has a consistent snapshot.
+
+struct TimePage {
+    volatile u32 update1;
+
+    // The monotonic clock as of the last timer interrupt.
+    u64 seconds_since_boot;
+    u32 ticks_this_second;
+    u32 ticks_per_second;
+
+    // The epoch time as of the last timer interrupt.
+    i64 epoch_seconds;
+    i64 epoch_nanoseconds;
+
+    // If non-zero, the user-readable address of the 64-bit HPET main counter. The precise
+    // monotonic time is ticks_this_second plus hpet_main_counter_drift plus however much
+    // the counter advanced since hpet_main_counter_last_read, with ticks_per_second being
+    // the counter frequency.
+    FlatPtr hpet_main_counter_address;
+    u64 hpet_main_counter_last_read;
+    u64 hpet_main_counter_drift;
+
+    volatile u32 update2;
+};
@@ -225,6 +225,8 @@ extern "C" u8* safe_memset_ins_1;
 extern "C" u8* safe_memset_1_faulted;
 extern "C" u8* safe_memset_ins_2;
 extern "C" u8* safe_memset_2_faulted;
+extern "C" u8* safe_atomic_compare_exchange_relaxed_ins;
+extern "C" u8* safe_atomic_compare_exchange_relaxed_faulted;
 
 bool safe_memcpy(void* dest_ptr, const void* src_ptr, size_t n, void*& fault_at)
 {
@@ -357,6 +359,29 @@ bool safe_memset(void* dest_ptr, int c, size_t n, void*& fault_at)
     return true;
 }
 
+Optional<bool> safe_atomic_compare_exchange_relaxed(volatile u32* var, u32& expected, u32 desired)
+{
+    // Returns an empty Optional if accessing var faulted
+    bool did_exchange;
+    u32 fault_at;
+    asm volatile(
+        "xor %[fault_at], %[fault_at] \n"
+        ".global safe_atomic_compare_exchange_relaxed_ins \n"
+        "safe_atomic_compare_exchange_relaxed_ins: \n"
+        "lock cmpxchgl %[desired], %[var] \n"
+        ".global safe_atomic_compare_exchange_relaxed_faulted \n"
+        "safe_atomic_compare_exchange_relaxed_faulted: \n" // handle_safe_access_fault() set edx to the fault address!
+        : "=@ccz" (did_exchange),
+          "+a" (expected),
+          [var] "+m" (*var),
+          [fault_at] "=&d" (fault_at)
+        : [desired] "r" (desired)
+        : "memory");
+    if (fault_at != 0)
+        return {};
+    return did_exchange;
+}
+
 static bool handle_safe_access_fault(RegisterState& regs, u32 fault_address)
 {
     // If we detect that the fault happened in safe_memcpy() safe_strnlen(),
@@ -371,6 +396,8 @@ static bool handle_safe_access_fault(RegisterState& regs, u32 fault_address)
         regs.eip = (FlatPtr)&safe_memset_1_faulted;
     else if (regs.eip == (FlatPtr)&safe_memset_ins_2)
         regs.eip = (FlatPtr)&safe_memset_2_faulted;
+    else if (regs.eip == (FlatPtr)&safe_atomic_compare_exchange_relaxed_ins)
+        regs.eip = (FlatPtr)&safe_atomic_compare_exchange_relaxed_faulted;
     else
         return false;
 
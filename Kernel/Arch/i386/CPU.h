@@ -29,6 +29,7 @@
 #include <AK/Atomic.h>
 #include <AK/Badge.h>
 #include <AK/Noncopyable.h>
+#include <AK/Optional.h>
 #include <AK/Vector.h>
 #include <Kernel/PhysicalAddress.h>
 #include <Kernel/VirtualAddress.h>
@@ -145,6 +146,14 @@ public:
         m_raw |= value & 0xfffff000;
     }
 
+    // With the Huge bit set, the entry maps a 2 MiB page directly instead of pointing to a page table.
+    u32 huge_page_base() const { return m_raw & 0xffe00000u; }
+    void set_huge_page_base(u32 value)
+    {
+        m_raw &= 0x8000000000001fffULL;
+        m_raw |= value & 0xffe00000;
+    }
+
     bool is_null() const { return m_raw == 0; }
     void clear() { m_raw = 0; }
 
@@ -215,6 +224,8 @@ public:
         UserSupervisor = 1 << 2,
         WriteThrough = 1 << 3,
         CacheDisabled = 1 << 4,
+        Accessed = 1 << 5,
+        Dirty = 1 << 6,
         Global = 1 << 8,
         NoExecute = 0x8000000000000000ULL,
     };
@@ -222,6 +233,12 @@ public:
     bool is_present() const { return raw() & Present; }
     void set_present(bool b) { set_bit(Present, b); }
 
+    bool is_accessed() const { return raw() & Accessed; }
+    void set_accessed(bool b) { set_bit(Accessed, b); }
+
+    bool is_dirty() const { return raw() & Dirty; }
+    void set_dirty(bool b) { set_bit(Dirty, b); }
+
     bool is_user_allowed() const { return raw() & UserSupervisor; }
     void set_user_allowed(bool b) { set_bit(UserSupervisor, b); }
 
@@ -287,6 +304,7 @@ void handle_crash(RegisterState&, const char* description, int signal, bool out_
 [[nodiscard]] bool safe_memcpy(void* dest_ptr, const void* src_ptr, size_t n, void*& fault_at);
 [[nodiscard]] ssize_t safe_strnlen(const char* str, size_t max_n, void*& fault_at);
 [[nodiscard]] bool safe_memset(void* dest_ptr, int c, size_t n, void*& fault_at);
+[[nodiscard]] Optional<bool> safe_atomic_compare_exchange_relaxed(volatile u32* var, u32& expected, u32 desired);
 
 #define LSW(x) ((u32)(x)&0xFFFF)
 #define MSW(x) (((u32)(x) >> 16) & 0xFFFF)
@@ -843,6 +861,11 @@ public:
         return *m_mm_data;
     }
 
+    ALWAYS_INLINE bool has_mm_data() const
+    {
+        return m_mm_data != nullptr;
+    }
+
     ALWAYS_INLINE Thread* idle_thread() const
     {
         return m_idle_thread;
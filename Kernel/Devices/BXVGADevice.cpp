@@ -185,9 +185,12 @@ KResultOr<Region*> BXVGADevice::mmap(Process& process, FileDescription&, Virtual
     auto vmobject = AnonymousVMObject::create_for_physical_range(m_framebuffer_address, framebuffer_size_in_bytes());
     if (!vmobject)
         return KResult(-ENOMEM);
+    // Align the mapping to the size of huge pages, so the framebuffer can be mapped with those.
+    auto range = process.allocate_range(preferred_vaddr, framebuffer_size_in_bytes(), huge_page_size);
+    if (!range.is_valid())
+        return KResult(-ENOMEM);
     auto* region = process.allocate_region_with_vmobject(
-        preferred_vaddr,
-        framebuffer_size_in_bytes(),
+        range,
         vmobject.release_nonnull(),
         0,
         "BXVGA Framebuffer",
@@ -87,10 +87,16 @@ void Device::process_next_queued_request(Badge<AsyncDeviceRequest>, const AsyncD
     {
         ScopedSpinLock lock(m_requests_lock);
         ASSERT(!m_requests.is_empty());
-        ASSERT(m_requests.first().ptr() == &completed_request);
-        m_requests.remove(m_requests.begin());
-        if (!m_requests.is_empty())
-            next_request = m_requests.first().ptr();
+        if (has_own_request_queue()) {
+            auto it = m_requests.find(const_cast<AsyncDeviceRequest*>(&completed_request));
+            ASSERT(it != m_requests.end());
+            m_requests.remove(it);
+        } else {
+            ASSERT(m_requests.first().ptr() == &completed_request);
+            m_requests.remove(m_requests.begin());
+            if (!m_requests.is_empty())
+                next_request = m_requests.first().ptr();
+        }
     }
 
     if (next_request)
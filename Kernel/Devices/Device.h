@@ -77,13 +77,17 @@ public:
             was_empty = m_requests.is_empty();
             m_requests.append(request);
         }
-        if (was_empty)
+        if (was_empty || has_own_request_queue())
             request->do_start({});
         return request;
     }
 
 protected:
     Device(unsigned major, unsigned minor);
+
+    // Devices that keep their own request queue are handed every request right away,
+    // and may complete them in any order. Everyone else gets one request at a time.
+    virtual bool has_own_request_queue() const { return false; }
     void set_uid(uid_t uid) { m_uid = uid; }
     void set_gid(gid_t gid) { m_gid = gid; }
 
@@ -0,0 +1,396 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Singleton.h>
+#include <Kernel/Arch/i386/CPU.h>
+#include <Kernel/Arch/i386/ProcessorInfo.h>
+#include <Kernel/Devices/PerformanceCounterDevice.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/Interrupts/APIC.h>
+#include <Kernel/Process.h>
+#include <Kernel/Time/TimeManagement.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <LibC/sys/ioctl_numbers.h>
+
+//#define PERFORMANCE_COUNTER_DEBUG
+
+#define MSR_IA32_PMC0 0xc1
+#define MSR_IA32_PERFEVTSEL0 0x186
+#define MSR_IA32_PERF_GLOBAL_STATUS 0x38e
+#define MSR_IA32_PERF_GLOBAL_CTRL 0x38f
+#define MSR_IA32_PERF_GLOBAL_OVF_CTRL 0x390
+
+#define PERFEVTSEL_USR (1 << 16)
+#define PERFEVTSEL_OS (1 << 17)
+#define PERFEVTSEL_INT (1 << 20)
+#define PERFEVTSEL_EN (1 << 22)
+
+namespace Kernel {
+
+static AK::Singleton<PerformanceCounterDevice> s_the;
+
+struct EventInfo {
+    u8 event;
+    u8 unit_mask;
+    // The bit in CPUID leaf 0xa's EBX that is set if the event is *not* available.
+    u8 unavailable_bit;
+    u32 default_period;
+};
+
+// These are architectural events, so they mean the same thing on every Intel CPU that has them.
+static constexpr EventInfo s_events[] = {
+    { 0x3c, 0x00, 0, 1000000 }, // PerformanceCounterEvent::Cycles: UnHalted Core Cycles
+    { 0x2e, 0x41, 4, 5000 },    // PerformanceCounterEvent::CacheMisses: LLC Misses
+    { 0xc5, 0x00, 6, 5000 },    // PerformanceCounterEvent::BranchMisses: Branch Misses Retired
+};
+
+// Anything lower than this would have us spend most of our time taking samples.
+static constexpr u32 minimum_period = 1000;
+
+void PerformanceCounterDevice::initialize()
+{
+    s_the.ensure_instance();
+}
+
+PerformanceCounterDevice& PerformanceCounterDevice::the()
+{
+    return *s_the;
+}
+
+PerformanceCounterDevice::PerformanceCounterDevice()
+    : CharacterDevice(1, 12)
+    , GenericInterruptHandler(APIC::performance_counter_interrupt_vector(), true)
+{
+    // The overflow interrupt comes from the local APIC, so there's nothing we can do without one.
+    if (APIC::the().enabled_processor_count() == 0)
+        return;
+    if (Processor::current().info().cpuid() != "GenuineIntel")
+        return;
+    if (CPUID(0).eax() < 0xa)
+        return;
+
+    CPUID cpuid(0xa);
+    u8 version = cpuid.eax() & 0xff;
+    u8 counter_count = (cpuid.eax() >> 8) & 0xff;
+    u8 event_bit_count = cpuid.eax() >> 24;
+    if (version == 0 || counter_count == 0)
+        return;
+
+    for (size_t i = 0; i < array_size(s_events); ++i) {
+        if (s_events[i].unavailable_bit < event_bit_count && !(cpuid.ebx() & (1 << s_events[i].unavailable_bit)))
+            m_available_events |= 1 << i;
+    }
+    if (!m_available_events)
+        return;
+
+    m_version = version;
+    klog() << "PerformanceCounterDevice: Architectural performance monitoring version " << version << ", " << counter_count << " counters, events 0x" << String::format("%x", m_available_events);
+}
+
+PerformanceCounterDevice::~PerformanceCounterDevice()
+{
+}
+
+template<typename Callback>
+static void on_each_processor(Callback callback)
+{
+    if (Processor::count() > 1)
+        Processor::smp_broadcast(callback, false);
+    InterruptDisabler disabler;
+    callback();
+}
+
+static void write_counter(u32 period)
+{
+    // Writes to IA32_PMC0 are sign extended from the low 32 bits, so this has it overflow after period events.
+    MSR(MSR_IA32_PMC0).set(-period, 0);
+}
+
+KResult PerformanceCounterDevice::allocate_rings()
+{
+    if (!m_rings.is_empty())
+        return KSuccess;
+
+    size_t page_count = performance_counter_ring_size / PAGE_SIZE;
+    Vector<Ring> rings;
+    rings.ensure_capacity(Processor::count());
+    for (u32 cpu = 0; cpu < Processor::count(); ++cpu) {
+        // The samples are written from the overflow interrupt, so these pages must never be swapped out.
+        // AnonymousVMObjects made from pages we hand them take care of that.
+        NonnullRefPtrVector<PhysicalPage> pages;
+        for (size_t i = 0; i < page_count; ++i) {
+            auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::Yes);
+            if (!page)
+                return KResult(-ENOMEM);
+            pages.append(page.release_nonnull());
+        }
+        auto vmobject = AnonymousVMObject::create_with_physical_pages(pages);
+        auto region = MM.allocate_kernel_region_with_vmobject(*vmobject, performance_counter_ring_size, String::format("Performance Counter Ring #%u", cpu), Region::Access::Read | Region::Access::Write);
+        if (!region)
+            return KResult(-ENOMEM);
+        rings.append({ move(vmobject), move(region) });
+    }
+    m_rings = move(rings);
+    return KSuccess;
+}
+
+KResult PerformanceCounterDevice::start(const PerformanceCounterConfiguration& configuration)
+{
+    ASSERT(m_lock.is_locked());
+    if (!m_version)
+        return KResult(-ENOTSUP);
+    auto event_index = static_cast<u32>(configuration.event);
+    if (event_index >= array_size(s_events))
+        return KResult(-EINVAL);
+    if (!(m_available_events & (1 << event_index)))
+        return KResult(-ENOTSUP);
+
+    auto& current_process = *Process::current();
+    {
+        ScopedSpinLock lock(g_processes_lock);
+        auto process = Process::from_pid(configuration.pid);
+        if (!process || process->is_dead())
+            return KResult(-ESRCH);
+        if (!current_process.is_superuser() && process->uid() != current_process.uid())
+            return KResult(-EPERM);
+    }
+    if (m_is_sampling && !current_process.is_superuser() && m_uid != current_process.uid())
+        return KResult(-EBUSY);
+
+    stop();
+
+    auto result = allocate_rings();
+    if (result.is_error())
+        return result;
+
+    for (auto& ring : m_rings) {
+        // Whoever started the last session may not be allowed to see what it sampled.
+        memset(ring.region->vaddr().as_ptr(), 0, performance_counter_ring_size);
+        auto& header = ring.header();
+        header.head = 0;
+        header.lost = 0;
+        header.capacity = performance_counter_ring_capacity;
+        header.event = configuration.event;
+        header.tail = 0;
+    }
+
+    auto& event = s_events[event_index];
+    m_pid = configuration.pid;
+    m_uid = current_process.uid();
+    m_mask_kernel_addresses = !current_process.is_superuser();
+    m_event = configuration.event;
+    m_period = max(configuration.period ? configuration.period : event.default_period, minimum_period);
+    m_event_select = event.event | (event.unit_mask << 8) | PERFEVTSEL_USR | PERFEVTSEL_INT | PERFEVTSEL_EN;
+    // Only count in the kernel for those who'd be allowed to see where.
+    if (!m_mask_kernel_addresses)
+        m_event_select |= PERFEVTSEL_OS;
+    m_is_sampling = true;
+
+#ifdef PERFORMANCE_COUNTER_DEBUG
+    dbg() << "PerformanceCounterDevice: Sampling " << m_pid.value() << " every " << m_period << " of event " << event_index;
+#endif
+
+    on_each_processor([this] {
+        MSR(MSR_IA32_PERFEVTSEL0).set(0, 0);
+        write_counter(m_period);
+        if (m_version >= 2) {
+            MSR(MSR_IA32_PERF_GLOBAL_OVF_CTRL).set(1, 0);
+            MSR(MSR_IA32_PERF_GLOBAL_CTRL).set(1, 0);
+        }
+        APIC::the().set_performance_counter_interrupt(true);
+        MSR(MSR_IA32_PERFEVTSEL0).set(m_event_select, 0);
+    });
+    return KSuccess;
+}
+
+void PerformanceCounterDevice::stop()
+{
+    ASSERT(m_lock.is_locked());
+    if (!m_is_sampling)
+        return;
+
+    on_each_processor([this] {
+        MSR(MSR_IA32_PERFEVTSEL0).set(0, 0);
+        if (m_version >= 2)
+            MSR(MSR_IA32_PERF_GLOBAL_CTRL).set(0, 0);
+        APIC::the().set_performance_counter_interrupt(false);
+    });
+    m_is_sampling = false;
+}
+
+KResultOr<NonnullRefPtr<FileDescription>> PerformanceCounterDevice::open(int options)
+{
+    auto description = CharacterDevice::open(options);
+    if (description.is_error())
+        return description;
+    LOCKER(m_lock);
+    ++m_open_count;
+    return description;
+}
+
+KResult PerformanceCounterDevice::close()
+{
+    LOCKER(m_lock);
+    ASSERT(m_open_count);
+    if (--m_open_count)
+        return KSuccess;
+
+    // Nobody is left to read the samples, so stop taking them and give the rings back.
+    // Anyone who still has one mapped keeps its pages alive through the VMObject.
+    stop();
+    m_rings.clear();
+    return KSuccess;
+}
+
+int PerformanceCounterDevice::ioctl(FileDescription&, unsigned request, FlatPtr arg)
+{
+    switch (request) {
+    case PERFCOUNTERS_IOCTL_GET_PROCESSOR_COUNT: {
+        u32 count = Processor::count();
+        if (!copy_to_user((u32*)arg, &count))
+            return -EFAULT;
+        return 0;
+    }
+    case PERFCOUNTERS_IOCTL_START: {
+        REQUIRE_NO_PROMISES;
+        PerformanceCounterConfiguration configuration;
+        if (!copy_from_user(&configuration, (const PerformanceCounterConfiguration*)arg))
+            return -EFAULT;
+        LOCKER(m_lock);
+        return start(configuration);
+    }
+    case PERFCOUNTERS_IOCTL_STOP: {
+        LOCKER(m_lock);
+        auto& current_process = *Process::current();
+        if (m_is_sampling && !current_process.is_superuser() && m_uid != current_process.uid())
+            return -EPERM;
+        stop();
+        return 0;
+    }
+    default:
+        return -EINVAL;
+    };
+}
+
+KResultOr<Region*> PerformanceCounterDevice::mmap(Process& process, FileDescription&, VirtualAddress preferred_vaddr, size_t offset, size_t size, int prot, bool shared)
+{
+    if (!shared)
+        return KResult(-ENODEV);
+    if (offset % performance_counter_ring_size || size != performance_counter_ring_size)
+        return KResult(-EINVAL);
+
+    LOCKER(m_lock);
+    // The rings only ever hold samples of whoever last started sampling.
+    if (m_rings.is_empty() || (!process.is_superuser() && process.uid() != m_uid))
+        return KResult(-EPERM);
+    size_t cpu = offset / performance_counter_ring_size;
+    if (cpu >= m_rings.size())
+        return KResult(-EINVAL);
+
+    auto* region = process.allocate_region_with_vmobject(preferred_vaddr, size, m_rings[cpu].vmobject, 0, "Performance Counter Ring", prot);
+    if (!region)
+        return KResult(-ENOMEM);
+    return region;
+}
+
+void PerformanceCounterDevice::handle_interrupt(const RegisterState& regs)
+{
+    if (!m_is_sampling)
+        return;
+
+    if (m_version >= 2) {
+        u32 status_low, status_high;
+        MSR(MSR_IA32_PERF_GLOBAL_STATUS).get(status_low, status_high);
+        if (!(status_low & 1)) {
+            APIC::the().set_performance_counter_interrupt(true);
+            return;
+        }
+    }
+
+    record_sample(regs);
+
+    write_counter(m_period);
+    if (m_version >= 2)
+        MSR(MSR_IA32_PERF_GLOBAL_OVF_CTRL).set(1, 0);
+    APIC::the().set_performance_counter_interrupt(true);
+}
+
+void PerformanceCounterDevice::record_sample(const RegisterState& regs)
+{
+    auto& processor = Processor::current();
+    auto* current_thread = processor.current_thread();
+    if (!current_thread || current_thread->process().pid() != m_pid)
+        return;
+    if (processor.id() >= m_rings.size())
+        return;
+
+    // We're the only writer of this ring (nothing else runs on this processor while we're here),
+    // so all we need to be careful about is publishing the sample after writing it.
+    auto& ring = m_rings[processor.id()];
+    auto& header = ring.header();
+    u32 head = header.head;
+    if (head - AK::atomic_load(&header.tail, AK::memory_order_acquire) >= performance_counter_ring_capacity) {
+        header.lost = header.lost + 1;
+        return;
+    }
+
+    auto& sample = ring.sample_at(head);
+    sample.event = m_event;
+    sample.tid = current_thread->tid().value();
+    sample.timestamp = TimeManagement::the().uptime_ms();
+
+    size_t stack_size = 0;
+    sample.stack[stack_size++] = regs.eip;
+    {
+        SmapDisabler disabler;
+        FlatPtr frame_pointer = regs.ebp;
+        while (frame_pointer && stack_size < performance_counter_max_stack_frame_count) {
+            FlatPtr frame[2];
+            void* fault_at;
+            if (!safe_memcpy(frame, (const void*)frame_pointer, sizeof(frame), fault_at))
+                break;
+            sample.stack[stack_size++] = frame[1];
+            frame_pointer = frame[0];
+        }
+    }
+    if (m_mask_kernel_addresses) {
+        for (size_t i = 0; i < stack_size; ++i) {
+            if (!is_user_address(VirtualAddress(sample.stack[i])))
+                sample.stack[i] = 0xdeadc0de;
+        }
+    }
+    sample.stack_size = stack_size;
+
+    AK::atomic_store(&header.head, head + 1, AK::memory_order_release);
+}
+
+bool PerformanceCounterDevice::eoi()
+{
+    APIC::the().eoi();
+    return true;
+}
+
+}
@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Vector.h>
+#include <Kernel/API/PerformanceCounters.h>
+#include <Kernel/Devices/CharacterDevice.h>
+#include <Kernel/Interrupts/GenericInterruptHandler.h>
+#include <Kernel/Lock.h>
+#include <Kernel/VM/AnonymousVMObject.h>
+
+namespace Kernel {
+
+// Samples one process on a hardware performance counter (Intel architectural performance
+// monitoring, counter 0), into one ring per processor that userland maps to read them.
+class PerformanceCounterDevice final : public CharacterDevice
+    , public GenericInterruptHandler {
+    AK_MAKE_ETERNAL
+public:
+    static void initialize();
+    static PerformanceCounterDevice& the();
+
+    PerformanceCounterDevice();
+    virtual ~PerformanceCounterDevice() override;
+
+    virtual KResultOr<NonnullRefPtr<FileDescription>> open(int options) override;
+    virtual KResult close() override;
+    virtual int ioctl(FileDescription&, unsigned request, FlatPtr arg) override;
+    virtual KResultOr<Region*> mmap(Process&, FileDescription&, VirtualAddress preferred_vaddr, size_t offset, size_t, int prot, bool shared) override;
+
+    // ^Device
+    virtual mode_t required_mode() const override { return 0666; }
+
+private:
+    // ^CharacterDevice
+    virtual const char* class_name() const override { return "PerformanceCounterDevice"; }
+    virtual bool can_read(const FileDescription&, size_t) const override { return true; }
+    virtual bool can_write(const FileDescription&, size_t) const override { return true; }
+    virtual KResultOr<size_t> read(FileDescription&, size_t, UserOrKernelBuffer&, size_t) override { return KResult(-EINVAL); }
+    virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) override { return KResult(-EINVAL); }
+
+    // ^GenericInterruptHandler
+    virtual void handle_interrupt(const RegisterState&) override;
+    virtual bool eoi() override;
+    virtual HandlerType type() const override { return HandlerType::IRQHandler; }
+    virtual const char* purpose() const override { return "Performance counter overflow"; }
+    virtual const char* controller() const override { return nullptr; }
+    virtual size_t sharing_devices_count() const override { return 0; }
+    virtual bool is_shared_handler() const override { return false; }
+    virtual bool is_sharing_with_others() const override { return false; }
+
+    struct Ring {
+        NonnullRefPtr<AnonymousVMObject> vmobject;
+        OwnPtr<Region> region;
+
+        PerformanceCounterRingHeader& header() { return *reinterpret_cast<PerformanceCounterRingHeader*>(region->vaddr().as_ptr()); }
+        PerformanceCounterSample& sample_at(u32 index) { return reinterpret_cast<PerformanceCounterSample*>(region->vaddr().offset(performance_counter_ring_samples_offset).as_ptr())[index % performance_counter_ring_capacity]; }
+    };
+
+    KResult allocate_rings();
+    KResult start(const PerformanceCounterConfiguration&);
+    void stop();
+    void record_sample(const RegisterState&);
+
+    Lock m_lock { "PerformanceCounterDevice" };
+    Vector<Ring> m_rings;
+    size_t m_open_count { 0 };
+    u8 m_version { 0 };
+    u32 m_available_events { 0 };
+
+    // Only changed while the counters are stopped on every processor.
+    bool m_is_sampling { false };
+    ProcessID m_pid { -1 };
+    uid_t m_uid { 0 };
+    bool m_mask_kernel_addresses { true };
+    PerformanceCounterEvent m_event { PerformanceCounterEvent::Cycles };
+    u32 m_event_select { 0 };
+    u32 m_period { 0 };
+};
+
+}
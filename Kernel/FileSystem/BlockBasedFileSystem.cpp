@@ -25,63 +25,131 @@
  */
 
 #include <AK/IntrusiveList.h>
+#include <AK/NonnullOwnPtrVector.h>
+#include <AK/QuickSort.h>
 #include <Kernel/FileSystem/BlockBasedFileSystem.h>
 #include <Kernel/Process.h>
+#include <Kernel/Tasks/SyncTask.h>
+#include <Kernel/VM/MemoryManager.h>
 
 //#define BBFS_DEBUG
 
 namespace Kernel {
 
+// The cache is made of segments, each holding the data for a fixed number of blocks
+// in a single kernel region. We start out with a few segments, add more while there
+// is plenty of free memory, and give clean segments back when memory gets tight.
+static constexpr size_t entries_per_segment = 64;
+static constexpr size_t min_segment_count = 16;
+
+// Both read-ahead and write-back coalescing go through a bounce buffer of this many blocks.
+static constexpr size_t max_blocks_per_io = 32;
+static constexpr size_t min_read_ahead_blocks = 4;
+
 struct CacheEntry {
     IntrusiveListNode list_node;
     u32 block_index { 0 };
     u8* data { nullptr };
+    bool has_block { false };
     bool has_data { false };
+    bool is_dirty { false };
+};
+
+struct CacheSegment {
+    explicit CacheSegment(NonnullOwnPtr<KBuffer>&& data)
+        : data(move(data))
+    {
+    }
+
+    NonnullOwnPtr<KBuffer> data;
+    CacheEntry entries[entries_per_segment];
 };
 
+static bool cache_may_grow()
+{
+    // Leave at least a quarter of physical memory free for everyone else.
+    auto total_pages = MM.user_physical_pages();
+    return total_pages - MM.user_physical_pages_used() > total_pages / 4;
+}
+
+static bool cache_should_shrink()
+{
+    auto total_pages = MM.user_physical_pages();
+    return total_pages - MM.user_physical_pages_used() < total_pages / 8;
+}
+
 class DiskCache {
 public:
     explicit DiskCache(BlockBasedFS& fs)
         : m_fs(fs)
-        , m_cached_block_data(KBuffer::create_with_size(m_entry_count * m_fs.block_size()))
-        , m_entries(KBuffer::create_with_size(m_entry_count * sizeof(CacheEntry)))
+        , m_io_buffer(KBuffer::create_with_size(max_blocks_per_io * m_fs.block_size()))
     {
-        for (size_t i = 0; i < m_entry_count; ++i) {
-            entries()[i].data = m_cached_block_data.data() + i * m_fs.block_size();
-            m_clean_list.append(entries()[i]);
+        while (m_segments.size() < min_segment_count) {
+            if (!try_grow())
+                break;
         }
+        ASSERT(!m_segments.is_empty());
     }
 
     ~DiskCache() { }
 
-    bool is_dirty() const { return m_dirty; }
-    void set_dirty(bool b) { m_dirty = b; }
+    bool is_dirty() const { return m_dirty_count; }
+    size_t entry_count() const { return m_segments.size() * entries_per_segment; }
+
+    // Kick off write-back once half the cache is dirty, so we don't end up
+    // having to flush synchronously when looking for a clean entry.
+    bool needs_write_back() const { return m_dirty_count >= entry_count() / 2; }
 
     void mark_all_clean()
     {
-        while (auto* entry = m_dirty_list.first())
+        while (auto* entry = m_dirty_list.first()) {
+            entry->is_dirty = false;
             m_clean_list.prepend(*entry);
-        m_dirty = false;
+        }
+        m_dirty_count = 0;
     }
 
     void mark_dirty(CacheEntry& entry)
     {
+        if (!entry.is_dirty) {
+            entry.is_dirty = true;
+            ++m_dirty_count;
+        }
         m_dirty_list.prepend(entry);
-        m_dirty = true;
     }
 
     void mark_clean(CacheEntry& entry)
     {
+        if (entry.is_dirty) {
+            entry.is_dirty = false;
+            --m_dirty_count;
+        }
         m_clean_list.prepend(entry);
     }
 
+    CacheEntry* find(u32 block_index) const
+    {
+        auto it = m_hash.find(block_index);
+        if (it == m_hash.end())
+            return nullptr;
+        auto& entry = const_cast<CacheEntry&>(*it->value);
+        ASSERT(entry.block_index == block_index);
+        // Keep the clean list in LRU order.
+        if (!entry.is_dirty)
+            m_clean_list.prepend(entry);
+        return &entry;
+    }
+
     CacheEntry& get(u32 block_index) const
     {
-        if (auto it = m_hash.find(block_index); it != m_hash.end()) {
-            auto& entry = const_cast<CacheEntry&>(*it->value);
-            ASSERT(entry.block_index == block_index);
-            return entry;
-        }
+        if (auto* entry = find(block_index))
+            return *entry;
+
+        // Unused entries sit at the end of the clean list. If there are none left,
+        // grow the cache rather than evicting something, if memory allows.
+        auto* last_clean = m_clean_list.last();
+        if (!last_clean || last_clean->has_block)
+            const_cast<DiskCache&>(*this).try_grow();
 
         if (m_clean_list.is_empty()) {
             // Not a single clean entry! Flush writes and try again.
@@ -95,17 +163,84 @@ public:
         auto& new_entry = *m_clean_list.last();
         m_clean_list.prepend(new_entry);
 
-        m_hash.remove(new_entry.block_index);
+        if (new_entry.has_block)
+            m_hash.remove(new_entry.block_index);
         m_hash.set(block_index, &new_entry);
 
         new_entry.block_index = block_index;
+        new_entry.has_block = true;
         new_entry.has_data = false;
 
         return new_entry;
     }
 
-    const CacheEntry* entries() const { return (const CacheEntry*)m_entries.data(); }
-    CacheEntry* entries() { return (CacheEntry*)m_entries.data(); }
+    void invalidate(u32 block_index)
+    {
+        auto it = m_hash.find(block_index);
+        if (it == m_hash.end())
+            return;
+        auto& entry = *it->value;
+        // Someone wrote to it through the cache in the meantime, so that copy is the latest one.
+        if (entry.is_dirty)
+            return;
+        m_hash.remove(it);
+        entry.has_block = false;
+        entry.has_data = false;
+        // Unused entries sit at the end of the clean list.
+        m_clean_list.append(entry);
+    }
+
+    bool try_grow()
+    {
+        if (m_segments.size() >= min_segment_count && !cache_may_grow())
+            return false;
+        auto data = KBuffer::try_create_with_size(entries_per_segment * m_fs.block_size(), Region::Access::Read | Region::Access::Write, "DiskCache");
+        if (!data)
+            return false;
+        auto segment = make<CacheSegment>(data.release_nonnull());
+        for (size_t i = 0; i < entries_per_segment; ++i) {
+            segment->entries[i].data = segment->data->data() + i * m_fs.block_size();
+            m_clean_list.append(segment->entries[i]);
+        }
+        m_segments.append(move(segment));
+#ifdef BBFS_DEBUG
+        dbg() << "DiskCache: Grew to " << entry_count() << " entries";
+#endif
+        return true;
+    }
+
+    // Make sure we can bring in this many blocks without evicting any of them again.
+    void reserve_clean_entries(size_t count)
+    {
+        while (entry_count() - m_dirty_count < count) {
+            if (!try_grow()) {
+                m_fs.flush_writes_impl();
+                return;
+            }
+        }
+    }
+
+    void shrink_if_needed()
+    {
+        while (m_segments.size() > min_segment_count && cache_should_shrink()) {
+            auto& segment = m_segments.last();
+            for (auto& entry : segment.entries) {
+                if (entry.is_dirty)
+                    return;
+            }
+            for (auto& entry : segment.entries) {
+                if (entry.has_block)
+                    m_hash.remove(entry.block_index);
+                m_clean_list.remove(entry);
+            }
+            m_segments.take_last();
+#ifdef BBFS_DEBUG
+            dbg() << "DiskCache: Shrunk to " << entry_count() << " entries";
+#endif
+        }
+    }
+
+    u8* io_buffer() const { return const_cast<u8*>(m_io_buffer.data()); }
 
     template<typename Callback>
     void for_each_clean_entry(Callback callback)
@@ -123,15 +258,29 @@ public:
 
 private:
     BlockBasedFS& m_fs;
-    size_t m_entry_count { 10000 };
+    NonnullOwnPtrVector<CacheSegment> m_segments;
     mutable HashMap<u32, CacheEntry*> m_hash;
     mutable IntrusiveList<CacheEntry, &CacheEntry::list_node> m_clean_list;
     mutable IntrusiveList<CacheEntry, &CacheEntry::list_node> m_dirty_list;
-    KBuffer m_cached_block_data;
-    KBuffer m_entries;
-    bool m_dirty { false };
+    KBuffer m_io_buffer;
+    size_t m_dirty_count { 0 };
 };
 
+// Returns how many blocks past the requested ones we should read.
+// The window opens up when reads pick up where the previous one ended,
+// and doubles for as long as that keeps happening.
+static size_t read_ahead_for(BlockBasedFS::ReadAheadState& state, u32 block_index, size_t count)
+{
+    if (block_index + 1 == state.next_sequential_block && count == 1)
+        return state.window; // Another partial read of the same block.
+    if (block_index == state.next_sequential_block)
+        state.window = clamp(state.window * 2, min_read_ahead_blocks, max_blocks_per_io);
+    else
+        state.window = 0;
+    state.next_sequential_block = block_index + count;
+    return state.window;
+}
+
 BlockBasedFS::BlockBasedFS(FileDescription& file_description)
     : FileBackedFS(file_description)
 {
@@ -158,19 +307,28 @@ int BlockBasedFS::write_block(unsigned index, const UserOrKernelBuffer& data, si
         if (nwritten.is_error())
             return -EIO; // TODO: Return error code as-is, could be -EFAULT!
         ASSERT(nwritten.value() == count);
+        // Don't let the cache hand out what was there before.
+        LOCKER(m_lock);
+        cache().invalidate(index);
         return 0;
     }
 
-    auto& entry = cache().get(index);
+    LOCKER(m_lock);
     if (count < block_size()) {
         // Fill the cache first.
-        read_block(index, nullptr, block_size());
+        int err = read_block(index, nullptr, block_size());
+        if (err < 0)
+            return err;
     }
+    auto& entry = cache().get(index);
     if (!data.read(entry.data + offset, count))
         return -EFAULT;
 
     cache().mark_dirty(entry);
     entry.has_data = true;
+
+    if (cache().needs_write_back())
+        SyncTask::wake();
     return 0;
 }
 
@@ -225,7 +383,7 @@ int BlockBasedFS::write_blocks(unsigned index, unsigned count, const UserOrKerne
     return 0;
 }
 
-int BlockBasedFS::read_block(unsigned index, UserOrKernelBuffer* buffer, size_t count, size_t offset, bool allow_cache) const
+int BlockBasedFS::read_block(unsigned index, UserOrKernelBuffer* buffer, size_t count, size_t offset, bool allow_cache, ReadAheadState* read_ahead_state) const
 {
     ASSERT(m_logical_block_size);
     ASSERT(offset + count <= block_size());
@@ -244,60 +402,130 @@ int BlockBasedFS::read_block(unsigned index, UserOrKernelBuffer* buffer, size_t
         return 0;
     }
 
+    LOCKER(m_lock);
+    int err = fill_cache(index, 1, read_ahead_state);
+    if (err < 0)
+        return err;
     auto& entry = cache().get(index);
-    if (!entry.has_data) {
-        u32 base_offset = static_cast<u32>(index) * static_cast<u32>(block_size());
-        file_description().seek(base_offset, SEEK_SET);
-        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-        auto nread = file_description().read(entry_data_buffer, block_size());
-        if (nread.is_error())
-            return -EIO;
-        ASSERT(nread.value() == block_size());
-        entry.has_data = true;
-    }
+    ASSERT(entry.has_data);
     if (buffer && !buffer->write(entry.data + offset, count))
         return -EFAULT;
     return 0;
 }
 
-int BlockBasedFS::read_blocks(unsigned index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache) const
+int BlockBasedFS::read_blocks(unsigned index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache, ReadAheadState* read_ahead_state) const
 {
     ASSERT(m_logical_block_size);
     if (!count)
         return false;
     if (count == 1)
-        return read_block(index, &buffer, block_size(), 0, allow_cache);
+        return read_block(index, &buffer, block_size(), 0, allow_cache, read_ahead_state);
+
+    if (!allow_cache) {
+        for (unsigned i = 0; i < count; ++i)
+            const_cast<BlockBasedFS*>(this)->flush_specific_block_if_needed(index + i);
+        u32 base_offset = static_cast<u32>(index) * static_cast<u32>(block_size());
+        file_description().seek(base_offset, SEEK_SET);
+        auto nread = file_description().read(buffer, count * block_size());
+        if (nread.is_error())
+            return -EIO;
+        ASSERT(nread.value() == count * block_size());
+        return 0;
+    }
+
+    LOCKER(m_lock);
     auto out = buffer;
-    for (unsigned i = 0; i < count; ++i) {
-        auto err = read_block(index + i, &out, block_size(), 0, allow_cache);
+    while (count) {
+        // Don't ask for more than the cache can hold at once.
+        unsigned chunk_count = min(count, (unsigned)max_blocks_per_io);
+        int err = fill_cache(index, chunk_count, read_ahead_state);
         if (err < 0)
             return err;
-        out = out.offset(block_size());
+        for (unsigned i = 0; i < chunk_count; ++i) {
+            auto& entry = cache().get(index + i);
+            ASSERT(entry.has_data);
+            if (!out.write(entry.data, block_size()))
+                return -EFAULT;
+            out = out.offset(block_size());
+        }
+        index += chunk_count;
+        count -= chunk_count;
     }
 
     return 0;
 }
 
+int BlockBasedFS::fill_cache(unsigned index, unsigned count, ReadAheadState* read_ahead_state) const
+{
+    ASSERT(m_lock.is_locked());
+    auto& cache = this->cache();
+    unsigned total_count = count;
+    if (read_ahead_state)
+        total_count += read_ahead_for(*read_ahead_state, index, count);
+    cache.reserve_clean_entries(total_count);
+
+    auto is_cached = [&](unsigned block_index) {
+        auto* entry = cache.find(block_index);
+        return entry && entry->has_data;
+    };
+
+    unsigned i = 0;
+    while (i < count) {
+        if (is_cached(index + i)) {
+            ++i;
+            continue;
+        }
+
+        // Read the run of uncached blocks starting here (and any read-ahead) in one go.
+        unsigned run_length = 1;
+        while (run_length < max_blocks_per_io && i + run_length < total_count && !is_cached(index + i + run_length))
+            ++run_length;
+
+        u32 base_offset = static_cast<u32>(index + i) * static_cast<u32>(block_size());
+        file_description().seek(base_offset, SEEK_SET);
+        auto io_buffer = UserOrKernelBuffer::for_kernel_buffer(cache.io_buffer());
+        auto nread = file_description().read(io_buffer, run_length * block_size());
+        if (nread.is_error())
+            return -EIO;
+
+        // Read-ahead may run past the end of the device, but the blocks we were asked for must be there.
+        unsigned blocks_read = nread.value() / block_size();
+        ASSERT(blocks_read >= min(run_length, count - i));
+
+#ifdef BBFS_DEBUG
+        klog() << "BlockBasedFileSystem::fill_cache " << (index + i) << " x" << blocks_read;
+#endif
+        for (unsigned j = 0; j < blocks_read; ++j) {
+            auto& entry = cache.get(index + i + j);
+            ASSERT(!entry.is_dirty);
+            memcpy(entry.data, cache.io_buffer() + j * block_size(), block_size());
+            entry.has_data = true;
+        }
+        i += run_length;
+    }
+    return 0;
+}
+
+void BlockBasedFS::uncache_block(unsigned index) const
+{
+    LOCKER(m_lock);
+    cache().invalidate(index);
+}
+
 void BlockBasedFS::flush_specific_block_if_needed(unsigned index)
 {
     LOCKER(m_lock);
     if (!cache().is_dirty())
         return;
-    Vector<CacheEntry*, 32> cleaned_entries;
-    cache().for_each_dirty_entry([&](CacheEntry& entry) {
-        if (entry.block_index != index) {
-            u32 base_offset = static_cast<u32>(entry.block_index) * static_cast<u32>(block_size());
-            file_description().seek(base_offset, SEEK_SET);
-            // FIXME: Should this error path be surfaced somehow?
-            auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-            [[maybe_unused]] auto rc = file_description().write(entry_data_buffer, block_size());
-            cleaned_entries.append(&entry);
-        }
-    });
-    // NOTE: We make a separate pass to mark entries clean since marking them clean
-    //       moves them out of the dirty list which would disturb the iteration above.
-    for (auto* entry : cleaned_entries)
-        cache().mark_clean(*entry);
+    auto* entry = cache().find(index);
+    if (!entry || !entry->is_dirty)
+        return;
+    u32 base_offset = static_cast<u32>(entry->block_index) * static_cast<u32>(block_size());
+    file_description().seek(base_offset, SEEK_SET);
+    // FIXME: Should this error path be surfaced somehow?
+    auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry->data);
+    [[maybe_unused]] auto rc = file_description().write(entry_data_buffer, block_size());
+    cache().mark_clean(*entry);
 }
 
 void BlockBasedFS::flush_writes_impl()
@@ -305,17 +533,39 @@ void BlockBasedFS::flush_writes_impl()
     LOCKER(m_lock);
     if (!cache().is_dirty())
         return;
-    u32 count = 0;
+
+    Vector<CacheEntry*> dirty_entries;
     cache().for_each_dirty_entry([&](CacheEntry& entry) {
-        u32 base_offset = static_cast<u32>(entry.block_index) * static_cast<u32>(block_size());
+        dirty_entries.append(&entry);
+    });
+    quick_sort(dirty_entries, [](auto* a, auto* b) { return a->block_index < b->block_index; });
+
+    // Merge runs of adjacent dirty blocks into a single write.
+    u32 write_count = 0;
+    for (size_t i = 0; i < dirty_entries.size();) {
+        auto& first_entry = *dirty_entries[i];
+        size_t run_length = 1;
+        while (run_length < max_blocks_per_io && i + run_length < dirty_entries.size() && dirty_entries[i + run_length]->block_index == first_entry.block_index + run_length)
+            ++run_length;
+
+        auto data = UserOrKernelBuffer::for_kernel_buffer(first_entry.data);
+        if (run_length > 1) {
+            for (size_t j = 0; j < run_length; ++j)
+                memcpy(cache().io_buffer() + j * block_size(), dirty_entries[i + j]->data, block_size());
+            data = UserOrKernelBuffer::for_kernel_buffer(cache().io_buffer());
+        }
+
+        u32 base_offset = static_cast<u32>(first_entry.block_index) * static_cast<u32>(block_size());
         file_description().seek(base_offset, SEEK_SET);
         // FIXME: Should this error path be surfaced somehow?
-        auto entry_data_buffer = UserOrKernelBuffer::for_kernel_buffer(entry.data);
-        [[maybe_unused]] auto rc = file_description().write(entry_data_buffer, block_size());
-        ++count;
-    });
+        [[maybe_unused]] auto rc = file_description().write(data, run_length * block_size());
+        ++write_count;
+        i += run_length;
+    }
     cache().mark_all_clean();
-    dbg() << class_name() << ": Flushed " << count << " blocks to disk";
+    dbg() << class_name() << ": Flushed " << dirty_entries.size() << " blocks to disk in " << write_count << " writes";
+
+    cache().shrink_if_needed();
 }
 
 void BlockBasedFS::flush_writes()
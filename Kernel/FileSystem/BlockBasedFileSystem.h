@@ -39,11 +39,18 @@ public:
     virtual void flush_writes() override;
     void flush_writes_impl();
 
+    // Sequential access is detected per reader (e.g. per inode), so that concurrent
+    // readers and unrelated metadata reads don't keep resetting each other's window.
+    struct ReadAheadState {
+        u32 next_sequential_block { 0 };
+        size_t window { 0 };
+    };
+
 protected:
     explicit BlockBasedFS(FileDescription&);
 
-    int read_block(unsigned index, UserOrKernelBuffer* buffer, size_t count, size_t offset = 0, bool allow_cache = true) const;
-    int read_blocks(unsigned index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache = true) const;
+    int read_block(unsigned index, UserOrKernelBuffer* buffer, size_t count, size_t offset = 0, bool allow_cache = true, ReadAheadState* = nullptr) const;
+    int read_blocks(unsigned index, unsigned count, UserOrKernelBuffer& buffer, bool allow_cache = true, ReadAheadState* = nullptr) const;
 
     bool raw_read(unsigned index, UserOrKernelBuffer& buffer);
     bool raw_write(unsigned index, const UserOrKernelBuffer& buffer);
@@ -54,10 +61,14 @@ protected:
     int write_block(unsigned index, const UserOrKernelBuffer& buffer, size_t count, size_t offset = 0, bool allow_cache = true);
     int write_blocks(unsigned index, unsigned count, const UserOrKernelBuffer&, bool allow_cache = true);
 
+    // Drops our copy of a block if it's clean, for when someone else is caching the data already.
+    void uncache_block(unsigned index) const;
+
     size_t m_logical_block_size { 512 };
 
 private:
     DiskCache& cache() const;
+    int fill_cache(unsigned index, unsigned count, ReadAheadState*) const;
     void flush_specific_block_if_needed(unsigned index);
 
     mutable OwnPtr<DiskCache> m_cache;
@@ -0,0 +1,137 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Singleton.h>
+#include <Kernel/FileSystem/DirectoryEntryCache.h>
+#include <Kernel/FileSystem/Inode.h>
+
+//#define DENTRY_CACHE_DEBUG
+
+namespace Kernel {
+
+static AK::Singleton<DirectoryEntryCache> s_the;
+
+DirectoryEntryCache& DirectoryEntryCache::the()
+{
+    return *s_the;
+}
+
+DirectoryEntryCache::DirectoryEntryCache()
+{
+    for (auto& entry : m_entries)
+        m_lru_list.append(entry);
+}
+
+static unsigned hash_for(InodeIdentifier directory, const StringView& name)
+{
+    return pair_int_hash(pair_int_hash(directory.fsid(), directory.index()), name.hash());
+}
+
+bool DirectoryEntryCache::lookup(const Inode& directory, const StringView& name, RefPtr<Inode>& child)
+{
+    LOCKER(m_lock);
+    auto identifier = directory.identifier();
+    auto it = m_hash.find(hash_for(identifier, name), [&](auto& entry) { return entry.key.directory == identifier && entry.key.name == name; });
+    if (it == m_hash.end())
+        return false;
+    auto& entry = *it->value;
+    m_lru_list.prepend(entry);
+    child = entry.child;
+    return true;
+}
+
+void DirectoryEntryCache::add(const Inode& directory, const StringView& name, Inode* child, u32 generation)
+{
+    // Declared before the locker so the evicted inodes are released after unlocking.
+    Vector<RefPtr<Inode>> evicted_children;
+    LOCKER(m_lock);
+    if (generation != m_generation)
+        return;
+
+    DirectoryEntryCacheKey key { directory.identifier(), name };
+    if (m_hash.contains(key))
+        return;
+
+    // Unused entries sit at the end of the list, followed by the least recently used ones.
+    auto& entry = *m_lru_list.last();
+    if (entry.in_use)
+        evict(entry, evicted_children);
+
+#ifdef DENTRY_CACHE_DEBUG
+    dbg() << "DirectoryEntryCache: " << key.directory << "/" << key.name << " -> " << (child ? child->identifier().to_string() : "(none)");
+#endif
+    entry.key = move(key);
+    entry.child = child;
+    entry.in_use = true;
+    m_hash.set(entry.key, &entry);
+    m_lru_list.prepend(entry);
+}
+
+void DirectoryEntryCache::evict(Entry& entry, Vector<RefPtr<Inode>>& evicted_children)
+{
+    ASSERT(m_lock.is_locked());
+    ASSERT(entry.in_use);
+    m_hash.remove(entry.key);
+    if (entry.child)
+        evicted_children.append(move(entry.child));
+    entry.key = {};
+    entry.in_use = false;
+    m_lru_list.append(entry);
+}
+
+void DirectoryEntryCache::invalidate(InodeIdentifier directory, const StringView& name)
+{
+    Vector<RefPtr<Inode>> evicted_children;
+    LOCKER(m_lock);
+    ++m_generation;
+    auto it = m_hash.find(hash_for(directory, name), [&](auto& entry) { return entry.key.directory == directory && entry.key.name == name; });
+    if (it != m_hash.end())
+        evict(*it->value, evicted_children);
+}
+
+void DirectoryEntryCache::invalidate_directory(InodeIdentifier directory)
+{
+    Vector<RefPtr<Inode>> evicted_children;
+    LOCKER(m_lock);
+    ++m_generation;
+    for (auto& entry : m_entries) {
+        if (entry.in_use && entry.key.directory == directory)
+            evict(entry, evicted_children);
+    }
+}
+
+void DirectoryEntryCache::invalidate_file_system(u32 fsid)
+{
+    Vector<RefPtr<Inode>> evicted_children;
+    LOCKER(m_lock);
+    ++m_generation;
+    for (auto& entry : m_entries) {
+        if (entry.in_use && entry.key.directory.fsid() == fsid)
+            evict(entry, evicted_children);
+    }
+}
+
+}
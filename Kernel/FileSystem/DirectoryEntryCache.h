@@ -0,0 +1,106 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/IntrusiveList.h>
+#include <AK/RefPtr.h>
+#include <AK/String.h>
+#include <AK/StringView.h>
+#include <AK/Vector.h>
+#include <Kernel/FileSystem/InodeIdentifier.h>
+#include <Kernel/Lock.h>
+
+namespace Kernel {
+
+class Inode;
+
+struct DirectoryEntryCacheKey {
+    InodeIdentifier directory;
+    String name;
+
+    bool operator==(const DirectoryEntryCacheKey& other) const { return directory == other.directory && name == other.name; }
+};
+
+}
+
+namespace AK {
+
+template<>
+struct Traits<Kernel::DirectoryEntryCacheKey> : public GenericTraits<Kernel::DirectoryEntryCacheKey> {
+    static unsigned hash(const Kernel::DirectoryEntryCacheKey& key) { return pair_int_hash(pair_int_hash(key.directory.fsid(), key.directory.index()), key.name.hash()); }
+};
+
+}
+
+namespace Kernel {
+
+// Remembers which inode a name in a directory refers to, or that there is no such name,
+// so that path resolution doesn't have to go to the file system for every component.
+// File systems opt in with FS::supports_directory_entry_cache(), and their directories
+// have to call Inode::did_add_child() and Inode::did_remove_child() for every change.
+class DirectoryEntryCache {
+public:
+    static DirectoryEntryCache& the();
+
+    DirectoryEntryCache();
+
+    // Changes whenever an entry is invalidated. Take it before asking the file system,
+    // and pass it to add(), so we don't cache an answer that was already stale.
+    u32 generation() const { return m_generation; }
+
+    // Returns false if we don't know the answer. Otherwise, child is the inode that name
+    // refers to, or null if the name doesn't exist.
+    bool lookup(const Inode& directory, const StringView& name, RefPtr<Inode>& child);
+    void add(const Inode& directory, const StringView& name, Inode* child, u32 generation);
+
+    void invalidate(InodeIdentifier directory, const StringView& name);
+    void invalidate_directory(InodeIdentifier directory);
+    void invalidate_file_system(u32 fsid);
+
+private:
+    struct Entry {
+        IntrusiveListNode list_node;
+        DirectoryEntryCacheKey key;
+        RefPtr<Inode> child;
+        bool in_use { false };
+    };
+
+    static constexpr size_t entry_count = 1024;
+
+    // Evicting an entry may drop the last reference to an inode, which must not happen
+    // while we're holding m_lock since file systems call us with their own locks held.
+    void evict(Entry&, Vector<RefPtr<Inode>>& evicted_children);
+
+    Lock m_lock { "DirectoryEntryCache" };
+    u32 m_generation { 0 };
+    Entry m_entries[entry_count];
+    HashMap<DirectoryEntryCacheKey, Entry*> m_hash;
+    IntrusiveList<Entry, &Entry::list_node> m_lru_list;
+};
+
+}
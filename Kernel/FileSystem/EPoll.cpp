@@ -0,0 +1,281 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/FileSystem/EPoll.h>
+#include <Kernel/FileSystem/FileDescription.h>
+
+namespace Kernel {
+
+EPollInterest::EPollInterest(EPoll& epoll, int fd, FileDescription& description, const epoll_event& event)
+    : m_epoll(epoll)
+    , m_fd(fd)
+    , m_file(description.file())
+    , m_description(&description)
+    , m_event(event)
+{
+}
+
+void EPollInterest::notify(Badge<FileBlockCondition>)
+{
+    m_epoll.enqueue_ready(*this);
+}
+
+void EPollInterest::description_closed(Badge<FileBlockCondition>, FileDescription& description)
+{
+    {
+        ScopedSpinLock lock(m_description_lock);
+        if (m_description != &description)
+            return;
+        m_description = nullptr;
+    }
+    // Have the next wait() drop this interest, even if it's disarmed.
+    {
+        ScopedSpinLock lock(m_epoll.m_lock);
+        m_description_closed = true;
+    }
+    m_epoll.enqueue_ready(*this);
+}
+
+bool EPollInterest::refers_to(const FileDescription& description) const
+{
+    ScopedSpinLock lock(m_description_lock);
+    return m_description == &description;
+}
+
+NonnullRefPtr<EPoll> EPoll::create()
+{
+    return adopt(*new EPoll);
+}
+
+EPoll::EPoll()
+{
+}
+
+EPoll::~EPoll()
+{
+    for (auto& it : m_interests)
+        detach(it.value);
+}
+
+void EPoll::enqueue_ready(EPollInterest& interest)
+{
+    {
+        ScopedSpinLock lock(m_lock);
+        if (!interest.m_registered || interest.m_in_ready_list)
+            return;
+        if (!interest.m_armed && !interest.m_description_closed)
+            return;
+        interest.m_in_ready_list = true;
+        m_ready_list.append(interest);
+    }
+    m_wait_queue.wake_all();
+    evaluate_block_conditions();
+}
+
+void EPoll::detach(EPollInterest& interest)
+{
+    {
+        ScopedSpinLock lock(m_lock);
+        interest.m_registered = false;
+    }
+    interest.m_file->block_condition().remove_epoll_interest({}, interest);
+}
+
+KResult EPoll::add(int fd, FileDescription& description, const epoll_event& event)
+{
+    // Watching another EPoll could create lock cycles between the two.
+    if (description.file().is_epoll())
+        return KResult(-EINVAL);
+
+    LOCKER(m_interests_lock);
+    auto it = m_interests.find(fd);
+    if (it != m_interests.end()) {
+        if (it->value->refers_to(description))
+            return KResult(-EEXIST);
+        // The fd was closed and reused without being removed from us first.
+        detach(it->value);
+        m_interests.remove(it);
+    }
+
+    auto interest = adopt(*new EPollInterest(*this, fd, description, event));
+    m_interests.set(fd, interest);
+    interest->m_file->block_condition().add_epoll_interest({}, interest);
+
+    // The file may already be ready, so have the next wait() take a look.
+    enqueue_ready(interest);
+    return KSuccess;
+}
+
+KResult EPoll::modify(int fd, FileDescription& description, const epoll_event& event)
+{
+    LOCKER(m_interests_lock);
+    auto it = m_interests.find(fd);
+    if (it == m_interests.end() || !it->value->refers_to(description))
+        return KResult(-ENOENT);
+
+    auto& interest = *it->value;
+    {
+        ScopedSpinLock lock(m_lock);
+        interest.m_event = event;
+        interest.m_armed = true;
+    }
+    enqueue_ready(interest);
+    return KSuccess;
+}
+
+KResult EPoll::remove(int fd, FileDescription& description)
+{
+    LOCKER(m_interests_lock);
+    auto it = m_interests.find(fd);
+    if (it == m_interests.end() || !it->value->refers_to(description))
+        return KResult(-ENOENT);
+
+    detach(it->value);
+    m_interests.remove(it);
+    return KSuccess;
+}
+
+void EPoll::collect_ready_events(Vector<epoll_event>& events, size_t max_events)
+{
+    NonnullRefPtrVector<EPollInterest> candidates;
+    {
+        ScopedSpinLock lock(m_lock);
+        candidates = move(m_ready_list);
+        for (auto& interest : candidates)
+            interest.m_in_ready_list = false;
+    }
+
+    NonnullRefPtrVector<EPollInterest> still_ready;
+    NonnullRefPtrVector<EPollInterest> dead;
+    for (auto& interest : candidates) {
+        if (events.size() >= max_events) {
+            still_ready.append(interest);
+            continue;
+        }
+
+        epoll_event event;
+        {
+            ScopedSpinLock lock(m_lock);
+            if (!interest.m_registered)
+                continue;
+            if (interest.m_description_closed) {
+                dead.append(interest);
+                continue;
+            }
+            if (!interest.m_armed)
+                continue;
+            event = interest.m_event;
+        }
+
+        u32 revents = 0;
+        {
+            // Holding the lock keeps the description from going away under us.
+            ScopedSpinLock lock(interest.m_description_lock);
+            auto* description = interest.m_description;
+            if (!description) {
+                dead.append(interest);
+                continue;
+            }
+
+            u32 block_flags = (u32)Thread::FileBlocker::BlockFlags::None;
+            if (event.events & EPOLLIN)
+                block_flags |= (u32)Thread::FileBlocker::BlockFlags::Read;
+            if (event.events & EPOLLOUT)
+                block_flags |= (u32)Thread::FileBlocker::BlockFlags::Write;
+            auto unblock_flags = (u32)description->should_unblock((Thread::FileBlocker::BlockFlags)block_flags);
+
+            if (unblock_flags & (u32)Thread::FileBlocker::BlockFlags::Read)
+                revents |= EPOLLIN;
+            if (unblock_flags & (u32)Thread::FileBlocker::BlockFlags::Write)
+                revents |= EPOLLOUT;
+            // EPOLLHUP and EPOLLERR are always reported, whether they were asked for or not.
+            if (description->has_hung_up())
+                revents |= EPOLLHUP;
+            if (description->has_pending_error())
+                revents |= EPOLLERR;
+        }
+        if (!revents)
+            continue;
+
+        events.append({ revents, event.data });
+
+        if (event.events & EPOLLONESHOT) {
+            ScopedSpinLock lock(m_lock);
+            interest.m_armed = false;
+        } else if (!(event.events & EPOLLET)) {
+            // Level-triggered interests are reported again until the file stops being ready.
+            // Edge-triggered ones wait for the file to notify us of the next change.
+            still_ready.append(interest);
+        }
+    }
+
+    if (!still_ready.is_empty()) {
+        ScopedSpinLock lock(m_lock);
+        for (auto& interest : still_ready) {
+            if (interest.m_in_ready_list)
+                continue;
+            interest.m_in_ready_list = true;
+            m_ready_list.append(interest);
+        }
+    }
+
+    if (!dead.is_empty()) {
+        // The watched descriptions have been closed, so drop them like Linux does.
+        LOCKER(m_interests_lock);
+        for (auto& interest : dead) {
+            auto it = m_interests.find(interest.m_fd);
+            if (it == m_interests.end() || it->value.ptr() != &interest)
+                continue;
+            detach(interest);
+            m_interests.remove(it);
+        }
+    }
+}
+
+KResult EPoll::wait(Vector<epoll_event>& events, size_t max_events, const Thread::BlockTimeout& timeout)
+{
+    for (;;) {
+        collect_ready_events(events, max_events);
+        if (!events.is_empty() || !timeout.should_block())
+            return KSuccess;
+
+        auto result = m_wait_queue.wait_on(timeout, "EPoll");
+        if (result.was_interrupted())
+            return KResult(-EINTR);
+        if (result == Thread::BlockResult::InterruptedByTimeout) {
+            collect_ready_events(events, max_events);
+            return KSuccess;
+        }
+    }
+}
+
+bool EPoll::can_read(const FileDescription&, size_t) const
+{
+    ScopedSpinLock lock(m_lock);
+    return !m_ready_list.is_empty();
+}
+
+}
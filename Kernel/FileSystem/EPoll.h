@@ -0,0 +1,110 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Badge.h>
+#include <AK/HashMap.h>
+#include <AK/NonnullRefPtrVector.h>
+#include <Kernel/FileSystem/File.h>
+#include <Kernel/Lock.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/WaitQueue.h>
+
+namespace Kernel {
+
+// One file description watched by an EPoll. It sits in the FileBlockCondition
+// of the watched file, and queues itself on the EPoll's ready list whenever
+// that file's state changes.
+class EPollInterest : public RefCounted<EPollInterest> {
+    friend class EPoll;
+
+public:
+    void notify(Badge<FileBlockCondition>);
+    void description_closed(Badge<FileBlockCondition>, FileDescription&);
+
+private:
+    EPollInterest(EPoll&, int fd, FileDescription&, const epoll_event&);
+
+    bool refers_to(const FileDescription&) const;
+
+    // The EPoll detaches all of its interests from their files before it goes away.
+    EPoll& m_epoll;
+    int m_fd { -1 };
+    NonnullRefPtr<File> m_file;
+
+    // The description clears this from its destructor, before it starts tearing
+    // itself down. Only look at the description while holding the lock.
+    mutable SpinLock<u8> m_description_lock;
+    FileDescription* m_description { nullptr };
+
+    // Everything below is protected by EPoll::m_lock.
+    epoll_event m_event;
+    bool m_registered { true };
+    bool m_armed { true };
+    bool m_description_closed { false };
+    bool m_in_ready_list { false };
+};
+
+class EPoll final : public File {
+public:
+    static NonnullRefPtr<EPoll> create();
+    virtual ~EPoll() override;
+
+    KResult add(int fd, FileDescription&, const epoll_event&);
+    KResult modify(int fd, FileDescription&, const epoll_event&);
+    KResult remove(int fd, FileDescription&);
+
+    // Collects up to max_events ready events, blocking until there is at least one
+    // or the timeout expires.
+    KResult wait(Vector<epoll_event>&, size_t max_events, const Thread::BlockTimeout&);
+
+    virtual bool can_read(const FileDescription&, size_t) const override;
+    virtual bool can_write(const FileDescription&, size_t) const override { return false; }
+    virtual KResultOr<size_t> read(FileDescription&, size_t, UserOrKernelBuffer&, size_t) override { return KResult(-EINVAL); }
+    virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) override { return KResult(-EINVAL); }
+    virtual String absolute_path(const FileDescription&) const override { return "epoll"; }
+    virtual const char* class_name() const override { return "EPoll"; }
+    virtual bool is_epoll() const override { return true; }
+
+private:
+    friend class EPollInterest;
+
+    EPoll();
+
+    void enqueue_ready(EPollInterest&);
+    void collect_ready_events(Vector<epoll_event>&, size_t max_events);
+    void detach(EPollInterest&);
+
+    Lock m_interests_lock { "EPoll" };
+    HashMap<int, NonnullRefPtr<EPollInterest>> m_interests;
+
+    mutable SpinLock<u8> m_lock;
+    NonnullRefPtrVector<EPollInterest> m_ready_list;
+    WaitQueue m_wait_queue;
+};
+
+}
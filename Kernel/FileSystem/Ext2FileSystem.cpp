@@ -27,14 +27,17 @@
 #include <AK/Bitmap.h>
 #include <AK/HashMap.h>
 #include <AK/MemoryStream.h>
+#include <AK/NonnullRefPtrVector.h>
 #include <AK/StdLibExtras.h>
 #include <AK/StringView.h>
 #include <Kernel/Devices/BlockDevice.h>
+#include <Kernel/FileSystem/DirectoryEntryCache.h>
 #include <Kernel/FileSystem/Ext2FileSystem.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/FileSystem/ext2_fs.h>
 #include <Kernel/Process.h>
 #include <Kernel/UnixTypes.h>
+#include <Kernel/VM/SharedInodeVMObject.h>
 #include <LibC/errno_numbers.h>
 
 //#define EXT2_DEBUG
@@ -247,7 +250,7 @@ bool Ext2FS::write_block_list_for_inode(InodeIndex inode_index, ext2_inode& e2in
 
     Vector<BlockIndex> new_meta_blocks;
     if (new_shape.meta_blocks > old_shape.meta_blocks) {
-        new_meta_blocks = allocate_blocks(group_index_from_inode(inode_index), new_shape.meta_blocks - old_shape.meta_blocks);
+        new_meta_blocks = allocate_blocks(group_index_from_inode(inode_index), new_shape.meta_blocks - old_shape.meta_blocks, inode_index);
     }
 
     e2inode.i_blocks = (blocks.size() + new_shape.meta_blocks) * (block_size() / 512);
@@ -532,6 +535,7 @@ void Ext2FS::free_inode(Ext2FSInode& inode)
 #endif
 
     auto block_list = block_list_for_inode(inode.m_raw_inode, true);
+    release_block_reservation(inode.index());
 
     for (auto block_index : block_list) {
         ASSERT(block_index <= super_block().s_blocks_count);
@@ -548,6 +552,9 @@ void Ext2FS::free_inode(Ext2FSInode& inode)
     set_inode_allocation_state(inode.index(), false);
 
     if (inode.is_directory()) {
+        // The inode number may be reused for another directory.
+        DirectoryEntryCache::the().invalidate_directory(inode.identifier());
+
         auto& bgd = const_cast<ext2_group_desc&>(group_descriptor(group_index_from_inode(inode.index())));
         --bgd.bg_used_dirs_count;
         dbg() << "Ext2FS: Decremented bg_used_dirs_count to " << bgd.bg_used_dirs_count;
@@ -566,6 +573,21 @@ void Ext2FS::flush_block_group_descriptor_table()
 
 void Ext2FS::flush_writes()
 {
+    // Pages written to through shared mappings go out with everything else. Writing them back takes the inode locks,
+    // which come before ours, so we only hold on to our lock long enough to find the inodes.
+    NonnullRefPtrVector<Ext2FSInode> inodes_with_dirty_pages;
+    {
+        LOCKER(m_lock);
+        for (auto& it : m_inode_cache) {
+            if (!it.value)
+                continue;
+            if (it.value->m_page_cache.has_dirty_pages() || it.value->shared_vmobject())
+                inodes_with_dirty_pages.append(*it.value);
+        }
+    }
+    for (auto& inode : inodes_with_dirty_pages)
+        inode.write_back_dirty_pages();
+
     LOCKER(m_lock);
     if (m_super_block_dirty) {
         flush_super_block();
@@ -608,6 +630,7 @@ void Ext2FS::flush_writes()
 
 Ext2FSInode::Ext2FSInode(Ext2FS& fs, unsigned index)
     : Inode(fs, index)
+    , m_page_cache(*this)
 {
 }
 
@@ -706,6 +729,171 @@ ssize_t Ext2FSInode::read_bytes(off_t offset, ssize_t count, UserOrKernelBuffer&
         return nread;
     }
 
+    if (description && description->is_direct())
+        return read_bytes_from_disk(offset, count, buffer, false);
+
+    if ((size_t)offset >= size())
+        return 0;
+
+    // We can't touch the (possibly user) buffer while a page is quickmapped, so bounce through
+    // the heap. A page-sized buffer is too much for the kernel stack.
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+
+    ssize_t nread = 0;
+    size_t remaining_count = min((off_t)count, (off_t)size() - offset);
+    while (remaining_count) {
+        size_t page_index = (offset + nread) / PAGE_SIZE;
+        size_t offset_into_page = (offset + nread) % PAGE_SIZE;
+        size_t num_bytes_to_copy = min(PAGE_SIZE - offset_into_page, remaining_count);
+
+        auto page_or_error = page_cache_page_impl(page_index);
+        if (page_or_error.is_error())
+            return nread ? nread : page_or_error.error().error();
+        auto page = page_or_error.release_value();
+
+        PageCache::copy_from_page(*page, offset_into_page, page_buffer.data(), num_bytes_to_copy);
+        if (!buffer.write(page_buffer.data(), nread, num_bytes_to_copy))
+            return -EFAULT;
+
+        remaining_count -= num_bytes_to_copy;
+        nread += num_bytes_to_copy;
+    }
+    return nread;
+}
+
+KResultOr<NonnullRefPtr<PhysicalPage>> Ext2FSInode::page_cache_page(size_t page_index)
+{
+    Locker inode_locker(m_lock);
+    return page_cache_page_impl(page_index);
+}
+
+KResultOr<NonnullRefPtr<PhysicalPage>> Ext2FSInode::page_cache_page_impl(size_t page_index) const
+{
+    ASSERT(m_lock.is_locked());
+    if (auto page = m_page_cache.find(page_index))
+        return page.release_nonnull();
+
+    if (PageCache::memory_is_low())
+        PageCache::evict_unused_pages_everywhere();
+
+    // Read the requested page, and if this looks like sequential access, the following ones as well.
+    size_t last_page_index = page_index + m_page_cache.read_ahead_for(page_index);
+    size_t page_count = ceil_div(size(), PAGE_SIZE);
+    RefPtr<PhysicalPage> requested_page;
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+    for (size_t i = page_index; i <= last_page_index; ++i) {
+        bool is_read_ahead = i != page_index;
+        if (is_read_ahead && (i >= page_count || m_page_cache.find(i)))
+            break;
+
+        ssize_t nread = 0;
+        if (i < page_count) {
+            // Read through the block cache, so we see any writes that haven't made it to disk yet
+            // without forcing them out, and get its read-ahead to turn this into larger transfers.
+            auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer.data());
+            nread = read_bytes_from_disk(i * PAGE_SIZE, PAGE_SIZE, buffer, true);
+            if (nread < 0) {
+                if (is_read_ahead)
+                    break;
+                return KResult(nread);
+            }
+        }
+        // If we read less than a page, zero out the rest to avoid leaking uninitialized data.
+        memset(page_buffer.data() + nread, 0, PAGE_SIZE - nread);
+
+        auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
+        if (!page) {
+            if (is_read_ahead)
+                break;
+            return KResult(-ENOMEM);
+        }
+        PageCache::copy_to_page(*page, page_buffer.data());
+        m_page_cache.add(i, *page);
+        // The page cache has its own copy now, so the block cache doesn't need to hold on to one as well.
+        if (i < page_count)
+            uncache_blocks_of_page(i);
+        if (!is_read_ahead)
+            requested_page = move(page);
+    }
+    ASSERT(requested_page);
+    return requested_page.release_nonnull();
+}
+
+void Ext2FSInode::uncache_blocks_of_page(size_t page_index) const
+{
+    Locker fs_locker(fs().m_lock);
+    const size_t block_size = fs().block_size();
+    size_t first_block_logical_index = page_index * PAGE_SIZE / block_size;
+    size_t last_block_logical_index = ((page_index + 1) * PAGE_SIZE - 1) / block_size;
+    for (size_t bi = first_block_logical_index; bi <= last_block_logical_index && bi < m_block_list.size(); ++bi)
+        fs().uncache_block(m_block_list[bi]);
+}
+
+void Ext2FSInode::write_back_dirty_pages()
+{
+    Locker inode_locker(m_lock);
+    if (auto shared_vmobject = this->shared_vmobject())
+        shared_vmobject->collect_dirty_pages(m_page_cache);
+    if (!m_page_cache.has_dirty_pages())
+        return;
+
+    auto page_buffer = ByteBuffer::create_uninitialized(PAGE_SIZE);
+    for (auto page_index : m_page_cache.take_dirty_pages()) {
+        auto page = m_page_cache.find(page_index);
+        if (!page)
+            continue;
+        auto result = write_back_page(page_index, *page, page_buffer);
+        if (result.is_error()) {
+            dbg() << "Ext2FS: Writing back page " << page_index << " of inode " << identifier() << " failed: " << result.error();
+            // Keep it around, maybe it works out next time.
+            m_page_cache.set_dirty(page_index, *page);
+        }
+    }
+}
+
+KResult Ext2FSInode::write_back_page(size_t page_index, PhysicalPage& page, ByteBuffer& page_buffer)
+{
+    ASSERT(m_lock.is_locked());
+    size_t offset = page_index * PAGE_SIZE;
+    // Whatever is past the end of the file was cut off by a truncate in the meantime.
+    if (offset >= size())
+        return KSuccess;
+    size_t count = min((size_t)PAGE_SIZE, size() - offset);
+    PageCache::copy_from_page(page, 0, page_buffer.data(), count);
+
+    // The blocks are already there, so unlike write_bytes() we don't have to touch the inode itself.
+    // Neither the page cache nor any mappings have to be invalidated, since they hold this very data.
+    Locker fs_locker(fs().m_lock);
+    if (m_block_list.is_empty())
+        m_block_list = fs().block_list_for_inode(m_raw_inode);
+    const size_t block_size = fs().block_size();
+    size_t nwritten = 0;
+    while (nwritten < count) {
+        size_t bi = (offset + nwritten) / block_size;
+        if (bi >= m_block_list.size())
+            return KResult(-EIO);
+        size_t offset_into_block = (offset + nwritten) % block_size;
+        size_t num_bytes_to_copy = min(block_size - offset_into_block, count - nwritten);
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer.data() + nwritten);
+        int err = fs().write_block(m_block_list[bi], buffer, num_bytes_to_copy, offset_into_block);
+        if (err < 0)
+            return KResult(err);
+        nwritten += num_bytes_to_copy;
+    }
+    return KSuccess;
+}
+
+KResultOr<Vector<u32>> Ext2FSInode::block_map()
+{
+    Locker inode_locker(m_lock);
+    Locker fs_locker(fs().m_lock);
+    if (m_block_list.is_empty())
+        m_block_list = fs().block_list_for_inode(m_raw_inode);
+    return m_block_list;
+}
+
+ssize_t Ext2FSInode::read_bytes_from_disk(off_t offset, ssize_t count, UserOrKernelBuffer& buffer, bool allow_cache) const
+{
     Locker fs_locker(fs().m_lock);
 
     if (m_block_list.is_empty())
@@ -716,9 +904,8 @@ ssize_t Ext2FSInode::read_bytes(off_t offset, ssize_t count, UserOrKernelBuffer&
         return -EIO;
     }
 
-    bool allow_cache = !description || !description->is_direct();
-
     const int block_size = fs().block_size();
+    auto* read_ahead_state = allow_cache ? &m_read_ahead_state : nullptr;
 
     size_t first_block_logical_index = offset / block_size;
     size_t last_block_logical_index = (offset + count) / block_size;
@@ -740,7 +927,28 @@ ssize_t Ext2FSInode::read_bytes(off_t offset, ssize_t count, UserOrKernelBuffer&
         size_t offset_into_block = (bi == first_block_logical_index) ? offset_into_first_block : 0;
         size_t num_bytes_to_copy = min(block_size - offset_into_block, remaining_count);
         auto buffer_offset = buffer.offset(nread);
-        int err = fs().read_block(block_index, &buffer_offset, num_bytes_to_copy, offset_into_block, allow_cache);
+
+        if (offset_into_block == 0 && num_bytes_to_copy == (size_t)block_size) {
+            // Read as many whole, physically contiguous blocks as we can in one go.
+            size_t run_length = 1;
+            while (bi + run_length <= last_block_logical_index
+                && remaining_count >= (run_length + 1) * block_size
+                && m_block_list[bi + run_length] == block_index + run_length)
+                ++run_length;
+            if (run_length > 1) {
+                int err = fs().read_blocks(block_index, run_length, buffer_offset, allow_cache, read_ahead_state);
+                if (err < 0) {
+                    klog() << "ext2fs: read_bytes: read_blocks(" << block_index << ", " << run_length << ") failed (lbi: " << bi << ")";
+                    return err;
+                }
+                remaining_count -= run_length * block_size;
+                nread += run_length * block_size;
+                bi += run_length - 1;
+                continue;
+            }
+        }
+
+        int err = fs().read_block(block_index, &buffer_offset, num_bytes_to_copy, offset_into_block, allow_cache, read_ahead_state);
         if (err < 0) {
             klog() << "ext2fs: read_bytes: read_block(" << block_index << ") failed (lbi: " << bi << ")";
             return err;
@@ -780,7 +988,8 @@ KResult Ext2FSInode::resize(u64 new_size)
         block_list = fs().block_list_for_inode(m_raw_inode);
 
     if (blocks_needed_after > blocks_needed_before) {
-        auto new_blocks = fs().allocate_blocks(fs().group_index_from_inode(index()), blocks_needed_after - blocks_needed_before);
+        auto goal = block_list.is_empty() ? 0 : block_list.last() + 1;
+        auto new_blocks = fs().allocate_blocks(fs().group_index_from_inode(index()), blocks_needed_after - blocks_needed_before, index(), goal);
         block_list.append(move(new_blocks));
     } else if (blocks_needed_after < blocks_needed_before) {
 #ifdef EXT2_DEBUG
@@ -794,6 +1003,7 @@ KResult Ext2FSInode::resize(u64 new_size)
             if (block_index)
                 fs().set_block_allocation_state(block_index, false);
         }
+        fs().release_block_reservation(index());
     }
 
     int err = fs().write_block_list_for_inode(index(), m_raw_inode, block_list);
@@ -804,6 +1014,7 @@ KResult Ext2FSInode::resize(u64 new_size)
     set_metadata_dirty(true);
 
     m_block_list = move(block_list);
+    m_page_cache.invalidate_from(min(old_size, new_size));
     return KSuccess;
 }
 
@@ -813,6 +1024,8 @@ ssize_t Ext2FSInode::write_bytes(off_t offset, ssize_t count, const UserOrKernel
     ASSERT(count >= 0);
 
     Locker inode_locker(m_lock);
+    // Anything written through a shared mapping has to go out first, since we're about to invalidate those pages.
+    write_back_dirty_pages();
     Locker fs_locker(fs().m_lock);
 
     auto result = prepare_to_write_data();
@@ -886,6 +1099,8 @@ ssize_t Ext2FSInode::write_bytes(off_t offset, ssize_t count, const UserOrKernel
     dbg() << "Ext2FS: After write, i_size=" << m_raw_inode.i_size << ", i_blocks=" << m_raw_inode.i_blocks << " (" << m_block_list.size() << " blocks in list)";
 #endif
 
+    m_page_cache.invalidate(offset, nwritten);
+
     if (old_size != new_size)
         inode_size_changed(old_size, new_size);
     inode_contents_changed(offset, count, data);
@@ -1048,7 +1263,7 @@ KResult Ext2FSInode::add_child(Inode& child, const StringView& name, mode_t mode
     if (success)
         m_lookup_cache.set(name, child.index());
 
-    did_add_child(child.identifier());
+    did_add_child(child.identifier(), name);
     return KSuccess;
 }
 
@@ -1087,14 +1302,10 @@ KResult Ext2FSInode::remove_child(const StringView& name)
     }
 
     m_lookup_cache.remove(name);
+    did_remove_child(child_id, name);
 
     auto child_inode = fs().get_inode(child_id);
-    result = child_inode->decrement_link_count();
-    if (result.is_error())
-        return result;
-
-    did_remove_child(child_id);
-    return KSuccess;
+    return child_inode->decrement_link_count();
 }
 
 unsigned Ext2FS::inodes_per_block() const
@@ -1127,64 +1338,213 @@ bool Ext2FS::write_ext2_inode(unsigned inode, const ext2_inode& e2inode)
     return write_block(block_index, buffer, inode_size(), offset) >= 0;
 }
 
-Vector<Ext2FS::BlockIndex> Ext2FS::allocate_blocks(GroupIndex preferred_group_index, size_t count)
+static constexpr size_t min_block_reservation = 64;
+static constexpr size_t max_block_reservation = 1024;
+static constexpr size_t max_block_reservation_count = 64;
+
+unsigned Ext2FS::blocks_in_group(GroupIndex group_index) const
+{
+    return min(blocks_per_group(), super_block().s_blocks_count - first_block_in_group(group_index));
+}
+
+Ext2FS::BlockIndex Ext2FS::first_block_in_group(GroupIndex group_index) const
+{
+    return (group_index - 1) * blocks_per_group() + first_block_index();
+}
+
+Optional<size_t> Ext2FS::find_free_run_in_group(GroupIndex group_index, size_t start_bit, size_t min_length, size_t max_length, InodeIndex owner, bool honor_reservations, size_t& found_length, bool& was_clipped)
+{
+    auto& cached_bitmap = get_bitmap_block(group_descriptor(group_index).bg_block_bitmap);
+    auto block_bitmap = cached_bitmap.bitmap(blocks_in_group(group_index));
+    BlockIndex first_block = first_block_in_group(group_index);
+
+    size_t bit = start_bit;
+    while (bit < block_bitmap.size()) {
+        auto length = block_bitmap.find_next_range_of_unset_bits(bit, min_length, max_length);
+        if (!length.has_value())
+            return {};
+        found_length = length.value();
+        if (!honor_reservations)
+            return bit;
+
+        // Stay out of other inodes' reservations, picking the earliest one we run into.
+        BlockIndex run_start = first_block + bit;
+        const BlockReservation* conflict = nullptr;
+        for (auto& reservation : m_block_reservations) {
+            if (reservation.inode == owner)
+                continue;
+            if (reservation.first_block >= run_start + found_length || reservation.first_block + reservation.block_count <= run_start)
+                continue;
+            if (!conflict || reservation.first_block < conflict->first_block)
+                conflict = &reservation;
+        }
+        if (!conflict)
+            return bit;
+
+        was_clipped = true;
+        if (conflict->first_block > run_start && conflict->first_block - run_start >= min_length) {
+            found_length = conflict->first_block - run_start;
+            return bit;
+        }
+        bit = conflict->first_block + conflict->block_count - first_block;
+    }
+    return {};
+}
+
+void Ext2FS::allocate_block_run(GroupIndex group_index, size_t first_bit, size_t length)
+{
+    auto& bgd = group_descriptor(group_index);
+    auto& cached_bitmap = get_bitmap_block(bgd.bg_block_bitmap);
+    auto block_bitmap = cached_bitmap.bitmap(blocks_in_group(group_index));
+    ASSERT(block_bitmap.count_in_range(first_bit, length, true) == 0);
+
+#ifdef EXT2_DEBUG
+    dbg() << "Ext2FS: allocating " << length << " blocks at " << (first_block_in_group(group_index) + first_bit) << " [" << group_index << "]";
+#endif
+    block_bitmap.set_range(first_bit, length, true);
+    cached_bitmap.dirty = true;
+
+    m_super_block.s_free_blocks_count -= length;
+    m_super_block_dirty = true;
+
+    auto& mutable_bgd = const_cast<ext2_group_desc&>(bgd);
+    ASSERT(mutable_bgd.bg_free_blocks_count >= length);
+    mutable_bgd.bg_free_blocks_count -= length;
+    m_block_group_descriptors_dirty = true;
+}
+
+void Ext2FS::release_block_reservation(InodeIndex inode)
+{
+    LOCKER(m_lock);
+    m_block_reservations.remove_first_matching([&](auto& reservation) { return reservation.inode == inode; });
+}
+
+Vector<Ext2FS::BlockIndex> Ext2FS::allocate_blocks(GroupIndex preferred_group_index, size_t count, InodeIndex owner, BlockIndex goal)
 {
     LOCKER(m_lock);
 #ifdef EXT2_DEBUG
-    dbg() << "Ext2FS: allocate_blocks(preferred group: " << preferred_group_index << ", count: " << count << ")";
+    dbg() << "Ext2FS: allocate_blocks(preferred group: " << preferred_group_index << ", count: " << count << ", owner: " << owner << ", goal: " << goal << ")";
 #endif
     if (count == 0)
         return {};
 
     Vector<BlockIndex> blocks;
-#ifdef EXT2_DEBUG
-    dbg() << "Ext2FS: allocate_blocks:";
-#endif
     blocks.ensure_capacity(count);
 
-    GroupIndex group_index = preferred_group_index;
+    if (m_largest_free_block_run.is_empty()) {
+        for (GroupIndex group_index = 1; group_index <= m_block_group_count; ++group_index)
+            m_largest_free_block_run.append(blocks_in_group(group_index));
+    }
 
-    if (!group_descriptor(preferred_group_index).bg_free_blocks_count) {
-        group_index = 1;
+    // If the owner has a reservation, that's where it wanted to continue.
+    Optional<size_t> reservation_index;
+    for (size_t i = 0; i < m_block_reservations.size(); ++i) {
+        if (owner && m_block_reservations[i].inode == owner) {
+            reservation_index = i;
+            goal = m_block_reservations[i].first_block;
+            break;
+        }
     }
 
-    while (blocks.size() < count) {
+    auto append_run = [&](GroupIndex group_index, size_t first_bit, size_t length) {
+        allocate_block_run(group_index, first_bit, length);
+        BlockIndex first_block = first_block_in_group(group_index) + first_bit;
+        for (size_t i = 0; i < length; ++i)
+            blocks.unchecked_append(first_block + i);
+        goal = first_block + length;
+    };
 
-        bool found_a_group = false;
-        if (group_descriptor(group_index).bg_free_blocks_count) {
-            found_a_group = true;
-        } else {
-            if (group_index == preferred_group_index)
-                group_index = 1;
-            for (; group_index <= m_block_group_count; ++group_index) {
-                if (group_descriptor(group_index).bg_free_blocks_count) {
-                    found_a_group = true;
-                    break;
+    while (blocks.size() < count) {
+        size_t remaining = count - blocks.size();
+
+        // First, try to continue right where the last allocation left off.
+        if (goal >= first_block_index() && goal < super_block().s_blocks_count) {
+            GroupIndex group_index = group_index_from_block_index(goal);
+            size_t bit = goal - first_block_in_group(group_index);
+            auto& cached_bitmap = get_bitmap_block(group_descriptor(group_index).bg_block_bitmap);
+            if (!cached_bitmap.bitmap(blocks_in_group(group_index)).get(bit)) {
+                size_t length = 0;
+                bool was_clipped = false;
+                auto first_bit = find_free_run_in_group(group_index, bit, 1, remaining, owner, true, length, was_clipped);
+                if (first_bit.has_value() && first_bit.value() == bit) {
+                    append_run(group_index, bit, length);
+                    continue;
                 }
             }
         }
 
-        ASSERT(found_a_group);
-        auto& bgd = group_descriptor(group_index);
-        auto& cached_bitmap = get_bitmap_block(bgd.bg_block_bitmap);
+        GroupIndex start_group = goal >= first_block_index() && goal < super_block().s_blocks_count ? group_index_from_block_index(goal) : preferred_group_index;
+        if (!start_group || start_group > m_block_group_count)
+            start_group = 1;
+
+        // Otherwise, look for a run that fits everything, starting at the goal and going
+        // through the groups in order.
+        bool found = false;
+        for (GroupIndex i = 0; i < m_block_group_count && !found; ++i) {
+            GroupIndex group_index = (start_group - 1 + i) % m_block_group_count + 1;
+            if (group_descriptor(group_index).bg_free_blocks_count < remaining || m_largest_free_block_run[group_index - 1] < remaining)
+                continue;
+            size_t start_bit = 0;
+            if (i == 0 && goal >= first_block_in_group(group_index))
+                start_bit = goal - first_block_in_group(group_index);
+            bool was_clipped = false;
+            size_t length = 0;
+            auto first_bit = find_free_run_in_group(group_index, start_bit, remaining, remaining, owner, true, length, was_clipped);
+            if (!first_bit.has_value() && start_bit)
+                first_bit = find_free_run_in_group(group_index, 0, remaining, remaining, owner, true, length, was_clipped);
+            if (first_bit.has_value()) {
+                append_run(group_index, first_bit.value(), length);
+                found = true;
+            } else if (!was_clipped) {
+                m_largest_free_block_run[group_index - 1] = remaining - 1;
+            }
+        }
+        if (found)
+            continue;
 
-        int blocks_in_group = min(blocks_per_group(), super_block().s_blocks_count);
-        auto block_bitmap = Bitmap::wrap(cached_bitmap.buffer.data(), blocks_in_group);
+        // No group has a run that large, so take the longest one we can find. If every
+        // free block is reserved by someone else, ignore the reservations.
+        for (int pass = 0; pass < 2 && !found; ++pass) {
+            bool honor_reservations = pass == 0;
+            for (GroupIndex i = 0; i < m_block_group_count && !found; ++i) {
+                GroupIndex group_index = (start_group - 1 + i) % m_block_group_count + 1;
+                if (!group_descriptor(group_index).bg_free_blocks_count)
+                    continue;
+                size_t longest_start = 0;
+                size_t longest_length = 0;
+                size_t bit = 0;
+                bool was_clipped = false;
+                for (;;) {
+                    size_t length = 0;
+                    auto first_bit = find_free_run_in_group(group_index, bit, longest_length + 1, remaining, owner, honor_reservations, length, was_clipped);
+                    if (!first_bit.has_value())
+                        break;
+                    longest_start = first_bit.value();
+                    longest_length = length;
+                    bit = longest_start + longest_length;
+                }
+                if (!was_clipped && longest_length < remaining)
+                    m_largest_free_block_run[group_index - 1] = longest_length;
+                if (longest_length) {
+                    append_run(group_index, longest_start, longest_length);
+                    found = true;
+                }
+            }
+        }
+        ASSERT(found);
+    }
 
-        BlockIndex first_block_in_group = (group_index - 1) * blocks_per_group() + first_block_index();
-        size_t free_region_size = 0;
-        auto first_unset_bit_index = block_bitmap.find_longest_range_of_unset_bits(count - blocks.size(), free_region_size);
-        ASSERT(first_unset_bit_index.has_value());
-#ifdef EXT2_DEBUG
-        dbg() << "Ext2FS: allocating free region of size: " << free_region_size << "[" << group_index << "]";
-#endif
-        for (size_t i = 0; i < free_region_size; ++i) {
-            BlockIndex block_index = (first_unset_bit_index.value() + i) + first_block_in_group;
-            set_block_allocation_state(block_index, true);
-            blocks.unchecked_append(block_index);
-#ifdef EXT2_DEBUG
-            dbg() << "  allocated > " << block_index;
-#endif
+    if (owner) {
+        // Reserve some room to grow into next time, proportional to how much was asked for.
+        size_t window = clamp(count * 2, min_block_reservation, max_block_reservation);
+        if (reservation_index.has_value()) {
+            auto& reservation = m_block_reservations[reservation_index.value()];
+            reservation.first_block = goal;
+            reservation.block_count = window;
+        } else {
+            if (m_block_reservations.size() >= max_block_reservation_count)
+                m_block_reservations.take_first();
+            m_block_reservations.append({ owner, goal, window });
         }
     }
 
@@ -1267,7 +1627,7 @@ Ext2FS::GroupIndex Ext2FS::group_index_from_block_index(BlockIndex block_index)
 {
     if (!block_index)
         return 0;
-    return (block_index - 1) / blocks_per_group() + 1;
+    return (block_index - first_block_index()) / blocks_per_group() + 1;
 }
 
 unsigned Ext2FS::group_index_from_inode(unsigned inode) const
@@ -1398,10 +1758,14 @@ bool Ext2FS::set_block_allocation_state(BlockIndex block_index, bool new_state)
 
     // Update BGD
     auto& mutable_bgd = const_cast<ext2_group_desc&>(bgd);
-    if (new_state)
+    if (new_state) {
         --mutable_bgd.bg_free_blocks_count;
-    else
+    } else {
         ++mutable_bgd.bg_free_blocks_count;
+        // Freeing a block can join runs together, so we no longer know the longest one.
+        if (!m_largest_free_block_run.is_empty())
+            m_largest_free_block_run[group_index - 1] = blocks_in_group(group_index);
+    }
 #ifdef EXT2_DEBUG
     dbg() << "Ext2FS: group " << group_index << " free block count " << bgd.bg_free_blocks_count << " -> " << (bgd.bg_free_blocks_count - 1);
 #endif
@@ -1486,7 +1850,7 @@ KResultOr<NonnullRefPtr<Inode>> Ext2FS::create_inode(InodeIdentifier parent_id,
         return KResult(-ENOSPC);
     }
 
-    auto blocks = allocate_blocks(group_index_from_inode(inode_id), needed_blocks);
+    auto blocks = allocate_blocks(group_index_from_inode(inode_id), needed_blocks, inode_id);
     ASSERT(blocks.size() == needed_blocks);
 
     // Looks like we're good, time to update the inode bitmap and group+global inode counters.
@@ -1631,6 +1995,7 @@ void Ext2FS::uncache_inode(InodeIndex index)
 {
     LOCKER(m_lock);
     m_inode_cache.remove(index);
+    release_block_reservation(index);
 }
 
 KResultOr<size_t> Ext2FSInode::directory_entry_count() const
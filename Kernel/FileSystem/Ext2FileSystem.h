@@ -33,6 +33,7 @@
 #include <Kernel/FileSystem/ext2_fs.h>
 #include <Kernel/KBuffer.h>
 #include <Kernel/UnixTypes.h>
+#include <Kernel/VM/PageCache.h>
 
 struct ext2_group_desc;
 struct ext2_inode;
@@ -76,10 +77,19 @@ private:
     virtual KResult chmod(mode_t) override;
     virtual KResult chown(uid_t, gid_t) override;
     virtual KResult truncate(u64) override;
+    virtual bool has_page_cache() const override { return true; }
+    virtual KResultOr<NonnullRefPtr<PhysicalPage>> page_cache_page(size_t page_index) override;
+    virtual PageCache* page_cache() override { return &m_page_cache; }
+    virtual KResultOr<Vector<u32>> block_map() override;
 
     bool write_directory(const Vector<Ext2FSDirectoryEntry>&);
     void populate_lookup_cache() const;
     KResult resize(u64);
+    ssize_t read_bytes_from_disk(off_t, ssize_t, UserOrKernelBuffer& buffer, bool allow_cache) const;
+    KResultOr<NonnullRefPtr<PhysicalPage>> page_cache_page_impl(size_t page_index) const;
+    void uncache_blocks_of_page(size_t page_index) const;
+    void write_back_dirty_pages();
+    KResult write_back_page(size_t page_index, PhysicalPage&, ByteBuffer& page_buffer);
 
     static u8 file_type_for_directory_entry(const ext2_dir_entry_2&);
 
@@ -89,6 +99,8 @@ private:
 
     mutable Vector<unsigned> m_block_list;
     mutable HashMap<String, unsigned> m_lookup_cache;
+    mutable PageCache m_page_cache;
+    mutable BlockBasedFS::ReadAheadState m_read_ahead_state;
     ext2_inode m_raw_inode;
 };
 
@@ -109,6 +121,7 @@ public:
     virtual KResult prepare_to_unmount() const override;
 
     virtual bool supports_watchers() const override { return true; }
+    virtual bool supports_directory_entry_cache() const override { return true; }
 
     virtual u8 internal_file_type_to_directory_entry_type(const DirectoryEntryView& entry) const override;
 
@@ -142,7 +155,7 @@ private:
 
     BlockIndex first_block_index() const;
     InodeIndex find_a_free_inode(GroupIndex preferred_group, off_t expected_size);
-    Vector<BlockIndex> allocate_blocks(GroupIndex preferred_group_index, size_t count);
+    Vector<BlockIndex> allocate_blocks(GroupIndex preferred_group_index, size_t count, InodeIndex owner = 0, BlockIndex goal = 0);
     GroupIndex group_index_from_inode(InodeIndex) const;
     GroupIndex group_index_from_block_index(BlockIndex) const;
 
@@ -154,6 +167,12 @@ private:
     bool set_inode_allocation_state(InodeIndex, bool);
     bool set_block_allocation_state(BlockIndex, bool);
 
+    unsigned blocks_in_group(GroupIndex) const;
+    BlockIndex first_block_in_group(GroupIndex) const;
+    Optional<size_t> find_free_run_in_group(GroupIndex, size_t start_bit, size_t min_length, size_t max_length, InodeIndex owner, bool honor_reservations, size_t& found_length, bool& was_clipped);
+    void allocate_block_run(GroupIndex, size_t first_bit, size_t length);
+    void release_block_reservation(InodeIndex);
+
     void uncache_inode(InodeIndex);
     void free_inode(Ext2FSInode&);
 
@@ -192,6 +211,20 @@ private:
     CachedBitmap& get_bitmap_block(BlockIndex);
 
     Vector<OwnPtr<CachedBitmap>> m_cached_bitmaps;
+
+    // A window of free blocks that we'd like an inode to grow into next. Reservations
+    // only live in memory and aren't marked in the bitmaps; other inodes just try to
+    // stay out of them so that files written at the same time don't interleave.
+    struct BlockReservation {
+        InodeIndex inode { 0 };
+        BlockIndex first_block { 0 };
+        size_t block_count { 0 };
+    };
+    Vector<BlockReservation> m_block_reservations;
+
+    // An upper bound on the longest run of free blocks in each group, so we can skip
+    // groups that can't fit a run without scanning their bitmaps.
+    Vector<size_t> m_largest_free_block_run;
 };
 
 inline Ext2FS& Ext2FSInode::fs()
@@ -154,6 +154,17 @@ bool FIFO::can_write(const FileDescription&, size_t) const
     return m_buffer.space_for_writing() || !m_readers;
 }
 
+bool FIFO::has_hung_up(const FileDescription& description) const
+{
+    return description.fifo_direction() == Direction::Reader && !m_writers;
+}
+
+bool FIFO::has_pending_error(const FileDescription& description) const
+{
+    // Writing would fail with EPIPE.
+    return description.fifo_direction() == Direction::Writer && !m_readers;
+}
+
 KResultOr<size_t> FIFO::read(FileDescription&, size_t, UserOrKernelBuffer& buffer, size_t size)
 {
     if (!m_writers && m_buffer.is_empty())
@@ -170,6 +181,27 @@ KResultOr<size_t> FIFO::write(FileDescription&, size_t, const UserOrKernelBuffer
     return m_buffer.write(buffer, size);
 }
 
+KResultOr<size_t> FIFO::read_with(size_t size, RingBuffer::TransferCallback callback)
+{
+    if (!m_writers && m_buffer.is_empty())
+        return 0;
+    return m_buffer.read_with(size, move(callback));
+}
+
+KResultOr<size_t> FIFO::write_with(size_t size, RingBuffer::TransferCallback callback)
+{
+    if (!m_readers) {
+        Thread::current()->send_signal(SIGPIPE, Process::current());
+        return KResult(-EPIPE);
+    }
+    return m_buffer.write_with(size, move(callback));
+}
+
+KResult FIFO::set_buffer_capacity(size_t size)
+{
+    return m_buffer.set_capacity(RingBuffer::round_up_capacity(size));
+}
+
 String FIFO::absolute_path(const FileDescription&) const
 {
     return String::format("fifo:%u", m_fifo_id);
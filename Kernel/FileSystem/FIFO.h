@@ -26,9 +26,9 @@
 
 #pragma once
 
-#include <Kernel/DoubleBuffer.h>
 #include <Kernel/FileSystem/File.h>
 #include <Kernel/Lock.h>
+#include <Kernel/RingBuffer.h>
 #include <Kernel/UnixTypes.h>
 #include <Kernel/WaitQueue.h>
 
@@ -55,6 +55,21 @@ public:
     void attach(Direction);
     void detach(Direction);
 
+    // Unprivileged processes can't make a pipe buffer larger than this.
+    static constexpr size_t max_unprivileged_buffer_capacity = 1 * MiB;
+    static constexpr size_t max_buffer_capacity = 16 * MiB;
+
+    size_t buffer_capacity() const { return m_buffer.capacity(); }
+    KResult set_buffer_capacity(size_t);
+
+    // Nothing is left to read, and nobody is going to write any more.
+    bool is_at_end_of_stream() const { return m_buffer.is_empty() && !m_writers; }
+    bool is_full() const { return !m_buffer.space_for_writing(); }
+
+    // Like read() and write(), but the callback gets to move the data in or out of the pipe buffer itself.
+    KResultOr<size_t> read_with(size_t, RingBuffer::TransferCallback);
+    KResultOr<size_t> write_with(size_t, RingBuffer::TransferCallback);
+
 private:
     // ^File
     virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) override;
@@ -62,6 +77,8 @@ private:
     virtual KResult stat(::stat&) const override;
     virtual bool can_read(const FileDescription&, size_t) const override;
     virtual bool can_write(const FileDescription&, size_t) const override;
+    virtual bool has_hung_up(const FileDescription&) const override;
+    virtual bool has_pending_error(const FileDescription&) const override;
     virtual String absolute_path(const FileDescription&) const override;
     virtual const char* class_name() const override { return "FIFO"; }
     virtual bool is_fifo() const override { return true; }
@@ -70,7 +87,7 @@ private:
 
     unsigned m_writers { 0 };
     unsigned m_readers { 0 };
-    DoubleBuffer m_buffer;
+    RingBuffer m_buffer;
 
     uid_t m_uid { 0 };
 
@@ -25,11 +25,43 @@
  */
 
 #include <AK/StringView.h>
+#include <Kernel/FileSystem/EPoll.h>
 #include <Kernel/FileSystem/File.h>
 #include <Kernel/FileSystem/FileDescription.h>
 
 namespace Kernel {
 
+void FileBlockCondition::unblock()
+{
+    ScopedSpinLock lock(m_lock);
+    do_unblock([&](auto& b, void* data, bool&) {
+        ASSERT(b.blocker_type() == Thread::Blocker::Type::File);
+        auto& blocker = static_cast<Thread::FileBlocker&>(b);
+        return blocker.unblock(false, data);
+    });
+    for (auto* interest : m_epoll_interests)
+        interest->notify({});
+}
+
+void FileBlockCondition::add_epoll_interest(Badge<EPoll>, EPollInterest& interest)
+{
+    ScopedSpinLock lock(m_lock);
+    m_epoll_interests.append(&interest);
+}
+
+void FileBlockCondition::remove_epoll_interest(Badge<EPoll>, EPollInterest& interest)
+{
+    ScopedSpinLock lock(m_lock);
+    m_epoll_interests.remove_first_matching([&](auto* entry) { return entry == &interest; });
+}
+
+void FileBlockCondition::description_closed(Badge<FileDescription>, FileDescription& description)
+{
+    ScopedSpinLock lock(m_lock);
+    for (auto* interest : m_epoll_interests)
+        interest->description_closed({}, description);
+}
+
 File::File()
     : m_block_condition(*this)
 {
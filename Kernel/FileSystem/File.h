@@ -26,10 +26,12 @@
 
 #pragma once
 
+#include <AK/Badge.h>
 #include <AK/NonnullRefPtr.h>
 #include <AK/RefCounted.h>
 #include <AK/String.h>
 #include <AK/Types.h>
+#include <AK/Vector.h>
 #include <AK/Weakable.h>
 #include <Kernel/Forward.h>
 #include <Kernel/KResult.h>
@@ -39,6 +41,8 @@
 
 namespace Kernel {
 
+class EPoll;
+class EPollInterest;
 class File;
 
 class FileBlockCondition : public Thread::BlockCondition {
@@ -55,18 +59,20 @@ public:
         return !blocker.unblock(true, data);
     }
 
-    void unblock()
-    {
-        ScopedSpinLock lock(m_lock);
-        do_unblock([&](auto& b, void* data, bool&) {
-            ASSERT(b.blocker_type() == Thread::Blocker::Type::File);
-            auto& blocker = static_cast<Thread::FileBlocker&>(b);
-            return blocker.unblock(false, data);
-        });
-    }
+    void unblock();
+
+    // EPoll instances watching this file are told about every state change
+    // here, so they never have to scan their whole interest list.
+    void add_epoll_interest(Badge<EPoll>, EPollInterest&);
+    void remove_epoll_interest(Badge<EPoll>, EPollInterest&);
+
+    // Called by a description of this file before it goes away, so that the
+    // EPoll instances watching it stop using it right away.
+    void description_closed(Badge<FileDescription>, FileDescription&);
 
 private:
     File& m_file;
+    Vector<EPollInterest*> m_epoll_interests;
 };
 
 // File is the base class for anything that can be referenced by a FileDescription.
@@ -84,6 +90,13 @@ private:
 //   - Note that can_read() should return true in EOF conditions,
 //     and a subsequent call to read() should return 0.
 //
+// has_hung_up() and has_pending_error()
+//
+//   - Optional. Used to report EPOLLHUP and EPOLLERR from epoll_wait().
+//   - has_hung_up() should return true once the other end has gone away for good.
+//   - has_pending_error() should return true if the File ran into an error
+//     that a subsequent read() or write() would report.
+//
 // ioctl()
 //
 //   - Optional. If unimplemented, ioctl() on this File will fail with -ENOTTY.
@@ -107,6 +120,8 @@ public:
 
     virtual bool can_read(const FileDescription&, size_t) const = 0;
     virtual bool can_write(const FileDescription&, size_t) const = 0;
+    virtual bool has_hung_up(const FileDescription&) const { return false; }
+    virtual bool has_pending_error(const FileDescription&) const { return false; }
 
     virtual KResultOr<size_t> read(FileDescription&, size_t, UserOrKernelBuffer&, size_t) = 0;
     virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) = 0;
@@ -132,6 +147,7 @@ public:
     virtual bool is_block_device() const { return false; }
     virtual bool is_character_device() const { return false; }
     virtual bool is_socket() const { return false; }
+    virtual bool is_epoll() const { return false; }
 
     virtual FileBlockCondition& block_condition() { return m_block_condition; }
 
@@ -66,6 +66,8 @@ FileDescription::FileDescription(File& file)
 
 FileDescription::~FileDescription()
 {
+    // Make sure no EPoll looks at us anymore before we start tearing down.
+    m_file->block_condition().description_closed({}, *this);
     if (is_socket())
         socket()->detach(*this);
     if (is_fifo())
@@ -179,6 +181,16 @@ bool FileDescription::can_read() const
     return m_file->can_read(*this, offset());
 }
 
+bool FileDescription::has_hung_up() const
+{
+    return m_file->has_hung_up(*this);
+}
+
+bool FileDescription::has_pending_error() const
+{
+    return m_file->has_pending_error(*this);
+}
+
 KResultOr<NonnullOwnPtr<KBuffer>> FileDescription::read_entire_file()
 {
     // HACK ALERT: (This entire function)
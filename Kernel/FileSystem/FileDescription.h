@@ -70,6 +70,8 @@ public:
 
     bool can_read() const;
     bool can_write() const;
+    bool has_hung_up() const;
+    bool has_pending_error() const;
 
     ssize_t get_dir_entries(UserOrKernelBuffer& buffer, ssize_t);
 
@@ -119,7 +121,7 @@ public:
 
     bool is_fifo() const;
     FIFO* fifo();
-    FIFO::Direction fifo_direction() { return m_fifo_direction; }
+    FIFO::Direction fifo_direction() const { return m_fifo_direction; }
     void set_fifo_direction(Badge<FIFO>, FIFO::Direction direction) { m_fifo_direction = direction; }
 
     OwnPtr<KBuffer>& generator_cache() { return m_generator_cache; }
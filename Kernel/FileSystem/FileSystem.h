@@ -61,6 +61,11 @@ public:
     virtual NonnullRefPtr<Inode> root_inode() const = 0;
     virtual bool supports_watchers() const { return false; }
 
+    // Whether path resolution may remember lookups in this file system's directories.
+    // The contents of its directories must only ever change through add_child() and
+    // remove_child(), which have to call Inode::did_add_child() and did_remove_child().
+    virtual bool supports_directory_entry_cache() const { return false; }
+
     bool is_readonly() const { return m_readonly; }
 
     virtual unsigned total_block_count() const { return 0; }
@@ -80,6 +80,13 @@ public:
     virtual KResult chmod(mode_t) = 0;
     virtual KResult chown(uid_t, gid_t) = 0;
     virtual KResult truncate(u64) { return KSuccess; }
+
+    // Filesystems with a page cache hand out its pages directly to file mappings.
+    virtual bool has_page_cache() const { return false; }
+    virtual KResultOr<NonnullRefPtr<PhysicalPage>> page_cache_page(size_t) { ASSERT_NOT_REACHED(); }
+    virtual PageCache* page_cache() { return nullptr; }
+    // The file system block holding each block of the file (0 for a hole), for swap files to bypass the file system.
+    virtual KResultOr<Vector<u32>> block_map() { return KResult(-EINVAL); }
     virtual KResultOr<NonnullRefPtr<Custody>> resolve_as_link(Custody& base, RefPtr<Custody>* out_parent = nullptr, int options = 0, int symlink_recursion_level = 0) const;
 
     LocalSocket* socket() { return m_socket.ptr(); }
@@ -128,8 +135,8 @@ protected:
     void inode_size_changed(size_t old_size, size_t new_size);
     KResult prepare_to_write_data();
 
-    void did_add_child(const InodeIdentifier&);
-    void did_remove_child(const InodeIdentifier&);
+    void did_add_child(const InodeIdentifier&, const StringView& name);
+    void did_remove_child(const InodeIdentifier&, const StringView& name);
 
     mutable Lock m_lock { "Inode" };
 
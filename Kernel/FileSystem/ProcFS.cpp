@@ -58,6 +58,7 @@
 #include <Kernel/TTY/TTY.h>
 #include <Kernel/VM/MemoryManager.h>
 #include <Kernel/VM/PurgeableVMObject.h>
+#include <Kernel/VM/SwapDevice.h>
 #include <LibC/errno_numbers.h>
 
 //#define PROCFS_DEBUG
@@ -87,6 +88,7 @@ enum ProcFileType {
     FI_Root_all,
     FI_Root_memstat,
     FI_Root_cpuinfo,
+    FI_Root_runqueues,
     FI_Root_inodes,
     FI_Root_dmesg,
     FI_Root_interrupts,
@@ -318,34 +320,34 @@ static OwnPtr<KBuffer> procfs$pid_vm(InodeIdentifier identifier)
     KBufferBuilder builder;
     JsonArraySerializer array { builder };
     {
-        ScopedSpinLock lock(process->get_lock());
+        ScopedSpinLock lock(process->address_space_lock());
         for (auto& region : process->regions()) {
-            if (!region.is_user_accessible() && !Process::current()->is_superuser())
+            if (!region->is_user_accessible() && !Process::current()->is_superuser())
                 continue;
             auto region_object = array.add_object();
-            region_object.add("readable", region.is_readable());
-            region_object.add("writable", region.is_writable());
-            region_object.add("executable", region.is_executable());
-            region_object.add("stack", region.is_stack());
-            region_object.add("shared", region.is_shared());
-            region_object.add("user_accessible", region.is_user_accessible());
-            region_object.add("purgeable", region.vmobject().is_purgeable());
-            if (region.vmobject().is_purgeable()) {
-                region_object.add("volatile", static_cast<const PurgeableVMObject&>(region.vmobject()).is_volatile());
+            region_object.add("readable", region->is_readable());
+            region_object.add("writable", region->is_writable());
+            region_object.add("executable", region->is_executable());
+            region_object.add("stack", region->is_stack());
+            region_object.add("shared", region->is_shared());
+            region_object.add("user_accessible", region->is_user_accessible());
+            region_object.add("purgeable", region->vmobject().is_purgeable());
+            if (region->vmobject().is_purgeable()) {
+                region_object.add("volatile", static_cast<const PurgeableVMObject&>(region->vmobject()).is_volatile());
             }
-            region_object.add("cacheable", region.is_cacheable());
-            region_object.add("kernel", region.is_kernel());
-            region_object.add("address", region.vaddr().get());
-            region_object.add("size", region.size());
-            region_object.add("amount_resident", region.amount_resident());
-            region_object.add("amount_dirty", region.amount_dirty());
-            region_object.add("cow_pages", region.cow_pages());
-            region_object.add("name", region.name());
-            region_object.add("vmobject", region.vmobject().class_name());
+            region_object.add("cacheable", region->is_cacheable());
+            region_object.add("kernel", region->is_kernel());
+            region_object.add("address", region->vaddr().get());
+            region_object.add("size", region->size());
+            region_object.add("amount_resident", region->amount_resident());
+            region_object.add("amount_dirty", region->amount_dirty());
+            region_object.add("cow_pages", region->cow_pages());
+            region_object.add("name", region->name());
+            region_object.add("vmobject", region->vmobject().class_name());
 
             StringBuilder pagemap_builder;
-            for (size_t i = 0; i < region.page_count(); ++i) {
-                auto* page = region.physical_page(i);
+            for (size_t i = 0; i < region->page_count(); ++i) {
+                auto* page = region->physical_page(i);
                 if (!page)
                     pagemap_builder.append('N');
                 else if (page->is_shared_zero_page())
@@ -553,6 +555,12 @@ static OwnPtr<KBuffer> procfs$net_tcp(InodeIdentifier)
         obj.add("bytes_in", socket.bytes_in());
         obj.add("packets_out", socket.packets_out());
         obj.add("bytes_out", socket.bytes_out());
+        obj.add("congestion_window", socket.congestion_window());
+        obj.add("slow_start_threshold", socket.slow_start_threshold());
+        obj.add("send_window", socket.send_window());
+        obj.add("smoothed_rtt_ms", socket.smoothed_rtt_ms());
+        obj.add("retransmission_timeout_ms", socket.retransmission_timeout_ms());
+        obj.add("retransmissions", socket.retransmissions());
     });
     array.finish();
     return builder.build();
@@ -599,22 +607,22 @@ static OwnPtr<KBuffer> procfs$pid_vmobjects(InodeIdentifier identifier)
     KBufferBuilder builder;
     builder.appendf("BEGIN       END         SIZE        NAME\n");
     {
-        ScopedSpinLock lock(process->get_lock());
+        ScopedSpinLock lock(process->address_space_lock());
         for (auto& region : process->regions()) {
             builder.appendf("%x -- %x    %x    %s\n",
-                region.vaddr().get(),
-                region.vaddr().offset(region.size() - 1).get(),
-                region.size(),
-                region.name().characters());
+                region->vaddr().get(),
+                region->vaddr().offset(region->size() - 1).get(),
+                region->size(),
+                region->name().characters());
             builder.appendf("VMO: %s @ %x(%u)\n",
-                region.vmobject().is_anonymous() ? "anonymous" : "file-backed",
-                &region.vmobject(),
-                region.vmobject().ref_count());
-            for (size_t i = 0; i < region.vmobject().page_count(); ++i) {
-                auto& physical_page = region.vmobject().physical_pages()[i];
+                region->vmobject().is_anonymous() ? "anonymous" : "file-backed",
+                &region->vmobject(),
+                region->vmobject().ref_count());
+            for (size_t i = 0; i < region->vmobject().page_count(); ++i) {
+                auto& physical_page = region->vmobject().physical_pages()[i];
                 bool should_cow = false;
-                if (i >= region.first_page_index() && i <= region.last_page_index())
-                    should_cow = region.should_cow(i - region.first_page_index());
+                if (i >= region->first_page_index() && i <= region->last_page_index())
+                    should_cow = region->should_cow(i - region->first_page_index());
                 builder.appendf("P%x%s(%u) ",
                     physical_page ? physical_page->paddr().get() : 0,
                     should_cow ? "!" : "",
@@ -799,6 +807,27 @@ static OwnPtr<KBuffer> procfs$cpuinfo(InodeIdentifier)
     return builder.build();
 }
 
+static OwnPtr<KBuffer> procfs$runqueues(InodeIdentifier)
+{
+    KBufferBuilder builder;
+    JsonArraySerializer array { builder };
+    Processor::for_each(
+        [&](Processor& proc) -> IterationDecision {
+            if (!g_scheduler_data->has_run_queue(proc.id()))
+                return IterationDecision::Continue;
+            auto& run_queue = g_scheduler_data->run_queue(proc.id());
+            auto obj = array.add_object();
+            obj.add("processor", proc.id());
+            obj.add("length", run_queue.m_run_queue_length.load());
+            obj.add("steal_count", run_queue.m_steal_count);
+            obj.add("migrations_in", run_queue.m_migrations_in);
+            obj.add("migrations_out", run_queue.m_migrations_out);
+            return IterationDecision::Continue;
+        });
+    array.finish();
+    return builder.build();
+}
+
 OwnPtr<KBuffer> procfs$memstat(InodeIdentifier)
 {
     InterruptDisabler disabler;
@@ -813,8 +842,14 @@ OwnPtr<KBuffer> procfs$memstat(InodeIdentifier)
     json.add("kmalloc_eternal_allocated", stats.bytes_eternal);
     json.add("user_physical_allocated", MM.user_physical_pages_used());
     json.add("user_physical_available", MM.user_physical_pages() - MM.user_physical_pages_used());
+    json.add("user_physical_zeroed", MM.zeroed_page_count());
     json.add("super_physical_allocated", MM.super_physical_pages_used());
     json.add("super_physical_available", MM.super_physical_pages() - MM.super_physical_pages_used());
+    auto* swap_device = SwapDevice::the();
+    json.add("swap_allocated", swap_device ? swap_device->used_slot_count() : 0);
+    json.add("swap_available", swap_device ? swap_device->slot_count() - swap_device->used_slot_count() : 0);
+    json.add("mm_lock_contentions", s_mm_lock.contention_count());
+    json.add("physical_page_lock_contentions", MM.physical_page_lock_contention_count());
     json.add("kmalloc_call_count", stats.kmalloc_call_count);
     json.add("kfree_call_count", stats.kfree_call_count);
     slab_alloc_stats([&json](size_t slab_size, size_t num_allocated, size_t num_free) {
@@ -822,6 +857,13 @@ OwnPtr<KBuffer> procfs$memstat(InodeIdentifier)
         json.add(String::format("%s_num_allocated", prefix.characters()), num_allocated);
         json.add(String::format("%s_num_free", prefix.characters()), num_free);
     });
+    for_each_kmalloc_size_class([&json](auto& stats) {
+        auto prefix = String::format("kmalloc_%zu", stats.size);
+        json.add(String::format("%s_allocations", prefix.characters()), stats.allocations);
+        json.add(String::format("%s_frees", prefix.characters()), stats.frees);
+        json.add(String::format("%s_depot_trips", prefix.characters()), stats.depot_trips);
+        json.add(String::format("%s_cached", prefix.characters()), stats.cached);
+    });
     json.finish();
     return builder.build();
 }
@@ -881,6 +923,7 @@ static OwnPtr<KBuffer> procfs$all(InodeIdentifier)
         process_object.add("amount_shared", process.amount_shared());
         process_object.add("amount_purgeable_volatile", process.amount_purgeable_volatile());
         process_object.add("amount_purgeable_nonvolatile", process.amount_purgeable_nonvolatile());
+        process_object.add("address_space_lock_contentions", process.address_space_lock().contention_count());
         process_object.add("dumpable", process.is_dumpable());
         auto thread_array = process_object.add_array("threads");
         process.for_each_thread([&](const Thread& thread) {
@@ -892,12 +935,14 @@ static OwnPtr<KBuffer> procfs$all(InodeIdentifier)
             thread_object.add("ticks_kernel", thread.ticks_in_kernel());
             thread_object.add("state", thread.state_string());
             thread_object.add("cpu", thread.cpu());
+            thread_object.add("affinity", thread.affinity());
             thread_object.add("priority", thread.priority());
             thread_object.add("effective_priority", thread.effective_priority());
             thread_object.add("syscall_count", thread.syscall_count());
             thread_object.add("inode_faults", thread.inode_faults());
             thread_object.add("zero_faults", thread.zero_faults());
             thread_object.add("cow_faults", thread.cow_faults());
+            thread_object.add("swap_faults", thread.swap_faults());
             thread_object.add("file_read_bytes", thread.file_read_bytes());
             thread_object.add("file_write_bytes", thread.file_write_bytes());
             thread_object.add("unix_socket_read_bytes", thread.unix_socket_read_bytes());
@@ -1685,6 +1730,7 @@ ProcFS::ProcFS()
     m_entries[FI_Root_all] = { "all", FI_Root_all, false, procfs$all };
     m_entries[FI_Root_memstat] = { "memstat", FI_Root_memstat, false, procfs$memstat };
     m_entries[FI_Root_cpuinfo] = { "cpuinfo", FI_Root_cpuinfo, false, procfs$cpuinfo };
+    m_entries[FI_Root_runqueues] = { "runqueues", FI_Root_runqueues, false, procfs$runqueues };
     m_entries[FI_Root_inodes] = { "inodes", FI_Root_inodes, true, procfs$inodes };
     m_entries[FI_Root_dmesg] = { "dmesg", FI_Root_dmesg, true, procfs$dmesg };
     m_entries[FI_Root_self] = { "self", FI_Root_self, false, procfs$self };
@@ -29,6 +29,7 @@
 #include <AK/StringBuilder.h>
 #include <Kernel/Devices/BlockDevice.h>
 #include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/DirectoryEntryCache.h>
 #include <Kernel/FileSystem/FileBackedFileSystem.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/FileSystem/FileSystem.h>
@@ -117,6 +118,8 @@ KResult VFS::unmount(Inode& guest_inode)
     for (size_t i = 0; i < m_mounts.size(); ++i) {
         auto& mount = m_mounts.at(i);
         if (&mount.guest() == &guest_inode) {
+            // Cached lookups keep inodes alive, which would make the file system look busy.
+            DirectoryEntryCache::the().invalidate_file_system(mount.guest_fs().fsid());
             auto result = mount.guest_fs().prepare_to_unmount();
             if (result.is_error()) {
                 dbg() << "VFS: Failed to unmount!";
@@ -912,6 +915,22 @@ KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path(StringView path, Custody& ba
     return custody;
 }
 
+static RefPtr<Inode> lookup_child(Inode& directory, const StringView& name)
+{
+    if (!directory.fs().supports_directory_entry_cache())
+        return directory.lookup(name);
+
+    auto& cache = DirectoryEntryCache::the();
+    RefPtr<Inode> child;
+    if (cache.lookup(directory, name, child))
+        return child;
+
+    auto generation = cache.generation();
+    child = directory.lookup(name);
+    cache.add(directory, name, child.ptr(), generation);
+    return child;
+}
+
 KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path, Custody& base, RefPtr<Custody>* out_parent, int options, int symlink_recursion_level)
 {
     if (symlink_recursion_level >= symlink_recursion_limit)
@@ -948,7 +967,7 @@ KResultOr<NonnullRefPtr<Custody>> VFS::resolve_path_without_veil(StringView path
         }
 
         // Okay, let's look up this part.
-        auto child_inode = parent.inode().lookup(part);
+        auto child_inode = lookup_child(parent.inode(), part);
         if (!child_inode) {
             if (out_parent) {
                 // ENOENT with a non-null parent custody signals to caller that
@@ -37,6 +37,7 @@ class DiskCache;
 class DoubleBuffer;
 class File;
 class FileDescription;
+class FutexQueue;
 class IPv4Socket;
 class Inode;
 class InodeIdentifier;
@@ -48,6 +49,7 @@ class LocalSocket;
 class Lock;
 class MappedROM;
 class MasterPTY;
+class PageCache;
 class PageDirectory;
 class PerformanceEventBuffer;
 class PhysicalPage;
@@ -0,0 +1,108 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/FutexQueue.h>
+
+namespace Kernel {
+
+u32 FutexQueue::wake_n(u32 wake_count, u32 bitset)
+{
+    if (wake_count == 0)
+        return 0;
+    ScopedSpinLock lock(m_lock);
+    u32 did_wake = 0;
+    do_unblock([&](Thread::Blocker& b, void*, bool& stop_iterating) {
+        ASSERT(b.blocker_type() == Thread::Blocker::Type::Futex);
+        auto& blocker = static_cast<Thread::FutexBlocker&>(b);
+        if (!(blocker.bitset() & bitset))
+            return false;
+        if (!blocker.unblock())
+            return false;
+        if (++did_wake == wake_count)
+            stop_iterating = true;
+        return true;
+    });
+    return did_wake;
+}
+
+u32 FutexQueue::wake_n_requeue(u32 wake_count, FutexQueue& target, u32 requeue_count)
+{
+    u32 did_wake = wake_n(wake_count, FUTEX_BITSET_MATCH_ANY);
+    if (requeue_count == 0)
+        return did_wake;
+
+    ScopedSpinLock lock(m_lock);
+    u32 did_requeue = do_requeue(target, [&](Thread::Blocker&, void*, bool& stop_iterating) {
+        if (--requeue_count == 0)
+            stop_iterating = true;
+        return true;
+    });
+    return did_wake + did_requeue;
+}
+
+RefPtr<Thread> FutexQueue::wake_highest_priority_waiter()
+{
+    ScopedSpinLock lock(m_lock);
+    Thread* best_thread = nullptr;
+    do_for_each_blocker([&](Thread::Blocker&, void* data) {
+        auto* thread = static_cast<Thread*>(data);
+        if (!best_thread || thread->base_priority() > best_thread->base_priority())
+            best_thread = thread;
+    });
+    if (!best_thread)
+        return nullptr;
+
+    RefPtr<Thread> woken_thread;
+    do_unblock([&](Thread::Blocker& b, void* data, bool& stop_iterating) {
+        if (data != best_thread)
+            return false;
+        stop_iterating = true;
+        ASSERT(b.blocker_type() == Thread::Blocker::Type::Futex);
+        if (!static_cast<Thread::FutexBlocker&>(b).unblock())
+            return false;
+        woken_thread = best_thread;
+        return true;
+    });
+    return woken_thread;
+}
+
+u32 FutexQueue::highest_waiter_priority()
+{
+    ScopedSpinLock lock(m_lock);
+    u32 priority = 0;
+    do_for_each_blocker([&](Thread::Blocker&, void* data) {
+        priority = max(priority, static_cast<Thread*>(data)->base_priority());
+    });
+    return priority;
+}
+
+bool FutexQueue::is_empty()
+{
+    ScopedSpinLock lock(m_lock);
+    return do_is_empty();
+}
+
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/RefCounted.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/Thread.h>
+
+namespace Kernel {
+
+class FutexQueue : public Thread::BlockCondition
+    , public RefCounted<FutexQueue> {
+public:
+    Thread::BlockResult wait_on(const Thread::BlockTimeout& timeout, u32 bitset)
+    {
+        return Thread::current()->block<Thread::FutexBlocker>(timeout, *this, bitset);
+    }
+
+    u32 wake_n(u32 wake_count, u32 bitset);
+    u32 wake_n_requeue(u32 wake_count, FutexQueue& target, u32 requeue_count);
+    RefPtr<Thread> wake_highest_priority_waiter();
+    u32 highest_waiter_priority();
+    bool is_empty();
+
+    // The thread owning the PI futex, if this is one
+    RefPtr<Thread> pi_owner() const { return m_pi_owner; }
+    void set_pi_owner(RefPtr<Thread> owner) { m_pi_owner = move(owner); }
+
+private:
+    RefPtr<Thread> m_pi_owner;
+};
+
+}
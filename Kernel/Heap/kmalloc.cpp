@@ -30,6 +30,7 @@
  */
 
 #include <AK/Assertions.h>
+#include <AK/Function.h>
 #include <AK/NonnullOwnPtrVector.h>
 #include <AK/Optional.h>
 #include <AK/StringView.h>
@@ -49,6 +50,7 @@
 #define CHUNK_SIZE 32
 #define POOL_SIZE (2 * MiB)
 #define ETERNAL_RANGE_SIZE (2 * MiB)
+#define MAGAZINE_MAX_PROCESSORS 32
 
 static RecursiveSpinLock s_lock; // needs to be recursive because of dump_backtrace()
 
@@ -208,6 +210,198 @@ static void kmalloc_allocate_backup_memory()
     g_kmalloc_global->allocate_backup_memory();
 }
 
+// Small allocations go through per-CPU magazine caches, one per size class.
+// A magazine is a stack of free objects that a processor can take from and
+// return to with interrupts disabled, without touching s_lock. Each processor
+// has a loaded and a previous magazine. Only when both are exhausted (or full)
+// do we go to the depot, which hands out full magazines and takes back empty
+// ones under s_lock.
+//
+// Objects in a magazine are regular heap allocations that just haven't been
+// given back to the heap, so krealloc() and heap statistics keep working.
+typedef KmallocGlobalHeap::HeapType::HeapType KmallocHeapType;
+
+static constexpr size_t s_size_class_chunks[] = { 1, 2, 4, 8, 16 };
+static constexpr size_t size_class_count = sizeof(s_size_class_chunks) / sizeof(s_size_class_chunks[0]);
+static constexpr size_t magazine_capacity = 16;
+static constexpr size_t max_depot_magazines = 4;
+
+struct KmallocMagazine {
+    KmallocMagazine* next { nullptr };
+    size_t count { 0 };
+    void* objects[magazine_capacity];
+
+    bool is_empty() const { return count == 0; }
+    bool is_full() const { return count == magazine_capacity; }
+};
+
+struct KmallocMagazineCache {
+    KmallocMagazine* loaded { nullptr };
+    KmallocMagazine* previous { nullptr };
+    size_t allocations { 0 };
+    size_t frees { 0 };
+    size_t depot_trips { 0 };
+};
+
+struct KmallocDepot {
+    KmallocMagazine* full { nullptr };
+    KmallocMagazine* empty { nullptr };
+    size_t full_count { 0 };
+    size_t empty_count { 0 };
+};
+
+static KmallocMagazineCache s_magazine_caches[MAGAZINE_MAX_PROCESSORS][size_class_count];
+static KmallocDepot s_depots[size_class_count]; // protected by s_lock
+
+static Optional<size_t> size_class_for_allocation(size_t size)
+{
+    size_t chunks = KmallocHeapType::chunks_needed_for(size);
+    for (size_t i = 0; i < size_class_count; i++) {
+        if (chunks <= s_size_class_chunks[i])
+            return i;
+    }
+    return {};
+}
+
+static Optional<size_t> size_class_for_pointer(const void* ptr)
+{
+    size_t chunks = KmallocHeapType::allocation_size_in_chunks(ptr);
+    for (size_t i = 0; i < size_class_count; i++) {
+        if (chunks == s_size_class_chunks[i])
+            return i;
+    }
+    return {};
+}
+
+static constexpr size_t size_class_bytes(size_t size_class)
+{
+    return KmallocHeapType::usable_size_for_chunks(s_size_class_chunks[size_class]);
+}
+
+static KmallocMagazineCache* magazine_cache_for(size_t size_class)
+{
+    ASSERT_INTERRUPTS_DISABLED();
+    if (!Processor::is_initialized() || g_dump_kmalloc_stacks)
+        return nullptr;
+    auto cpu = Processor::current().id();
+    if (cpu >= MAGAZINE_MAX_PROCESSORS)
+        return nullptr;
+    return &s_magazine_caches[cpu][size_class];
+}
+
+static KmallocMagazine* take_magazine(KmallocMagazine*& list, size_t& count)
+{
+    auto* magazine = list;
+    if (magazine) {
+        list = magazine->next;
+        magazine->next = nullptr;
+        count--;
+    }
+    return magazine;
+}
+
+static void put_magazine(KmallocMagazine*& list, size_t& count, KmallocMagazine& magazine)
+{
+    magazine.next = list;
+    list = &magazine;
+    count++;
+}
+
+static void* allocate_from_magazines(KmallocMagazineCache& cache)
+{
+    if (cache.loaded && !cache.loaded->is_empty())
+        return cache.loaded->objects[--cache.loaded->count];
+    if (cache.previous && !cache.previous->is_empty()) {
+        swap(cache.loaded, cache.previous);
+        return cache.loaded->objects[--cache.loaded->count];
+    }
+    return nullptr;
+}
+
+static bool free_to_magazines(KmallocMagazineCache& cache, void* ptr)
+{
+    if (cache.loaded && !cache.loaded->is_full()) {
+        cache.loaded->objects[cache.loaded->count++] = ptr;
+        return true;
+    }
+    if (cache.previous && cache.previous->is_empty()) {
+        swap(cache.loaded, cache.previous);
+        cache.loaded->objects[cache.loaded->count++] = ptr;
+        return true;
+    }
+    return false;
+}
+
+static void release_empty_magazine(KmallocDepot& depot, KmallocMagazine* magazine)
+{
+    ASSERT(s_lock.own_lock());
+    if (!magazine)
+        return;
+    ASSERT(magazine->is_empty());
+    if (depot.empty_count < max_depot_magazines)
+        put_magazine(depot.empty, depot.empty_count, *magazine);
+    else
+        g_kmalloc_global->m_heap.deallocate(magazine);
+}
+
+static void* allocate_from_depot(KmallocMagazineCache& cache, size_t size_class)
+{
+    ASSERT(s_lock.own_lock());
+    auto& depot = s_depots[size_class];
+    cache.depot_trips++;
+
+    // Both of our magazines are empty at this point. Trade the previous one
+    // for a full magazine from the depot, if it has one.
+    if (auto* full_magazine = take_magazine(depot.full, depot.full_count)) {
+        release_empty_magazine(depot, cache.previous);
+        cache.previous = cache.loaded;
+        cache.loaded = full_magazine;
+        return cache.loaded->objects[--cache.loaded->count];
+    }
+
+    return g_kmalloc_global->m_heap.allocate(size_class_bytes(size_class));
+}
+
+static void free_to_depot(KmallocMagazineCache& cache, size_t size_class, void* ptr)
+{
+    ASSERT(s_lock.own_lock());
+    auto& depot = s_depots[size_class];
+    cache.depot_trips++;
+
+    // The loaded magazine is full, and the previous one is either full or
+    // missing. Hand the previous one to the depot and start a fresh one.
+    KmallocMagazine* empty_magazine = nullptr;
+    if (cache.previous) {
+        if (depot.full_count < max_depot_magazines) {
+            put_magazine(depot.full, depot.full_count, *cache.previous);
+        } else {
+            // The depot has plenty, give the objects back to the heap.
+            for (size_t i = 0; i < cache.previous->count; i++)
+                g_kmalloc_global->m_heap.deallocate(cache.previous->objects[i]);
+            cache.previous->count = 0;
+            empty_magazine = cache.previous;
+        }
+        cache.previous = nullptr;
+    }
+
+    if (!empty_magazine)
+        empty_magazine = take_magazine(depot.empty, depot.empty_count);
+    if (!empty_magazine) {
+        void* memory = g_kmalloc_global->m_heap.allocate(sizeof(KmallocMagazine));
+        if (!memory) {
+            cache.previous = cache.loaded;
+            cache.loaded = nullptr;
+            g_kmalloc_global->m_heap.deallocate(ptr);
+            return;
+        }
+        empty_magazine = new (memory) KmallocMagazine;
+    }
+
+    cache.previous = cache.loaded;
+    cache.loaded = empty_magazine;
+    cache.loaded->objects[cache.loaded->count++] = ptr;
+}
+
 void kmalloc_enable_expand()
 {
     g_kmalloc_global->allocate_backup_memory();
@@ -238,6 +432,27 @@ void* kmalloc_eternal(size_t size)
 
 void* kmalloc_impl(size_t size)
 {
+    if (auto size_class = size_class_for_allocation(size); size_class.has_value()) {
+        InterruptDisabler disabler;
+        if (auto* cache = magazine_cache_for(size_class.value())) {
+            cache->allocations++;
+            void* ptr = allocate_from_magazines(*cache);
+            if (!ptr) {
+                ScopedSpinLock lock(s_lock);
+                ptr = allocate_from_depot(*cache, size_class.value());
+            }
+            if (!ptr) {
+                klog() << "kmalloc(): PANIC! Out of memory (no suitable block for size " << size << ")";
+                Kernel::dump_backtrace();
+                Processor::halt();
+            }
+#ifdef SANITIZE_KMALLOC
+            __builtin_memset(ptr, KMALLOC_SCRUB_BYTE, size_class_bytes(size_class.value()));
+#endif
+            return ptr;
+        }
+    }
+
     ScopedSpinLock lock(s_lock);
     ++g_kmalloc_call_count;
 
@@ -261,6 +476,21 @@ void kfree(void* ptr)
     if (!ptr)
         return;
 
+    if (auto size_class = size_class_for_pointer(ptr); size_class.has_value()) {
+        InterruptDisabler disabler;
+        if (auto* cache = magazine_cache_for(size_class.value())) {
+            cache->frees++;
+#ifdef SANITIZE_KMALLOC
+            __builtin_memset(ptr, KFREE_SCRUB_BYTE, size_class_bytes(size_class.value()));
+#endif
+            if (!free_to_magazines(*cache, ptr)) {
+                ScopedSpinLock lock(s_lock);
+                free_to_depot(*cache, size_class.value(), ptr);
+            }
+            return;
+        }
+    }
+
     ScopedSpinLock lock(s_lock);
     ++g_kfree_call_count;
 
@@ -291,4 +521,33 @@ void get_kmalloc_stats(kmalloc_stats& stats)
     stats.bytes_eternal = g_kmalloc_bytes_eternal;
     stats.kmalloc_call_count = g_kmalloc_call_count;
     stats.kfree_call_count = g_kfree_call_count;
+    for (auto& caches : s_magazine_caches) {
+        for (auto& cache : caches) {
+            stats.kmalloc_call_count += cache.allocations;
+            stats.kfree_call_count += cache.frees;
+        }
+    }
+}
+
+void for_each_kmalloc_size_class(Function<void(const kmalloc_size_class_stats&)> callback)
+{
+    for (size_t size_class = 0; size_class < size_class_count; size_class++) {
+        kmalloc_size_class_stats stats {};
+        stats.size = size_class_bytes(size_class);
+        {
+            ScopedSpinLock lock(s_lock);
+            stats.cached = s_depots[size_class].full_count * magazine_capacity;
+            for (auto& caches : s_magazine_caches) {
+                auto& cache = caches[size_class];
+                stats.allocations += cache.allocations;
+                stats.frees += cache.frees;
+                stats.depot_trips += cache.depot_trips;
+                if (cache.loaded)
+                    stats.cached += cache.loaded->count;
+                if (cache.previous)
+                    stats.cached += cache.previous->count;
+            }
+        }
+        callback(stats);
+    }
 }
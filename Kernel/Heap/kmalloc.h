@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <AK/Forward.h>
 #include <AK/Types.h>
 
 //#define KMALLOC_DEBUG_LARGE_ALLOCATIONS
@@ -49,6 +50,15 @@ struct kmalloc_stats {
 };
 void get_kmalloc_stats(kmalloc_stats&);
 
+struct kmalloc_size_class_stats {
+    size_t size;
+    size_t allocations;
+    size_t frees;
+    size_t depot_trips;
+    size_t cached;
+};
+void for_each_kmalloc_size_class(Function<void(const kmalloc_size_class_stats&)>);
+
 extern bool g_dump_kmalloc_stacks;
 
 inline void* operator new(size_t, void* p) { return p; }
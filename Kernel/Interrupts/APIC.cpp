@@ -44,6 +44,7 @@
 //#define APIC_DEBUG
 //#define APIC_SMP_DEBUG
 
+#define IRQ_APIC_PERFORMANCE_COUNTER (0xfb - IRQ_VECTOR_BASE)
 #define IRQ_APIC_TIMER (0xfc - IRQ_VECTOR_BASE)
 #define IRQ_APIC_IPI (0xfd - IRQ_VECTOR_BASE)
 #define IRQ_APIC_ERR (0xfe - IRQ_VECTOR_BASE)
@@ -230,6 +231,11 @@ u8 APIC::spurious_interrupt_vector()
     return IRQ_APIC_SPURIOUS;
 }
 
+u8 APIC::performance_counter_interrupt_vector()
+{
+    return IRQ_APIC_PERFORMANCE_COUNTER;
+}
+
 #define APIC_INIT_VAR_PTR(tpe, vaddr, varname)                         \
     reinterpret_cast<volatile tpe*>(reinterpret_cast<ptrdiff_t>(vaddr) \
         + reinterpret_cast<ptrdiff_t>(&varname)                        \
@@ -604,6 +610,14 @@ u32 APIC::get_timer_divisor()
     return 16;
 }
 
+void APIC::set_performance_counter_interrupt(bool enabled)
+{
+    u32 flags = 0;
+    if (!enabled)
+        flags |= APIC_LVT_MASKED;
+    write_register(APIC_REG_LVT_PERFORMANCE_COUNTER, APIC_LVT(IRQ_APIC_PERFORMANCE_COUNTER + IRQ_VECTOR_BASE, 0) | flags);
+}
+
 void APICIPIInterruptHandler::handle_interrupt(const RegisterState&)
 {
 #ifdef APIC_SMP_DEBUG
@@ -52,6 +52,7 @@ public:
     void broadcast_ipi();
     void send_ipi(u32 cpu);
     static u8 spurious_interrupt_vector();
+    static u8 performance_counter_interrupt_vector();
     Thread* get_idle_thread(u32 cpu) const;
     u32 enabled_processor_count() const { return m_processor_enabled_cnt; }
 
@@ -66,6 +67,10 @@ public:
     u32 get_timer_current_count();
     u32 get_timer_divisor();
 
+    // Unmasks (or masks) the performance counter overflow interrupt on the current processor.
+    // The local APIC masks it again every time it is delivered.
+    void set_performance_counter_interrupt(bool enabled);
+
 private:
     class ICRReg {
         u32 m_low { 0 };
@@ -27,6 +27,8 @@
 #include <AK/MACAddress.h>
 #include <Kernel/IO.h>
 #include <Kernel/Net/E1000NetworkAdapter.h>
+#include <Kernel/Net/EthernetFrameHeader.h>
+#include <Kernel/Net/TCP.h>
 #include <Kernel/Thread.h>
 
 //#define E1000_DEBUG
@@ -58,7 +60,10 @@ namespace Kernel {
 #define REG_RXDCTL 0x3828           // RX Descriptor Control
 #define REG_RADV 0x282C             // RX Int. Absolute Delay Timer
 #define REG_RSRPD 0x2C00            // RX Small Packet Detect Interrupt
+#define REG_TIDV 0x3820             // TX Interrupt Delay Value
+#define REG_TADV 0x382C             // TX Absolute Interrupt Delay Value
 #define REG_TIPG 0x0410             // Transmit Inter Packet Gap
+#define REG_RXCSUM 0x5000           // RX Checksum Control
 #define ECTRL_SLU 0x40              //set link up
 #define RCTL_EN (1 << 1)            // Receiver Enable
 #define RCTL_SBP (1 << 2)           // Store Bad Packets
@@ -91,6 +96,20 @@ namespace Kernel {
 #define RCTL_BSIZE_8192 ((2 << 16) | (1 << 25))
 #define RCTL_BSIZE_16384 ((1 << 16) | (1 << 25))
 
+// RX Checksum Control
+
+#define RXCSUM_IPOFLD (1 << 8) // IP Checksum Offload Enable
+#define RXCSUM_TUOFLD (1 << 9) // TCP/UDP Checksum Offload Enable
+
+// RX Descriptor Status and Errors
+
+#define RSTA_DD (1 << 0)    // Descriptor Done
+#define RSTA_EOP (1 << 1)   // End of Packet
+#define RSTA_TCPCS (1 << 5) // TCP/UDP Checksum Calculated
+#define RSTA_IPCS (1 << 6)  // IP Checksum Calculated
+#define RERR_TCPE (1 << 5)  // TCP/UDP Checksum Error
+#define RERR_IPE (1 << 6)   // IP Checksum Error
+
 // Transmit Command
 
 #define CMD_EOP (1 << 0)  // End of Packet
@@ -101,6 +120,24 @@ namespace Kernel {
 #define CMD_VLE (1 << 6)  // VLAN Packet Enable
 #define CMD_IDE (1 << 7)  // Interrupt Delay Enable
 
+// Extended Transmit Descriptors
+
+#define DTYP_CONTEXT (0 << 20)
+#define DTYP_DATA (1 << 20)
+#define TUCMD_TCP (1 << 24)   // TCP (rather than UDP) packet
+#define TUCMD_IP (1 << 25)    // IPv4 (rather than IPv6) packet
+#define TUCMD_TSE (1 << 26)   // TCP Segmentation Enable
+#define TUCMD_RS (1 << 27)    // Report Status
+#define TUCMD_DEXT (1 << 29)  // Descriptor Extension
+#define DCMD_EOP (1 << 24)    // End of Packet
+#define DCMD_IFCS (1 << 25)   // Insert FCS
+#define DCMD_TSE (1 << 26)    // TCP Segmentation Enable
+#define DCMD_RS (1 << 27)     // Report Status
+#define DCMD_DEXT (1 << 29)   // Descriptor Extension
+#define DCMD_IDE (1u << 31)   // Interrupt Delay Enable
+#define POPTS_IXSM (1 << 0)   // Insert IP Checksum
+#define POPTS_TXSM (1 << 1)   // Insert TCP/UDP Checksum
+
 // TCTL Register
 
 #define TCTL_EN (1 << 1)      // Transmit Enable
@@ -142,6 +179,8 @@ namespace Kernel {
 #define INTERRUPT_SRPD (1 << 16)
 // clang-format on
 
+static constexpr u32 interrupt_mask = INTERRUPT_LSC | INTERRUPT_RXT0 | INTERRUPT_RXDMT0 | INTERRUPT_RXO | INTERRUPT_TXDW;
+
 // https://www.intel.com/content/dam/doc/manual/pci-pci-x-family-gbe-controllers-software-dev-manual.pdf Section 5.2
 static bool is_valid_device_id(u16 device_id)
 {
@@ -224,13 +263,18 @@ E1000NetworkAdapter::E1000NetworkAdapter(PCI::Address address, u8 irq)
     u32 flags = in32(REG_CTRL);
     out32(REG_CTRL, flags | ECTRL_SLU);
 
-    out32(REG_INTERRUPT_RATE, 6000); // Interrupt rate of 1.536 milliseconds
+    // Coalesce interrupts, so a flood of packets doesn't turn into a flood of interrupts.
+    // The throttling interval is in units of 256ns, the delay timers in units of 1.024us.
+    out32(REG_INTERRUPT_RATE, 488); // At most ~8000 interrupts per second
+    out32(REG_RDTR, 32);            // Wait for ~32us of quiet after a packet arrives...
+    out32(REG_RADV, 128);           // ...but no longer than ~128us after the first one.
+    out32(REG_TIDV, 64);
+    out32(REG_TADV, 256);
 
     initialize_rx_descriptors();
     initialize_tx_descriptors();
 
-    out32(REG_INTERRUPT_MASK_SET, 0x1f6dc);
-    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | INTERRUPT_RXT0);
+    out32(REG_INTERRUPT_MASK_SET, interrupt_mask);
     in32(REG_INTERRUPT_CAUSE_READ);
 
     enable_irq();
@@ -248,20 +292,17 @@ void E1000NetworkAdapter::handle_irq(const RegisterState&)
 
     m_entropy_source.add_random_event(status);
 
-    if (status & 4) {
+    if (status & INTERRUPT_LSC) {
         u32 flags = in32(REG_CTRL);
         out32(REG_CTRL, flags | ECTRL_SLU);
     }
-    if (status & 0x80) {
+    // RXDMT0 means the ring is half full, so we don't wait for the delay timers to run out.
+    if (status & (INTERRUPT_RXT0 | INTERRUPT_RXDMT0 | INTERRUPT_RXO))
         receive();
-    }
-    if (status & 0x10) {
-        // Threshold OK?
-    }
+    if (status & INTERRUPT_TXDW)
+        m_wait_queue.wake_all();
 
-    m_wait_queue.wake_all();
-
-    out32(REG_INTERRUPT_MASK_SET, INTERRUPT_LSC | INTERRUPT_RXT0 | INTERRUPT_RXO);
+    out32(REG_INTERRUPT_MASK_SET, interrupt_mask);
 }
 
 void E1000NetworkAdapter::detect_eeprom()
@@ -320,13 +361,13 @@ bool E1000NetworkAdapter::link_up()
 
 void E1000NetworkAdapter::initialize_rx_descriptors()
 {
-    auto* rx_descriptors = (e1000_tx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    auto* rx_descriptors = (e1000_rx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    m_rx_buffers_region = MM.allocate_contiguous_kernel_region(number_of_rx_descriptors * buffer_size, "E1000 RX buffers", Region::Access::Read | Region::Access::Write);
+    ASSERT(m_rx_buffers_region);
+    auto buffers_base = m_rx_buffers_region->physical_page(0)->paddr();
     for (size_t i = 0; i < number_of_rx_descriptors; ++i) {
         auto& descriptor = rx_descriptors[i];
-        auto region = MM.allocate_contiguous_kernel_region(8192, "E1000 RX buffer", Region::Access::Read | Region::Access::Write);
-        ASSERT(region);
-        m_rx_buffers_regions.append(region.release_nonnull());
-        descriptor.addr = m_rx_buffers_regions[i].physical_page(0)->paddr().get();
+        descriptor.addr = buffers_base.offset(i * buffer_size).get();
         descriptor.status = 0;
     }
 
@@ -336,18 +377,18 @@ void E1000NetworkAdapter::initialize_rx_descriptors()
     out32(REG_RXDESCHEAD, 0);
     out32(REG_RXDESCTAIL, number_of_rx_descriptors - 1);
 
-    out32(REG_RCTRL, RCTL_EN | RCTL_SBP | RCTL_UPE | RCTL_MPE | RCTL_LBM_NONE | RTCL_RDMTS_HALF | RCTL_BAM | RCTL_SECRC | RCTL_BSIZE_8192);
+    out32(REG_RXCSUM, RXCSUM_IPOFLD | RXCSUM_TUOFLD);
+    out32(REG_RCTRL, RCTL_EN | RCTL_SBP | RCTL_UPE | RCTL_MPE | RCTL_LBM_NONE | RTCL_RDMTS_HALF | RCTL_BAM | RCTL_SECRC | RCTL_BSIZE_2048);
 }
 
 void E1000NetworkAdapter::initialize_tx_descriptors()
 {
     auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
+    m_tx_buffers_region = MM.allocate_contiguous_kernel_region(number_of_tx_descriptors * buffer_size, "E1000 TX buffers", Region::Access::Read | Region::Access::Write);
+    ASSERT(m_tx_buffers_region);
     for (size_t i = 0; i < number_of_tx_descriptors; ++i) {
         auto& descriptor = tx_descriptors[i];
-        auto region = MM.allocate_contiguous_kernel_region(8192, "E1000 TX buffer", Region::Access::Read | Region::Access::Write);
-        ASSERT(region);
-        m_tx_buffers_regions.append(region.release_nonnull());
-        descriptor.addr = m_tx_buffers_regions[i].physical_page(0)->paddr().get();
+        descriptor.addr = 0;
         descriptor.cmd = 0;
     }
 
@@ -432,59 +473,139 @@ u32 E1000NetworkAdapter::in32(u16 address)
 
 void E1000NetworkAdapter::send_raw(ReadonlyBytes payload)
 {
-    disable_irq();
-    size_t tx_current = in32(REG_TXDESCTAIL) % number_of_tx_descriptors;
-#ifdef E1000_DEBUG
-    klog() << "E1000: Sending packet (" << payload.size() << " bytes)";
-#endif
+    send_packet(payload, {});
+}
+
+void E1000NetworkAdapter::send_raw_offloaded(ReadonlyBytes payload, const TransmitOffload& offload)
+{
+    send_packet(payload, offload);
+}
+
+void E1000NetworkAdapter::reclaim_tx_descriptors()
+{
+    ASSERT(m_tx_lock.is_locked());
+    // Every descriptor is sent with RS set, so the hardware marks each of them done.
     auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
-    auto& descriptor = tx_descriptors[tx_current];
-    ASSERT(payload.size() <= 8192);
-    auto* vptr = (void*)m_tx_buffers_regions[tx_current].vaddr().as_ptr();
-    memcpy(vptr, payload.data(), payload.size());
-    descriptor.length = payload.size();
-    descriptor.status = 0;
-    descriptor.cmd = CMD_EOP | CMD_IFCS | CMD_RS;
+    while (m_tx_clean != m_tx_tail && (tx_descriptors[m_tx_clean].status & TSTA_DD)) {
+        tx_descriptors[m_tx_clean].status = 0;
+        m_tx_clean = (m_tx_clean + 1) % number_of_tx_descriptors;
+    }
+}
+
+void E1000NetworkAdapter::send_packet(ReadonlyBytes payload, const TransmitOffload& offload)
+{
+    bool use_context = offload.checksum || offload.segment_size;
+    size_t descriptors_needed = (payload.size() + buffer_size - 1) / buffer_size + (use_context ? 1 : 0);
+    ASSERT(descriptors_needed < number_of_tx_descriptors);
 #ifdef E1000_DEBUG
-    klog() << "E1000: Using tx descriptor " << tx_current << " (head is at " << in32(REG_TXDESCHEAD) << ")";
+    klog() << "E1000: Sending packet (" << payload.size() << " bytes, " << descriptors_needed << " descriptors)";
 #endif
-    tx_current = (tx_current + 1) % number_of_tx_descriptors;
-    cli();
-    enable_irq();
-    out32(REG_TXDESCTAIL, tx_current);
+
+    LOCKER(m_tx_lock);
     for (;;) {
-        if (descriptor.status) {
-            sti();
+        reclaim_tx_descriptors();
+        if (free_tx_descriptors() >= descriptors_needed)
             break;
-        }
+        // The TXDW interrupt wakes us once the hardware is done with some descriptors.
         m_wait_queue.wait_on(nullptr, "E1000NetworkAdapter");
     }
-#ifdef E1000_DEBUG
-    dbgln("E1000: Sent packet, status is now {:#02x}!", (u8)descriptor.status);
-#endif
+
+    auto* tx_descriptors = (e1000_tx_desc*)m_tx_descriptors_region->vaddr().as_ptr();
+    u8 popts = 0;
+    u32 data_command = 0;
+    if (use_context) {
+        // The packet was built by NetworkAdapter::send_ipv4(), so it's Ethernet + IPv4 + TCP/UDP.
+        auto& ipv4_packet = *(const IPv4Packet*)(payload.data() + sizeof(EthernetFrameHeader));
+        size_t ipv4_header_start = sizeof(EthernetFrameHeader);
+        size_t l4_header_start = ipv4_header_start + ipv4_packet.internet_header_length() * sizeof(u32);
+        bool is_tcp = ipv4_packet.protocol() == (u8)IPv4Protocol::TCP;
+        ASSERT(is_tcp || ipv4_packet.protocol() == (u8)IPv4Protocol::UDP);
+
+        auto& context = (e1000_tx_context_desc&)tx_descriptors[m_tx_tail];
+        context.ipcss = ipv4_header_start;
+        context.ipcso = ipv4_header_start + 10;
+        context.ipcse = l4_header_start - 1;
+        context.tucss = l4_header_start;
+        context.tucso = l4_header_start + (is_tcp ? 16 : 6);
+        context.tucse = 0;
+        u32 command = DTYP_CONTEXT | TUCMD_DEXT | TUCMD_RS | TUCMD_IP | (is_tcp ? TUCMD_TCP : 0);
+        context.hdrlen = 0;
+        context.mss = 0;
+        if (offload.segment_size) {
+            auto& tcp_packet = *(const TCPPacket*)(payload.data() + l4_header_start);
+            size_t header_size = l4_header_start + tcp_packet.header_size();
+            command |= TUCMD_TSE | (payload.size() - header_size);
+            context.hdrlen = header_size;
+            context.mss = offload.segment_size;
+            data_command |= DCMD_TSE;
+        }
+        context.paylen_and_command = command;
+        context.status = 0;
+        m_tx_tail = (m_tx_tail + 1) % number_of_tx_descriptors;
+
+        popts = POPTS_IXSM | POPTS_TXSM;
+        data_command |= DTYP_DATA | DCMD_DEXT;
+    }
+
+    for (size_t offset = 0; offset < payload.size(); offset += buffer_size) {
+        size_t chunk_size = min(payload.size() - offset, buffer_size);
+        bool is_last = offset + chunk_size == payload.size();
+        memcpy(tx_buffer(m_tx_tail), payload.offset(offset), chunk_size);
+        u64 buffer_address = m_tx_buffers_region->physical_page(0)->paddr().offset(m_tx_tail * buffer_size).get();
+        if (use_context) {
+            auto& descriptor = (e1000_tx_data_desc&)tx_descriptors[m_tx_tail];
+            descriptor.addr = buffer_address;
+            descriptor.popts = popts;
+            descriptor.status = 0;
+            descriptor.length_and_command = data_command | DCMD_IFCS | DCMD_RS | DCMD_IDE | (is_last ? DCMD_EOP : 0) | chunk_size;
+        } else {
+            auto& descriptor = tx_descriptors[m_tx_tail];
+            descriptor.addr = buffer_address;
+            descriptor.length = chunk_size;
+            descriptor.cso = 0;
+            descriptor.css = 0;
+            descriptor.status = 0;
+            descriptor.cmd = CMD_IFCS | CMD_RS | CMD_IDE | (is_last ? CMD_EOP : 0);
+        }
+        m_tx_tail = (m_tx_tail + 1) % number_of_tx_descriptors;
+    }
+
+    // The hardware takes it from here; we'll reclaim the descriptors on a later send.
+    out32(REG_TXDESCTAIL, m_tx_tail);
 }
 
 void E1000NetworkAdapter::receive()
 {
-    auto* rx_descriptors = (e1000_tx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
-    u32 rx_current;
+    auto* rx_descriptors = (e1000_rx_desc*)m_rx_descriptors_region->vaddr().as_ptr();
+    size_t old_rx_tail = m_rx_tail;
     for (;;) {
-        rx_current = in32(REG_RXDESCTAIL) % number_of_rx_descriptors;
-        if (rx_current == (in32(REG_RXDESCHEAD) % number_of_rx_descriptors))
-            return;
-        rx_current = (rx_current + 1) % number_of_rx_descriptors;
-        if (!(rx_descriptors[rx_current].status & 1))
+        size_t rx_current = (m_rx_tail + 1) % number_of_rx_descriptors;
+        auto& descriptor = rx_descriptors[rx_current];
+        if (!(descriptor.status & RSTA_DD))
             break;
-        auto* buffer = m_rx_buffers_regions[rx_current].vaddr().as_ptr();
-        u16 length = rx_descriptors[rx_current].length;
-        ASSERT(length <= 8192);
+        auto* buffer = rx_buffer(rx_current);
+        u16 length = descriptor.length;
+        ASSERT(length <= buffer_size);
+        // The hardware has already verified the checksums, so drop anything that was corrupted on the way.
+        bool checksum_error = ((descriptor.status & RSTA_IPCS) && (descriptor.errors & RERR_IPE))
+            || ((descriptor.status & RSTA_TCPCS) && (descriptor.errors & RERR_TCPE));
+        if (checksum_error) {
+#ifdef E1000_DEBUG
+            klog() << "E1000: Dropping packet with bad checksum (" << length << " bytes)";
+#endif
+        } else {
 #ifdef E1000_DEBUG
-        klog() << "E1000: Received 1 packet @ " << buffer << " (" << length << ") bytes!";
+            klog() << "E1000: Received 1 packet @ " << buffer << " (" << length << ") bytes!";
 #endif
-        did_receive({ buffer, length });
-        rx_descriptors[rx_current].status = 0;
-        out32(REG_RXDESCTAIL, rx_current);
+            did_receive({ buffer, length });
+        }
+        descriptor.status = 0;
+        descriptor.errors = 0;
+        m_rx_tail = rx_current;
     }
+    // Hand all the descriptors we're done with back at once.
+    if (m_rx_tail != old_rx_tail)
+        out32(REG_RXDESCTAIL, m_rx_tail);
 }
 
 }
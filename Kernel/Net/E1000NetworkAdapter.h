@@ -26,10 +26,11 @@
 
 #pragma once
 
-#include <AK/NonnullOwnPtrVector.h>
+#include <AK/NumericLimits.h>
 #include <AK/OwnPtr.h>
 #include <Kernel/IO.h>
 #include <Kernel/Interrupts/IRQHandler.h>
+#include <Kernel/Lock.h>
 #include <Kernel/Net/NetworkAdapter.h>
 #include <Kernel/PCI/Access.h>
 #include <Kernel/PCI/Device.h>
@@ -46,8 +47,12 @@ public:
     virtual ~E1000NetworkAdapter() override;
 
     virtual void send_raw(ReadonlyBytes) override;
+    virtual void send_raw_offloaded(ReadonlyBytes, const TransmitOffload&) override;
     virtual bool link_up() override;
 
+    virtual bool has_checksum_offload() const override { return true; }
+    virtual size_t max_segmentation_offload_size() const override { return NumericLimits<u16>::max(); }
+
     virtual const char* purpose() const override { return class_name(); }
 
 private:
@@ -73,6 +78,31 @@ private:
         volatile uint16_t special { 0 };
     };
 
+    // The extended descriptor formats, used for checksum and segmentation offload.
+    struct [[gnu::packed]] e1000_tx_context_desc {
+        volatile uint8_t ipcss { 0 };
+        volatile uint8_t ipcso { 0 };
+        volatile uint16_t ipcse { 0 };
+        volatile uint8_t tucss { 0 };
+        volatile uint8_t tucso { 0 };
+        volatile uint16_t tucse { 0 };
+        volatile uint32_t paylen_and_command { 0 };
+        volatile uint8_t status { 0 };
+        volatile uint8_t hdrlen { 0 };
+        volatile uint16_t mss { 0 };
+    };
+
+    struct [[gnu::packed]] e1000_tx_data_desc {
+        volatile uint64_t addr { 0 };
+        volatile uint32_t length_and_command { 0 };
+        volatile uint8_t status { 0 };
+        volatile uint8_t popts { 0 };
+        volatile uint16_t special { 0 };
+    };
+
+    static_assert(sizeof(e1000_tx_desc) == sizeof(e1000_tx_context_desc));
+    static_assert(sizeof(e1000_tx_desc) == sizeof(e1000_tx_data_desc));
+
     void detect_eeprom();
     u32 read_eeprom(u8 address);
     void read_mac_address();
@@ -91,21 +121,35 @@ private:
     u32 in32(u16 address);
 
     void receive();
+    void send_packet(ReadonlyBytes, const TransmitOffload&);
+    void reclaim_tx_descriptors();
+    size_t free_tx_descriptors() const { return number_of_tx_descriptors - 1 - (m_tx_tail - m_tx_clean + number_of_tx_descriptors) % number_of_tx_descriptors; }
+    u8* tx_buffer(size_t index) { return m_tx_buffers_region->vaddr().offset(index * buffer_size).as_ptr(); }
+    u8* rx_buffer(size_t index) { return m_rx_buffers_region->vaddr().offset(index * buffer_size).as_ptr(); }
 
     IOAddress m_io_base;
     VirtualAddress m_mmio_base;
     OwnPtr<Region> m_rx_descriptors_region;
     OwnPtr<Region> m_tx_descriptors_region;
-    NonnullOwnPtrVector<Region> m_rx_buffers_regions;
-    NonnullOwnPtrVector<Region> m_tx_buffers_regions;
+    OwnPtr<Region> m_rx_buffers_region;
+    OwnPtr<Region> m_tx_buffers_region;
     OwnPtr<Region> m_mmio_region;
     u8 m_interrupt_line { 0 };
     bool m_has_eeprom { false };
     bool m_use_mmio { false };
     EntropySource m_entropy_source;
 
-    static const size_t number_of_rx_descriptors = 32;
-    static const size_t number_of_tx_descriptors = 8;
+    static const size_t number_of_rx_descriptors = 256;
+    static const size_t number_of_tx_descriptors = 256;
+    static const size_t buffer_size = 2048;
+
+    // The last RX descriptor we handed back to the hardware.
+    size_t m_rx_tail { number_of_rx_descriptors - 1 };
+
+    // TX descriptors in [m_tx_clean, m_tx_tail) belong to the hardware until it marks them done.
+    Lock m_tx_lock { "E1000NetworkAdapter TX" };
+    size_t m_tx_tail { 0 };
+    size_t m_tx_clean { 0 };
 
     WaitQueue m_wait_queue;
 };
@@ -140,4 +140,20 @@ inline NetworkOrdered<u16> internet_checksum(const void* ptr, size_t count)
     return ~checksum & 0xffff;
 }
 
+// The sum of the TCP/UDP pseudo-header, which is what checksum offloading hardware expects
+// to find in the checksum field. Unlike internet_checksum(), the result is not inverted.
+inline NetworkOrdered<u16> ipv4_pseudo_header_checksum(const IPv4Address& source, const IPv4Address& destination, IPv4Protocol protocol, u16 length)
+{
+    u32 checksum = 0;
+    checksum += (source[0] << 8) | source[1];
+    checksum += (source[2] << 8) | source[3];
+    checksum += (destination[0] << 8) | destination[1];
+    checksum += (destination[2] << 8) | destination[3];
+    checksum += (u16)protocol;
+    checksum += length;
+    while (checksum >> 16)
+        checksum = (checksum & 0xffff) + (checksum >> 16);
+    return checksum;
+}
+
 }
@@ -192,6 +192,13 @@ bool IPv4Socket::can_write(const FileDescription&, size_t) const
     return is_connected();
 }
 
+bool IPv4Socket::has_hung_up(const FileDescription& description) const
+{
+    if (m_role == Role::Listener)
+        return false;
+    return protocol_is_disconnected() || Socket::has_hung_up(description);
+}
+
 int IPv4Socket::allocate_local_port_if_needed()
 {
     if (m_local_port)
@@ -262,6 +262,14 @@ bool LocalSocket::can_read(const FileDescription& description, size_t) const
     return false;
 }
 
+bool LocalSocket::has_hung_up(const FileDescription& description) const
+{
+    auto role = this->role(description);
+    if ((role == Role::Accepted || role == Role::Connected) && !has_attached_peer(description))
+        return true;
+    return Socket::has_hung_up(description);
+}
+
 bool LocalSocket::has_attached_peer(const FileDescription& description) const
 {
     auto role = this->role(description);
@@ -101,11 +101,17 @@ void NetworkAdapter::send(const MACAddress& destination, const ARPPacket& packet
     send_raw({ (const u8*)eth, size_in_bytes });
 }
 
-int NetworkAdapter::send_ipv4(const MACAddress& destination_mac, const IPv4Address& destination_ipv4, IPv4Protocol protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl)
+int NetworkAdapter::send_ipv4(const MACAddress& destination_mac, const IPv4Address& destination_ipv4, IPv4Protocol protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl, const TransmitOffload& offload)
 {
     size_t ipv4_packet_size = sizeof(IPv4Packet) + payload_size;
-    if (ipv4_packet_size > mtu())
+    if (offload.segment_size) {
+        ASSERT(offload.checksum);
+        ASSERT(protocol == IPv4Protocol::TCP);
+        ASSERT(ipv4_packet_size <= max_segmentation_offload_size());
+    } else if (ipv4_packet_size > mtu()) {
+        ASSERT(!offload.checksum);
         return send_ipv4_fragmented(destination_mac, destination_ipv4, protocol, payload, payload_size, ttl);
+    }
 
     size_t ethernet_frame_size = sizeof(EthernetFrameHeader) + sizeof(IPv4Packet) + payload_size;
     auto buffer = ByteBuffer::create_zeroed(ethernet_frame_size);
@@ -122,13 +128,17 @@ int NetworkAdapter::send_ipv4(const MACAddress& destination_mac, const IPv4Addre
     ipv4.set_length(sizeof(IPv4Packet) + payload_size);
     ipv4.set_ident(1);
     ipv4.set_ttl(ttl);
-    ipv4.set_checksum(ipv4.compute_checksum());
+    if (!offload.checksum)
+        ipv4.set_checksum(ipv4.compute_checksum());
     m_packets_out++;
     m_bytes_out += ethernet_frame_size;
 
     if (!payload.read(ipv4.payload(), payload_size))
         return -EFAULT;
-    send_raw({ (const u8*)&eth, ethernet_frame_size });
+    if (offload.checksum)
+        send_raw_offloaded({ (const u8*)&eth, ethernet_frame_size }, offload);
+    else
+        send_raw({ (const u8*)&eth, ethernet_frame_size });
     return 0;
 }
 
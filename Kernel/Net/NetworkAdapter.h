@@ -43,6 +43,17 @@ namespace Kernel {
 
 class NetworkAdapter;
 
+// Work a protocol leaves to the adapter when sending a packet.
+// Protocols only ask for what the adapter says it can do.
+struct TransmitOffload {
+    // Fill in the IPv4 header checksum, and the TCP or UDP checksum.
+    // The latter has to be primed with ipv4_pseudo_header_checksum().
+    bool checksum { false };
+    // Split the TCP payload into segments of this size. The pseudo-header checksum
+    // must be computed with a length of 0, since every segment has a different one.
+    u16 segment_size { 0 };
+};
+
 class NetworkAdapter : public RefCounted<NetworkAdapter> {
 public:
     static void for_each(Function<void(NetworkAdapter&)>);
@@ -59,12 +70,18 @@ public:
     IPv4Address ipv4_gateway() const { return m_ipv4_gateway; }
     virtual bool link_up() { return false; }
 
+    virtual bool has_checksum_offload() const { return false; }
+    // The largest IPv4 packet (including headers) the adapter can split into TCP segments, or 0.
+    virtual size_t max_segmentation_offload_size() const { return 0; }
+    // Every segment gets a checksum of its own, so segmentation offload is only usable along with checksum offload.
+    bool supports_tso() const { return has_checksum_offload() && max_segmentation_offload_size() > mtu(); }
+
     void set_ipv4_address(const IPv4Address&);
     void set_ipv4_netmask(const IPv4Address&);
     void set_ipv4_gateway(const IPv4Address&);
 
     void send(const MACAddress&, const ARPPacket&);
-    int send_ipv4(const MACAddress&, const IPv4Address&, IPv4Protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl);
+    int send_ipv4(const MACAddress&, const IPv4Address&, IPv4Protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl, const TransmitOffload& = {});
     int send_ipv4_fragmented(const MACAddress&, const IPv4Address&, IPv4Protocol, const UserOrKernelBuffer& payload, size_t payload_size, u8 ttl);
 
     size_t dequeue_packet(u8* buffer, size_t buffer_size, timeval& packet_timestamp);
@@ -86,6 +103,7 @@ protected:
     void set_interface_name(const StringView& basename);
     void set_mac_address(const MACAddress& mac_address) { m_mac_address = mac_address; }
     virtual void send_raw(ReadonlyBytes) = 0;
+    virtual void send_raw_offloaded(ReadonlyBytes, const TransmitOffload&) { ASSERT_NOT_REACHED(); }
     void did_receive(ReadonlyBytes);
 
 private:
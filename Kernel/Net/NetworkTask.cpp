@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/NonnullRefPtrVector.h>
 #include <Kernel/Lock.h>
 #include <Kernel/Net/ARP.h>
 #include <Kernel/Net/EtherType.h>
@@ -56,18 +57,30 @@ static void handle_ipv4(const EthernetFrameHeader&, size_t frame_size, const tim
 static void handle_icmp(const EthernetFrameHeader&, const IPv4Packet&, const timeval& packet_timestamp);
 static void handle_udp(const IPv4Packet&, const timeval& packet_timestamp);
 static void handle_tcp(const IPv4Packet&, const timeval& packet_timestamp);
+static void retransmit_tcp_packets();
 
 [[noreturn]] static void NetworkTask_main(void*);
 
+static WaitQueue* s_packet_wait_queue;
+static Atomic<bool> s_tcp_retransmit_pending { false };
+
 void NetworkTask::spawn()
 {
     RefPtr<Thread> thread;
     Process::create_kernel_process(thread, "NetworkTask", NetworkTask_main, nullptr);
 }
 
+void NetworkTask::tcp_retransmit_timer_expired()
+{
+    s_tcp_retransmit_pending.store(true, AK::MemoryOrder::memory_order_release);
+    if (s_packet_wait_queue)
+        s_packet_wait_queue->wake_all();
+}
+
 void NetworkTask_main(void*)
 {
     WaitQueue packet_wait_queue;
+    s_packet_wait_queue = &packet_wait_queue;
     u8 octet = 15;
     int pending_packets = 0;
     NetworkAdapter::for_each([&](auto& adapter) {
@@ -112,6 +125,10 @@ void NetworkTask_main(void*)
 
     klog() << "NetworkTask: Enter main loop.";
     for (;;) {
+        // A TCP socket's retransmission timer went off, so check on them even if packets keep coming in.
+        if (s_tcp_retransmit_pending.exchange(false, AK::MemoryOrder::memory_order_acq_rel))
+            retransmit_tcp_packets();
+
         size_t packet_size = dequeue_packet(buffer, buffer_size, packet_timestamp);
         if (!packet_size) {
             packet_wait_queue.wait_on(nullptr, "NetworkTask");
@@ -433,6 +450,7 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
             klog() << "handle_tcp: created new client socket with tuple " << client->tuple().to_string().characters();
 #endif
             client->set_sequence_number(1000);
+            client->process_syn_options(tcp_packet);
             client->set_ack_number(tcp_packet.sequence_number() + payload_size + 1);
             [[maybe_unused]] auto rc2 = client->send_tcp_packet(TCPFlags::SYN | TCPFlags::ACK);
             client->set_state(TCPSocket::State::SynReceived);
@@ -591,17 +609,42 @@ void handle_tcp(const IPv4Packet& ipv4_packet, const timeval& packet_timestamp)
             return;
         }
 
-        socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
+        if (!payload_size)
+            return;
+
+        if (tcp_packet.sequence_number() != socket->ack_number()) {
+            // This is either out of order or something we already have. Either way, let the peer know
+            // what we're actually waiting for, so it can retransmit that.
+#ifdef TCP_DEBUG
+            klog() << "Got out of order packet with seq_no=" << tcp_packet.sequence_number() << ", expected " << socket->ack_number();
+#endif
+            unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
+            return;
+        }
+
+        if (socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp))
+            socket->set_ack_number(tcp_packet.sequence_number() + payload_size);
 
 #ifdef TCP_DEBUG
         klog() << "Got packet with ack_no=" << tcp_packet.ack_number() << ", seq_no=" << tcp_packet.sequence_number() << ", payload_size=" << payload_size << ", acking it with new ack_no=" << socket->ack_number() << ", seq_no=" << socket->sequence_number();
 #endif
 
-        if (payload_size) {
-            if (socket->did_receive(ipv4_packet.source(), tcp_packet.source_port(), KBuffer::copy(&ipv4_packet, sizeof(IPv4Packet) + ipv4_packet.payload_size()), packet_timestamp))
-                unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
-        }
+        unused_rc = socket->send_tcp_packet(TCPFlags::ACK);
+    }
+}
+
+void retransmit_tcp_packets()
+{
+    // Keep the sockets alive while we work on them, but don't hold on to the table lock while doing so.
+    NonnullRefPtrVector<TCPSocket, 16> sockets;
+    {
+        LOCKER(TCPSocket::sockets_by_tuple().lock(), Lock::Mode::Shared);
+        for (auto& it : TCPSocket::sockets_by_tuple().resource())
+            sockets.append(*it.value);
     }
+
+    for (auto& socket : sockets)
+        socket.retransmit_packets();
 }
 
 }
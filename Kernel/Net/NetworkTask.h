@@ -30,5 +30,6 @@ namespace Kernel {
 class NetworkTask {
 public:
     static void spawn();
+    static void tcp_retransmit_timer_expired();
 };
 }
@@ -259,9 +259,15 @@ KResult Socket::shutdown(int how)
         shut_down_for_reading();
     m_shut_down_for_reading |= (how & SHUT_RD) != 0;
     m_shut_down_for_writing |= (how & SHUT_WR) != 0;
+    evaluate_block_conditions();
     return KSuccess;
 }
 
+bool Socket::has_hung_up(const FileDescription&) const
+{
+    return m_shut_down_for_reading && m_shut_down_for_writing;
+}
+
 KResult Socket::stat(::stat& st) const
 {
     memset(&st, 0, sizeof(st));
@@ -128,6 +128,7 @@ public:
     virtual KResultOr<size_t> write(FileDescription&, size_t, const UserOrKernelBuffer&, size_t) override final;
     virtual KResult stat(::stat&) const override;
     virtual String absolute_path(const FileDescription&) const override = 0;
+    virtual bool has_hung_up(const FileDescription&) const override;
 
     bool has_receive_timeout() const { return m_receive_timeout.tv_sec || m_receive_timeout.tv_usec; }
     const timeval& receive_timeout() const { return m_receive_timeout; }
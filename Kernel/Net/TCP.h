@@ -41,6 +41,15 @@ struct TCPFlags {
     };
 };
 
+struct TCPOptionKind {
+    enum : u8 {
+        End = 0,
+        NOP = 1,
+        MSS = 2,
+        WindowScale = 3,
+    };
+};
+
 class [[gnu::packed]] TCPPacket {
 public:
     TCPPacket() = default;
@@ -80,6 +89,10 @@ public:
     u16 urgent() const { return m_urgent; }
     void set_urgent(u16 urgent) { m_urgent = urgent; }
 
+    const u8* options() const { return ((const u8*)this) + sizeof(TCPPacket); }
+    u8* options() { return ((u8*)this) + sizeof(TCPPacket); }
+    size_t options_size() const { return header_size() - sizeof(TCPPacket); }
+
     const void* payload() const { return ((const u8*)this) + header_size(); }
     void* payload() { return ((u8*)this) + header_size(); }
 
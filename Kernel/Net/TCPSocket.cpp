@@ -24,11 +24,14 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/NumericLimits.h>
 #include <AK/Singleton.h>
+#include <AK/TemporaryChange.h>
 #include <AK/Time.h>
 #include <Kernel/Devices/RandomDevice.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/Net/NetworkAdapter.h>
+#include <Kernel/Net/NetworkTask.h>
 #include <Kernel/Net/Routing.h>
 #include <Kernel/Net/TCP.h>
 #include <Kernel/Net/TCPSocket.h>
@@ -39,6 +42,36 @@
 
 namespace Kernel {
 
+// Sequence numbers wrap around, so they have to be compared relative to each other.
+static inline bool seq_less_than(u32 a, u32 b)
+{
+    return (i32)(a - b) < 0;
+}
+
+static inline bool seq_greater_than(u32 a, u32 b)
+{
+    return (i32)(a - b) > 0;
+}
+
+static u32 milliseconds_between(const timeval& start, const timeval& end)
+{
+    timeval difference;
+    timeval_sub(end, start, difference);
+    if (difference.tv_sec < 0)
+        return 0;
+    return difference.tv_sec * 1000 + difference.tv_usec / 1000;
+}
+
+// The initial congestion window, as given in RFC 5681, section 3.1.
+static u32 initial_congestion_window(u32 mss)
+{
+    if (mss > 2190)
+        return 2 * mss;
+    if (mss > 1095)
+        return 3 * mss;
+    return 4 * mss;
+}
+
 void TCPSocket::for_each(Function<void(const TCPSocket&)> callback)
 {
     LOCKER(sockets_by_tuple().lock(), Lock::Mode::Shared);
@@ -154,6 +187,8 @@ TCPSocket::TCPSocket(int protocol)
 
 TCPSocket::~TCPSocket()
 {
+    stop_retransmission_timer();
+
     LOCKER(sockets_by_tuple().lock());
     sockets_by_tuple().resource().remove(tuple());
 
@@ -183,54 +218,129 @@ KResultOr<size_t> TCPSocket::protocol_receive(ReadonlyBytes raw_ipv4_packet, Use
 
 KResultOr<size_t> TCPSocket::protocol_send(const UserOrKernelBuffer& data, size_t data_length)
 {
-    int err = send_tcp_packet(TCPFlags::PUSH | TCPFlags::ACK, &data, data_length);
-    if (err < 0)
-        return KResult(err);
-    return data_length;
+    // Segments are queued one MSS at a time, so they can be retransmitted and acknowledged individually.
+    // send_outgoing_packets() hands runs of them to the adapter in one go if it can split them up again.
+    size_t nsent = 0;
+    {
+        LOCKER(m_not_acked_lock);
+        size_t space_in_send_buffer = send_buffer_size - min(send_buffer_size, m_not_acked_payload_size);
+        size_t mss = m_send_mss;
+        // Always take at least one segment, so that senders who don't wait for can_write() still make progress.
+        size_t bytes_to_send = min(data_length, max(space_in_send_buffer, mss));
+        TemporaryChange holding_back(m_holding_back_packets, true);
+        while (nsent < bytes_to_send) {
+            size_t segment_size = min(bytes_to_send - nsent, mss);
+            auto segment = data.offset(nsent);
+            int err = send_tcp_packet(TCPFlags::PUSH | TCPFlags::ACK, &segment, segment_size);
+            if (err < 0) {
+                if (nsent)
+                    break;
+                return KResult(err);
+            }
+            nsent += segment_size;
+        }
+    }
+    send_outgoing_packets();
+    return nsent;
+}
+
+bool TCPSocket::can_write(const FileDescription& description, size_t size) const
+{
+    if (!IPv4Socket::can_write(description, size))
+        return false;
+    return m_not_acked_payload_size < send_buffer_size;
+}
+
+void TCPSocket::set_sequence_number(u32 n)
+{
+    LOCKER(m_not_acked_lock);
+    m_sequence_number = n;
+    m_send_unacknowledged = n;
+    m_send_next = n;
+    m_send_max = n;
+    m_recover = n;
+    m_congestion_window = initial_congestion_window(m_send_mss);
+}
+
+u16 TCPSocket::advertised_window(bool is_syn) const
+{
+    // The window field of a SYN is never scaled.
+    size_t window = receive_buffer_space();
+    if (!is_syn)
+        window >>= m_receive_window_scale;
+    return min(window, (size_t)NumericLimits<u16>::max());
 }
 
 int TCPSocket::send_tcp_packet(u16 flags, const UserOrKernelBuffer* payload, size_t payload_size)
 {
-    const size_t buffer_size = sizeof(TCPPacket) + payload_size;
-    alignas(TCPPacket) u8 buffer[buffer_size];
-    new (buffer) TCPPacket;
-    auto& tcp_packet = *(TCPPacket*)(buffer);
+    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+    if (routing_decision.is_zero())
+        return -EHOSTUNREACH;
+
+    bool is_syn = flags & TCPFlags::SYN;
+    bool is_fin = flags & TCPFlags::FIN;
+    // A SYN carries our MSS, plus the window scale if we're the one offering it, or if the peer offered it to us.
+    bool include_window_scale = is_syn && (!(flags & TCPFlags::ACK) || m_window_scaling_offered);
+    size_t options_size = is_syn ? (include_window_scale ? 8 : 4) : 0;
+    size_t header_size = sizeof(TCPPacket) + options_size;
+
+    const size_t buffer_size = header_size + payload_size;
+    // NOTE: Segments can be as large as the interface MTU (64 KiB on loopback), so this doesn't go on the stack.
+    auto buffer = ByteBuffer::create_zeroed(buffer_size);
+    new (buffer.data()) TCPPacket;
+    auto& tcp_packet = *(TCPPacket*)(buffer.data());
     ASSERT(local_port());
     tcp_packet.set_source_port(local_port());
     tcp_packet.set_destination_port(peer_port());
-    tcp_packet.set_window_size(1024);
-    tcp_packet.set_sequence_number(m_sequence_number);
-    tcp_packet.set_data_offset(sizeof(TCPPacket) / sizeof(u32));
+    tcp_packet.set_window_size(advertised_window(is_syn));
+    tcp_packet.set_data_offset(header_size / sizeof(u32));
     tcp_packet.set_flags(flags);
 
+    if (is_syn) {
+        u16 local_mss = routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket);
+        u8* options = tcp_packet.options();
+        options[0] = TCPOptionKind::MSS;
+        options[1] = 4;
+        options[2] = local_mss >> 8;
+        options[3] = local_mss & 0xff;
+        if (include_window_scale) {
+            options[4] = TCPOptionKind::NOP;
+            options[5] = TCPOptionKind::WindowScale;
+            options[6] = 3;
+            options[7] = receive_window_scale;
+        }
+    }
+
     if (flags & TCPFlags::ACK)
         tcp_packet.set_ack_number(m_ack_number);
 
     if (payload && !payload->read(tcp_packet.payload(), payload_size))
         return -EFAULT;
 
-    if (flags & TCPFlags::SYN) {
-        ++m_sequence_number;
-    } else {
-        m_sequence_number += payload_size;
-    }
-
-    tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
-
-    if (tcp_packet.has_syn() || payload_size > 0) {
+    if (is_syn || is_fin || payload_size > 0) {
+        // This occupies sequence space, so it goes through the retransmission queue.
         LOCKER(m_not_acked_lock);
-        m_not_acked.append({ m_sequence_number, ByteBuffer::copy(buffer, buffer_size) });
-        send_outgoing_packets();
+        u32 sequence_number = m_sequence_number;
+        m_sequence_number += payload_size + (is_syn ? 1 : 0) + (is_fin ? 1 : 0);
+        tcp_packet.set_sequence_number(sequence_number);
+        m_not_acked.append({ sequence_number, m_sequence_number, move(buffer) });
+        m_not_acked_payload_size += payload_size;
+        if (!m_holding_back_packets)
+            send_outgoing_packets();
         return 0;
     }
 
-    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
-    ASSERT(!routing_decision.is_zero());
+    {
+        // A bare ACK or RST refers to the next byte we'll actually put on the wire, not what's queued behind it.
+        LOCKER(m_not_acked_lock, Lock::Mode::Shared);
+        tcp_packet.set_sequence_number(m_send_next);
+    }
+    auto offload = finish_checksum(tcp_packet, payload_size, *routing_decision.adapter);
 
-    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer);
+    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer.data());
     int err = routing_decision.adapter->send_ipv4(
         routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
-        packet_buffer, buffer_size, ttl());
+        packet_buffer, buffer_size, ttl(), offload);
     if (err < 0)
         return err;
 
@@ -239,69 +349,415 @@ int TCPSocket::send_tcp_packet(u16 flags, const UserOrKernelBuffer* payload, siz
     return 0;
 }
 
+void TCPSocket::did_transmit_packet(OutgoingPacket& packet)
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    packet.tx_time = kgettimeofday();
+    packet.tx_counter++;
+    // Every time a segment goes out, the timer is started if it isn't running already (RFC 6298, section 5.1).
+    if (!m_retransmission_timer_id)
+        start_retransmission_timer(m_retransmission_timeout_ms);
+    if (seq_greater_than(packet.ack_number, m_send_next))
+        m_send_next = packet.ack_number;
+    if (seq_greater_than(m_send_next, m_send_max))
+        m_send_max = m_send_next;
+}
+
+int TCPSocket::transmit_packet(OutgoingPacket& packet, RoutingDecision& routing_decision)
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    auto& tcp_packet = *(TCPPacket*)(packet.buffer.data());
+
+    // The packet may have been queued for a while, so make it carry our latest ACK and window.
+    if (tcp_packet.has_ack())
+        tcp_packet.set_ack_number(m_ack_number);
+    tcp_packet.set_window_size(advertised_window(tcp_packet.has_syn()));
+    auto offload = finish_checksum(tcp_packet, packet.buffer.size() - tcp_packet.header_size(), *routing_decision.adapter);
+
+    did_transmit_packet(packet);
+
+#ifdef TCP_SOCKET_DEBUG
+    klog() << "sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", tx_counter=" << packet.tx_counter;
+#endif
+    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(packet.buffer.data());
+    int err = routing_decision.adapter->send_ipv4(
+        routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
+        packet_buffer, packet.buffer.size(), ttl(), offload);
+    if (err < 0) {
+        klog() << "Error (" << err << ") sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", tx_counter=" << packet.tx_counter;
+        return err;
+    }
+
+    m_packets_out++;
+    m_bytes_out += packet.buffer.size();
+    return 0;
+}
+
+int TCPSocket::transmit_packets_offloaded(Vector<OutgoingPacket*, 32>& packets, RoutingDecision& routing_decision)
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    ASSERT(packets.size() > 1);
+
+    // Glue the payloads together behind the first packet's header, and let the adapter cut them up again.
+    auto& first_tcp_packet = *(const TCPPacket*)(packets.first()->buffer.data());
+    size_t header_size = first_tcp_packet.header_size();
+    size_t payload_size = 0;
+    for (auto* packet : packets)
+        payload_size += packet->buffer.size() - ((const TCPPacket*)packet->buffer.data())->header_size();
+    auto buffer = ByteBuffer::create_uninitialized(header_size + payload_size);
+    memcpy(buffer.data(), packets.first()->buffer.data(), header_size);
+    size_t offset = header_size;
+    for (auto* packet : packets) {
+        size_t packet_header_size = ((const TCPPacket*)packet->buffer.data())->header_size();
+        memcpy(buffer.data() + offset, packet->buffer.data() + packet_header_size, packet->buffer.size() - packet_header_size);
+        offset += packet->buffer.size() - packet_header_size;
+    }
+
+    auto& tcp_packet = *(TCPPacket*)(buffer.data());
+    tcp_packet.set_ack_number(m_ack_number);
+    tcp_packet.set_window_size(advertised_window(false));
+    auto offload = finish_checksum(tcp_packet, payload_size, *routing_decision.adapter);
+    ASSERT(offload.segment_size);
+
+    for (auto* packet : packets)
+        did_transmit_packet(*packet);
+
+    auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(buffer.data());
+    int err = routing_decision.adapter->send_ipv4(
+        routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
+        packet_buffer, buffer.size(), ttl(), offload);
+    if (err < 0) {
+        klog() << "Error (" << err << ") sending " << packets.size() << " offloaded tcp segments from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with seq_no=" << tcp_packet.sequence_number();
+        return err;
+    }
+
+    m_packets_out += packets.size();
+    m_bytes_out += buffer.size();
+    return 0;
+}
+
+TransmitOffload TCPSocket::finish_checksum(TCPPacket& tcp_packet, size_t payload_size, const NetworkAdapter& adapter) const
+{
+    TransmitOffload offload;
+    size_t tcp_length = tcp_packet.header_size() + payload_size;
+    size_t ipv4_packet_size = sizeof(IPv4Packet) + tcp_length;
+    bool needs_segmentation = payload_size > m_send_mss;
+    bool can_offload = needs_segmentation
+        ? adapter.supports_tso() && ipv4_packet_size <= adapter.max_segmentation_offload_size()
+        : adapter.has_checksum_offload() && ipv4_packet_size <= adapter.mtu();
+
+    tcp_packet.set_checksum(0);
+    if (!can_offload) {
+        tcp_packet.set_checksum(compute_tcp_checksum(local_address(), peer_address(), tcp_packet, payload_size));
+        return offload;
+    }
+
+    offload.checksum = true;
+    if (needs_segmentation) {
+        offload.segment_size = m_send_mss;
+        tcp_length = 0;
+    }
+    tcp_packet.set_checksum(ipv4_pseudo_header_checksum(local_address(), peer_address(), IPv4Protocol::TCP, tcp_length));
+    return offload;
+}
+
 void TCPSocket::send_outgoing_packets()
 {
     auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
-    ASSERT(!routing_decision.is_zero());
-
-    auto now = kgettimeofday();
+    if (routing_decision.is_zero())
+        return;
+
+    LOCKER(m_not_acked_lock);
+    u32 window = min(m_congestion_window, m_send_window);
+    auto& adapter = *routing_decision.adapter;
+    size_t max_offload_payload_size = adapter.supports_tso() ? adapter.max_segmentation_offload_size() - sizeof(IPv4Packet) - sizeof(TCPPacket) : 0;
+
+    // Consecutive full-sized data segments are collected here, so the adapter can send them all at once.
+    Vector<OutgoingPacket*, 32> run;
+    u32 run_size = 0;
+    auto flush_run = [&] {
+        int err = 0;
+        if (run.size() == 1)
+            err = transmit_packet(*run.first(), routing_decision);
+        else if (run.size() > 1)
+            err = transmit_packets_offloaded(run, routing_decision);
+        run.clear_with_capacity();
+        run_size = 0;
+        return err;
+    };
 
-    LOCKER(m_not_acked_lock, Lock::Mode::Shared);
     for (auto& packet : m_not_acked) {
-        timeval diff;
-        timeval_sub(packet.tx_time, now, diff);
-        if (diff.tv_sec == 0 && diff.tv_usec <= 500000)
+        if (seq_less_than(packet.sequence_number, m_send_next))
             continue;
-        packet.tx_time = now;
-        packet.tx_counter++;
+        u32 in_flight = bytes_in_flight() + run_size;
+        u32 packet_size = packet.ack_number - packet.sequence_number;
+        // With nothing in flight, one segment is always allowed out. If the peer's window is closed,
+        // that acts as a window probe, and the retransmission timer keeps probing until it opens up.
+        if (in_flight && in_flight + packet_size > window)
+            break;
+
+        auto& tcp_packet = *(const TCPPacket*)packet.buffer.data();
+        bool can_join_run = max_offload_payload_size
+            && !tcp_packet.has_syn() && !tcp_packet.has_fin()
+            && tcp_packet.header_size() == sizeof(TCPPacket)
+            && run.size() < run.capacity();
+        if (!can_join_run) {
+            if (flush_run() < 0 || transmit_packet(packet, routing_decision) < 0)
+                return;
+            continue;
+        }
+        // The adapter splits at MSS boundaries, so only the last segment of a run may be short,
+        // or the segments on the wire wouldn't line up with the ones we have queued.
+        if (!run.is_empty() && (run.last()->ack_number - run.last()->sequence_number != m_send_mss || run_size + packet_size > max_offload_payload_size)) {
+            if (flush_run() < 0)
+                return;
+        }
+        run.append(&packet);
+        run_size += packet_size;
+    }
+    [[maybe_unused]] auto rc = flush_run();
+}
+
+void TCPSocket::retransmit_first_unacknowledged_packet()
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    if (m_not_acked.is_empty())
+        return;
+    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+    if (routing_decision.is_zero())
+        return;
+    ++m_retransmissions;
+    [[maybe_unused]] auto rc = transmit_packet(m_not_acked.first(), routing_decision);
+}
+
+void TCPSocket::retransmit_packets()
+{
+    LOCKER(m_not_acked_lock);
+    // Our timer may or may not be the one that went off, so start over and re-arm it below as needed.
+    stop_retransmission_timer();
+    if (m_not_acked.is_empty())
+        return;
+
+    if (state() == State::Closed) {
+        m_not_acked.clear();
+        m_not_acked_payload_size = 0;
+        return;
+    }
+
+    auto& packet = m_not_acked.first();
+    if (!seq_less_than(packet.sequence_number, m_send_next)) {
+        // Nothing is in flight, so there's nothing to time out. Just see if the window has opened up.
+        send_outgoing_packets();
+        if (!m_retransmission_timer_id)
+            start_retransmission_timer(m_retransmission_timeout_ms);
+        return;
+    }
+
+    u32 elapsed_ms = milliseconds_between(packet.tx_time, kgettimeofday());
+    if (elapsed_ms < m_retransmission_timeout_ms) {
+        start_retransmission_timer(m_retransmission_timeout_ms - elapsed_ms);
+        return;
+    }
 
 #ifdef TCP_SOCKET_DEBUG
-        auto& tcp_packet = *(TCPPacket*)(packet.buffer.data());
-        klog() << "sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", tx_counter=" << packet.tx_counter;
+    dbg() << "TCPSocket: retransmission timeout (" << m_retransmission_timeout_ms << " ms) for seq_no=" << packet.sequence_number;
 #endif
-        auto packet_buffer = UserOrKernelBuffer::for_kernel_buffer(packet.buffer.data());
-        int err = routing_decision.adapter->send_ipv4(
-            routing_decision.next_hop, peer_address(), IPv4Protocol::TCP,
-            packet_buffer, packet.buffer.size(), ttl());
-        if (err < 0) {
-            auto& tcp_packet = *(TCPPacket*)(packet.buffer.data());
-            klog() << "Error (" << err << ") sending tcp packet from " << local_address().to_string().characters() << ":" << local_port() << " to " << peer_address().to_string().characters() << ":" << peer_port() << " with (" << (tcp_packet.has_syn() ? "SYN " : "") << (tcp_packet.has_ack() ? "ACK " : "") << (tcp_packet.has_fin() ? "FIN " : "") << (tcp_packet.has_rst() ? "RST " : "") << ") seq_no=" << tcp_packet.sequence_number() << ", ack_no=" << tcp_packet.ack_number() << ", tx_counter=" << packet.tx_counter;
-        } else {
-            m_packets_out++;
-            m_bytes_out += packet.buffer.size();
+
+    // The retransmission timer went off, so assume everything in flight was lost (RFC 5681, section 3.1),
+    // back off the timer (RFC 6298, section 5), and start over from the first unacknowledged segment.
+    m_slow_start_threshold = max(bytes_in_flight() / 2, 2u * m_send_mss);
+    m_congestion_window = m_send_mss;
+    m_duplicate_acks = 0;
+    m_in_fast_recovery = false;
+    m_recover = m_send_max;
+    m_retransmission_timeout_ms = min(m_retransmission_timeout_ms * 2, max_retransmission_timeout_ms);
+    m_send_next = packet.sequence_number;
+    ++m_retransmissions;
+    send_outgoing_packets();
+    if (!m_retransmission_timer_id)
+        start_retransmission_timer(m_retransmission_timeout_ms);
+}
+
+void TCPSocket::start_retransmission_timer(u32 timeout_ms)
+{
+    ASSERT(m_not_acked_lock.is_locked());
+    ASSERT(!m_retransmission_timer_id);
+    timeval timeout { (time_t)(timeout_ms / 1000), (suseconds_t)((timeout_ms % 1000) * 1000) };
+    // The timer fires in a deferred call, where we can't take our locks. Let NetworkTask do the work.
+    m_retransmission_timer_id = TimerQueue::the().add_timer(CLOCK_MONOTONIC_COARSE, timeout, [] {
+        NetworkTask::tcp_retransmit_timer_expired();
+    });
+}
+
+void TCPSocket::stop_retransmission_timer()
+{
+    if (!m_retransmission_timer_id)
+        return;
+    // This fails harmlessly if the timer has already fired.
+    TimerQueue::the().cancel_timer(m_retransmission_timer_id);
+    m_retransmission_timer_id = 0;
+}
+
+void TCPSocket::update_rtt_estimate(u32 rtt_ms)
+{
+    if (!m_has_rtt_sample) {
+        m_smoothed_rtt_ms = rtt_ms;
+        m_rtt_variance_ms = rtt_ms / 2;
+        m_has_rtt_sample = true;
+    } else {
+        u32 delta = m_smoothed_rtt_ms > rtt_ms ? m_smoothed_rtt_ms - rtt_ms : rtt_ms - m_smoothed_rtt_ms;
+        m_rtt_variance_ms = (3 * m_rtt_variance_ms + delta) / 4;
+        m_smoothed_rtt_ms = (7 * m_smoothed_rtt_ms + rtt_ms) / 8;
+    }
+    // NOTE: RFC 6298 asks for a minimum of one second, but like most stacks we go lower than that.
+    u32 timeout = m_smoothed_rtt_ms + max(clock_granularity_ms, 4 * m_rtt_variance_ms);
+    m_retransmission_timeout_ms = min(max(timeout, min_retransmission_timeout_ms), max_retransmission_timeout_ms);
+}
+
+void TCPSocket::process_syn_options(const TCPPacket& packet)
+{
+    u16 mss = default_mss;
+    bool has_window_scale = false;
+    u8 window_scale = 0;
+
+    auto* options = packet.options();
+    size_t options_size = packet.options_size();
+    for (size_t i = 0; i < options_size;) {
+        u8 kind = options[i];
+        if (kind == TCPOptionKind::End)
+            break;
+        if (kind == TCPOptionKind::NOP) {
+            ++i;
+            continue;
         }
+        if (i + 1 >= options_size)
+            break;
+        u8 length = options[i + 1];
+        if (length < 2 || i + length > options_size)
+            break;
+        if (kind == TCPOptionKind::MSS && length == 4) {
+            mss = (options[i + 2] << 8) | options[i + 3];
+        } else if (kind == TCPOptionKind::WindowScale && length == 3) {
+            has_window_scale = true;
+            window_scale = min(options[i + 2], (u8)14);
+        }
+        i += length;
     }
+
+    // Don't send segments that are larger than what our own interface can carry, either.
+    auto routing_decision = route_to(peer_address(), local_address(), bound_interface());
+    if (!routing_decision.is_zero())
+        mss = min(mss, (u16)(routing_decision.adapter->mtu() - sizeof(IPv4Packet) - sizeof(TCPPacket)));
+
+#ifdef TCP_SOCKET_DEBUG
+    dbg() << "TCPSocket: peer sent mss=" << mss << ", window_scale=" << (has_window_scale ? window_scale : -1);
+#endif
+
+    LOCKER(m_not_acked_lock);
+    m_send_mss = max(mss, (u16)64);
+    // Window scaling is only in effect if both sides sent the option (RFC 7323, section 2.2).
+    m_window_scaling_offered = has_window_scale;
+    m_send_window_scale = has_window_scale ? window_scale : 0;
+    m_receive_window_scale = has_window_scale ? receive_window_scale : 0;
+    m_send_window = packet.window_size();
+    m_congestion_window = initial_congestion_window(m_send_mss);
 }
 
 void TCPSocket::receive_tcp_packet(const TCPPacket& packet, u16 size)
 {
+    if (packet.has_syn() && state() == State::SynSent)
+        process_syn_options(packet);
+
     if (packet.has_ack()) {
         u32 ack_number = packet.ack_number();
+        size_t payload_size = size - packet.header_size();
 
 #ifdef TCP_SOCKET_DEBUG
         dbg() << "TCPSocket: receive_tcp_packet: " << ack_number;
 #endif
 
-        int removed = 0;
         LOCKER(m_not_acked_lock);
-        while (!m_not_acked.is_empty()) {
-            auto& packet = m_not_acked.first();
+        m_send_window = (u32)packet.window_size() << (packet.has_syn() ? 0 : m_send_window_scale);
+
+        if (seq_greater_than(ack_number, m_send_unacknowledged) && !seq_greater_than(ack_number, m_send_max)) {
+            u32 acknowledged_bytes = ack_number - m_send_unacknowledged;
+            auto now = kgettimeofday();
+            Optional<u32> rtt_sample;
+            int removed = 0;
+            while (!m_not_acked.is_empty()) {
+                auto& outgoing_packet = m_not_acked.first();
 
 #ifdef TCP_SOCKET_DEBUG
-            dbg() << "TCPSocket: iterate: " << packet.ack_number;
+                dbg() << "TCPSocket: iterate: " << outgoing_packet.ack_number;
 #endif
 
-            if (packet.ack_number <= ack_number) {
+                if (seq_greater_than(outgoing_packet.ack_number, ack_number))
+                    break;
+                // Karn's algorithm: a retransmitted packet doesn't tell us which transmission was acknowledged.
+                if (outgoing_packet.tx_counter == 1)
+                    rtt_sample = milliseconds_between(outgoing_packet.tx_time, now);
+                auto& tcp_packet = *(const TCPPacket*)outgoing_packet.buffer.data();
+                m_not_acked_payload_size -= outgoing_packet.buffer.size() - tcp_packet.header_size();
                 m_not_acked.take_first();
                 removed++;
+            }
+
+#ifdef TCP_SOCKET_DEBUG
+            dbg() << "TCPSocket: receive_tcp_packet acknowledged " << removed << " packets";
+#endif
+
+            if (rtt_sample.has_value())
+                update_rtt_estimate(rtt_sample.value());
+
+            m_send_unacknowledged = ack_number;
+            if (seq_less_than(m_send_next, ack_number))
+                m_send_next = ack_number;
+            m_duplicate_acks = 0;
+
+            // New data was acknowledged, so restart the timer, or stop it if everything is (RFC 6298, section 5.2 and 5.3).
+            stop_retransmission_timer();
+            if (!m_not_acked.is_empty())
+                start_retransmission_timer(m_retransmission_timeout_ms);
+
+            if (m_in_fast_recovery) {
+                if (!seq_less_than(ack_number, m_recover)) {
+                    // Full acknowledgment, so we're done recovering (RFC 6582, section 3.2, step 3).
+                    m_congestion_window = m_slow_start_threshold;
+                    m_in_fast_recovery = false;
+                } else {
+                    // Partial acknowledgment: the next segment was lost too (RFC 6582, section 3.2, step 4).
+                    retransmit_first_unacknowledged_packet();
+                    m_congestion_window = m_congestion_window > acknowledged_bytes ? m_congestion_window - acknowledged_bytes : 0;
+                    m_congestion_window += m_send_mss;
+                }
+            } else if (m_congestion_window < m_slow_start_threshold) {
+                // Slow start.
+                m_congestion_window += min(acknowledged_bytes, (u32)m_send_mss);
             } else {
-                break;
+                // Congestion avoidance: grow by about one segment per round trip.
+                m_congestion_window += max(1u, (u32)m_send_mss * m_send_mss / m_congestion_window);
             }
-        }
 
+            // There's room in the send buffer again.
+            evaluate_block_conditions();
+        } else if (ack_number == m_send_unacknowledged && payload_size == 0 && !packet.has_syn() && !packet.has_fin() && bytes_in_flight()) {
+            ++m_duplicate_acks;
+            if (m_in_fast_recovery) {
+                m_congestion_window += m_send_mss;
+            } else if (m_duplicate_acks == 3 && !seq_less_than(ack_number, m_recover)) {
+                // Fast retransmit (RFC 5681, section 3.2).
 #ifdef TCP_SOCKET_DEBUG
-        dbg() << "TCPSocket: receive_tcp_packet acknowledged " << removed << " packets";
+                dbg() << "TCPSocket: fast retransmit of seq_no=" << ack_number;
 #endif
+                m_slow_start_threshold = max(bytes_in_flight() / 2, 2u * m_send_mss);
+                m_recover = m_send_max;
+                m_in_fast_recovery = true;
+                retransmit_first_unacknowledged_packet();
+                m_congestion_window = m_slow_start_threshold + 3 * m_send_mss;
+            }
+        }
+
+        send_outgoing_packets();
     }
 
     m_packets_in++;
@@ -318,7 +774,7 @@ NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, c
         NetworkOrdered<u16> payload_size;
     };
 
-    PseudoHeader pseudo_header { source, destination, 0, (u8)IPv4Protocol::TCP, sizeof(TCPPacket) + payload_size };
+    PseudoHeader pseudo_header { source, destination, 0, (u8)IPv4Protocol::TCP, (u16)(packet.header_size() + payload_size) };
 
     u32 checksum = 0;
     auto* w = (const NetworkOrdered<u16>*)&pseudo_header;
@@ -328,12 +784,11 @@ NetworkOrdered<u16> TCPSocket::compute_tcp_checksum(const IPv4Address& source, c
             checksum = (checksum >> 16) + (checksum & 0xffff);
     }
     w = (const NetworkOrdered<u16>*)&packet;
-    for (size_t i = 0; i < sizeof(packet) / sizeof(u16); ++i) {
+    for (size_t i = 0; i < packet.header_size() / sizeof(u16); ++i) {
         checksum += w[i];
         if (checksum > 0xffff)
             checksum = (checksum >> 16) + (checksum & 0xffff);
     }
-    ASSERT(packet.data_offset() * 4 == sizeof(TCPPacket));
     w = (const NetworkOrdered<u16>*)packet.payload();
     for (size_t i = 0; i < payload_size / sizeof(u16); ++i) {
         checksum += w[i];
@@ -384,7 +839,7 @@ KResult TCPSocket::protocol_connect(FileDescription& description, ShouldBlock sh
 
     allocate_local_port_if_needed();
 
-    m_sequence_number = get_good_random<u32>();
+    set_sequence_number(get_good_random<u32>());
     m_ack_number = 0;
 
     set_setup_state(SetupState::InProgress);
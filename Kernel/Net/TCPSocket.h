@@ -31,6 +31,8 @@
 #include <AK/SinglyLinkedList.h>
 #include <AK/WeakPtr.h>
 #include <Kernel/Net/IPv4Socket.h>
+#include <Kernel/Net/Routing.h>
+#include <Kernel/TimerQueue.h>
 
 namespace Kernel {
 
@@ -140,17 +142,25 @@ public:
     void set_error(Error error) { m_error = error; }
 
     void set_ack_number(u32 n) { m_ack_number = n; }
-    void set_sequence_number(u32 n) { m_sequence_number = n; }
+    void set_sequence_number(u32 n);
     u32 ack_number() const { return m_ack_number; }
     u32 sequence_number() const { return m_sequence_number; }
     u32 packets_in() const { return m_packets_in; }
     u32 bytes_in() const { return m_bytes_in; }
     u32 packets_out() const { return m_packets_out; }
     u32 bytes_out() const { return m_bytes_out; }
+    u32 congestion_window() const { return m_congestion_window; }
+    u32 slow_start_threshold() const { return m_slow_start_threshold; }
+    u32 send_window() const { return m_send_window; }
+    u32 smoothed_rtt_ms() const { return m_smoothed_rtt_ms; }
+    u32 retransmission_timeout_ms() const { return m_retransmission_timeout_ms; }
+    u32 retransmissions() const { return m_retransmissions; }
 
     [[nodiscard]] int send_tcp_packet(u16 flags, const UserOrKernelBuffer* = nullptr, size_t = 0);
     void send_outgoing_packets();
+    void retransmit_packets();
     void receive_tcp_packet(const TCPPacket&, u16 size);
+    void process_syn_options(const TCPPacket&);
 
     static Lockable<HashMap<IPv4SocketTuple, TCPSocket*>>& sockets_by_tuple();
     static RefPtr<TCPSocket> from_tuple(const IPv4SocketTuple& tuple);
@@ -165,6 +175,8 @@ public:
     void release_for_accept(RefPtr<TCPSocket>);
 
     virtual KResult close() override;
+    virtual bool can_write(const FileDescription&, size_t) const override;
+    virtual bool has_pending_error(const FileDescription&) const override { return has_error(); }
 
 protected:
     void set_direction(Direction direction) { m_direction = direction; }
@@ -175,6 +187,15 @@ private:
 
     static NetworkOrdered<u16> compute_tcp_checksum(const IPv4Address& source, const IPv4Address& destination, const TCPPacket&, u16 payload_size);
 
+    static constexpr u16 default_mss = 536;
+    // Our receive buffer fits in an unscaled window, but sending the option lets the peer scale its own window.
+    static constexpr u8 receive_window_scale = 0;
+    static constexpr size_t send_buffer_size = 256 * KiB;
+    static constexpr u32 initial_retransmission_timeout_ms = 1000;
+    static constexpr u32 min_retransmission_timeout_ms = 200;
+    static constexpr u32 max_retransmission_timeout_ms = 60000;
+    static constexpr u32 clock_granularity_ms = 10;
+
     virtual void shut_down_for_writing() override;
 
     virtual KResultOr<size_t> protocol_receive(ReadonlyBytes raw_ipv4_packet, UserOrKernelBuffer& buffer, size_t buffer_size, int flags) override;
@@ -199,14 +220,58 @@ private:
     u32 m_bytes_out { 0 };
 
     struct OutgoingPacket {
+        u32 sequence_number { 0 };
         u32 ack_number { 0 };
         ByteBuffer buffer;
         int tx_counter { 0 };
         timeval tx_time { 0, 0 };
     };
 
+    u16 advertised_window(bool is_syn) const;
+    int transmit_packet(OutgoingPacket&, RoutingDecision&);
+    int transmit_packets_offloaded(Vector<OutgoingPacket*, 32>&, RoutingDecision&);
+    void did_transmit_packet(OutgoingPacket&);
+    TransmitOffload finish_checksum(TCPPacket&, size_t payload_size, const NetworkAdapter&) const;
+    void retransmit_first_unacknowledged_packet();
+    void update_rtt_estimate(u32 rtt_ms);
+    void start_retransmission_timer(u32 timeout_ms);
+    void stop_retransmission_timer();
+    u32 bytes_in_flight() const { return (i32)(m_send_next - m_send_unacknowledged) > 0 ? m_send_next - m_send_unacknowledged : 0; }
+
+    // NOTE: m_not_acked_lock also protects all the send state below.
     Lock m_not_acked_lock { "TCPSocket unacked packets" };
     SinglyLinkedList<OutgoingPacket> m_not_acked;
+    size_t m_not_acked_payload_size { 0 };
+    // Set while protocol_send() queues up segments, so they can go out together afterwards.
+    bool m_holding_back_packets { false };
+
+    // The sequence number range [m_send_unacknowledged, m_send_next) has been sent, but not yet acknowledged.
+    // Queued packets from m_send_next onwards are waiting for the send or congestion window to open up.
+    // m_send_max is the highest sequence number ever sent; it's only ahead of m_send_next after a timeout.
+    u32 m_send_unacknowledged { 0 };
+    u32 m_send_next { 0 };
+    u32 m_send_max { 0 };
+    u32 m_send_window { 0 };
+    u8 m_send_window_scale { 0 };
+    u8 m_receive_window_scale { 0 };
+    bool m_window_scaling_offered { false };
+    u16 m_send_mss { default_mss };
+
+    // Congestion control, as described in RFC 5681 (NewReno fast recovery as in RFC 6582).
+    u32 m_congestion_window { 0 };
+    u32 m_slow_start_threshold { 0xffffffff };
+    u32 m_duplicate_acks { 0 };
+    bool m_in_fast_recovery { false };
+    u32 m_recover { 0 };
+
+    // Round-trip time estimation, as described in RFC 6298.
+    bool m_has_rtt_sample { false };
+    u32 m_smoothed_rtt_ms { 0 };
+    u32 m_rtt_variance_ms { 0 };
+    u32 m_retransmission_timeout_ms { initial_retransmission_timeout_ms };
+    // Only armed while there is unacknowledged data, so idle sockets don't wake up NetworkTask.
+    TimerId m_retransmission_timer_id { 0 };
+    u32 m_retransmissions { 0 };
 };
 
 }
@@ -107,7 +107,14 @@ KResultOr<size_t> UDPSocket::protocol_send(const UserOrKernelBuffer& data, size_
     if (!data.read(udp_packet.payload(), data_length))
         return KResult(-EFAULT);
 
-    routing_decision.adapter->send_ipv4(routing_decision.next_hop, peer_address(), IPv4Protocol::UDP, UserOrKernelBuffer::for_kernel_buffer(buffer), buffer_size, ttl());
+    // The UDP checksum is optional, so we only fill it in when the adapter can do it for us.
+    TransmitOffload offload;
+    if (routing_decision.adapter->has_checksum_offload() && sizeof(IPv4Packet) + buffer_size <= routing_decision.adapter->mtu()) {
+        offload.checksum = true;
+        udp_packet.set_checksum(ipv4_pseudo_header_checksum(routing_decision.adapter->ipv4_address(), peer_address(), IPv4Protocol::UDP, buffer_size));
+    }
+
+    routing_decision.adapter->send_ipv4(routing_decision.next_hop, peer_address(), IPv4Protocol::UDP, UserOrKernelBuffer::for_kernel_buffer(buffer), buffer_size, ttl(), offload);
     return data_length;
 }
 
@@ -25,7 +25,6 @@
  */
 
 #include <AK/Demangle.h>
-#include <AK/QuickSort.h>
 #include <AK/StdLibExtras.h>
 #include <AK/StringBuilder.h>
 #include <AK/Time.h>
@@ -37,6 +36,7 @@
 #include <Kernel/FileSystem/Custody.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/FutexQueue.h>
 #include <Kernel/Heap/kmalloc.h>
 #include <Kernel/KBufferBuilder.h>
 #include <Kernel/KSyms.h>
@@ -65,6 +65,7 @@ static void create_signal_trampolines();
 
 RecursiveSpinLock g_processes_lock;
 static Atomic<pid_t> next_pid;
+static Atomic<u32> s_statistics_generation;
 InlineLinkedList<Process>* g_processes;
 String* g_hostname;
 Lock* g_hostname_lock;
@@ -81,6 +82,16 @@ ProcessID Process::allocate_pid()
     return next_pid.fetch_add(1, AK::MemoryOrder::memory_order_acq_rel);
 }
 
+u32 Process::next_statistics_generation()
+{
+    return s_statistics_generation.fetch_add(1, AK::MemoryOrder::memory_order_relaxed) + 1;
+}
+
+u32 Process::current_statistics_generation()
+{
+    return s_statistics_generation.load(AK::MemoryOrder::memory_order_relaxed);
+}
+
 void Process::initialize()
 {
     g_modules = new HashMap<String, OwnPtr<Module>>;
@@ -193,44 +204,38 @@ Region* Process::allocate_region_with_vmobject(VirtualAddress vaddr, size_t size
 bool Process::deallocate_region(Region& region)
 {
     OwnPtr<Region> region_protector;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
 
     if (m_region_lookup_cache.region.unsafe_ptr() == &region)
         m_region_lookup_cache.region = nullptr;
-    for (size_t i = 0; i < m_regions.size(); ++i) {
-        if (&m_regions[i] == &region) {
-            region_protector = m_regions.unstable_take(i);
-            return true;
-        }
-    }
-    return false;
+    auto* owned_region = m_regions.find(region.vaddr().get());
+    if (!owned_region || owned_region->ptr() != &region)
+        return false;
+    region_protector = m_regions.take(region.vaddr().get()).release_value();
+    return true;
 }
 
 Region* Process::find_region_from_range(const Range& range)
 {
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     if (m_region_lookup_cache.range == range && m_region_lookup_cache.region)
         return m_region_lookup_cache.region.unsafe_ptr();
 
-    size_t size = PAGE_ROUND_UP(range.size());
-    for (auto& region : m_regions) {
-        if (region.vaddr() == range.base() && region.size() == size) {
-            m_region_lookup_cache.range = range;
-            m_region_lookup_cache.region = region;
-            return &region;
-        }
-    }
-    return nullptr;
+    auto* region = m_regions.find(range.base().get());
+    if (!region || (*region)->size() != PAGE_ROUND_UP(range.size()))
+        return nullptr;
+    m_region_lookup_cache.range = range;
+    m_region_lookup_cache.region = **region;
+    return region->ptr();
 }
 
 Region* Process::find_region_containing(const Range& range)
 {
-    ScopedSpinLock lock(m_lock);
-    for (auto& region : m_regions) {
-        if (region.contains(range))
-            return &region;
-    }
-    return nullptr;
+    ScopedSpinLock lock(m_address_space_lock);
+    auto* region = m_regions.find_largest_not_above(range.base().get());
+    if (!region || !(*region)->contains(range))
+        return nullptr;
+    return region->ptr();
 }
 
 void Process::kill_threads_except_self()
@@ -382,18 +387,10 @@ void Process::dump_regions()
     klog() << "Process regions:";
     klog() << "BEGIN       END         SIZE        ACCESS  NAME";
 
-    ScopedSpinLock lock(m_lock);
-
-    Vector<Region*> sorted_regions;
-    sorted_regions.ensure_capacity(m_regions.size());
-    for (auto& region : m_regions)
-        sorted_regions.append(&region);
-    quick_sort(sorted_regions, [](auto& a, auto& b) {
-        return a->vaddr() < b->vaddr();
-    });
+    ScopedSpinLock lock(m_address_space_lock);
 
-    for (auto& sorted_region : sorted_regions) {
-        auto& region = *sorted_region;
+    for (auto& owned_region : m_regions) {
+        auto& region = *owned_region;
         klog() << String::format("%08x", region.vaddr().get()) << " -- " << String::format("%08x", region.vaddr().offset(region.size() - 1).get()) << "    " << String::format("%08x", region.size()) << "    " << (region.is_readable() ? 'R' : ' ') << (region.is_writable() ? 'W' : ' ') << (region.is_executable() ? 'X' : ' ') << (region.is_shared() ? 'S' : ' ') << (region.is_stack() ? 'T' : ' ') << (region.vmobject().is_purgeable() ? 'P' : ' ') << "    " << region.name().characters();
     }
     MM.dump_kernel_regions();
@@ -628,8 +625,11 @@ void Process::finalize()
     if (m_alarm_timer)
         TimerQueue::the().cancel_timer(m_alarm_timer.release_nonnull());
     m_fds.clear();
+    // A priority-inheriting futex queue keeps its owner thread alive, and the thread keeps us alive.
+    m_futex_queues.clear();
     m_tty = nullptr;
     m_executable = nullptr;
+    statistics_did_change();
     m_cwd = nullptr;
     m_root_directory = nullptr;
     m_root_directory_relative_to_global_root = nullptr;
@@ -658,7 +658,7 @@ void Process::finalize()
     unblock_waiters(Thread::WaitBlocker::UnblockFlags::Terminated);
 
     {
-        ScopedSpinLock lock(m_lock);
+        ScopedSpinLock lock(m_address_space_lock);
         m_regions.clear();
     }
 
@@ -688,6 +688,7 @@ void Process::die()
     // If the master PTY owner relies on an EOF to know when to wait() on a
     // slave owner, we have to allow the PTY pair to be torn down.
     m_tty = nullptr;
+    statistics_did_change();
 
     kill_all_threads();
 }
@@ -698,10 +699,10 @@ size_t Process::amount_dirty_private() const
     //        The main issue I'm thinking of is when the VMObject has physical pages that none of the Regions are mapping.
     //        That's probably a situation that needs to be looked at in general.
     size_t amount = 0;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     for (auto& region : m_regions) {
-        if (!region.is_shared())
-            amount += region.amount_dirty();
+        if (!region->is_shared())
+            amount += region->amount_dirty();
     }
     return amount;
 }
@@ -710,10 +711,10 @@ size_t Process::amount_clean_inode() const
 {
     HashTable<const InodeVMObject*> vmobjects;
     {
-        ScopedSpinLock lock(m_lock);
+        ScopedSpinLock lock(m_address_space_lock);
         for (auto& region : m_regions) {
-            if (region.vmobject().is_inode())
-                vmobjects.set(&static_cast<const InodeVMObject&>(region.vmobject()));
+            if (region->vmobject().is_inode())
+                vmobjects.set(&static_cast<const InodeVMObject&>(region->vmobject()));
         }
     }
     size_t amount = 0;
@@ -725,9 +726,9 @@ size_t Process::amount_clean_inode() const
 size_t Process::amount_virtual() const
 {
     size_t amount = 0;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     for (auto& region : m_regions) {
-        amount += region.size();
+        amount += region->size();
     }
     return amount;
 }
@@ -736,9 +737,9 @@ size_t Process::amount_resident() const
 {
     // FIXME: This will double count if multiple regions use the same physical page.
     size_t amount = 0;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     for (auto& region : m_regions) {
-        amount += region.amount_resident();
+        amount += region->amount_resident();
     }
     return amount;
 }
@@ -750,9 +751,9 @@ size_t Process::amount_shared() const
     //        and each PhysicalPage is only reffed by its VMObject. This needs to be refactored
     //        so that every Region contributes +1 ref to each of its PhysicalPages.
     size_t amount = 0;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     for (auto& region : m_regions) {
-        amount += region.amount_shared();
+        amount += region->amount_shared();
     }
     return amount;
 }
@@ -760,10 +761,10 @@ size_t Process::amount_shared() const
 size_t Process::amount_purgeable_volatile() const
 {
     size_t amount = 0;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     for (auto& region : m_regions) {
-        if (region.vmobject().is_purgeable() && static_cast<const PurgeableVMObject&>(region.vmobject()).is_volatile())
-            amount += region.amount_resident();
+        if (region->vmobject().is_purgeable() && static_cast<const PurgeableVMObject&>(region->vmobject()).is_volatile())
+            amount += region->amount_resident();
     }
     return amount;
 }
@@ -771,10 +772,10 @@ size_t Process::amount_purgeable_volatile() const
 size_t Process::amount_purgeable_nonvolatile() const
 {
     size_t amount = 0;
-    ScopedSpinLock lock(m_lock);
+    ScopedSpinLock lock(m_address_space_lock);
     for (auto& region : m_regions) {
-        if (region.vmobject().is_purgeable() && !static_cast<const PurgeableVMObject&>(region.vmobject()).is_volatile())
-            amount += region.amount_resident();
+        if (region->vmobject().is_purgeable() && !static_cast<const PurgeableVMObject&>(region->vmobject()).is_volatile())
+            amount += region->amount_resident();
     }
     return amount;
 }
@@ -878,14 +879,15 @@ void Process::set_root_directory(const Custody& root)
 Region& Process::add_region(NonnullOwnPtr<Region> region)
 {
     auto* ptr = region.ptr();
-    ScopedSpinLock lock(m_lock);
-    m_regions.append(move(region));
+    ScopedSpinLock lock(m_address_space_lock);
+    m_regions.insert(ptr->vaddr().get(), move(region));
     return *ptr;
 }
 
 void Process::set_tty(TTY* tty)
 {
     m_tty = tty;
+    statistics_did_change();
 }
 
 void Process::start_tracing_from(ProcessID tracer)
@@ -31,6 +31,7 @@
 #include <AK/InlineLinkedList.h>
 #include <AK/NonnullOwnPtrVector.h>
 #include <AK/NonnullRefPtrVector.h>
+#include <AK/RedBlackTree.h>
 #include <AK/String.h>
 #include <AK/Userspace.h>
 #include <AK/WeakPtr.h>
@@ -180,6 +181,13 @@ public:
     gid_t sgid() const { return m_sgid; }
     ProcessID ppid() const { return m_ppid; }
 
+    // The statistics generation is bumped whenever something other than the counters
+    // reported by get_process_statistics() changes, like the name or the pledge.
+    static u32 next_statistics_generation();
+    static u32 current_statistics_generation();
+    u32 statistics_generation() const { return m_statistics_generation; }
+    void statistics_did_change() { m_statistics_generation = next_statistics_generation(); }
+
     bool is_dumpable() const { return m_dumpable; }
     void set_dumpable(bool dumpable) { m_dumpable = dumpable; }
 
@@ -324,6 +332,8 @@ public:
     int sys$getpeername(Userspace<const Syscall::SC_getpeername_params*>);
     int sys$sched_setparam(pid_t pid, Userspace<const struct sched_param*>);
     int sys$sched_getparam(pid_t pid, Userspace<struct sched_param*>);
+    int sys$sched_setaffinity(pid_t tid, size_t cpusetsize, Userspace<const cpu_set_t*>);
+    int sys$sched_getaffinity(pid_t tid, size_t cpusetsize, Userspace<cpu_set_t*>);
     int sys$create_thread(void* (*)(void*), Userspace<const Syscall::SC_create_thread_params*>);
     void sys$exit_thread(Userspace<void*>);
     int sys$join_thread(pid_t tid, Userspace<void**> exit_value);
@@ -364,6 +374,13 @@ public:
     void* sys$allocate_tls(size_t);
     int sys$prctl(int option, FlatPtr arg1, FlatPtr arg2);
     int sys$set_coredump_metadata(Userspace<const Syscall::SC_set_coredump_metadata_params*>);
+    ssize_t sys$splice(Userspace<const Syscall::SC_splice_params*>);
+    int sys$epoll_create1(int flags);
+    int sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*>);
+    int sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*>);
+    ssize_t sys$sendfile(Userspace<const Syscall::SC_sendfile_params*>);
+    ssize_t sys$get_process_statistics(Userspace<const Syscall::SC_get_process_statistics_params*>);
+    int sys$swapon(int fd, size_t size);
 
     template<bool sockname, typename Params>
     int get_sock_or_peer_name(const Params&);
@@ -378,11 +395,12 @@ public:
     void set_tty(TTY*);
 
     size_t region_count() const { return m_regions.size(); }
-    const NonnullOwnPtrVector<Region>& regions() const
+    const RedBlackTree<FlatPtr, NonnullOwnPtr<Region>>& regions() const
     {
-        ASSERT(m_lock.is_locked());
+        ASSERT(m_address_space_lock.is_locked());
         return m_regions;
     }
+    RecursiveSpinLock& address_space_lock() const { return m_address_space_lock; }
     void dump_regions();
 
     u32 m_ticks_in_user { 0 };
@@ -436,6 +454,7 @@ public:
         return m_euid == 0;
     }
 
+    Range allocate_range(VirtualAddress, size_t, size_t alignment = PAGE_SIZE);
     Region* allocate_region_with_vmobject(VirtualAddress, size_t, NonnullRefPtr<VMObject>, size_t offset_in_vmobject, const String& name, int prot);
     Region* allocate_region(VirtualAddress, size_t, const String& name, int prot = PROT_READ | PROT_WRITE, bool should_commit = true);
     Region* allocate_region_with_vmobject(const Range&, NonnullRefPtr<VMObject>, size_t offset_in_vmobject, const String& name, int prot);
@@ -511,8 +530,6 @@ private:
     Process(RefPtr<Thread>& first_thread, const String& name, uid_t, gid_t, ProcessID ppid, bool is_kernel_process, RefPtr<Custody> cwd = nullptr, RefPtr<Custody> executable = nullptr, TTY* = nullptr, Process* fork_parent = nullptr);
     static ProcessID allocate_pid();
 
-    Range allocate_range(VirtualAddress, size_t, size_t alignment = PAGE_SIZE);
-
     Region& add_region(NonnullOwnPtr<Region>);
 
     void kill_threads_except_self();
@@ -548,6 +565,7 @@ private:
     Process* m_next { nullptr };
 
     String m_name;
+    u32 m_statistics_generation { next_statistics_generation() };
 
     ProcessID m_pid { 0 };
     SessionID m_sid { 0 };
@@ -605,7 +623,11 @@ private:
     Region* find_region_from_range(const Range&);
     Region* find_region_containing(const Range&);
 
-    NonnullOwnPtrVector<Region> m_regions;
+    // Keyed by base address, so that the region containing an address can be found in O(log n).
+    RedBlackTree<FlatPtr, NonnullOwnPtr<Region>> m_regions;
+    // Protects m_regions, and is held while handling page faults in them. Each process has its own,
+    // so faults in different processes don't serialize. It's taken before s_mm_lock.
+    mutable RecursiveSpinLock m_address_space_lock;
     struct RegionLookupCache {
         Range range;
         WeakPtr<Region> region;
@@ -636,8 +658,10 @@ private:
     VeilState m_veil_state { VeilState::None };
     UnveilNode m_unveiled_paths { "/", { .full_path = "/", .unveil_inherited_from_root = true } };
 
-    WaitQueue& futex_queue(Userspace<const i32*>);
-    HashMap<u32, OwnPtr<WaitQueue>> m_futex_queues;
+    RefPtr<FutexQueue> find_futex_queue(FlatPtr user_address, bool create_if_missing);
+    void release_futex_queue_if_unused(FlatPtr user_address);
+    void update_inherited_priority(Thread&);
+    HashMap<FlatPtr, NonnullRefPtr<FutexQueue>> m_futex_queues;
 
     OwnPtr<PerformanceEventBuffer> m_perf_event_buffer;
 
@@ -751,7 +775,7 @@ inline const LogStream& operator<<(const LogStream& stream, const Process& proce
 
 inline u32 Thread::effective_priority() const
 {
-    return m_priority + m_process->priority_boost() + m_priority_boost + m_extra_priority;
+    return base_priority() + m_process->priority_boost() + m_priority_boost + m_extra_priority;
 }
 
 #define REQUIRE_NO_PROMISES                        \
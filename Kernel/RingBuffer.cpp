@@ -0,0 +1,177 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/StdLibExtras.h>
+#include <Kernel/RingBuffer.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+size_t RingBuffer::round_up_capacity(size_t size)
+{
+    size_t capacity = PAGE_SIZE;
+    while (capacity < size)
+        capacity <<= 1;
+    return capacity;
+}
+
+RingBuffer::RingBuffer(size_t capacity)
+    : m_capacity(capacity)
+{
+    ASSERT(capacity && (capacity & (capacity - 1)) == 0);
+    m_storage = make<KBuffer>(KBuffer::create_with_size(capacity, Region::Access::Read | Region::Access::Write, "RingBuffer"));
+}
+
+KResultOr<size_t> RingBuffer::write_with(size_t size, TransferCallback callback)
+{
+    if (!size)
+        return 0;
+    LOCKER(m_write_lock);
+    size_t tail = m_tail.load(AK::memory_order_relaxed);
+    size_t head = m_head.load(AK::memory_order_acquire);
+    size_t bytes_to_write = min(size, m_capacity - (tail - head));
+
+    size_t nwritten = 0;
+    while (nwritten < bytes_to_write) {
+        size_t offset = offset_of(tail + nwritten);
+        size_t chunk_size = min(bytes_to_write - nwritten, m_capacity - offset);
+        auto result = callback(m_storage->data() + offset, chunk_size);
+        if (result.is_error()) {
+            if (nwritten == 0)
+                return result.error();
+            break;
+        }
+        nwritten += result.value();
+        if (result.value() < chunk_size)
+            break;
+    }
+
+    if (nwritten) {
+        // Publish the data only once it's all in place.
+        m_tail.store(tail + nwritten, AK::memory_order_release);
+        if (m_unblock_callback)
+            m_unblock_callback();
+    }
+    return nwritten;
+}
+
+KResultOr<size_t> RingBuffer::read_with(size_t size, TransferCallback callback)
+{
+    if (!size)
+        return 0;
+    LOCKER(m_read_lock);
+    size_t head = m_head.load(AK::memory_order_relaxed);
+    size_t tail = m_tail.load(AK::memory_order_acquire);
+    size_t bytes_to_read = min(size, tail - head);
+
+    size_t nread = 0;
+    while (nread < bytes_to_read) {
+        size_t offset = offset_of(head + nread);
+        size_t chunk_size = min(bytes_to_read - nread, m_capacity - offset);
+        auto result = callback(m_storage->data() + offset, chunk_size);
+        if (result.is_error()) {
+            if (nread == 0)
+                return result.error();
+            break;
+        }
+        nread += result.value();
+        if (result.value() < chunk_size)
+            break;
+    }
+
+    if (nread) {
+        m_head.store(head + nread, AK::memory_order_release);
+        if (m_unblock_callback)
+            m_unblock_callback();
+    }
+    return nread;
+}
+
+ssize_t RingBuffer::write(const UserOrKernelBuffer& data, size_t size)
+{
+    size_t nwritten = 0;
+    auto result = write_with(size, [&](u8* chunk, size_t chunk_size) -> KResultOr<size_t> {
+        if (!data.read(chunk, nwritten, chunk_size))
+            return KResult(-EFAULT);
+        nwritten += chunk_size;
+        return chunk_size;
+    });
+    if (result.is_error())
+        return result.error();
+    return (ssize_t)result.value();
+}
+
+ssize_t RingBuffer::read(UserOrKernelBuffer& data, size_t size)
+{
+    size_t nread = 0;
+    auto result = read_with(size, [&](u8* chunk, size_t chunk_size) -> KResultOr<size_t> {
+        if (!data.write(chunk, nread, chunk_size))
+            return KResult(-EFAULT);
+        nread += chunk_size;
+        return chunk_size;
+    });
+    if (result.is_error())
+        return result.error();
+    return (ssize_t)result.value();
+}
+
+KResult RingBuffer::set_capacity(size_t capacity)
+{
+    ASSERT(capacity && (capacity & (capacity - 1)) == 0);
+    // NOTE: The read lock is taken first, so that nobody ever holds the write lock while waiting for a read lock.
+    //       That keeps a splice() from one pipe into another from deadlocking against us.
+    Locker read_locker(m_read_lock);
+    Locker write_locker(m_write_lock);
+    if (capacity == m_capacity)
+        return KSuccess;
+
+    size_t head = m_head.load(AK::memory_order_relaxed);
+    size_t tail = m_tail.load(AK::memory_order_relaxed);
+    if (tail - head > capacity)
+        return KResult(-EBUSY);
+
+    auto storage = KBuffer::try_create_with_size(capacity, Region::Access::Read | Region::Access::Write, "RingBuffer");
+    if (!storage)
+        return KResult(-ENOMEM);
+
+    // Keep the positions as they are, and move every byte to where that position lands in the new buffer.
+    size_t new_mask = capacity - 1;
+    for (size_t position = head; position < tail;) {
+        size_t old_offset = offset_of(position);
+        size_t new_offset = position & new_mask;
+        size_t chunk_size = min(tail - position, min(m_capacity - old_offset, capacity - new_offset));
+        memcpy(storage->data() + new_offset, m_storage->data() + old_offset, chunk_size);
+        position += chunk_size;
+    }
+
+    m_storage = move(storage);
+    m_capacity = capacity;
+    if (m_unblock_callback)
+        m_unblock_callback();
+    return KSuccess;
+}
+
+}
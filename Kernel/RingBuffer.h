@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Atomic.h>
+#include <AK/Function.h>
+#include <AK/OwnPtr.h>
+#include <AK/Types.h>
+#include <Kernel/KBuffer.h>
+#include <Kernel/KResult.h>
+#include <Kernel/Lock.h>
+#include <Kernel/UserOrKernelBuffer.h>
+
+namespace Kernel {
+
+// A byte ring buffer with one producer and one consumer side.
+// Readers and writers are only serialized against their own side, so a reader never
+// has to wait for a writer (or vice versa) to get at the buffer.
+class RingBuffer {
+public:
+    static constexpr size_t default_capacity = 65536;
+
+    explicit RingBuffer(size_t capacity = default_capacity);
+
+    [[nodiscard]] ssize_t write(const UserOrKernelBuffer&, size_t);
+    [[nodiscard]] ssize_t read(UserOrKernelBuffer&, size_t);
+
+    // These hand out the buffer memory directly, so data can be moved from (or to)
+    // another file without bouncing through an intermediate buffer. The callback gets
+    // a contiguous chunk of the buffer and returns how many bytes it produced (or consumed).
+    using TransferCallback = Function<KResultOr<size_t>(u8*, size_t)>;
+    [[nodiscard]] KResultOr<size_t> write_with(size_t, TransferCallback);
+    [[nodiscard]] KResultOr<size_t> read_with(size_t, TransferCallback);
+
+    bool is_empty() const { return used_bytes() == 0; }
+    size_t used_bytes() const { return m_tail.load(AK::memory_order_acquire) - m_head.load(AK::memory_order_acquire); }
+    size_t space_for_writing() const { return m_capacity - used_bytes(); }
+    size_t capacity() const { return m_capacity; }
+
+    // The capacity is always a power of two, and at least one page.
+    static size_t round_up_capacity(size_t);
+    KResult set_capacity(size_t);
+
+    void set_unblock_callback(Function<void()> callback)
+    {
+        ASSERT(!m_unblock_callback);
+        m_unblock_callback = move(callback);
+    }
+
+private:
+    size_t offset_of(size_t position) const { return position & (m_capacity - 1); }
+
+    OwnPtr<KBuffer> m_storage;
+    size_t m_capacity { 0 };
+
+    // Both positions only ever grow; the buffer offset is the position modulo the capacity.
+    // The writer owns m_tail and the reader owns m_head.
+    Atomic<size_t> m_head { 0 };
+    Atomic<size_t> m_tail { 0 };
+
+    Function<void()> m_unblock_callback;
+    Lock m_write_lock { "RingBuffer write" };
+    Lock m_read_lock { "RingBuffer read" };
+};
+
+}
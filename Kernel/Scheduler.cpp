@@ -24,7 +24,6 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <AK/QuickSort.h>
 #include <AK/ScopeGuard.h>
 #include <AK/TemporaryChange.h>
 #include <AK/Time.h>
@@ -34,6 +33,7 @@
 #include <Kernel/Scheduler.h>
 #include <Kernel/Time/TimeManagement.h>
 #include <Kernel/TimerQueue.h>
+#include <Kernel/VM/MemoryManager.h>
 
 //#define LOG_EVERY_CONTEXT_SWITCH
 //#define SCHEDULER_DEBUG
@@ -41,18 +41,6 @@
 
 namespace Kernel {
 
-class SchedulerPerProcessorData {
-    AK_MAKE_NONCOPYABLE(SchedulerPerProcessorData);
-    AK_MAKE_NONMOVABLE(SchedulerPerProcessorData);
-
-public:
-    SchedulerPerProcessorData() = default;
-
-    WeakPtr<Thread> m_pending_beneficiary;
-    const char* m_pending_donate_reason { nullptr };
-    bool m_in_scheduler { true };
-};
-
 SchedulerData* g_scheduler_data;
 RecursiveSpinLock g_scheduler_lock;
 
@@ -62,6 +50,255 @@ void Scheduler::init_thread(Thread& thread)
     g_scheduler_data->m_nonrunnable_threads.append(thread);
 }
 
+// Every this many ticks the BSP moves queued threads from the busiest
+// run queue to the least busy one.
+static constexpr u32 load_balance_interval_ticks = 25;
+static constexpr u32 max_migrations_per_balance = 4;
+
+u32 SchedulerData::select_run_queue_for(const Thread& thread) const
+{
+    u32 candidates = thread.affinity() & m_online_run_queues.load(AK::MemoryOrder::memory_order_relaxed);
+    if (!candidates) {
+        // None of the processors this thread may run on are scheduling yet.
+        // Park it on the boot processor, the processor it's meant for will
+        // steal it once it starts up.
+        return 0;
+    }
+
+    // The lengths are only a hint, so there's no need to lock the queues here.
+    auto length_of = [&](u32 cpu) {
+        return Processor::by_id(cpu).get_scheduler_data().m_run_queue_length.load(AK::MemoryOrder::memory_order_relaxed);
+    };
+
+    u32 least_loaded_cpu = __builtin_ctz(candidates);
+    u32 least_load = length_of(least_loaded_cpu);
+    for (u32 cpu = least_loaded_cpu + 1; cpu < max_run_queues; cpu++) {
+        if (!(candidates & (1u << cpu)))
+            continue;
+        u32 load = length_of(cpu);
+        if (load < least_load) {
+            least_loaded_cpu = cpu;
+            least_load = load;
+        }
+    }
+
+    // Prefer the processor the thread last ran on, its caches are likely
+    // still warm. Only give that up if it's clearly busier than the others.
+    u32 last_cpu = thread.cpu();
+    if (last_cpu < max_run_queues && (candidates & (1u << last_cpu)) && length_of(last_cpu) <= least_load + 1)
+        return last_cpu;
+    return least_loaded_cpu;
+}
+
+SchedulerPerProcessorData* SchedulerData::lock_run_queue_of(const Thread& thread, u32& prev_flags)
+{
+    for (;;) {
+        u32 cpu = thread.m_run_queue_cpu;
+        if (cpu == Thread::not_on_a_run_queue)
+            return nullptr;
+        auto& queue = run_queue(cpu);
+        prev_flags = queue.m_run_queue_lock.lock();
+        if (thread.m_run_queue_cpu == cpu)
+            return &queue;
+        // It was moved to another queue in the meantime.
+        queue.m_run_queue_lock.unlock(prev_flags);
+    }
+}
+
+u32 SchedulerData::lock_all_run_queues(u32 (&prev_flags)[max_run_queues])
+{
+    u32 locked_run_queues = 0;
+    for (u32 cpu = 0; cpu < max_run_queues; cpu++) {
+        if (!has_run_queue(cpu))
+            continue;
+        prev_flags[cpu] = run_queue(cpu).m_run_queue_lock.lock();
+        locked_run_queues |= 1u << cpu;
+    }
+    return locked_run_queues;
+}
+
+void SchedulerData::unlock_all_run_queues(u32 locked_run_queues, u32 (&prev_flags)[max_run_queues])
+{
+    for (u32 cpu = max_run_queues; cpu-- > 0;) {
+        if (locked_run_queues & (1u << cpu))
+            run_queue(cpu).m_run_queue_lock.unlock(prev_flags[cpu]);
+    }
+}
+
+void SchedulerData::enqueue(Thread& thread, u32 cpu)
+{
+    ASSERT(g_scheduler_lock.own_lock());
+    ASSERT(!is_queued(thread));
+    auto& queue = run_queue(cpu);
+    ScopedSpinLock lock(queue.m_run_queue_lock);
+    if (m_nonrunnable_threads.contains(thread))
+        m_nonrunnable_threads.remove(thread);
+    queue.m_run_queue.append(thread);
+    queue.m_run_queue_length++;
+    thread.m_run_queue_cpu = cpu;
+}
+
+void SchedulerData::dequeue(Thread& thread)
+{
+    ASSERT(g_scheduler_lock.own_lock());
+    u32 prev_flags;
+    auto* queue = lock_run_queue_of(thread, prev_flags);
+    if (!queue)
+        return;
+    queue->m_run_queue.remove(thread);
+    ASSERT(queue->m_run_queue_length.load() > 0);
+    queue->m_run_queue_length--;
+    thread.m_run_queue_cpu = Thread::not_on_a_run_queue;
+    queue->m_run_queue_lock.unlock(prev_flags);
+}
+
+bool SchedulerData::migrate(Thread& thread, u32 to_cpu)
+{
+    auto& to_queue = run_queue(to_cpu);
+    for (;;) {
+        u32 from_cpu = thread.m_run_queue_cpu;
+        if (from_cpu == Thread::not_on_a_run_queue)
+            return false;
+        if (from_cpu == to_cpu)
+            return true;
+
+        // Always lock the lower numbered queue first, so that two processors
+        // moving threads in opposite directions can't deadlock.
+        auto& from_queue = run_queue(from_cpu);
+        auto& first_queue = from_cpu < to_cpu ? from_queue : to_queue;
+        auto& second_queue = from_cpu < to_cpu ? to_queue : from_queue;
+        ScopedSpinLock first_lock(first_queue.m_run_queue_lock);
+        ScopedSpinLock second_lock(second_queue.m_run_queue_lock);
+        if (thread.m_run_queue_cpu != from_cpu)
+            continue;
+
+        from_queue.m_run_queue.remove(thread);
+        from_queue.m_run_queue_length--;
+        from_queue.m_migrations_out++;
+        to_queue.m_run_queue.append(thread);
+        to_queue.m_run_queue_length++;
+        to_queue.m_migrations_in++;
+        thread.m_run_queue_cpu = to_cpu;
+        return true;
+    }
+}
+
+void SchedulerData::requeue_if_disallowed(Thread& thread)
+{
+    ASSERT(g_scheduler_lock.own_lock());
+    u32 cpu = thread.m_run_queue_cpu;
+    if (cpu == Thread::not_on_a_run_queue || (thread.affinity() & (1u << cpu)))
+        return;
+    migrate(thread, select_run_queue_for(thread));
+}
+
+static bool is_schedulable_on(Thread& thread, u32 cpu, Thread* current_thread)
+{
+    if ((thread.affinity() & (1u << cpu)) == 0)
+        return false;
+    if (&thread == current_thread)
+        return thread.state() == Thread::Running || thread.state() == Thread::Runnable;
+    // A thread that was woken up right after blocking may still be executing on
+    // another processor's stack until that processor has switched away from it.
+    if (thread.is_active())
+        return false;
+    return thread.state() == Thread::Runnable;
+}
+
+static bool is_held_back_by_exec(Thread& thread)
+{
+    return thread.process().exec_tid() && thread.process().exec_tid() != thread.tid();
+}
+
+static RefPtr<Thread> steal_thread_for(u32 cpu)
+{
+    auto& scheduler_data = *g_scheduler_data;
+
+    RefPtr<Thread> stolen_thread;
+    [[maybe_unused]] u32 stolen_from_cpu = 0;
+    for (u32 victim_cpu = 0; victim_cpu < SchedulerData::max_run_queues; victim_cpu++) {
+        if (victim_cpu == cpu || !scheduler_data.is_run_queue_online(victim_cpu))
+            continue;
+        auto& victim = scheduler_data.run_queue(victim_cpu);
+        if (victim.m_run_queue_length.load(AK::MemoryOrder::memory_order_relaxed) == 0)
+            continue;
+        RefPtr<Thread> candidate;
+        {
+            ScopedSpinLock lock(victim.m_run_queue_lock);
+            Thread* best_thread = nullptr;
+            for (auto& thread : victim.m_run_queue) {
+                // Running threads are busy on the victim processor, and idle
+                // threads are pinned, so the affinity check also skips those.
+                if (thread.state() != Thread::Runnable || thread.is_active() || (thread.affinity() & (1u << cpu)) == 0 || is_held_back_by_exec(thread))
+                    continue;
+                if (!best_thread || thread.effective_priority() > best_thread->effective_priority())
+                    best_thread = &thread;
+            }
+            // Queued threads are kept alive by their own reference, so it's fine
+            // to take another one while we hold the queue's lock.
+            if (best_thread && (!stolen_thread || best_thread->effective_priority() > stolen_thread->effective_priority()))
+                candidate = best_thread;
+        }
+        // Let go of the previous candidate only after dropping the lock, in case
+        // that was the last reference to it.
+        if (candidate) {
+            stolen_thread = move(candidate);
+            stolen_from_cpu = victim_cpu;
+        }
+    }
+
+    if (!stolen_thread || !scheduler_data.migrate(*stolen_thread, cpu))
+        return nullptr;
+
+#ifdef SCHEDULER_DEBUG
+    dbg() << "Scheduler[" << cpu << "]: Stealing " << *stolen_thread << " from processor " << stolen_from_cpu;
+#endif
+    scheduler_data.run_queue(cpu).m_steal_count++;
+    return stolen_thread;
+}
+
+// Picks the best thread from our own run queue, or steals one if there's nothing to do.
+// This runs without holding g_scheduler_lock, so the caller has to check again whether
+// the thread can still be scheduled once it holds it.
+RefPtr<Thread> Scheduler::select_next_thread(u32 cpu, Thread* current_thread)
+{
+    auto& run_queue = Processor::current().get_scheduler_data();
+    auto* idle_thread = Processor::current().idle_thread();
+
+    RefPtr<Thread> thread_to_schedule;
+    {
+        ScopedSpinLock lock(run_queue.m_run_queue_lock);
+        Thread* best_thread = nullptr;
+        for (auto& thread : run_queue.m_run_queue) {
+            if (&thread == idle_thread || !is_schedulable_on(thread, cpu, current_thread) || is_held_back_by_exec(thread))
+                continue;
+            if (!best_thread || thread.effective_priority() > best_thread->effective_priority())
+                best_thread = &thread;
+        }
+
+        if (best_thread) {
+            for (auto& thread : run_queue.m_run_queue) {
+                if (&thread == idle_thread || !is_schedulable_on(thread, cpu, current_thread) || is_held_back_by_exec(thread))
+                    continue;
+                if (&thread == best_thread)
+                    thread.m_extra_priority = 0;
+                else
+                    thread.m_extra_priority++;
+            }
+            // Queued threads are kept alive by their own reference.
+            thread_to_schedule = best_thread;
+        }
+    }
+
+    if (!thread_to_schedule) {
+        // Nothing to do here, see if another processor has work to spare.
+        thread_to_schedule = steal_thread_for(cpu);
+        if (thread_to_schedule)
+            thread_to_schedule->m_extra_priority = 0;
+    }
+    return thread_to_schedule;
+}
+
 static u32 time_slice_for(const Thread& thread)
 {
     // One time slice unit == 4ms (assuming 250 ticks/second)
@@ -84,8 +321,11 @@ void Scheduler::start()
     g_scheduler_lock.lock();
 
     auto& processor = Processor::current();
-    processor.set_scheduler_data(*new SchedulerPerProcessorData());
     ASSERT(processor.is_initialized());
+    // The boot processor's data was set up in Scheduler::initialize().
+    if (processor.id() != 0)
+        processor.set_scheduler_data(*new SchedulerPerProcessorData(processor.id()));
+    g_scheduler_data->m_online_run_queues.fetch_or(1u << processor.id(), AK::MemoryOrder::memory_order_release);
     auto& idle_thread = *processor.idle_thread();
     ASSERT(processor.current_thread() == &idle_thread);
     ASSERT(processor.idle_thread() == &idle_thread);
@@ -154,24 +394,10 @@ bool Scheduler::pick_next()
     });
 #endif
 
-    Thread* thread_to_schedule = nullptr;
+    u32 cpu = Processor::current().id();
 
     auto pending_beneficiary = scheduler_data.m_pending_beneficiary.strong_ref();
-    Vector<Thread*, 128> sorted_runnables;
-    for_each_runnable([&](auto& thread) {
-        if ((thread.affinity() & (1u << Processor::current().id())) == 0)
-            return IterationDecision::Continue;
-        if (thread.state() == Thread::Running && &thread != current_thread)
-            return IterationDecision::Continue;
-        sorted_runnables.append(&thread);
-        if (&thread == pending_beneficiary) {
-            thread_to_schedule = &thread;
-            return IterationDecision::Break;
-        }
-        return IterationDecision::Continue;
-    });
-
-    if (thread_to_schedule) {
+    if (pending_beneficiary && is_schedulable_on(*pending_beneficiary, cpu, current_thread)) {
         // The thread we're supposed to donate to still exists
         const char* reason = scheduler_data.m_pending_donate_reason;
         scheduler_data.m_pending_beneficiary = nullptr;
@@ -182,9 +408,9 @@ bool Scheduler::pick_next()
         critical.leave();
 
 #ifdef SCHEDULER_DEBUG
-        dbg() << "Processing pending donate to " << *thread_to_schedule << " reason=" << reason;
+        dbg() << "Processing pending donate to " << *pending_beneficiary << " reason=" << reason;
 #endif
-        return donate_to_and_switch(thread_to_schedule, reason);
+        return donate_to_and_switch(pending_beneficiary.ptr(), reason);
     }
 
     // Either we're not donating or the beneficiary disappeared.
@@ -192,35 +418,38 @@ bool Scheduler::pick_next()
     scheduler_data.m_pending_beneficiary = nullptr;
     scheduler_data.m_pending_donate_reason = nullptr;
 
-    quick_sort(sorted_runnables, [](auto& a, auto& b) { return a->effective_priority() >= b->effective_priority(); });
-
-    for (auto* thread : sorted_runnables) {
-        if (thread->process().exec_tid() && thread->process().exec_tid() != thread->tid())
-            continue;
-
-        ASSERT(thread->state() == Thread::Runnable || thread->state() == Thread::Running);
+    // Picking the next thread only needs our own run queue's lock (and the
+    // locks of the queues we steal from), so let go of the scheduler lock
+    // until we actually switch.
+    lock.unlock();
 
-        if (!thread_to_schedule) {
-            thread->m_extra_priority = 0;
-            thread_to_schedule = thread;
-        } else {
-            thread->m_extra_priority++;
-        }
+    RefPtr<Thread> thread_to_schedule;
+    for (;;) {
+        thread_to_schedule = select_next_thread(cpu, current_thread);
+        lock.lock();
+        // Whatever we picked may have been stolen, blocked or killed in the
+        // meantime, or may still be running on the processor it just blocked
+        // on. Processors only switch away from a thread while holding the
+        // scheduler lock, so none of this can change while we hold it.
+        if (!thread_to_schedule || (is_schedulable_on(*thread_to_schedule, cpu, current_thread) && !is_held_back_by_exec(*thread_to_schedule)))
+            break;
+        lock.unlock();
     }
 
-    if (!thread_to_schedule)
-        thread_to_schedule = Processor::current().idle_thread();
+    // It's still runnable, so it holds a reference to itself and we don't need ours anymore.
+    Thread* next_thread = thread_to_schedule ? thread_to_schedule.ptr() : Processor::current().idle_thread();
+    thread_to_schedule = nullptr;
 
 #ifdef SCHEDULER_DEBUG
-    dbg() << "Scheduler[" << Processor::current().id() << "]: Switch to " << *thread_to_schedule << " @ " << String::format("%04x:%08x", thread_to_schedule->tss().cs, thread_to_schedule->tss().eip);
+    dbg() << "Scheduler[" << Processor::current().id() << "]: Switch to " << *next_thread << " @ " << String::format("%04x:%08x", next_thread->tss().cs, next_thread->tss().eip);
 #endif
 
     // We need to leave our first critical section before switching context,
     // but since we're still holding the scheduler lock we're still in a critical section
     critical.leave();
 
-    thread_to_schedule->set_ticks_left(time_slice_for(*thread_to_schedule));
-    return context_switch(thread_to_schedule);
+    next_thread->set_ticks_left(time_slice_for(*next_thread));
+    return context_switch(next_thread);
 }
 
 bool Scheduler::yield()
@@ -262,7 +491,9 @@ bool Scheduler::donate_to_and_switch(Thread* beneficiary, [[maybe_unused]] const
     ASSERT(proc.in_critical() == 1);
 
     unsigned ticks_left = Thread::current()->ticks_left();
-    if (!beneficiary || beneficiary->state() != Thread::Runnable || ticks_left <= 1)
+    if (!beneficiary || beneficiary->state() != Thread::Runnable || beneficiary->is_active() || ticks_left <= 1)
+        return Scheduler::yield();
+    if ((beneficiary->affinity() & (1u << proc.id())) == 0)
         return Scheduler::yield();
 
     unsigned ticks_to_donate = min(ticks_left - 1, time_slice_for(*beneficiary));
@@ -327,8 +558,10 @@ bool Scheduler::context_switch(Thread* thread)
     if (from_thread) {
         // If the last process hasn't blocked (still marked as running),
         // mark it as runnable for the next round.
-        if (from_thread->state() == Thread::Running)
+        if (from_thread->state() == Thread::Running) {
             from_thread->set_state(Thread::Runnable);
+            g_scheduler_data->requeue_if_disallowed(*from_thread);
+        }
 
 #ifdef LOG_EVERY_CONTEXT_SWITCH
         dbgln("Scheduler[{}]: {} -> {} [prio={}] {:04x}:{:08x}", Processor::current().id(), from_thread->tid().value(), thread->tid().value(), thread->priority(), thread->tss().cs, thread->tss().eip);
@@ -336,6 +569,10 @@ bool Scheduler::context_switch(Thread* thread)
     }
 
     auto& proc = Processor::current();
+
+    // Whatever run queue the thread was picked from, it now belongs to us.
+    g_scheduler_data->migrate(*thread, proc.id());
+
     if (!thread->is_initialized()) {
         proc.init_context(*thread, false);
         thread->set_initialized(true);
@@ -434,6 +671,7 @@ void Scheduler::initialize()
 
     RefPtr<Thread> idle_thread;
     g_scheduler_data = new SchedulerData;
+    Processor::current().set_scheduler_data(*new SchedulerPerProcessorData(0));
     g_finalizer_wait_queue = new WaitQueue;
 
     g_finalizer_has_work.store(false, AK::MemoryOrder::memory_order_release);
@@ -474,9 +712,7 @@ void Scheduler::timer_tick(const RegisterState& regs)
         return;
 
     bool is_bsp = Processor::current().id() == 0;
-    if (!is_bsp)
-        return; // TODO: This prevents scheduling on other CPUs!
-    if (current_thread->process().is_profiling()) {
+    if (is_bsp && current_thread->process().is_profiling()) {
         SmapDisabler disabler;
         auto backtrace = current_thread->raw_backtrace(regs.ebp, regs.eip);
         auto& sample = Profiling::next_sample_slot();
@@ -488,6 +724,14 @@ void Scheduler::timer_tick(const RegisterState& regs)
         }
     }
 
+    if (is_bsp && Processor::count() > 1) {
+        static u32 s_ticks_until_load_balance = load_balance_interval_ticks;
+        if (--s_ticks_until_load_balance == 0) {
+            s_ticks_until_load_balance = load_balance_interval_ticks;
+            Processor::deferred_call_queue(Scheduler::balance_run_queues);
+        }
+    }
+
     if (current_thread->tick((regs.cs & 3) == 0))
         return;
 
@@ -496,6 +740,51 @@ void Scheduler::timer_tick(const RegisterState& regs)
     Processor::current().invoke_scheduler_async();
 }
 
+void Scheduler::balance_run_queues()
+{
+    // Only the two run queues involved are locked while moving a thread, so
+    // the lengths we look at here are just a hint.
+    auto& scheduler_data = *g_scheduler_data;
+    auto length_of = [&](u32 cpu) {
+        return scheduler_data.run_queue(cpu).m_run_queue_length.load(AK::MemoryOrder::memory_order_relaxed);
+    };
+
+    for (u32 i = 0; i < max_migrations_per_balance; i++) {
+        Optional<u32> busiest_cpu;
+        Optional<u32> idlest_cpu;
+        for (u32 cpu = 0; cpu < SchedulerData::max_run_queues; cpu++) {
+            if (!scheduler_data.is_run_queue_online(cpu))
+                continue;
+            auto length = length_of(cpu);
+            if (!busiest_cpu.has_value() || length > length_of(busiest_cpu.value()))
+                busiest_cpu = cpu;
+            if (!idlest_cpu.has_value() || length < length_of(idlest_cpu.value()))
+                idlest_cpu = cpu;
+        }
+        if (!busiest_cpu.has_value() || length_of(busiest_cpu.value()) <= length_of(idlest_cpu.value()) + 1)
+            return;
+
+        RefPtr<Thread> thread_to_move;
+        {
+            auto& busiest = scheduler_data.run_queue(busiest_cpu.value());
+            ScopedSpinLock lock(busiest.m_run_queue_lock);
+            for (auto& thread : busiest.m_run_queue) {
+                if (thread.state() == Thread::Runnable && !thread.is_active() && (thread.affinity() & (1u << idlest_cpu.value()))) {
+                    thread_to_move = thread;
+                    break;
+                }
+            }
+        }
+        if (!thread_to_move)
+            return;
+
+#ifdef SCHEDULER_DEBUG
+        dbg() << "Scheduler: Balancing " << *thread_to_move << " from processor " << busiest_cpu.value() << " to " << idlest_cpu.value();
+#endif
+        scheduler_data.migrate(*thread_to_move, idlest_cpu.value());
+    }
+}
+
 void Scheduler::invoke_async()
 {
     ASSERT_INTERRUPTS_DISABLED();
@@ -536,10 +825,12 @@ void Scheduler::idle_loop(void*)
     ASSERT(are_interrupts_enabled());
 
     for (;;) {
+        // Nobody else wants to run, so get some pages ready for zero faults.
+        MM.refill_zeroed_pages();
+
         asm("hlt");
 
-        if (Processor::current().id() == 0)
-            yield();
+        yield();
     }
 }
 
@@ -56,6 +56,7 @@ public:
     static void timer_tick(const RegisterState&);
     [[noreturn]] static void start();
     static bool pick_next();
+    static RefPtr<Thread> select_next_thread(u32 cpu, Thread* current_thread);
     static bool yield();
     static void yield_from_critical();
     static bool donate_to_and_switch(Thread*, const char* reason);
@@ -69,6 +70,7 @@ public:
     static void beep();
     static void idle_loop(void*);
     static void invoke_async();
+    static void balance_run_queues();
     static void notify_finalizer();
 
     template<typename Callback>
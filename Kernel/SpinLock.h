@@ -86,12 +86,16 @@ public:
         u32 prev_flags;
         proc.enter_critical(prev_flags);
         FlatPtr expected = 0;
+        bool contended = false;
         while (!m_lock.compare_exchange_strong(expected, cpu, AK::memory_order_acq_rel)) {
             if (expected == cpu)
                 break;
+            contended = true;
             Processor::wait_check();
             expected = 0;
         }
+        if (contended)
+            m_contention_count.fetch_add(1, AK::memory_order_relaxed);
         m_recursions++;
         return prev_flags;
     }
@@ -115,6 +119,12 @@ public:
         return m_lock.load(AK::memory_order_relaxed) == FlatPtr(&Processor::current());
     }
 
+    // How many times lock() had to wait for another processor to release the lock.
+    [[nodiscard]] ALWAYS_INLINE u32 contention_count() const
+    {
+        return m_contention_count.load(AK::memory_order_relaxed);
+    }
+
     ALWAYS_INLINE void initialize()
     {
         m_lock.store(0, AK::memory_order_relaxed);
@@ -123,6 +133,7 @@ public:
 private:
     AK::Atomic<FlatPtr> m_lock { 0 };
     u32 m_recursions { 0 };
+    AK::Atomic<u32> m_contention_count { 0 };
 };
 
 template<typename LockType>
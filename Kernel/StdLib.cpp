@@ -63,6 +63,18 @@ String copy_string_from_user(Userspace<const char*> user_str, size_t user_str_si
     return copy_string_from_user(user_str.unsafe_userspace_ptr(), user_str_size);
 }
 
+Optional<bool> user_atomic_compare_exchange_relaxed(volatile u32* var, u32& expected, u32 desired)
+{
+    if (FlatPtr(var) & 3)
+        return {}; // not aligned!
+    bool is_user = Kernel::is_user_range(VirtualAddress(FlatPtr(var)), sizeof(*var));
+    ASSERT(is_user); // For now assert to catch bugs, but technically not an error
+    if (!is_user)
+        return {};
+    Kernel::SmapDisabler disabler;
+    return Kernel::safe_atomic_compare_exchange_relaxed(var, expected, desired);
+}
+
 extern "C" {
 
 bool copy_to_user(void* dest_ptr, const void* src_ptr, size_t n)
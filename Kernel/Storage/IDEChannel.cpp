@@ -149,29 +149,133 @@ void IDEChannel::start_request(AsyncBlockDeviceRequest& request, bool use_dma, b
 #ifdef PATA_DEBUG
     dbg() << "IDEChannel::start_request";
 #endif
+    m_queued_requests.append({ &request, use_dma, is_slave });
+    if (!m_current_request)
+        start_next_request();
+}
+
+size_t IDEChannel::pick_next_request() const
+{
+    ASSERT(!m_queued_requests.is_empty());
+    // Keep sweeping towards higher LBAs; once there's nothing left ahead of us, start over from the lowest one.
+    Optional<size_t> next_ahead;
+    size_t lowest = 0;
+    for (size_t i = 0; i < m_queued_requests.size(); ++i) {
+        auto position = m_queued_requests[i].position();
+        if (position < m_queued_requests[lowest].position())
+            lowest = i;
+        if (position >= m_head_position && (!next_ahead.has_value() || position < m_queued_requests[next_ahead.value()].position()))
+            next_ahead = i;
+    }
+    return next_ahead.value_or(lowest);
+}
+
+Optional<size_t> IDEChannel::find_request_to_merge(const QueuedRequest& first) const
+{
+    auto type = first.request->request_type();
+    for (size_t i = 0; i < m_queued_requests.size(); ++i) {
+        auto& candidate = m_queued_requests[i];
+        if (!candidate.use_dma || candidate.is_slave != first.is_slave || candidate.request->request_type() != type)
+            continue;
+        if (candidate.request->block_index() != m_current_batch_lba + m_current_batch_sector_count)
+            continue;
+        if (m_current_batch_sector_count + candidate.request->block_count() > max_sectors_per_transfer)
+            continue;
+        return i;
+    }
+    return {};
+}
+
+void IDEChannel::start_next_request()
+{
+    ASSERT(m_request_lock.is_locked());
+    ASSERT(!m_current_request);
+    if (m_queued_requests.is_empty())
+        return;
+
+    auto queued = m_queued_requests.take(pick_next_request());
+    auto& request = *queued.request;
     m_current_request = &request;
     m_current_request_block_index = 0;
-    m_current_request_uses_dma = use_dma;
+    m_current_request_uses_dma = queued.use_dma;
     m_current_request_flushing_cache = false;
-
-    if (request.request_type() == AsyncBlockDeviceRequest::Read) {
-        if (use_dma)
-            ata_read_sectors_with_dma(is_slave);
-        else
-            ata_read_sectors(is_slave);
-    } else {
-        if (use_dma)
-            ata_write_sectors_with_dma(is_slave);
+    m_current_batch.clear();
+    m_current_batch.append(&request);
+    m_current_batch_lba = request.block_index();
+    m_current_batch_sector_count = request.block_count();
+
+    bool is_read = request.request_type() == AsyncBlockDeviceRequest::Read;
+    if (!queued.use_dma) {
+        m_head_position = queued.position() + request.block_count();
+        if (is_read)
+            ata_read_sectors(queued.is_slave);
         else
-            ata_write_sectors(is_slave);
+            ata_write_sectors(queued.is_slave);
+        return;
     }
+
+    ASSERT(request.block_count() <= max_sectors_per_transfer);
+    if (!is_read && !copy_to_dma_buffer(request, 0)) {
+        complete_current_request(AsyncDeviceRequest::MemoryFault);
+        return;
+    }
+
+    // Pull in any queued requests that continue where this one ends, so they go out as a single transfer.
+    for (;;) {
+        auto index = find_request_to_merge(queued);
+        if (!index.has_value())
+            break;
+        auto& next_request = *m_queued_requests[index.value()].request;
+        // If we can't get at its data, leave it in the queue and let it fail on its own.
+        if (!is_read && !copy_to_dma_buffer(next_request, m_current_batch_sector_count))
+            break;
+        m_queued_requests.remove(index.value());
+        m_current_batch.append(&next_request);
+        m_current_batch_sector_count += next_request.block_count();
+    }
+    m_head_position = queued.position() + m_current_batch_sector_count;
+
+#ifdef PATA_DEBUG
+    dbg() << "IDEChannel: Starting DMA for " << m_current_batch.size() << " request(s), " << m_current_batch_sector_count << " sector(s) @ LBA " << m_current_batch_lba;
+#endif
+    if (is_read)
+        ata_read_sectors_with_dma(queued.is_slave);
+    else
+        ata_write_sectors_with_dma(queued.is_slave);
+}
+
+bool IDEChannel::copy_to_dma_buffer(AsyncBlockDeviceRequest& request, size_t sector_offset)
+{
+    size_t dma_offset = sector_offset * 512;
+    size_t size = request.block_count() * 512;
+    for (size_t nread = 0; nread < size;) {
+        size_t offset_in_page = (dma_offset + nread) % PAGE_SIZE;
+        size_t chunk_size = min((size_t)PAGE_SIZE - offset_in_page, size - nread);
+        if (!request.read_from_buffer(request.buffer(), dma_buffer_page((dma_offset + nread) / PAGE_SIZE) + offset_in_page, nread, chunk_size))
+            return false;
+        nread += chunk_size;
+    }
+    return true;
+}
+
+bool IDEChannel::copy_from_dma_buffer(AsyncBlockDeviceRequest& request, size_t sector_offset)
+{
+    size_t dma_offset = sector_offset * 512;
+    size_t size = request.block_count() * 512;
+    for (size_t nwritten = 0; nwritten < size;) {
+        size_t offset_in_page = (dma_offset + nwritten) % PAGE_SIZE;
+        size_t chunk_size = min((size_t)PAGE_SIZE - offset_in_page, size - nwritten);
+        if (!request.write_to_buffer(request.buffer(), dma_buffer_page((dma_offset + nwritten) / PAGE_SIZE) + offset_in_page, nwritten, chunk_size))
+            return false;
+        nwritten += chunk_size;
+    }
+    return true;
 }
 
 void IDEChannel::complete_current_request(AsyncDeviceRequest::RequestResult result)
 {
     // NOTE: this may be called from the interrupt handler!
     ASSERT(m_current_request);
-    ASSERT(m_request_lock.is_locked());
 
     // Now schedule reading back the buffer as soon as we leave the irq handler.
     // This is important so that we can safely write the buffer back,
@@ -181,25 +285,34 @@ void IDEChannel::complete_current_request(AsyncDeviceRequest::RequestResult resu
 #ifdef PATA_DEBUG
         dbg() << "IDEChannel::complete_current_request result: " << result;
 #endif
-        ASSERT(m_current_request);
-        auto& request = *m_current_request;
-        m_current_request = nullptr;
-
-        if (m_current_request_uses_dma) {
-            if (result == AsyncDeviceRequest::Success) {
-                if (request.request_type() == AsyncBlockDeviceRequest::Read) {
-                    if (!request.write_to_buffer(request.buffer(), m_dma_buffer_page->paddr().offset(0xc0000000).as_ptr(), 512 * request.block_count())) {
-                        request.complete(AsyncDeviceRequest::MemoryFault);
-                        return;
-                    }
-                }
+        Vector<AsyncBlockDeviceRequest*, 16> batch;
+        bool uses_dma;
+        {
+            ScopedSpinLock lock(m_request_lock);
+            ASSERT(m_current_request);
+            batch = move(m_current_batch);
+            uses_dma = m_current_request_uses_dma;
+        }
 
-                // I read somewhere that this may trigger a cache flush so let's do it.
-                m_io_group.bus_master_base().offset(2).out<u8>(m_io_group.bus_master_base().offset(2).in<u8>() | 0x6);
+        size_t sector_offset = 0;
+        for (auto* request : batch) {
+            auto request_result = result;
+            if (uses_dma && result == AsyncDeviceRequest::Success && request->request_type() == AsyncBlockDeviceRequest::Read) {
+                if (!copy_from_dma_buffer(*request, sector_offset))
+                    request_result = AsyncDeviceRequest::MemoryFault;
             }
+            sector_offset += request->block_count();
+            request->complete(request_result);
         }
 
-        request.complete(result);
+        if (uses_dma && result == AsyncDeviceRequest::Success) {
+            // I read somewhere that this may trigger a cache flush so let's do it.
+            m_io_group.bus_master_base().offset(2).out<u8>(m_io_group.bus_master_base().offset(2).in<u8>() | 0x6);
+        }
+
+        ScopedSpinLock lock(m_request_lock);
+        m_current_request = nullptr;
+        start_next_request();
     });
 }
 
@@ -214,8 +327,9 @@ void IDEChannel::initialize(bool force_pio)
     // Let's try to set up DMA transfers.
     PCI::enable_bus_mastering(m_parent_controller->pci_address());
     m_prdt_page = MM.allocate_supervisor_physical_page();
-    prdt().end_of_table = 0x8000;
-    m_dma_buffer_page = MM.allocate_supervisor_physical_page();
+    prdt()[0].end_of_table = 0x8000;
+    for (size_t i = 0; i < max_dma_pages; ++i)
+        m_dma_buffer_pages.append(MM.allocate_supervisor_physical_page().release_nonnull());
     klog() << "IDEChannel: Bus master IDE: " << m_io_group.bus_master_base();
 }
 
@@ -364,18 +478,27 @@ void IDEChannel::detect_disks()
     }
 }
 
+void IDEChannel::prepare_prdt(size_t byte_count)
+{
+    size_t entry_count = ceil_div(byte_count, PAGE_SIZE);
+    ASSERT(entry_count && entry_count <= max_dma_pages);
+    for (size_t i = 0; i < entry_count; ++i) {
+        auto& entry = prdt()[i];
+        entry.offset = m_dma_buffer_pages[i].paddr();
+        entry.size = min((size_t)PAGE_SIZE, byte_count - i * PAGE_SIZE);
+        entry.end_of_table = i == entry_count - 1 ? 0x8000 : 0;
+    }
+}
+
 void IDEChannel::ata_read_sectors_with_dma(bool slave_request)
 {
-    auto& request = *m_current_request;
-    u32 lba = request.block_index();
+    u32 lba = m_current_batch_lba;
+    u32 sector_count = m_current_batch_sector_count;
 #ifdef PATA_DEBUG
-    dbg() << "IDEChannel::ata_read_sectors_with_dma (" << lba << " x" << request.block_count() << ")";
+    dbg() << "IDEChannel::ata_read_sectors_with_dma (" << lba << " x" << sector_count << ")";
 #endif
 
-    prdt().offset = m_dma_buffer_page->paddr();
-    prdt().size = 512 * request.block_count();
-
-    ASSERT(prdt().size <= PAGE_SIZE);
+    prepare_prdt(512 * sector_count);
 
     // Stop bus master
     m_io_group.bus_master_base().out<u8>(0);
@@ -403,7 +526,7 @@ void IDEChannel::ata_read_sectors_with_dma(bool slave_request)
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>(0);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>(0);
 
-    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(request.block_count());
+    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(sector_count);
     m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>((lba & 0x000000ff) >> 0);
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>((lba & 0x0000ff00) >> 8);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>((lba & 0x00ff0000) >> 16);
@@ -487,21 +610,14 @@ void IDEChannel::ata_read_sectors(bool slave_request)
 
 void IDEChannel::ata_write_sectors_with_dma(bool slave_request)
 {
-    auto& request = *m_current_request;
-    u32 lba = request.block_index();
+    // NOTE: The data has already been copied into the DMA buffer by start_next_request().
+    u32 lba = m_current_batch_lba;
+    u32 sector_count = m_current_batch_sector_count;
 #ifdef PATA_DEBUG
-    dbg() << "IDEChannel::ata_write_sectors_with_dma (" << lba << " x" << request.block_count() << ")";
+    dbg() << "IDEChannel::ata_write_sectors_with_dma (" << lba << " x" << sector_count << ")";
 #endif
 
-    prdt().offset = m_dma_buffer_page->paddr();
-    prdt().size = 512 * request.block_count();
-
-    if (!request.read_from_buffer(request.buffer(), m_dma_buffer_page->paddr().offset(0xc0000000).as_ptr(), 512 * request.block_count())) {
-        complete_current_request(AsyncDeviceRequest::MemoryFault);
-        return;
-    }
-
-    ASSERT(prdt().size <= PAGE_SIZE);
+    prepare_prdt(512 * sector_count);
 
     // Stop bus master
     m_io_group.bus_master_base().out<u8>(0);
@@ -526,7 +642,7 @@ void IDEChannel::ata_write_sectors_with_dma(bool slave_request)
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>(0);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>(0);
 
-    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(request.block_count());
+    m_io_group.io_base().offset(ATA_REG_SECCOUNT0).out<u8>(sector_count);
     m_io_group.io_base().offset(ATA_REG_LBA0).out<u8>((lba & 0x000000ff) >> 0);
     m_io_group.io_base().offset(ATA_REG_LBA1).out<u8>((lba & 0x0000ff00) >> 8);
     m_io_group.io_base().offset(ATA_REG_LBA2).out<u8>((lba & 0x00ff0000) >> 16);
@@ -37,8 +37,10 @@
 
 #pragma once
 
+#include <AK/NonnullRefPtrVector.h>
 #include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
+#include <AK/Vector.h>
 #include <Kernel/Devices/Device.h>
 #include <Kernel/IO.h>
 #include <Kernel/Interrupts/IRQHandler.h>
@@ -104,6 +106,10 @@ public:
     };
 
 public:
+    // A single DMA transfer covers up to this many pages, each with its own PRD entry.
+    static constexpr size_t max_dma_pages = 16;
+    static constexpr size_t max_sectors_per_transfer = max_dma_pages * PAGE_SIZE / 512;
+
     static NonnullOwnPtr<IDEChannel> create(const IDEController&, IOAddressGroup, ChannelType type, bool force_pio);
     IDEChannel(const IDEController&, IOAddressGroup, ChannelType type, bool force_pio);
     virtual ~IDEChannel() override;
@@ -120,9 +126,25 @@ private:
     void initialize(bool force_pio);
     void detect_disks();
 
+    struct QueuedRequest {
+        AsyncBlockDeviceRequest* request { nullptr };
+        bool use_dma { false };
+        bool is_slave { false };
+
+        u64 position() const { return ((u64)is_slave << 32) | request->block_index(); }
+    };
+
     void start_request(AsyncBlockDeviceRequest&, bool, bool);
+    void start_next_request();
+    size_t pick_next_request() const;
+    Optional<size_t> find_request_to_merge(const QueuedRequest&) const;
     void complete_current_request(AsyncDeviceRequest::RequestResult);
 
+    void prepare_prdt(size_t byte_count);
+    bool copy_to_dma_buffer(AsyncBlockDeviceRequest&, size_t sector_offset);
+    bool copy_from_dma_buffer(AsyncBlockDeviceRequest&, size_t sector_offset);
+    u8* dma_buffer_page(size_t index) { return m_dma_buffer_pages[index].paddr().offset(0xc0000000).as_ptr(); }
+
     void ata_read_sectors_with_dma(bool);
     void ata_read_sectors(bool);
     bool ata_do_read_sector();
@@ -135,20 +157,28 @@ private:
 
     volatile u8 m_device_error { 0 };
 
-    PhysicalRegionDescriptor& prdt() { return *reinterpret_cast<PhysicalRegionDescriptor*>(m_prdt_page->paddr().offset(0xc0000000).as_ptr()); }
+    PhysicalRegionDescriptor* prdt() { return reinterpret_cast<PhysicalRegionDescriptor*>(m_prdt_page->paddr().offset(0xc0000000).as_ptr()); }
     RefPtr<PhysicalPage> m_prdt_page;
-    RefPtr<PhysicalPage> m_dma_buffer_page;
+    NonnullRefPtrVector<PhysicalPage> m_dma_buffer_pages;
     Lockable<bool> m_dma_enabled;
     EntropySource m_entropy_source;
 
     RefPtr<StorageDevice> m_master;
     RefPtr<StorageDevice> m_slave;
 
+    // Requests waiting for the channel, served in ascending LBA order (C-LOOK).
+    // Adjacent DMA requests to the same drive are merged into a single transfer.
+    Vector<QueuedRequest> m_queued_requests;
+    u64 m_head_position { 0 };
+
     AsyncBlockDeviceRequest* m_current_request { nullptr };
+    Vector<AsyncBlockDeviceRequest*, 16> m_current_batch;
+    u32 m_current_batch_lba { 0 };
+    u32 m_current_batch_sector_count { 0 };
     u32 m_current_request_block_index { 0 };
     bool m_current_request_uses_dma { false };
     bool m_current_request_flushing_cache { false };
-    SpinLock<u8> m_request_lock;
+    RecursiveSpinLock m_request_lock;
 
     IOAddressGroup m_io_group;
     NonnullRefPtr<IDEController> m_parent_controller;
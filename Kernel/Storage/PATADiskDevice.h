@@ -58,6 +58,7 @@ public:
     // ^StorageDevice
     virtual Type type() const override { return StorageDevice::Type::IDE; }
     virtual size_t max_addressable_block() const override;
+    virtual size_t max_blocks_per_request() const override;
 
     // ^BlockDevice
     virtual void start_request(AsyncBlockDeviceRequest&) override;
@@ -68,6 +69,9 @@ private:
     // ^DiskDevice
     virtual const char* class_name() const override;
 
+    // ^Device
+    virtual bool has_own_request_queue() const override { return true; }
+
     bool is_slave() const;
 
     Lock m_lock { "IDEDiskDevice" };
@@ -50,39 +50,65 @@ NonnullRefPtr<StorageController> StorageDevice::controller() const
     return m_storage_controller;
 }
 
+static AsyncDeviceRequest::RequestResult wait_until_completed(AsyncDeviceRequest& request, bool& was_interrupted)
+{
+    // The device keeps using the request's buffer until the request completes,
+    // so a signal must not make us return early. Just remember that it happened.
+    for (;;) {
+        auto result = request.wait();
+        if (result.wait_result().was_interrupted())
+            was_interrupted = true;
+        if (result.request_result() != AsyncDeviceRequest::Pending && result.request_result() != AsyncDeviceRequest::Started)
+            return result.request_result();
+    }
+}
+
+static KResult wait_for_requests(NonnullRefPtrVector<AsyncBlockDeviceRequest>& requests)
+{
+    // Wait for every request, even after a failure: the rest are still using the buffer.
+    KResult result = KSuccess;
+    bool was_interrupted = false;
+    for (auto& request : requests) {
+        auto request_result = wait_until_completed(request, was_interrupted);
+        if (result.is_error())
+            continue;
+        switch (request_result) {
+        case AsyncDeviceRequest::Failure:
+        case AsyncDeviceRequest::Cancelled:
+            result = KResult(-EIO);
+            break;
+        case AsyncDeviceRequest::MemoryFault:
+            result = KResult(-EFAULT);
+            break;
+        default:
+            break;
+        }
+    }
+    if (was_interrupted)
+        return KResult(-EINTR);
+    return result;
+}
+
 KResultOr<size_t> StorageDevice::read(FileDescription&, size_t offset, UserOrKernelBuffer& outbuf, size_t len)
 {
     unsigned index = offset / block_size();
-    u16 whole_blocks = len / block_size();
+    size_t whole_blocks = len / block_size();
     ssize_t remaining = len % block_size();
 
-    unsigned blocks_per_page = PAGE_SIZE / block_size();
-
-    // PATAChannel will chuck a wobbly if we try to read more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= blocks_per_page) {
-        whole_blocks = blocks_per_page;
-        remaining = 0;
-    }
-
 #ifdef STORAGE_DEVICE_DEBUG
     klog() << "StorageDevice::read() index=" << index << " whole_blocks=" << whole_blocks << " remaining=" << remaining;
 #endif
 
     if (whole_blocks > 0) {
-        auto read_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read, index, whole_blocks, outbuf, whole_blocks * block_size());
-        auto result = read_request->wait();
-        if (result.wait_result().was_interrupted())
-            return KResult(-EINTR);
-        switch (result.request_result()) {
-        case AsyncDeviceRequest::Failure:
-        case AsyncDeviceRequest::Cancelled:
-            return KResult(-EIO);
-        case AsyncDeviceRequest::MemoryFault:
-            return KResult(-EFAULT);
-        default:
-            break;
+        // Queue up all the requests before waiting, so the device never has to wait for us.
+        NonnullRefPtrVector<AsyncBlockDeviceRequest> read_requests;
+        for (size_t block = 0; block < whole_blocks; block += max_blocks_per_request()) {
+            size_t count = min(whole_blocks - block, max_blocks_per_request());
+            read_requests.append(make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read, index + block, count, outbuf.offset(block * block_size()), count * block_size()));
         }
+        auto result = wait_for_requests(read_requests);
+        if (result.is_error())
+            return result;
     }
 
     off_t pos = whole_blocks * block_size();
@@ -91,10 +117,11 @@ KResultOr<size_t> StorageDevice::read(FileDescription&, size_t offset, UserOrKer
         auto data = ByteBuffer::create_uninitialized(block_size());
         auto data_buffer = UserOrKernelBuffer::for_kernel_buffer(data.data());
         auto read_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read, index + whole_blocks, 1, data_buffer, block_size());
-        auto result = read_request->wait();
-        if (result.wait_result().was_interrupted())
+        bool was_interrupted = false;
+        auto result = wait_until_completed(*read_request, was_interrupted);
+        if (was_interrupted)
             return KResult(-EINTR);
-        switch (result.request_result()) {
+        switch (result) {
         case AsyncDeviceRequest::Failure:
             return pos;
         case AsyncDeviceRequest::Cancelled:
@@ -120,36 +147,22 @@ bool StorageDevice::can_read(const FileDescription&, size_t offset) const
 KResultOr<size_t> StorageDevice::write(FileDescription&, size_t offset, const UserOrKernelBuffer& inbuf, size_t len)
 {
     unsigned index = offset / block_size();
-    u16 whole_blocks = len / block_size();
+    size_t whole_blocks = len / block_size();
     ssize_t remaining = len % block_size();
 
-    unsigned blocks_per_page = PAGE_SIZE / block_size();
-
-    // PATAChannel will chuck a wobbly if we try to write more than PAGE_SIZE
-    // at a time, because it uses a single page for its DMA buffer.
-    if (whole_blocks >= blocks_per_page) {
-        whole_blocks = blocks_per_page;
-        remaining = 0;
-    }
-
 #ifdef STORAGE_DEVICE_DEBUG
     klog() << "StorageDevice::write() index=" << index << " whole_blocks=" << whole_blocks << " remaining=" << remaining;
 #endif
 
     if (whole_blocks > 0) {
-        auto write_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Write, index, whole_blocks, inbuf, whole_blocks * block_size());
-        auto result = write_request->wait();
-        if (result.wait_result().was_interrupted())
-            return KResult(-EINTR);
-        switch (result.request_result()) {
-        case AsyncDeviceRequest::Failure:
-        case AsyncDeviceRequest::Cancelled:
-            return KResult(-EIO);
-        case AsyncDeviceRequest::MemoryFault:
-            return KResult(-EFAULT);
-        default:
-            break;
+        NonnullRefPtrVector<AsyncBlockDeviceRequest> write_requests;
+        for (size_t block = 0; block < whole_blocks; block += max_blocks_per_request()) {
+            size_t count = min(whole_blocks - block, max_blocks_per_request());
+            write_requests.append(make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Write, index + block, count, inbuf.offset(block * block_size()), count * block_size()));
         }
+        auto result = wait_for_requests(write_requests);
+        if (result.is_error())
+            return result;
     }
 
     off_t pos = whole_blocks * block_size();
@@ -163,10 +176,11 @@ KResultOr<size_t> StorageDevice::write(FileDescription&, size_t offset, const Us
 
         {
             auto read_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Read, index + whole_blocks, 1, data_buffer, block_size());
-            auto result = read_request->wait();
-            if (result.wait_result().was_interrupted())
+            bool was_interrupted = false;
+            auto result = wait_until_completed(*read_request, was_interrupted);
+            if (was_interrupted)
                 return KResult(-EINTR);
-            switch (result.request_result()) {
+            switch (result) {
             case AsyncDeviceRequest::Failure:
                 return pos;
             case AsyncDeviceRequest::Cancelled:
@@ -184,10 +198,11 @@ KResultOr<size_t> StorageDevice::write(FileDescription&, size_t offset, const Us
 
         {
             auto write_request = make_request<AsyncBlockDeviceRequest>(AsyncBlockDeviceRequest::Write, index + whole_blocks, 1, data_buffer, block_size());
-            auto result = write_request->wait();
-            if (result.wait_result().was_interrupted())
+            bool was_interrupted = false;
+            auto result = wait_until_completed(*write_request, was_interrupted);
+            if (was_interrupted)
                 return KResult(-EINTR);
-            switch (result.request_result()) {
+            switch (result) {
             case AsyncDeviceRequest::Failure:
                 return pos;
             case AsyncDeviceRequest::Cancelled:
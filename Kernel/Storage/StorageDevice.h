@@ -47,6 +47,9 @@ public:
     virtual Type type() const = 0;
     virtual size_t max_addressable_block() const { return m_max_addressable_block; }
 
+    // Larger transfers are split up into several requests.
+    virtual size_t max_blocks_per_request() const { return PAGE_SIZE / block_size(); }
+
     NonnullRefPtr<StorageController> controller() const;
 
     // ^BlockDevice
@@ -0,0 +1,141 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/Checked.h>
+#include <AK/ScopeGuard.h>
+#include <Kernel/FileSystem/EPoll.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+int Process::sys$epoll_create1(int flags)
+{
+    REQUIRE_PROMISE(stdio);
+    if ((flags & EPOLL_CLOEXEC) != flags)
+        return -EINVAL;
+
+    int fd = alloc_fd();
+    if (fd < 0)
+        return fd;
+
+    u32 fd_flags = (flags & EPOLL_CLOEXEC) ? FD_CLOEXEC : 0;
+    m_fds[fd].set(FileDescription::create(*EPoll::create()), fd_flags);
+    m_fds[fd].description()->set_readable(true);
+    return fd;
+}
+
+static EPoll* epoll_for(FileDescription& description)
+{
+    if (!description.file().is_epoll())
+        return nullptr;
+    return static_cast<EPoll*>(&description.file());
+}
+
+int Process::sys$epoll_ctl(Userspace<const Syscall::SC_epoll_ctl_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+    Syscall::SC_epoll_ctl_params params;
+    if (!copy_from_user(&params, user_params))
+        return -EFAULT;
+
+    auto epoll_description = file_description(params.epfd);
+    auto description = file_description(params.fd);
+    if (!epoll_description || !description)
+        return -EBADF;
+    auto* epoll = epoll_for(*epoll_description);
+    if (!epoll)
+        return -EINVAL;
+
+    epoll_event event {};
+    if (params.op != EPOLL_CTL_DEL && !copy_from_user(&event, params.event))
+        return -EFAULT;
+
+    switch (params.op) {
+    case EPOLL_CTL_ADD:
+        return epoll->add(params.fd, *description, event);
+    case EPOLL_CTL_MOD:
+        return epoll->modify(params.fd, *description, event);
+    case EPOLL_CTL_DEL:
+        return epoll->remove(params.fd, *description);
+    }
+    return -EINVAL;
+}
+
+int Process::sys$epoll_wait(Userspace<const Syscall::SC_epoll_wait_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+    Syscall::SC_epoll_wait_params params;
+    if (!copy_from_user(&params, user_params))
+        return -EFAULT;
+
+    if (params.maxevents <= 0)
+        return -EINVAL;
+    Checked events_size = sizeof(epoll_event);
+    events_size *= params.maxevents;
+    if (events_size.has_overflow())
+        return -EFAULT;
+
+    auto epoll_description = file_description(params.epfd);
+    if (!epoll_description)
+        return -EBADF;
+    auto* epoll = epoll_for(*epoll_description);
+    if (!epoll)
+        return -EINVAL;
+
+    Thread::BlockTimeout timeout;
+    if (params.timeout) {
+        timespec timeout_copy;
+        if (!copy_from_user(&timeout_copy, params.timeout))
+            return -EFAULT;
+        timeout = Thread::BlockTimeout(false, &timeout_copy);
+    }
+
+    auto current_thread = Thread::current();
+
+    u32 previous_signal_mask = 0;
+    if (params.sigmask) {
+        sigset_t sigmask_copy;
+        if (!copy_from_user(&sigmask_copy, params.sigmask))
+            return -EFAULT;
+        previous_signal_mask = current_thread->update_signal_mask(sigmask_copy);
+    }
+    ScopeGuard rollback_signal_mask([&]() {
+        if (params.sigmask)
+            current_thread->update_signal_mask(previous_signal_mask);
+    });
+
+    Vector<epoll_event> events;
+    auto result = epoll->wait(events, params.maxevents, timeout);
+    if (result.is_error())
+        return result;
+
+    if (!events.is_empty() && !copy_n_to_user(params.events, events.data(), events.size()))
+        return -EFAULT;
+    return events.size();
+}
+
+}
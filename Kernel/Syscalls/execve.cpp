@@ -29,6 +29,7 @@
 #include <AK/TemporaryChange.h>
 #include <Kernel/FileSystem/Custody.h>
 #include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/FutexQueue.h>
 #include <Kernel/Process.h>
 #include <Kernel/Profiling.h>
 #include <Kernel/Random.h>
@@ -280,7 +281,7 @@ KResultOr<Process::LoadResult> Process::load_elf_object(FileDescription& object_
 KResultOr<Process::LoadResult> Process::load(NonnullRefPtr<FileDescription> main_program_description, RefPtr<FileDescription> interpreter_description)
 {
     RefPtr<PageDirectory> old_page_directory;
-    NonnullOwnPtrVector<Region> old_regions;
+    RedBlackTree<FlatPtr, NonnullOwnPtr<Region>> old_regions;
 
     {
         // Need to make sure we don't swap contexts in the middle
@@ -466,6 +467,7 @@ int Process::do_exec(NonnullRefPtr<FileDescription> main_program_description, Ve
 
     m_name = parts.take_last();
     new_main_thread->set_name(m_name);
+    statistics_did_change();
 
     // FIXME: PID/TID ISSUE
     m_pid = new_main_thread->tid().value();
@@ -534,6 +536,8 @@ static Vector<ELF::AuxiliaryValue> generate_auxiliary_vector(FlatPtr load_base,
 
     auxv.append({ ELF::AuxiliaryValue::ExecFileDescriptor, main_program_fd });
 
+    auxv.append({ ELF::AuxiliaryValue::TimePage, TimeManagement::the().user_time_page_address().as_ptr() });
+
     auxv.append({ ELF::AuxiliaryValue::Null, 0L });
     return auxv;
 }
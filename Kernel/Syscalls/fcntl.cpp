@@ -63,6 +63,23 @@ int Process::sys$fcntl(int fd, int cmd, u32 arg)
         break;
     case F_ISTTY:
         return description->is_tty();
+    case F_GETPIPE_SZ:
+        if (!description->is_fifo())
+            return -EBADF;
+        return description->fifo()->buffer_capacity();
+    case F_SETPIPE_SZ: {
+        if (!description->is_fifo())
+            return -EBADF;
+        if (arg > FIFO::max_buffer_capacity)
+            return -EINVAL;
+        if (arg > FIFO::max_unprivileged_buffer_capacity && !is_superuser())
+            return -EPERM;
+        auto& fifo = *description->fifo();
+        auto result = fifo.set_buffer_capacity(arg);
+        if (result.is_error())
+            return result;
+        return fifo.buffer_capacity();
+    }
     default:
         return -EINVAL;
     }
@@ -84,7 +84,9 @@ pid_t Process::sys$fork(RegisterState& regs)
 
     {
         ScopedSpinLock lock(m_lock);
-        for (auto& region : m_regions) {
+        ScopedSpinLock address_space_lock(m_address_space_lock);
+        for (auto& owned_region : m_regions) {
+            auto& region = *owned_region;
 #ifdef FORK_DEBUG
             dbg() << "fork: cloning Region{" << &region << "} '" << region.name() << "' @ " << region.vaddr();
 #endif
@@ -25,16 +25,45 @@
  */
 
 #include <AK/Time.h>
+#include <Kernel/FutexQueue.h>
 #include <Kernel/Process.h>
 
 namespace Kernel {
 
-WaitQueue& Process::futex_queue(Userspace<const i32*> userspace_address)
+RefPtr<FutexQueue> Process::find_futex_queue(FlatPtr user_address, bool create_if_missing)
 {
-    auto& queue = m_futex_queues.ensure(userspace_address.ptr());
-    if (!queue)
-        queue = make<WaitQueue>();
-    return *queue;
+    auto it = m_futex_queues.find(user_address);
+    if (it != m_futex_queues.end())
+        return it->value;
+    if (!create_if_missing)
+        return nullptr;
+    auto queue = adopt(*new FutexQueue);
+    m_futex_queues.set(user_address, queue);
+    return queue;
+}
+
+void Process::release_futex_queue_if_unused(FlatPtr user_address)
+{
+    auto it = m_futex_queues.find(user_address);
+    if (it == m_futex_queues.end())
+        return;
+    auto& queue = it->value;
+    if (queue->is_empty()) {
+        queue->set_pi_owner(nullptr);
+        m_futex_queues.remove(it);
+    }
+}
+
+void Process::update_inherited_priority(Thread& thread)
+{
+    // A thread inherits the priority of the most important thread waiting
+    // for any of the PI futexes it holds.
+    u32 priority = 0;
+    for (auto& it : m_futex_queues) {
+        if (it.value->pi_owner() == &thread)
+            priority = max(priority, it.value->highest_waiter_priority());
+    }
+    thread.set_inherited_priority(priority);
 }
 
 int Process::sys$futex(Userspace<const Syscall::SC_futex_params*> user_params)
@@ -45,42 +74,192 @@ int Process::sys$futex(Userspace<const Syscall::SC_futex_params*> user_params)
     if (!copy_from_user(&params, user_params))
         return -EFAULT;
 
-    switch (params.futex_op) {
-    case FUTEX_WAIT: {
+    // NOTE: All futex operations of a process are serialized by its big lock. Threads only
+    //       let go of it once they are on a futex queue, so checking the futex value and
+    //       starting to wait can't race with a wake.
+    FlatPtr user_address = (FlatPtr)params.userspace_address;
+    int command = params.futex_op & FUTEX_CMD_MASK;
+
+    Thread::BlockTimeout timeout;
+    if (params.timeout && (command == FUTEX_WAIT || command == FUTEX_WAIT_BITSET || command == FUTEX_LOCK_PI)) {
+        timespec ts_abstimeout { 0, 0 };
+        if (!copy_from_user(&ts_abstimeout, params.timeout))
+            return -EFAULT;
+        clockid_t clock_id = (params.futex_op & FUTEX_CLOCK_REALTIME) ? CLOCK_REALTIME : CLOCK_MONOTONIC_COARSE;
+        timeout = Thread::BlockTimeout(true, &ts_abstimeout, nullptr, clock_id);
+    }
+
+    switch (command) {
+    case FUTEX_WAIT:
+    case FUTEX_WAIT_BITSET: {
+        u32 bitset = command == FUTEX_WAIT ? FUTEX_BITSET_MATCH_ANY : (u32)params.val3;
+        if (bitset == 0)
+            return -EINVAL;
+
         i32 user_value;
         if (!copy_from_user(&user_value, params.userspace_address))
             return -EFAULT;
         if (user_value != params.val)
             return -EAGAIN;
 
-        Thread::BlockTimeout timeout;
-        if (params.timeout) {
-            timespec ts_abstimeout { 0, 0 };
-            if (!copy_from_user(&ts_abstimeout, params.timeout))
+        auto queue = find_futex_queue(user_address, true);
+        Thread::BlockResult result = queue->wait_on(timeout, bitset);
+        release_futex_queue_if_unused(user_address);
+        if (result == Thread::BlockResult::InterruptedByTimeout)
+            return -ETIMEDOUT;
+        return 0;
+    }
+    case FUTEX_WAKE:
+    case FUTEX_WAKE_BITSET: {
+        u32 bitset = command == FUTEX_WAKE ? FUTEX_BITSET_MATCH_ANY : (u32)params.val3;
+        if (bitset == 0)
+            return -EINVAL;
+        if (params.val <= 0)
+            return 0;
+
+        auto queue = find_futex_queue(user_address, false);
+        if (!queue)
+            return 0;
+        u32 did_wake = queue->wake_n(params.val, bitset);
+        release_futex_queue_if_unused(user_address);
+        return did_wake;
+    }
+    case FUTEX_REQUEUE:
+    case FUTEX_CMP_REQUEUE: {
+        if (params.val < 0)
+            return -EINVAL;
+        u32 requeue_count = (u32)(FlatPtr)params.timeout;
+
+        if (command == FUTEX_CMP_REQUEUE) {
+            i32 user_value;
+            if (!copy_from_user(&user_value, params.userspace_address))
                 return -EFAULT;
-            timeout = Thread::BlockTimeout(true, &ts_abstimeout);
+            if (user_value != params.val3)
+                return -EAGAIN;
         }
 
-        WaitQueue& wait_queue = futex_queue((FlatPtr)params.userspace_address);
-        Thread::BlockResult result = wait_queue.wait_on(timeout, "Futex");
-        if (result == Thread::BlockResult::InterruptedByTimeout) {
-            return -ETIMEDOUT;
+        auto queue = find_futex_queue(user_address, false);
+        if (!queue)
+            return 0;
+
+        FlatPtr user_address2 = (FlatPtr)params.userspace_address2;
+        u32 did_wake_or_requeue;
+        if (user_address2 == user_address) {
+            did_wake_or_requeue = queue->wake_n(params.val, FUTEX_BITSET_MATCH_ANY);
+        } else {
+            auto target_queue = find_futex_queue(user_address2, true);
+            if (target_queue->pi_owner()) {
+                release_futex_queue_if_unused(user_address2);
+                return -EINVAL;
+            }
+            did_wake_or_requeue = queue->wake_n_requeue(params.val, *target_queue, requeue_count);
+            release_futex_queue_if_unused(user_address2);
         }
+        release_futex_queue_if_unused(user_address);
+        return did_wake_or_requeue;
+    }
+    case FUTEX_LOCK_PI: {
+        auto* user_word = (volatile u32*)user_address;
+        auto* current_thread = Thread::current();
+        u32 tid = current_thread->tid().value();
+        for (;;) {
+            u32 value;
+            if (!copy_from_user(&value, (const u32*)user_address))
+                return -EFAULT;
+            if ((value & FUTEX_TID_MASK) == tid)
+                return -EDEADLK;
+
+            if ((value & FUTEX_TID_MASK) == 0) {
+                // Nobody owns it, so just take it. Other threads may still be waiting.
+                auto did_exchange = user_atomic_compare_exchange_relaxed(user_word, value, tid | (value & FUTEX_WAITERS));
+                if (!did_exchange.has_value())
+                    return -EFAULT;
+                if (!did_exchange.value())
+                    continue;
+                if (auto queue = find_futex_queue(user_address, false)) {
+                    queue->set_pi_owner(current_thread);
+                    update_inherited_priority(*current_thread);
+                }
+                return 0;
+            }
+
+            // Make sure the owner comes to us when unlocking.
+            if (!(value & FUTEX_WAITERS)) {
+                auto did_exchange = user_atomic_compare_exchange_relaxed(user_word, value, value | FUTEX_WAITERS);
+                if (!did_exchange.has_value())
+                    return -EFAULT;
+                if (!did_exchange.value())
+                    continue;
+            }
 
-        break;
+            auto owner = Thread::from_tid(value & FUTEX_TID_MASK);
+            if (!owner || owner->pid() != pid())
+                return -ESRCH;
+
+            // Lend our priority to the owner until it lets go of the futex.
+            auto queue = find_futex_queue(user_address, true);
+            queue->set_pi_owner(owner);
+            if (owner->inherited_priority() < current_thread->base_priority())
+                owner->set_inherited_priority(current_thread->base_priority());
+
+            Thread::BlockResult result = queue->wait_on(timeout, FUTEX_BITSET_MATCH_ANY);
+
+            // The owner hands the futex over to the waiter it wakes up.
+            if (!copy_from_user(&value, (const u32*)user_address))
+                return -EFAULT;
+            if ((value & FUTEX_TID_MASK) == tid)
+                return 0;
+            if (result == Thread::BlockResult::InterruptedByTimeout) {
+                release_futex_queue_if_unused(user_address);
+                return -ETIMEDOUT;
+            }
+            if (result.was_interrupted()) {
+                // Let the signal handler run; userspace will try again.
+                release_futex_queue_if_unused(user_address);
+                return -EINTR;
+            }
+        }
     }
-    case FUTEX_WAKE:
-        if (params.val == 0)
-            return 0;
-        if (params.val == 1) {
-            futex_queue((FlatPtr)params.userspace_address).wake_one();
-        } else {
-            futex_queue((FlatPtr)params.userspace_address).wake_n(params.val);
+    case FUTEX_UNLOCK_PI: {
+        auto* user_word = (volatile u32*)user_address;
+        auto* current_thread = Thread::current();
+        u32 tid = current_thread->tid().value();
+
+        auto queue = find_futex_queue(user_address, false);
+        RefPtr<Thread> next_owner;
+        for (;;) {
+            u32 value;
+            if (!copy_from_user(&value, (const u32*)user_address))
+                return -EFAULT;
+            if ((value & FUTEX_TID_MASK) != tid)
+                return -EPERM;
+
+            // Hand the futex over to the most important waiter.
+            if (queue && !next_owner)
+                next_owner = queue->wake_highest_priority_waiter();
+            u32 new_value = 0;
+            if (next_owner)
+                new_value = next_owner->tid().value() | (queue->is_empty() ? 0 : FUTEX_WAITERS);
+
+            auto did_exchange = user_atomic_compare_exchange_relaxed(user_word, value, new_value);
+            if (!did_exchange.has_value())
+                return -EFAULT;
+            if (did_exchange.value())
+                break;
         }
-        break;
+
+        if (queue) {
+            queue->set_pi_owner(next_owner);
+            if (next_owner)
+                update_inherited_priority(*next_owner);
+            release_futex_queue_if_unused(user_address);
+        }
+        update_inherited_priority(*current_thread);
+        return 0;
+    }
     }
 
-    return 0;
+    return -ENOSYS;
 }
 
 }
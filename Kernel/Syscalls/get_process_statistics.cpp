@@ -0,0 +1,180 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/StringBuilder.h>
+#include <Kernel/API/ProcessStatistics.h>
+#include <Kernel/FileSystem/Custody.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/FileSystem/VirtualFileSystem.h>
+#include <Kernel/KBufferBuilder.h>
+#include <Kernel/Process.h>
+#include <Kernel/TTY/TTY.h>
+
+namespace Kernel {
+
+static void append_statistics_string(KBufferBuilder& builder, const StringView& string)
+{
+    u16 length = min(string.length(), (size_t)NumericLimits<u16>::max());
+    builder.append((const char*)&length, sizeof(length));
+    builder.append(string.characters_without_null_termination(), length);
+}
+
+static void append_process_statistics(KBufferBuilder& builder, const Process& process, u32 since_generation)
+{
+    ProcessStatisticsEntry entry {};
+    bool has_strings = process.statistics_generation() > since_generation;
+    if (has_strings)
+        entry.flags |= ProcessStatisticsEntry::HasStrings;
+    entry.pid = process.pid().value();
+    entry.pgid = process.tty() ? process.tty()->pgid().value() : 0;
+    entry.pgp = process.pgid().value();
+    entry.sid = process.sid().value();
+    entry.uid = process.uid();
+    entry.gid = process.gid();
+    entry.ppid = process.ppid().value();
+    entry.nfds = process.number_of_open_file_descriptors();
+    entry.amount_virtual = process.amount_virtual();
+    entry.amount_resident = process.amount_resident();
+    entry.amount_shared = process.amount_shared();
+    entry.amount_dirty_private = process.amount_dirty_private();
+    entry.amount_clean_inode = process.amount_clean_inode();
+    entry.amount_purgeable_volatile = process.amount_purgeable_volatile();
+    entry.amount_purgeable_nonvolatile = process.amount_purgeable_nonvolatile();
+
+    Vector<const Thread*, 16> threads;
+    process.for_each_thread([&](const Thread& thread) {
+        threads.append(&thread);
+        return IterationDecision::Continue;
+    });
+    entry.thread_count = threads.size();
+    builder.append((const char*)&entry, sizeof(entry));
+
+    if (has_strings) {
+        String pledge;
+        const char* veil = "";
+        if (process.is_user_process()) {
+            StringBuilder pledge_builder;
+#define __ENUMERATE_PLEDGE_PROMISE(promise)      \
+    if (process.has_promised(Pledge::promise)) { \
+        pledge_builder.append(#promise " ");     \
+    }
+            ENUMERATE_PLEDGE_PROMISES
+#undef __ENUMERATE_PLEDGE_PROMISE
+            pledge = pledge_builder.to_string();
+
+            switch (process.veil_state()) {
+            case VeilState::None:
+                veil = "None";
+                break;
+            case VeilState::Dropped:
+                veil = "Dropped";
+                break;
+            case VeilState::Locked:
+                veil = "Locked";
+                break;
+            }
+        }
+
+        append_statistics_string(builder, process.name());
+        append_statistics_string(builder, process.executable() ? process.executable()->absolute_path() : "");
+        append_statistics_string(builder, process.tty() ? process.tty()->tty_name() : "notty");
+        append_statistics_string(builder, pledge);
+        append_statistics_string(builder, veil);
+    }
+
+    for (auto* thread : threads) {
+        ThreadStatisticsEntry thread_entry {};
+        bool thread_has_strings = thread->statistics_generation() > since_generation;
+        if (thread_has_strings)
+            thread_entry.flags |= ThreadStatisticsEntry::HasStrings;
+        thread_entry.tid = thread->tid().value();
+        thread_entry.times_scheduled = thread->times_scheduled();
+        thread_entry.ticks_user = thread->ticks_in_user();
+        thread_entry.ticks_kernel = thread->ticks_in_kernel();
+        thread_entry.syscall_count = thread->syscall_count();
+        thread_entry.inode_faults = thread->inode_faults();
+        thread_entry.zero_faults = thread->zero_faults();
+        thread_entry.cow_faults = thread->cow_faults();
+        thread_entry.swap_faults = thread->swap_faults();
+        thread_entry.unix_socket_read_bytes = thread->unix_socket_read_bytes();
+        thread_entry.unix_socket_write_bytes = thread->unix_socket_write_bytes();
+        thread_entry.ipv4_socket_read_bytes = thread->ipv4_socket_read_bytes();
+        thread_entry.ipv4_socket_write_bytes = thread->ipv4_socket_write_bytes();
+        thread_entry.file_read_bytes = thread->file_read_bytes();
+        thread_entry.file_write_bytes = thread->file_write_bytes();
+        thread_entry.cpu = thread->cpu();
+        thread_entry.affinity = thread->affinity();
+        thread_entry.priority = thread->priority();
+        thread_entry.effective_priority = thread->effective_priority();
+        StringView state = thread->state_string();
+        memcpy(thread_entry.state, state.characters_without_null_termination(), min(state.length(), sizeof(thread_entry.state) - 1));
+        builder.append((const char*)&thread_entry, sizeof(thread_entry));
+
+        if (thread_has_strings)
+            append_statistics_string(builder, thread->name());
+    }
+}
+
+ssize_t Process::sys$get_process_statistics(Userspace<const Syscall::SC_get_process_statistics_params*> user_params)
+{
+    REQUIRE_PROMISE(rpath);
+    Syscall::SC_get_process_statistics_params params;
+    if (!copy_from_user(&params, user_params))
+        return -EFAULT;
+
+    // This is the same information as /proc/all, so it's subject to the same veil and permissions.
+    auto custody_or_error = VFS::the().resolve_path("/proc/all", current_directory());
+    if (custody_or_error.is_error())
+        return custody_or_error.error();
+    if (!custody_or_error.value()->inode().metadata().may_read(*this))
+        return -EACCES;
+
+    KBufferBuilder builder;
+    {
+        ScopedSpinLock lock(g_scheduler_lock);
+        auto processes = Process::all_processes();
+
+        ProcessStatisticsHeader header {};
+        header.generation = Process::current_statistics_generation();
+        header.process_count = processes.size() + 1;
+        builder.append((const char*)&header, sizeof(header));
+
+        append_process_statistics(builder, *Scheduler::colonel(), params.since_generation);
+        for (auto& process : processes)
+            append_process_statistics(builder, process, params.since_generation);
+    }
+
+    auto buffer = builder.build();
+    if (!buffer)
+        return -ENOMEM;
+    if (buffer->size() > params.buffer_size)
+        return -ERANGE;
+    if (!copy_to_user(params.buffer, buffer->data(), buffer->size()))
+        return -EFAULT;
+    return buffer->size();
+}
+
+}
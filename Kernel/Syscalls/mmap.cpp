@@ -27,6 +27,8 @@
 #include <AK/WeakPtr.h>
 #include <Kernel/FileSystem/FileDescription.h>
 #include <Kernel/Process.h>
+#include <Kernel/VM/AnonymousVMObject.h>
+#include <Kernel/VM/MemoryManager.h>
 #include <Kernel/VM/PageDirectory.h>
 #include <Kernel/VM/PrivateInodeVMObject.h>
 #include <Kernel/VM/PurgeableVMObject.h>
@@ -120,6 +122,7 @@ void* Process::sys$mmap(Userspace<const Syscall::SC_mmap_params*> user_params)
     bool map_private = flags & MAP_PRIVATE;
     bool map_stack = flags & MAP_STACK;
     bool map_fixed = flags & MAP_FIXED;
+    bool map_huge_pages = flags & MAP_HUGETLB;
 
     if (map_shared && map_private)
         return (void*)-EINVAL;
@@ -133,6 +136,13 @@ void* Process::sys$mmap(Userspace<const Syscall::SC_mmap_params*> user_params)
     if (map_stack && (!map_private || !map_anonymous))
         return (void*)-EINVAL;
 
+    if (map_huge_pages && (!map_anonymous || map_purgeable || map_stack))
+        return (void*)-EINVAL;
+
+    // Huge pages need the virtual address to be aligned to their size as well.
+    if (map_huge_pages)
+        alignment = max(alignment, huge_page_size);
+
     Region* region = nullptr;
     Optional<Range> range;
     if (map_purgeable || map_anonymous) {
@@ -147,6 +157,12 @@ void* Process::sys$mmap(Userspace<const Syscall::SC_mmap_params*> user_params)
         region = allocate_region_with_vmobject(range.value(), vmobject, 0, !name.is_null() ? name : "mmap (purgeable)", prot);
         if (!region && (!map_fixed && addr != 0))
             region = allocate_region_with_vmobject({}, size, vmobject, 0, !name.is_null() ? name : "mmap (purgeable)", prot);
+    } else if (map_huge_pages) {
+
+        auto vmobject = AnonymousVMObject::create_with_huge_pages(range.value().size());
+        region = allocate_region_with_vmobject(range.value(), vmobject, 0, !name.is_null() ? name : "mmap (huge)", prot);
+        if (!region && (!map_fixed && addr != 0))
+            region = allocate_region_with_vmobject(allocate_range({}, size, alignment), vmobject, 0, !name.is_null() ? name : "mmap (huge)", prot);
     } else if (map_anonymous) {
 
         region = allocate_region(range.value(), !name.is_null() ? name : "mmap", prot, false);
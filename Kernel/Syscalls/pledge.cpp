@@ -97,6 +97,7 @@ int Process::sys$pledge(Userspace<const Syscall::SC_pledge_params*> user_params)
 
     m_promises = new_promises;
     m_execpromises = new_execpromises;
+    statistics_did_change();
 
     return 0;
 }
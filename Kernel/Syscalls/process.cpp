@@ -62,6 +62,7 @@ int Process::sys$set_process_name(Userspace<const char*> user_name, size_t user_
     if (name.is_null())
         return -EFAULT;
     m_name = move(name);
+    statistics_did_change();
     return 0;
 }
 
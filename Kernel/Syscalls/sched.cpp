@@ -104,6 +104,80 @@ int Process::sys$sched_getparam(pid_t pid, Userspace<struct sched_param*> user_p
     return 0;
 }
 
+static u32 processor_affinity_mask()
+{
+    u32 count = Processor::count();
+    if (count >= 32)
+        return THREAD_AFFINITY_DEFAULT;
+    return (1u << count) - 1;
+}
+
+int Process::sys$sched_setaffinity(pid_t tid, size_t cpusetsize, Userspace<const cpu_set_t*> user_mask)
+{
+    REQUIRE_PROMISE(proc);
+    if (cpusetsize < sizeof(u32))
+        return -EINVAL;
+
+    cpu_set_t mask {};
+    if (!copy_from_user(&mask, user_mask, min(cpusetsize, sizeof(mask))))
+        return -EFAULT;
+
+    u32 affinity = mask.__bits[0] & processor_affinity_mask();
+    if (!affinity)
+        return -EINVAL;
+
+    bool should_yield = false;
+    {
+        auto* peer = Thread::current();
+        ScopedSpinLock lock(g_scheduler_lock);
+        if (tid != 0)
+            peer = Thread::from_tid(tid);
+
+        if (!peer)
+            return -ESRCH;
+
+        if (!is_superuser() && m_euid != peer->process().m_uid && m_uid != peer->process().m_uid)
+            return -EPERM;
+
+        peer->set_affinity(affinity);
+        if (peer->state() == Thread::Runnable)
+            g_scheduler_data->requeue_if_disallowed(*peer);
+        should_yield = peer == Thread::current() && !(affinity & (1u << Processor::current().id()));
+    }
+
+    // We're not allowed to run here anymore, so get off this processor.
+    if (should_yield)
+        Thread::current()->yield_without_holding_big_lock();
+    return 0;
+}
+
+int Process::sys$sched_getaffinity(pid_t tid, size_t cpusetsize, Userspace<cpu_set_t*> user_mask)
+{
+    REQUIRE_PROMISE(proc);
+    if (cpusetsize < sizeof(u32))
+        return -EINVAL;
+
+    cpu_set_t mask {};
+    {
+        auto* peer = Thread::current();
+        ScopedSpinLock lock(g_scheduler_lock);
+        if (tid != 0)
+            peer = Thread::from_tid(tid);
+
+        if (!peer)
+            return -ESRCH;
+
+        if (!is_superuser() && m_euid != peer->process().m_uid && m_uid != peer->process().m_uid)
+            return -EPERM;
+
+        mask.__bits[0] = peer->affinity() & processor_affinity_mask();
+    }
+
+    if (!copy_to_user(user_mask, &mask, min(cpusetsize, sizeof(mask))))
+        return -EFAULT;
+    return 0;
+}
+
 int Process::sys$set_thread_boost(pid_t tid, int amount)
 {
     REQUIRE_PROMISE(proc);
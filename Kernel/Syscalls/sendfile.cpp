@@ -0,0 +1,151 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NumericLimits.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/Process.h>
+#include <Kernel/VM/AnonymousVMObject.h>
+#include <Kernel/VM/MemoryManager.h>
+
+namespace Kernel {
+
+// How much of the file we map into the kernel and pass on to the destination at once.
+static constexpr size_t sendfile_chunk_pages = 16;
+
+ssize_t Process::sys$sendfile(Userspace<const Syscall::SC_sendfile_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+    Syscall::SC_sendfile_params params;
+    if (!copy_from_user(&params, user_params))
+        return -EFAULT;
+    if (params.count > (size_t)NumericLimits<ssize_t>::max())
+        return -EINVAL;
+
+    auto in_description = file_description(params.in_fd);
+    auto out_description = file_description(params.out_fd);
+    if (!in_description || !out_description)
+        return -EBADF;
+    if (!in_description->is_readable() || !out_description->is_writable())
+        return -EBADF;
+
+    // The data has to come from a regular file, since that's what has a page cache.
+    auto* inode = in_description->inode();
+    if (!inode || !inode->metadata().is_regular_file())
+        return -EINVAL;
+
+    off_t offset;
+    if (params.offset) {
+        if (!copy_from_user(&offset, params.offset))
+            return -EFAULT;
+        if (offset < 0)
+            return -EINVAL;
+    } else {
+        offset = in_description->offset();
+    }
+
+    size_t file_size = inode->size();
+    size_t count = 0;
+    if ((size_t)offset < file_size)
+        count = min(params.count, file_size - (size_t)offset);
+
+    bool use_page_cache = inode->has_page_cache() && !in_description->is_direct();
+    OwnPtr<Region> bounce_region;
+
+    ssize_t total_nsent = 0;
+    while ((size_t)total_nsent < count) {
+        size_t chunk_offset = offset + total_nsent;
+        size_t offset_into_first_page = chunk_offset % PAGE_SIZE;
+        size_t chunk_size = min(count - total_nsent, sendfile_chunk_pages * PAGE_SIZE - offset_into_first_page);
+
+        OwnPtr<Region> page_cache_region;
+        u8* data;
+        if (use_page_cache) {
+            // Map the page cache pages themselves, so the destination copies straight out of them.
+            NonnullRefPtrVector<PhysicalPage> pages;
+            size_t first_page_index = chunk_offset / PAGE_SIZE;
+            size_t last_page_index = (chunk_offset + chunk_size - 1) / PAGE_SIZE;
+            KResult result = KSuccess;
+            for (size_t page_index = first_page_index; page_index <= last_page_index; ++page_index) {
+                auto page_or_error = inode->page_cache_page(page_index);
+                if (page_or_error.is_error()) {
+                    result = page_or_error.error();
+                    break;
+                }
+                pages.append(page_or_error.release_value());
+            }
+            if (result.is_error()) {
+                if (total_nsent)
+                    break;
+                return result;
+            }
+            auto vmobject = AnonymousVMObject::create_with_physical_pages(pages);
+            page_cache_region = MM.allocate_kernel_region_with_vmobject(*vmobject, pages.size() * PAGE_SIZE, "sendfile", Region::Access::Read);
+            if (!page_cache_region) {
+                if (total_nsent)
+                    break;
+                return -ENOMEM;
+            }
+            data = page_cache_region->vaddr().offset(offset_into_first_page).as_ptr();
+        } else {
+            if (!bounce_region) {
+                bounce_region = MM.allocate_kernel_region(sendfile_chunk_pages * PAGE_SIZE, "sendfile", Region::Access::Read | Region::Access::Write);
+                if (!bounce_region)
+                    return -ENOMEM;
+            }
+            data = bounce_region->vaddr().as_ptr();
+            auto buffer = UserOrKernelBuffer::for_kernel_buffer(data);
+            ssize_t nread = inode->read_bytes(chunk_offset, chunk_size, buffer, in_description);
+            if (nread <= 0) {
+                if (total_nsent || nread == 0)
+                    break;
+                return nread;
+            }
+            chunk_size = nread;
+        }
+
+        ssize_t nwritten = do_write(*out_description, UserOrKernelBuffer::for_kernel_buffer(data), chunk_size);
+        if (nwritten < 0) {
+            if (total_nsent)
+                break;
+            return nwritten;
+        }
+        total_nsent += nwritten;
+        if ((size_t)nwritten < chunk_size)
+            break;
+    }
+
+    off_t new_offset = offset + total_nsent;
+    if (params.offset) {
+        if (!copy_to_user(params.offset, &new_offset))
+            return -EFAULT;
+    } else {
+        in_description->seek(new_offset, SEEK_SET);
+    }
+    return total_nsent;
+}
+
+}
@@ -58,6 +58,7 @@ pid_t Process::sys$setsid()
     m_sid = m_pid.value();
     m_pg = ProcessGroup::create(ProcessGroupID(m_pid.value()));
     m_tty = nullptr;
+    statistics_did_change();
     return m_sid.value();
 }
 
@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NumericLimits.h>
+#include <Kernel/FileSystem/FIFO.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/Process.h>
+
+namespace Kernel {
+
+ssize_t Process::sys$splice(Userspace<const Syscall::SC_splice_params*> user_params)
+{
+    REQUIRE_PROMISE(stdio);
+    Syscall::SC_splice_params params;
+    if (!copy_from_user(&params, user_params))
+        return -EFAULT;
+    if (params.flags & ~(SPLICE_F_MOVE | SPLICE_F_NONBLOCK))
+        return -EINVAL;
+    if (params.length > (size_t)NumericLimits<ssize_t>::max())
+        return -EINVAL;
+    if (params.length == 0)
+        return 0;
+
+    auto in_description = file_description(params.fd_in);
+    auto out_description = file_description(params.fd_out);
+    if (!in_description || !out_description)
+        return -EBADF;
+    if (!in_description->is_readable() || !out_description->is_writable())
+        return -EBADF;
+    if (in_description->is_directory())
+        return -EISDIR;
+
+    // One of the two has to be a pipe, since that's where the data is moved through.
+    auto* in_fifo = in_description->fifo();
+    auto* out_fifo = out_description->fifo();
+    if (!in_fifo && !out_fifo)
+        return -EINVAL;
+    if (in_fifo && in_fifo == out_fifo)
+        return -EINVAL;
+
+    bool nonblocking = params.flags & SPLICE_F_NONBLOCK;
+    KResultOr<size_t> result = 0;
+    for (;;) {
+        if (!in_description->can_read()) {
+            if (nonblocking || !in_description->is_blocking())
+                return -EAGAIN;
+            auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+            if (Thread::current()->block<Thread::ReadBlocker>(nullptr, *in_description, unblock_flags).was_interrupted())
+                return -EINTR;
+            if (!((u32)unblock_flags & (u32)Thread::FileBlocker::BlockFlags::Read))
+                return -EAGAIN;
+        }
+        if (out_fifo && !out_description->can_write()) {
+            if (nonblocking || !out_description->is_blocking())
+                return -EAGAIN;
+            auto unblock_flags = Thread::FileBlocker::BlockFlags::None;
+            if (Thread::current()->block<Thread::WriteBlocker>(nullptr, *out_description, unblock_flags).was_interrupted())
+                return -EINTR;
+            if (!((u32)unblock_flags & (u32)Thread::FileBlocker::BlockFlags::Write))
+                return -EAGAIN;
+        }
+
+        if (in_fifo && out_fifo) {
+            // Pipe to pipe: copy straight from one pipe buffer into the other.
+            result = in_fifo->read_with(params.length, [&](u8* in_chunk, size_t in_chunk_size) {
+                size_t ncopied = 0;
+                return out_fifo->write_with(in_chunk_size, [&](u8* out_chunk, size_t out_chunk_size) -> KResultOr<size_t> {
+                    memcpy(out_chunk, in_chunk + ncopied, out_chunk_size);
+                    ncopied += out_chunk_size;
+                    return out_chunk_size;
+                });
+            });
+        } else if (in_fifo) {
+            // Pipe to file: write the pipe buffer contents out directly.
+            result = in_fifo->read_with(params.length, [&](u8* chunk, size_t chunk_size) -> KResultOr<size_t> {
+                auto buffer = UserOrKernelBuffer::for_kernel_buffer(chunk);
+                ssize_t nwritten = do_write(*out_description, buffer, chunk_size);
+                if (nwritten < 0)
+                    return KResult(nwritten);
+                return (size_t)nwritten;
+            });
+        } else {
+            // File to pipe: read the file contents directly into the pipe buffer.
+            result = out_fifo->write_with(params.length, [&](u8* chunk, size_t chunk_size) {
+                auto buffer = UserOrKernelBuffer::for_kernel_buffer(chunk);
+                return in_description->read(buffer, chunk_size);
+            });
+        }
+
+        if (result.is_error() || result.value() != 0)
+            break;
+        // Moving nothing into a pipe only means end-of-file if there really is nothing left to read. Otherwise, the
+        // output pipe filled up (or the input pipe ran dry) since we looked, so go back to waiting for it.
+        bool at_end = !out_fifo || (in_fifo ? in_fifo->is_at_end_of_stream() : !out_fifo->is_full());
+        if (at_end)
+            break;
+    }
+
+    if (result.is_error())
+        return result.error();
+    return result.value();
+}
+
+}
@@ -40,6 +40,7 @@ int Process::sys$unveil(Userspace<const Syscall::SC_unveil_params*> user_params)
 
     if (!params.path.characters && !params.permissions.characters) {
         m_veil_state = VeilState::Locked;
+        statistics_did_change();
         return 0;
     }
 
@@ -127,6 +128,7 @@ int Process::sys$unveil(Userspace<const Syscall::SC_unveil_params*> user_params)
         [](auto& parent, auto& it) -> Optional<UnveilMetadata> { return UnveilMetadata { String::formatted("{}/{}", parent.path(), *it), parent.permissions(), false, parent.permissions_inherited_from_root() }; });
     ASSERT(m_veil_state != VeilState::Locked);
     m_veil_state = VeilState::Dropped;
+    statistics_did_change();
     return 0;
 }
 
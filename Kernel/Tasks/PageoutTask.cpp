@@ -0,0 +1,164 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NonnullRefPtrVector.h>
+#include <Kernel/Process.h>
+#include <Kernel/Tasks/PageoutTask.h>
+#include <Kernel/VM/AnonymousVMObject.h>
+#include <Kernel/VM/InodeVMObject.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VM/PageCache.h>
+#include <Kernel/VM/PurgeableVMObject.h>
+#include <Kernel/VM/SwapDevice.h>
+#include <Kernel/WaitQueue.h>
+
+namespace Kernel {
+
+static WaitQueue* s_pageout_wait_queue;
+static WaitQueue* s_reclaim_done_wait_queue;
+static Thread* s_pageout_thread;
+
+// How many pages to take from a single VMObject before moving on to the next one.
+static constexpr size_t pages_per_vmobject = 32;
+
+template<typename T>
+static NonnullRefPtrVector<T> all_vmobjects_of_type()
+{
+    NonnullRefPtrVector<T> vmobjects;
+    ScopedSpinLock lock(s_mm_lock);
+    MM.for_each_vmobject_of_type<T>([&](auto& vmobject) {
+        vmobjects.append(vmobject);
+        return IterationDecision::Continue;
+    });
+    return vmobjects;
+}
+
+static size_t purge_volatile_memory()
+{
+    size_t count = 0;
+    for (auto& vmobject : all_vmobjects_of_type<PurgeableVMObject>()) {
+        if (vmobject.is_volatile())
+            count += vmobject.purge();
+        if (!PageCache::memory_is_low())
+            break;
+    }
+    return count;
+}
+
+static size_t release_clean_inode_pages()
+{
+    size_t count = 0;
+    for (auto& vmobject : all_vmobjects_of_type<InodeVMObject>()) {
+        count += vmobject.release_unused_clean_pages(pages_per_vmobject);
+        // The pages we dropped may still be in the page cache.
+        if (count)
+            PageCache::evict_unused_pages_everywhere();
+        if (!PageCache::memory_is_low())
+            break;
+    }
+    return count;
+}
+
+static size_t swap_out_anonymous_pages(SwapDevice& swap_device)
+{
+    size_t count = 0;
+    for (auto& vmobject : all_vmobjects_of_type<AnonymousVMObject>()) {
+        count += vmobject.swap_out_unused_pages(swap_device, pages_per_vmobject);
+        if (!PageCache::memory_is_low())
+            break;
+    }
+    return count;
+}
+
+static void reclaim_memory()
+{
+    size_t evicted = 0;
+    size_t purged = 0;
+    size_t released = 0;
+    size_t swapped_out = 0;
+
+    // Start with what's cheapest to get back. The first pass over mapped pages mostly clears their
+    // accessed bits, so pages that weren't touched in between are only taken away on the second one.
+    for (int pass = 0; pass < 2 && PageCache::memory_is_low(); ++pass) {
+        evicted += PageCache::evict_unused_pages_everywhere();
+        if (!PageCache::memory_is_low())
+            break;
+        purged += purge_volatile_memory();
+        if (!PageCache::memory_is_low())
+            break;
+        released += release_clean_inode_pages();
+        if (!PageCache::memory_is_low())
+            break;
+        if (auto* swap_device = SwapDevice::the())
+            swapped_out += swap_out_anonymous_pages(*swap_device);
+    }
+
+    if (evicted || purged || released || swapped_out)
+        dbg() << "PageoutTask: Evicted " << evicted << ", purged " << purged << ", released " << released << " and swapped out " << swapped_out << " pages";
+}
+
+void PageoutTask::spawn()
+{
+    s_pageout_wait_queue = new WaitQueue;
+    s_reclaim_done_wait_queue = new WaitQueue;
+    RefPtr<Thread> pageout_thread;
+    Process::create_kernel_process(pageout_thread, "PageoutTask", [] {
+        dbg() << "PageoutTask is running";
+        for (;;) {
+            if (PageCache::memory_is_low())
+                reclaim_memory();
+            s_reclaim_done_wait_queue->wake_all();
+            timeval timeout { 1, 0 };
+            s_pageout_wait_queue->wait_on(Thread::BlockTimeout(false, &timeout), "PageoutTask");
+        }
+    });
+    s_pageout_thread = pageout_thread.ptr();
+}
+
+void PageoutTask::wake()
+{
+    if (s_pageout_wait_queue)
+        s_pageout_wait_queue->wake_one();
+}
+
+void PageoutTask::wait_for_reclaim()
+{
+    if (!s_pageout_wait_queue)
+        return;
+    auto& processor = Processor::current();
+    auto* current_thread = Thread::current();
+    // Page faults and anyone holding a spinlock can't block, and the pageout task can't wait for itself.
+    if (processor.in_irq() || processor.in_critical() || !current_thread || current_thread == s_pageout_thread) {
+        wake();
+        PageCache::evict_unused_pages_everywhere();
+        return;
+    }
+    wake();
+    timeval timeout { 1, 0 };
+    s_reclaim_done_wait_queue->wait_on(Thread::BlockTimeout(false, &timeout), "PageoutTask");
+}
+
+}
@@ -30,5 +30,8 @@ namespace Kernel {
 class SyncTask {
 public:
     static void spawn();
+
+    // Ask the sync task to flush dirty data now instead of at its next periodic wakeup.
+    static void wake();
 };
 }
@@ -49,6 +49,7 @@ namespace Kernel {
 Thread::Thread(NonnullRefPtr<Process> process)
     : m_process(move(process))
     , m_name(m_process->name())
+    , m_statistics_generation(Process::next_statistics_generation())
 {
     if (m_process->m_thread_count.fetch_add(1, AK::MemoryOrder::memory_order_relaxed) == 0) {
         // First thread gets TID == PID
@@ -122,7 +123,7 @@ Thread::~Thread()
         // block conditions would access m_process, which would be in
         // the middle of being destroyed.
         ScopedSpinLock lock(g_scheduler_lock);
-        g_scheduler_data->thread_list_for_state(m_state).remove(*this);
+        g_scheduler_data->remove_thread(*this);
     }
 }
 
@@ -340,6 +341,11 @@ const char* Thread::state_string() const
     return nullptr;
 }
 
+void Thread::statistics_did_change()
+{
+    m_statistics_generation = Process::next_statistics_generation();
+}
+
 void Thread::finalize()
 {
     ASSERT(Thread::current() == g_finalizer);
@@ -942,17 +948,21 @@ void Thread::update_state_for_thread(Thread::State previous_state)
     ASSERT_INTERRUPTS_DISABLED();
     ASSERT(g_scheduler_data);
     ASSERT(g_scheduler_lock.own_lock());
-    auto& previous_list = g_scheduler_data->thread_list_for_state(previous_state);
-    auto& list = g_scheduler_data->thread_list_for_state(state());
+    auto& scheduler_data = *g_scheduler_data;
 
-    if (&previous_list != &list) {
-        previous_list.remove(*this);
+    if (!is_runnable_state(state())) {
+        if (is_runnable_state(previous_state))
+            scheduler_data.dequeue(*this);
+        if (!scheduler_data.m_nonrunnable_threads.contains(*this))
+            scheduler_data.m_nonrunnable_threads.append(*this);
+        return;
     }
 
-    if (list.contains(*this))
+    // Going from Runnable to Running (or back) keeps us on the same run queue.
+    if (scheduler_data.is_queued(*this))
         return;
 
-    list.append(*this);
+    scheduler_data.enqueue(*this, scheduler_data.select_run_queue_for(*this));
 }
 
 String Thread::backtrace()
@@ -105,6 +105,11 @@ public:
     void set_priority_boost(u32 boost) { m_priority_boost = boost; }
     u32 priority_boost() const { return m_priority_boost; }
 
+    // The priority inherited from threads waiting for a PI futex held by this thread
+    void set_inherited_priority(u32 priority) { m_inherited_priority = priority; }
+    u32 inherited_priority() const { return m_inherited_priority; }
+    u32 base_priority() const { return max(m_priority, m_inherited_priority); }
+
     u32 effective_priority() const;
 
     void detach()
@@ -136,12 +141,16 @@ public:
     {
         ScopedSpinLock lock(m_lock);
         m_name = s;
+        statistics_did_change();
     }
     void set_name(String&& name)
     {
         ScopedSpinLock lock(m_lock);
         m_name = move(name);
+        statistics_did_change();
     }
+    u32 statistics_generation() const { return m_statistics_generation; }
+    void statistics_did_change();
 
     void finalize();
 
@@ -261,6 +270,7 @@ public:
         enum class Type {
             Unknown = 0,
             File,
+            Futex,
             Plan9FS,
             Join,
             Queue,
@@ -312,6 +322,12 @@ public:
         void begin_blocking(Badge<Thread>);
         BlockResult end_blocking(Badge<Thread>, bool);
 
+        void did_requeue(Badge<BlockCondition>, BlockCondition& block_condition)
+        {
+            ScopedSpinLock lock(m_lock);
+            m_block_condition = &block_condition;
+        }
+
     protected:
         void do_set_interrupted_by_death()
         {
@@ -423,6 +439,44 @@ public:
             return did_unblock;
         }
 
+        // Moves blockers to another block condition without unblocking them
+        template<typename RequeueOne>
+        u32 do_requeue(BlockCondition& target, RequeueOne requeue_one)
+        {
+            ASSERT(m_lock.is_locked());
+            ASSERT(&target != this);
+            ScopedSpinLock target_lock(target.m_lock);
+            bool stop_iterating = false;
+            u32 requeued = 0;
+            for (size_t i = 0; i < m_blockers.size() && !stop_iterating;) {
+                auto info = m_blockers[i];
+                if (requeue_one(*info.blocker, info.data, stop_iterating)) {
+                    m_blockers.remove(i);
+                    target.m_blockers.append(info);
+                    info.blocker->did_requeue({}, target);
+                    requeued++;
+                    continue;
+                }
+
+                i++;
+            }
+            return requeued;
+        }
+
+        template<typename Callback>
+        void do_for_each_blocker(Callback callback)
+        {
+            ASSERT(m_lock.is_locked());
+            for (auto& info : m_blockers)
+                callback(*info.blocker, info.data);
+        }
+
+        bool do_is_empty() const
+        {
+            ASSERT(m_lock.is_locked());
+            return m_blockers.is_empty();
+        }
+
         virtual bool should_add_blocker(Blocker&, void*) { return true; }
 
         SpinLock<u8> m_lock;
@@ -477,6 +531,30 @@ public:
         bool m_did_unblock { false };
     };
 
+    class FutexBlocker final : public Blocker {
+    public:
+        FutexBlocker(FutexQueue&, u32 bitset);
+        virtual ~FutexBlocker();
+
+        virtual Type blocker_type() const override { return Type::Futex; }
+        virtual const char* state_string() const override { return "Futex"; }
+        virtual void not_blocking(bool) override { }
+
+        virtual bool should_block() override
+        {
+            return m_should_block;
+        }
+
+        u32 bitset() const { return m_bitset; }
+
+        bool unblock();
+
+    private:
+        u32 m_bitset;
+        bool m_should_block { true };
+        bool m_did_unblock { false };
+    };
+
     class FileBlocker : public Blocker {
     public:
         enum class BlockFlags : u32 {
@@ -945,6 +1023,8 @@ public:
     void did_zero_fault() { ++m_zero_faults; }
     unsigned cow_faults() const { return m_cow_faults; }
     void did_cow_fault() { ++m_cow_faults; }
+    unsigned swap_faults() const { return m_swap_faults; }
+    void did_swap_fault() { ++m_swap_faults; }
 
     unsigned file_read_bytes() const { return m_file_read_bytes; }
     unsigned file_write_bytes() const { return m_file_write_bytes; }
@@ -1075,9 +1155,15 @@ public:
 #endif
 
 private:
+    static constexpr u32 not_on_a_run_queue = 0xffffffff;
+
+    // m_run_queue_cpu only changes while holding the lock of the run queue the thread
+    // is moving from or to.
     IntrusiveListNode m_runnable_list_node;
+    u32 m_run_queue_cpu { not_on_a_run_queue };
 
 private:
+    friend class SchedulerPerProcessorData;
     friend struct SchedulerData;
     friend class WaitQueue;
 
@@ -1182,6 +1268,7 @@ private:
     unsigned m_inode_faults { 0 };
     unsigned m_zero_faults { 0 };
     unsigned m_cow_faults { 0 };
+    unsigned m_swap_faults { 0 };
 
     unsigned m_file_read_bytes { 0 };
     unsigned m_file_write_bytes { 0 };
@@ -1195,9 +1282,11 @@ private:
     FPUState* m_fpu_state { nullptr };
     State m_state { Invalid };
     String m_name;
+    u32 m_statistics_generation { 0 };
     u32 m_priority { THREAD_PRIORITY_NORMAL };
     u32 m_extra_priority { 0 };
     u32 m_priority_boost { 0 };
+    u32 m_inherited_priority { 0 };
 
     State m_stop_state { Invalid };
 
@@ -1252,23 +1341,104 @@ inline IterationDecision Thread::for_each_in_state(State state, Callback callbac
 
 const LogStream& operator<<(const LogStream&, const Thread&);
 
-struct SchedulerData {
+class SchedulerPerProcessorData {
+    AK_MAKE_NONCOPYABLE(SchedulerPerProcessorData);
+    AK_MAKE_NONMOVABLE(SchedulerPerProcessorData);
+
+public:
     typedef IntrusiveList<Thread, &Thread::m_runnable_list_node> ThreadList;
 
-    ThreadList m_runnable_threads;
+    explicit SchedulerPerProcessorData(u32 cpu)
+        : m_cpu(cpu)
+    {
+    }
+
+    u32 cpu() const { return m_cpu; }
+
+    WeakPtr<Thread> m_pending_beneficiary;
+    const char* m_pending_donate_reason { nullptr };
+    bool m_in_scheduler { true };
+
+    // The threads that are runnable on this processor. Only this processor picks
+    // threads from it. Other processors only lock it to queue threads that became
+    // runnable, to steal threads or to balance the load.
+    RecursiveSpinLock m_run_queue_lock;
+    ThreadList m_run_queue;
+
+    // These may be read without holding m_run_queue_lock.
+    Atomic<u32> m_run_queue_length { 0 };
+    u64 m_steal_count { 0 };
+    u64 m_migrations_in { 0 };
+    u64 m_migrations_out { 0 };
+
+private:
+    const u32 m_cpu { 0 };
+};
+
+struct SchedulerData {
+    typedef SchedulerPerProcessorData::ThreadList ThreadList;
+
+    // Thread affinity masks are 32 bits wide, so this is as many run queues as we can address.
+    static constexpr u32 max_run_queues = 32;
+
+    // Protected by g_scheduler_lock.
     ThreadList m_nonrunnable_threads;
 
+    Atomic<u32> m_online_run_queues { 0 };
+
+    bool is_run_queue_online(u32 cpu) const
+    {
+        return cpu < max_run_queues && (m_online_run_queues.load(AK::MemoryOrder::memory_order_relaxed) & (1u << cpu)) != 0;
+    }
+
+    // The boot processor's run queue is set up before it starts scheduling,
+    // so that threads can be queued on it early on.
+    bool has_run_queue(u32 cpu) const
+    {
+        return cpu == 0 || is_run_queue_online(cpu);
+    }
+
+    SchedulerPerProcessorData& run_queue(u32 cpu)
+    {
+        ASSERT(has_run_queue(cpu));
+        return Processor::by_id(cpu).get_scheduler_data();
+    }
+
+    bool is_queued(const Thread& thread) const
+    {
+        return thread.m_run_queue_cpu != Thread::not_on_a_run_queue;
+    }
+
     bool has_thread(Thread& thread) const
     {
-        return m_runnable_threads.contains(thread) || m_nonrunnable_threads.contains(thread);
+        return is_queued(thread) || m_nonrunnable_threads.contains(thread);
     }
 
-    ThreadList& thread_list_for_state(Thread::State state)
+    // Threads are only put on or taken off a run queue while holding g_scheduler_lock,
+    // as part of a state transition. Moving a queued thread between run queues only
+    // needs the locks of the two queues involved.
+    void enqueue(Thread&, u32 cpu);
+    void dequeue(Thread&);
+    bool migrate(Thread&, u32 to_cpu);
+
+    // Moves a queued thread to a run queue it's allowed on, e.g. after its affinity changed.
+    void requeue_if_disallowed(Thread&);
+
+    void remove_thread(Thread& thread)
     {
-        if (Thread::is_runnable_state(state))
-            return m_runnable_threads;
-        return m_nonrunnable_threads;
+        dequeue(thread);
+        if (m_nonrunnable_threads.contains(thread))
+            m_nonrunnable_threads.remove(thread);
     }
+
+    u32 select_run_queue_for(const Thread&) const;
+
+    // Locks the run queue the thread is on and returns it, or returns nullptr if it's not queued.
+    SchedulerPerProcessorData* lock_run_queue_of(const Thread&, u32& prev_flags);
+
+    // Locks all run queues in order, e.g. to iterate over them. Returns which ones were locked.
+    u32 lock_all_run_queues(u32 (&prev_flags)[max_run_queues]);
+    void unlock_all_run_queues(u32 locked_run_queues, u32 (&prev_flags)[max_run_queues]);
 };
 
 template<typename Callback>
@@ -1276,15 +1446,26 @@ inline IterationDecision Scheduler::for_each_runnable(Callback callback)
 {
     ASSERT_INTERRUPTS_DISABLED();
     ASSERT(g_scheduler_lock.own_lock());
-    auto& tl = g_scheduler_data->m_runnable_threads;
-    for (auto it = tl.begin(); it != tl.end();) {
-        auto& thread = *it;
-        it = ++it;
-        if (callback(thread) == IterationDecision::Break)
-            return IterationDecision::Break;
+    // Run queue locks are recursive, so the callback may still change thread states.
+    auto& scheduler_data = *g_scheduler_data;
+    u32 prev_flags[SchedulerData::max_run_queues];
+    u32 locked_run_queues = scheduler_data.lock_all_run_queues(prev_flags);
+    auto decision = IterationDecision::Continue;
+    for (u32 cpu = 0; cpu < SchedulerData::max_run_queues && decision == IterationDecision::Continue; cpu++) {
+        if (!(locked_run_queues & (1u << cpu)))
+            continue;
+        auto& tl = scheduler_data.run_queue(cpu).m_run_queue;
+        for (auto it = tl.begin(); it != tl.end();) {
+            auto& thread = *it;
+            it = ++it;
+            if (callback(thread) == IterationDecision::Break) {
+                decision = IterationDecision::Break;
+                break;
+            }
+        }
     }
-
-    return IterationDecision::Continue;
+    scheduler_data.unlock_all_run_queues(locked_run_queues, prev_flags);
+    return decision;
 }
 
 template<typename Callback>
@@ -269,6 +269,11 @@ u64 HPET::update_time(u64& seconds_since_boot, u32& ticks_this_second, bool quer
     return (delta_ticks * 1000000000ull) / ticks_per_second;
 }
 
+PhysicalAddress HPET::main_counter_physical_address() const
+{
+    return m_physical_acpi_hpet_registers.offset(__builtin_offsetof(HPETRegistersBlock, main_counter_value));
+}
+
 void HPET::enable_periodic_interrupt(const HPETComparator& comparator)
 {
 #ifdef HPET_DEBUG
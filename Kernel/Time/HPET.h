@@ -61,6 +61,10 @@ public:
 
     u64 update_time(u64& seconds_since_boot, u32& ticks_this_second, bool query_only);
 
+    PhysicalAddress main_counter_physical_address() const;
+    u64 main_counter_last_read() const { return m_main_counter_last_read; }
+    u64 main_counter_drift() const { return m_main_counter_drift; }
+
     Vector<unsigned> capable_interrupt_numbers(u8 comparator_number);
     Vector<unsigned> capable_interrupt_numbers(const HPETComparator&);
 
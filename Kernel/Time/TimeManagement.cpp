@@ -39,6 +39,7 @@
 #include <Kernel/Time/RTC.h>
 #include <Kernel/Time/TimeManagement.h>
 #include <Kernel/TimerQueue.h>
+#include <Kernel/VM/AnonymousVMObject.h>
 #include <Kernel/VM/MemoryManager.h>
 
 //#define TIME_DEBUG
@@ -92,8 +93,11 @@ bool TimeManagement::is_system_timer(const HardwareTimerBase& timer) const
 void TimeManagement::set_epoch_time(timespec ts)
 {
     InterruptDisabler disabler;
+    u32 update_iteration = m_update1.fetch_add(1, AK::MemoryOrder::memory_order_acquire);
     m_epoch_time = ts;
     m_remaining_epoch_time_adjustment = { 0, 0 };
+    update_time_page();
+    m_update2.store(update_iteration + 1, AK::MemoryOrder::memory_order_release);
 }
 
 timespec TimeManagement::monotonic_time(TimePrecision precision) const
@@ -211,6 +215,61 @@ TimeManagement::TimeManagement()
     } else if (!probe_and_set_legacy_hardware_timers()) {
         ASSERT_NOT_REACHED();
     }
+    set_up_time_page();
+}
+
+void TimeManagement::set_up_time_page()
+{
+    auto physical_page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::Yes);
+    ASSERT(physical_page);
+    auto vmobject = AnonymousVMObject::create_with_physical_page(*physical_page);
+    m_time_page_region = MM.allocate_kernel_region_with_vmobject(vmobject, PAGE_SIZE, "Time page", Region::Access::Read | Region::Access::Write);
+    m_user_time_page_region = MM.allocate_kernel_region_with_vmobject(vmobject, PAGE_SIZE, "User time page", Region::Access::Read, true);
+    ASSERT(m_time_page_region && m_user_time_page_region);
+
+    auto& page = time_page();
+    page.ticks_per_second = m_time_ticks_per_second;
+
+    if (m_can_query_precise_time) {
+        // Let userspace read the HPET main counter so it can get the precise
+        // time the same way monotonic_time() does. The HPET registers can't be
+        // mapped any finer than a page, so this is the one page holding the
+        // counter, read-only. Reading any of the registers has no side effects.
+        auto main_counter = HPET::the().main_counter_physical_address();
+        ASSERT(main_counter.offset_in_page() + sizeof(u64) <= PAGE_SIZE);
+        m_user_hpet_main_counter_region = MM.allocate_kernel_region(main_counter.page_base(), PAGE_SIZE, "User HPET main counter", Region::Access::Read, true, false);
+        if (m_user_hpet_main_counter_region)
+            page.hpet_main_counter_address = m_user_hpet_main_counter_region->vaddr().offset(main_counter.offset_in_page()).get();
+    }
+
+    update_time_page();
+}
+
+VirtualAddress TimeManagement::user_time_page_address() const
+{
+    return m_user_time_page_region->vaddr();
+}
+
+TimePage& TimeManagement::time_page()
+{
+    return *(TimePage*)m_time_page_region->vaddr().as_ptr();
+}
+
+void TimeManagement::update_time_page()
+{
+    // NOTE: This must only be called while holding m_update1 ahead of m_update2,
+    // so that there's only ever one writer.
+    auto& page = time_page();
+    u32 update_iteration = AK::atomic_fetch_add(&page.update1, 1u, AK::MemoryOrder::memory_order_acquire);
+    page.seconds_since_boot = m_seconds_since_boot;
+    page.ticks_this_second = m_ticks_this_second;
+    page.epoch_seconds = m_epoch_time.tv_sec;
+    page.epoch_nanoseconds = m_epoch_time.tv_nsec;
+    if (page.hpet_main_counter_address) {
+        page.hpet_main_counter_last_read = HPET::the().main_counter_last_read();
+        page.hpet_main_counter_drift = HPET::the().main_counter_drift();
+    }
+    AK::atomic_store(&page.update2, update_iteration + 1, AK::MemoryOrder::memory_order_release);
 }
 
 timeval TimeManagement::now_as_timeval()
@@ -356,6 +415,7 @@ void TimeManagement::increment_time_since_boot_hpet()
     m_ticks_this_second = ticks_this_second;
     // TODO: Apply m_remaining_epoch_time_adjustment
     timespec_add(m_epoch_time, { (time_t)(delta_ns / 1000000000), (long)(delta_ns % 1000000000) }, m_epoch_time);
+    update_time_page();
     m_update2.store(update_iteration + 1, AK::MemoryOrder::memory_order_release);
 }
 
@@ -386,6 +446,7 @@ void TimeManagement::increment_time_since_boot()
         ++m_seconds_since_boot;
         m_ticks_this_second = 0;
     }
+    update_time_page();
     m_update2.store(update_iteration + 1, AK::MemoryOrder::memory_order_release);
 }
 
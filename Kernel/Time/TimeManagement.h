@@ -27,16 +27,20 @@
 #pragma once
 
 #include <AK/NonnullRefPtrVector.h>
+#include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
 #include <AK/Types.h>
+#include <Kernel/API/TimePage.h>
 #include <Kernel/KResult.h>
 #include <Kernel/UnixTypes.h>
+#include <Kernel/VirtualAddress.h>
 
 namespace Kernel {
 
 #define OPTIMAL_TICKS_PER_SECOND_RATE 250
 
 class HardwareTimerBase;
+class Region;
 
 enum class TimePrecision {
     Coarse = 0,
@@ -80,6 +84,9 @@ public:
     timespec remaining_epoch_time_adjustment() const { return m_remaining_epoch_time_adjustment; }
     void set_remaining_epoch_time_adjustment(const timespec& adjustment) { m_remaining_epoch_time_adjustment = adjustment; }
 
+    // The address at which userspace can read the TimePage.
+    VirtualAddress user_time_page_address() const;
+
 private:
     bool probe_and_set_legacy_hardware_timers();
     bool probe_and_set_non_legacy_hardware_timers();
@@ -89,6 +96,10 @@ private:
     void set_system_timer(HardwareTimerBase&);
     static void system_timer_tick(const RegisterState&);
 
+    void set_up_time_page();
+    void update_time_page();
+    TimePage& time_page();
+
     // Variables between m_update1 and m_update2 are synchronized
     Atomic<u32> m_update1 { 0 };
     u32 m_ticks_this_second { 0 };
@@ -102,6 +113,10 @@ private:
 
     RefPtr<HardwareTimerBase> m_system_timer;
     RefPtr<HardwareTimerBase> m_time_keeper_timer;
+
+    OwnPtr<Region> m_time_page_region;
+    OwnPtr<Region> m_user_time_page_region;
+    OwnPtr<Region> m_user_hpet_main_counter_region;
 };
 
 }
@@ -87,6 +87,8 @@ TimerQueue& TimerQueue::the()
 TimerQueue::TimerQueue()
 {
     m_ticks_per_second = TimeManagement::the().ticks_per_second();
+    m_timer_queue_monotonic.clock_id = CLOCK_MONOTONIC_COARSE;
+    m_timer_queue_realtime.clock_id = CLOCK_REALTIME_COARSE;
 }
 
 RefPtr<Timer> TimerQueue::add_timer_without_id(clockid_t clock_id, const timespec& deadline, Function<void()>&& callback)
@@ -113,38 +115,40 @@ TimerId TimerQueue::add_timer(NonnullRefPtr<Timer>&& timer)
 
     timer->m_id = ++m_timer_id_count;
     ASSERT(timer->m_id != 0); // wrapped
+    m_timers_by_id.set(timer->m_id, timer.ptr());
     add_timer_locked(move(timer));
     return m_timer_id_count;
 }
 
 void TimerQueue::add_timer_locked(NonnullRefPtr<Timer> timer)
 {
-    u64 timer_expiration = timer->m_expires;
-
     ASSERT(!timer->is_queued());
 
     auto& queue = queue_for_timer(*timer);
-    if (queue.list.is_empty()) {
-        queue.list.append(&timer.leak_ref());
-        queue.next_timer_due = timer_expiration;
-    } else {
-        Timer* following_timer = nullptr;
-        queue.list.for_each([&](Timer& t) {
-            if (t.m_expires > timer_expiration) {
-                following_timer = &t;
-                return IterationDecision::Break;
-            }
-            return IterationDecision::Continue;
-        });
-        if (following_timer) {
-            bool next_timer_needs_update = queue.list.head() == following_timer;
-            queue.list.insert_before(following_timer, &timer.leak_ref());
-            if (next_timer_needs_update)
-                queue.next_timer_due = timer_expiration;
-        } else {
-            queue.list.append(&timer.leak_ref());
-        }
-    }
+    insert_timer_locked(queue, timer.leak_ref());
+}
+
+void TimerQueue::insert_timer_locked(Queue& queue, Timer& timer)
+{
+    ASSERT(g_timerqueue_lock.is_locked());
+
+    u64 expires_tick = timer.m_expires >> tick_shift;
+    if (expires_tick < queue.current_tick)
+        expires_tick = queue.current_tick;
+
+    // Pick the lowest level that the timer fits in. Anything that is too
+    // far out for the last level waits in its farthest slot.
+    u64 delta = expires_tick - queue.current_tick;
+    size_t level = 0;
+    while (level < level_count - 1 && delta >= (1ull << ((level + 1) * level_bits)))
+        level++;
+    if (delta >= (1ull << (level_count * level_bits)))
+        expires_tick = queue.current_tick + (1ull << (level_count * level_bits)) - 1;
+
+    auto& slot = queue.slots[level][(expires_tick >> (level * level_bits)) & (slots_per_level - 1)];
+    slot.append(&timer);
+    timer.m_bucket = &slot;
+    timer.set_queued(true);
 }
 
 TimerId TimerQueue::add_timer(clockid_t clock_id, timeval& deadline, Function<void()>&& callback)
@@ -156,30 +160,9 @@ TimerId TimerQueue::add_timer(clockid_t clock_id, timeval& deadline, Function<vo
 
 bool TimerQueue::cancel_timer(TimerId id)
 {
-    Timer* found_timer = nullptr;
-    Queue* timer_queue = nullptr;
-
     ScopedSpinLock lock(g_timerqueue_lock);
-    if (m_timer_queue_monotonic.list.for_each([&](Timer& timer) {
-            if (timer.m_id == id) {
-                found_timer = &timer;
-                timer_queue = &m_timer_queue_monotonic;
-                return IterationDecision::Break;
-            }
-            return IterationDecision::Continue;
-        })
-        != IterationDecision::Break) {
-        m_timer_queue_realtime.list.for_each([&](Timer& timer) {
-            if (timer.m_id == id) {
-                found_timer = &timer;
-                timer_queue = &m_timer_queue_realtime;
-                return IterationDecision::Break;
-            }
-            return IterationDecision::Continue;
-        });
-    }
-
-    if (!found_timer) {
+    auto it = m_timers_by_id.find(id);
+    if (it == m_timers_by_id.end()) {
         // The timer may be executing right now, if it is then it should
         // be in m_timers_executing. If it is then release the lock
         // briefly to allow it to finish by removing itself
@@ -202,17 +185,14 @@ bool TimerQueue::cancel_timer(TimerId id)
         return false;
     }
 
-    ASSERT(found_timer);
-    ASSERT(timer_queue);
-    remove_timer_locked(*timer_queue, *found_timer);
+    remove_timer_locked(*it->value);
     return true;
 }
 
 bool TimerQueue::cancel_timer(Timer& timer)
 {
-    auto& timer_queue = queue_for_timer(timer);
     ScopedSpinLock lock(g_timerqueue_lock);
-    if (!timer_queue.list.contains_slow(&timer)) {
+    if (!timer.is_queued()) {
         // The timer may be executing right now, if it is then it should
         // be in m_timers_executing. If it is then release the lock
         // briefly to allow it to finish by removing itself
@@ -232,74 +212,124 @@ bool TimerQueue::cancel_timer(Timer& timer)
     }
 
     ASSERT(timer.ref_count() > 1);
-    remove_timer_locked(timer_queue, timer);
+    remove_timer_locked(timer);
     return true;
 }
 
-void TimerQueue::remove_timer_locked(Queue& queue, Timer& timer)
+void TimerQueue::remove_timer_locked(Timer& timer)
 {
-    bool was_next_timer = (queue.list.head() == &timer);
-    queue.list.remove(&timer);
+    ASSERT(timer.m_bucket);
+    timer.m_bucket->remove(&timer);
+    timer.m_bucket = nullptr;
     timer.set_queued(false);
+    if (timer.m_id != 0)
+        m_timers_by_id.remove(timer.m_id);
     auto now = timer.now(false);
     if (timer.m_expires > now)
         timer.m_remaining = timer.m_expires - now;
 
-    if (was_next_timer)
-        update_next_timer_due(queue);
     // Whenever we remove a timer that was still queued (but hasn't been
     // fired) we added a reference to it. So, when removing it from the
     // queue we need to drop that reference.
     timer.unref();
 }
 
-void TimerQueue::fire()
+void TimerQueue::cascade_locked(Queue& queue)
 {
-    ScopedSpinLock lock(g_timerqueue_lock);
-
-    auto fire_timers = [&](Queue& queue) {
-        auto* timer = queue.list.head();
-        ASSERT(timer);
-        ASSERT(queue.next_timer_due == timer->m_expires);
-
-        while (timer && timer->now(true) > timer->m_expires) {
-            queue.list.remove(timer);
-            timer->set_queued(false);
-
-            m_timers_executing.append(timer);
-
-            update_next_timer_due(queue);
-
-            lock.unlock();
+    // Level 0 just wrapped around, so move the timers of the slots on the
+    // upper levels that are now due down to where they belong.
+    for (size_t level = 1; level < level_count; level++) {
+        size_t index = (queue.current_tick >> (level * level_bits)) & (slots_per_level - 1);
+        InlineLinkedList<Timer> timers;
+        timers.append(queue.slots[level][index]);
+        while (auto* timer = timers.remove_head())
+            insert_timer_locked(queue, *timer);
+        // Only continue with the next level if this one wrapped around, too
+        if (index != 0)
+            break;
+    }
+}
 
-            // Defer executing the timer outside of the irq handler
-            Processor::current().deferred_call_queue([this, timer]() {
-                timer->m_callback();
-                ScopedSpinLock lock(g_timerqueue_lock);
-                m_timers_executing.remove(timer);
-                // Drop the reference we added when queueing the timer
-                timer->unref();
-            });
+void TimerQueue::rebuild_locked(Queue& queue, u64 now_tick)
+{
+    // The clock jumped, so walking the wheel tick by tick isn't worth it.
+    // Just take all timers out and put them back relative to the new time.
+    InlineLinkedList<Timer> timers;
+    for (auto& level : queue.slots) {
+        for (auto& slot : level)
+            timers.append(slot);
+    }
+    queue.current_tick = now_tick;
+    while (auto* timer = timers.remove_head())
+        insert_timer_locked(queue, *timer);
+}
 
-            lock.lock();
-            timer = queue.list.head();
-        }
+void TimerQueue::collect_expired_timers_locked(Queue& queue, InlineLinkedList<Timer>& expired)
+{
+    auto move_to_expired = [&](Timer& timer) {
+        timer.m_bucket->remove(&timer);
+        expired.append(&timer);
+        timer.m_bucket = &expired;
     };
 
-    if (!m_timer_queue_monotonic.list.is_empty())
-        fire_timers(m_timer_queue_monotonic);
-    if (!m_timer_queue_realtime.list.is_empty())
-        fire_timers(m_timer_queue_realtime);
+    u64 now_tick = time_to_ns(TimeManagement::the().current_time(queue.clock_id).value()) >> tick_shift;
+
+    // Walking the wheel is cheap for the gaps we usually see between two
+    // system timer ticks, but the realtime clock may be set to anything.
+    if (now_tick < queue.current_tick || now_tick - queue.current_tick >= slots_per_level * slots_per_level)
+        rebuild_locked(queue, now_tick);
+
+    while (queue.current_tick < now_tick) {
+        // Every timer in a slot for a tick that has passed is due
+        auto& slot = queue.slots[0][queue.current_tick & (slots_per_level - 1)];
+        while (auto* timer = slot.head())
+            move_to_expired(*timer);
+        queue.current_tick++;
+        if ((queue.current_tick & (slots_per_level - 1)) == 0)
+            cascade_locked(queue);
+    }
+
+    // The slot for the current tick may contain timers that aren't due yet
+    auto& slot = queue.slots[0][queue.current_tick & (slots_per_level - 1)];
+    for (auto* timer = slot.head(); timer;) {
+        auto* next_timer = timer->next();
+        if (timer->now(true) > timer->m_expires)
+            move_to_expired(*timer);
+        timer = next_timer;
+    }
 }
 
-void TimerQueue::update_next_timer_due(Queue& queue)
+void TimerQueue::fire()
 {
-    ASSERT(g_timerqueue_lock.is_locked());
+    ScopedSpinLock lock(g_timerqueue_lock);
 
-    if (auto* next_timer = queue.list.head())
-        queue.next_timer_due = next_timer->m_expires;
-    else
-        queue.next_timer_due = 0;
+    // Expired timers stay queued on this list until their callback has
+    // been deferred, so that they can still be cancelled in the meantime.
+    InlineLinkedList<Timer> expired;
+    collect_expired_timers_locked(m_timer_queue_monotonic, expired);
+    collect_expired_timers_locked(m_timer_queue_realtime, expired);
+
+    while (auto* timer = expired.remove_head()) {
+        timer->m_bucket = nullptr;
+        timer->set_queued(false);
+        if (timer->m_id != 0)
+            m_timers_by_id.remove(timer->m_id);
+
+        m_timers_executing.append(timer);
+
+        lock.unlock();
+
+        // Defer executing the timer outside of the irq handler
+        Processor::current().deferred_call_queue([this, timer]() {
+            timer->m_callback();
+            ScopedSpinLock lock(g_timerqueue_lock);
+            m_timers_executing.remove(timer);
+            // Drop the reference we added when queueing the timer
+            timer->unref();
+        });
+
+        lock.lock();
+    }
 }
 
 }
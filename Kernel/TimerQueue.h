@@ -27,6 +27,7 @@
 #pragma once
 
 #include <AK/Function.h>
+#include <AK/HashMap.h>
 #include <AK/InlineLinkedList.h>
 #include <AK/NonnullRefPtr.h>
 #include <AK/OwnPtr.h>
@@ -64,6 +65,7 @@ private:
     Function<void()> m_callback;
     Timer* m_next { nullptr };
     Timer* m_prev { nullptr };
+    InlineLinkedList<Timer>* m_bucket { nullptr };
     Atomic<bool> m_queued { false };
 
     bool operator<(const Timer& rhs) const
@@ -102,13 +104,29 @@ public:
     void fire();
 
 private:
+    // Timers are kept in a hierarchical timing wheel per clock. A slot on level 0 covers
+    // one tick of 2^tick_shift ns (about a millisecond), and a slot on each level above
+    // covers a whole revolution of the level below. Timers on the upper levels are
+    // cascaded down whenever the level below wraps around, so adding, cancelling and
+    // firing a timer are all O(1). Timers beyond the last level wait in its farthest
+    // slot and are re-evaluated whenever they get cascaded.
+    static constexpr u64 tick_shift = 20;
+    static constexpr size_t level_bits = 6;
+    static constexpr size_t slots_per_level = 1 << level_bits;
+    static constexpr size_t level_count = 5;
+
     struct Queue {
-        InlineLinkedList<Timer> list;
-        u64 next_timer_due { 0 };
+        InlineLinkedList<Timer> slots[level_count][slots_per_level];
+        // All slots for ticks before this one have been processed
+        u64 current_tick { 0 };
+        clockid_t clock_id;
     };
-    void remove_timer_locked(Queue&, Timer&);
-    void update_next_timer_due(Queue&);
+    void remove_timer_locked(Timer&);
     void add_timer_locked(NonnullRefPtr<Timer>);
+    void insert_timer_locked(Queue&, Timer&);
+    void cascade_locked(Queue&);
+    void rebuild_locked(Queue&, u64 now_tick);
+    void collect_expired_timers_locked(Queue&, InlineLinkedList<Timer>& expired);
 
     Queue& queue_for_timer(Timer& timer)
     {
@@ -124,11 +142,11 @@ private:
             ASSERT_NOT_REACHED();
         }
     }
-
     u64 m_timer_id_count { 0 };
     u64 m_ticks_per_second { 0 };
     Queue m_timer_queue_monotonic;
     Queue m_timer_queue_realtime;
+    HashMap<TimerId, Timer*> m_timers_by_id;
     InlineLinkedList<Timer> m_timers_executing;
 };
 
@@ -27,6 +27,8 @@
 #include <Kernel/VM/AnonymousVMObject.h>
 #include <Kernel/VM/MemoryManager.h>
 #include <Kernel/VM/PhysicalPage.h>
+#include <Kernel/VM/Region.h>
+#include <Kernel/VM/SwapDevice.h>
 
 namespace Kernel {
 
@@ -47,10 +49,36 @@ RefPtr<AnonymousVMObject> AnonymousVMObject::create_for_physical_range(PhysicalA
 NonnullRefPtr<AnonymousVMObject> AnonymousVMObject::create_with_physical_page(PhysicalPage& page)
 {
     auto vmobject = create_with_size(PAGE_SIZE);
+    vmobject->m_can_swap_out = false;
     vmobject->m_physical_pages[0] = page;
     return vmobject;
 }
 
+NonnullRefPtr<AnonymousVMObject> AnonymousVMObject::create_with_physical_pages(NonnullRefPtrVector<PhysicalPage>& pages)
+{
+    auto vmobject = create_with_size(pages.size() * PAGE_SIZE);
+    vmobject->m_can_swap_out = false;
+    for (size_t i = 0; i < pages.size(); ++i)
+        vmobject->m_physical_pages[i] = pages[i];
+    return vmobject;
+}
+
+NonnullRefPtr<AnonymousVMObject> AnonymousVMObject::create_with_huge_pages(size_t size)
+{
+    auto vmobject = create_with_size(size);
+    // Back as much as we can with aligned, physically contiguous 2 MiB chunks, so they can be mapped
+    // with huge pages. Whatever we can't get that way is committed one page at a time when touched.
+    constexpr size_t pages_per_huge_page = huge_page_size / PAGE_SIZE;
+    for (size_t page_index = 0; page_index + pages_per_huge_page <= vmobject->page_count(); page_index += pages_per_huge_page) {
+        auto pages = MM.allocate_contiguous_user_physical_pages(huge_page_size, huge_page_size);
+        if (pages.is_empty())
+            break;
+        for (size_t i = 0; i < pages_per_huge_page; ++i)
+            vmobject->m_physical_pages[page_index + i] = pages[i];
+    }
+    return vmobject;
+}
+
 AnonymousVMObject::AnonymousVMObject(size_t size)
     : VMObject(size)
 {
@@ -62,6 +90,7 @@ AnonymousVMObject::AnonymousVMObject(size_t size)
 
 AnonymousVMObject::AnonymousVMObject(PhysicalAddress paddr, size_t size)
     : VMObject(size)
+    , m_can_swap_out(false)
 {
     ASSERT(paddr.page_base() == paddr);
     for (size_t i = 0; i < page_count(); ++i)
@@ -70,16 +99,157 @@ AnonymousVMObject::AnonymousVMObject(PhysicalAddress paddr, size_t size)
 
 AnonymousVMObject::AnonymousVMObject(const AnonymousVMObject& other)
     : VMObject(other)
+    , m_can_swap_out(other.m_can_swap_out)
+    , m_swap_slots(other.m_swap_slots)
 {
+    for (auto& it : m_swap_slots)
+        SwapDevice::the()->ref_slot(it.value);
 }
 
 AnonymousVMObject::~AnonymousVMObject()
 {
+    for (auto& it : m_swap_slots)
+        SwapDevice::the()->unref_slot(it.value);
 }
 
 NonnullRefPtr<VMObject> AnonymousVMObject::clone()
 {
+    // Pages move between memory and swap with s_mm_lock held, so this gets us a consistent copy.
+    ScopedSpinLock lock(s_mm_lock);
     return adopt(*new AnonymousVMObject(*this));
 }
 
+bool AnonymousVMObject::is_swapped_out(size_t page_index) const
+{
+    ScopedSpinLock lock(s_mm_lock);
+    return m_swap_slots.contains(page_index);
+}
+
+size_t AnonymousVMObject::amount_swapped() const
+{
+    ScopedSpinLock lock(s_mm_lock);
+    return m_swap_slots.size() * PAGE_SIZE;
+}
+
+bool AnonymousVMObject::can_swap_out() const
+{
+    ScopedSpinLock lock(s_mm_lock);
+    return m_can_swap_out;
+}
+
+size_t AnonymousVMObject::swap_out_unused_pages(SwapDevice& swap_device, size_t max_count)
+{
+    // This has to be decided before taking the paging lock, see m_can_swap_out.
+    if (is_purgeable() || !can_swap_out())
+        return 0;
+
+    Vector<size_t, 16> page_indices;
+    {
+        LOCKER(m_paging_lock);
+        ScopedSpinLock lock(s_mm_lock);
+
+        Vector<Region*, 4> regions;
+        bool mapped_into_kernel = false;
+        for_each_region([&](auto& region) {
+            if (region.is_kernel())
+                mapped_into_kernel = true;
+            regions.append(&region);
+        });
+        // The kernel doesn't expect its own memory to fault, and memory nobody maps isn't worth the trouble.
+        if (mapped_into_kernel || regions.is_empty())
+            return 0;
+
+        for (size_t scanned = 0; scanned < page_count() && page_indices.size() < max_count; ++scanned) {
+            size_t page_index = m_clock_hand;
+            m_clock_hand = (m_clock_hand + 1) % page_count();
+            auto& page = m_physical_pages[page_index];
+            // Pages that are shared with another VMObject (after a fork, for example) stay where they are.
+            if (!page || page->is_shared_zero_page() || page->ref_count() != 1)
+                continue;
+
+            bool recently_used = false;
+            for (auto* region : regions) {
+                if (region->maps_vmobject_page(page_index) && region->test_and_clear_accessed(page_index - region->first_page_index()))
+                    recently_used = true;
+            }
+            if (recently_used)
+                continue;
+
+            // Unmap the page before we copy it out, so it can't change behind our back.
+            // If it's needed again in the meantime, handle_swap_fault() maps it back in, and swap_out_page() notices.
+            for (auto* region : regions) {
+                if (region->maps_vmobject_page(page_index))
+                    region->unmap_page(page_index - region->first_page_index());
+            }
+            page_indices.append(page_index);
+        }
+    }
+
+    size_t count = 0;
+    for (auto page_index : page_indices) {
+        if (swap_out_page(swap_device, page_index))
+            ++count;
+    }
+    return count;
+}
+
+bool AnonymousVMObject::swap_out_page(SwapDevice& swap_device, size_t page_index)
+{
+    auto slot = swap_device.allocate_slot();
+    if (!slot.has_value())
+        return false;
+
+    RefPtr<PhysicalPage> page;
+    {
+        ScopedSpinLock lock(s_mm_lock);
+        page = m_physical_pages[page_index];
+    }
+    if (!page || swap_device.write_page(slot.value(), *page).is_error()) {
+        swap_device.unref_slot(slot.value());
+        return false;
+    }
+
+    if (!can_swap_out()) {
+        swap_device.unref_slot(slot.value());
+        return false;
+    }
+    LOCKER(m_paging_lock);
+    ScopedSpinLock lock(s_mm_lock);
+    // We hold one reference to the page ourselves.
+    bool still_unused = m_physical_pages[page_index] == page && page->ref_count() == 2;
+    for_each_region([&](auto& region) {
+        if (region.maps_vmobject_page(page_index) && region.is_page_mapped(page_index - region.first_page_index()))
+            still_unused = false;
+    });
+    if (!still_unused) {
+        swap_device.unref_slot(slot.value());
+        return false;
+    }
+    m_physical_pages[page_index] = nullptr;
+    m_swap_slots.set(page_index, slot.value());
+    return true;
+}
+
+KResult AnonymousVMObject::swap_in_page(size_t page_index, PhysicalPage& page)
+{
+    u32 slot;
+    {
+        ScopedSpinLock lock(s_mm_lock);
+        auto it = m_swap_slots.find(page_index);
+        ASSERT(it != m_swap_slots.end());
+        slot = it->value;
+    }
+
+    auto& swap_device = *SwapDevice::the();
+    auto result = swap_device.read_page(slot, page);
+    if (result.is_error())
+        return result;
+
+    ScopedSpinLock lock(s_mm_lock);
+    m_swap_slots.remove(page_index);
+    m_physical_pages[page_index] = page;
+    swap_device.unref_slot(slot);
+    return KSuccess;
+}
+
 }
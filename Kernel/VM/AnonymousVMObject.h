@@ -26,11 +26,17 @@
 
 #pragma once
 
+#include <AK/Badge.h>
+#include <AK/HashMap.h>
+#include <AK/NonnullRefPtrVector.h>
+#include <Kernel/KResult.h>
 #include <Kernel/PhysicalAddress.h>
 #include <Kernel/VM/VMObject.h>
 
 namespace Kernel {
 
+class SwapDevice;
+
 class AnonymousVMObject : public VMObject {
 public:
     virtual ~AnonymousVMObject() override;
@@ -38,8 +44,19 @@ public:
     static NonnullRefPtr<AnonymousVMObject> create_with_size(size_t);
     static RefPtr<AnonymousVMObject> create_for_physical_range(PhysicalAddress, size_t);
     static NonnullRefPtr<AnonymousVMObject> create_with_physical_page(PhysicalPage&);
+    static NonnullRefPtr<AnonymousVMObject> create_with_physical_pages(NonnullRefPtrVector<PhysicalPage>&);
+    static NonnullRefPtr<AnonymousVMObject> create_with_huge_pages(size_t);
     virtual NonnullRefPtr<VMObject> clone() override;
 
+    bool is_swapped_out(size_t page_index) const;
+    size_t amount_swapped() const;
+
+    // Writes up to max_count pages that haven't been accessed since the previous call out to swap, continuing where it left off.
+    size_t swap_out_unused_pages(SwapDevice&, size_t max_count);
+    KResult swap_in_page(size_t page_index, PhysicalPage&);
+
+    void set_mapped_into_kernel(Badge<MemoryManager>) { m_can_swap_out = false; }
+
 protected:
     explicit AnonymousVMObject(size_t);
     explicit AnonymousVMObject(const AnonymousVMObject&);
@@ -54,6 +71,18 @@ private:
     AnonymousVMObject(AnonymousVMObject&&) = delete;
 
     virtual bool is_anonymous() const override { return true; }
+
+    bool can_swap_out() const;
+    bool swap_out_page(SwapDevice&, size_t page_index);
+
+    // Pages we were handed (device memory, DMA buffers) are never swapped out, only ones we allocated ourselves.
+    // Neither is anything the kernel maps, since its page faults come in holding s_mm_lock and would then wait
+    // on our paging lock, the other way around from us. Guarded by s_mm_lock, and never goes back to true.
+    bool m_can_swap_out { true };
+
+    // Maps page indices to swap slots. Guarded by s_mm_lock.
+    HashMap<size_t, u32> m_swap_slots;
+    size_t m_clock_hand { 0 };
 };
 
 }
@@ -160,6 +160,55 @@ int InodeVMObject::release_all_clean_pages_impl()
     return count;
 }
 
+size_t InodeVMObject::release_unused_clean_pages(size_t max_count)
+{
+    LOCKER(m_paging_lock);
+    ScopedSpinLock lock(s_mm_lock);
+
+    Vector<Region*, 4> regions;
+    for_each_region([&](auto& region) {
+        regions.append(&region);
+    });
+
+    // The inode may have shrunk since we last looked.
+    if (m_clock_hand >= page_count())
+        m_clock_hand = 0;
+
+    size_t count = 0;
+    for (size_t scanned = 0; scanned < page_count() && count < max_count; ++scanned) {
+        size_t page_index = m_clock_hand;
+        m_clock_hand = (m_clock_hand + 1) % page_count();
+        if (!m_physical_pages[page_index] || m_dirty_pages.get(page_index))
+            continue;
+
+        bool recently_used = false;
+        bool writable = false;
+        for (auto* region : regions) {
+            if (!region->maps_vmobject_page(page_index))
+                continue;
+            size_t page_index_in_region = page_index - region->first_page_index();
+            // Every mapping gets its accessed bit cleared, so the page is judged by all of them next time.
+            if (region->test_and_clear_accessed(page_index_in_region))
+                recently_used = true;
+            if (region->is_page_dirty(page_index_in_region))
+                m_dirty_pages.set(page_index, true);
+            else if (region->is_page_mapped_writable(page_index_in_region))
+                writable = true;
+        }
+        // We have no way to write pages back yet, so anything that could be written to has to stay.
+        if (recently_used || writable || m_dirty_pages.get(page_index))
+            continue;
+
+        for (auto* region : regions) {
+            if (region->maps_vmobject_page(page_index))
+                region->unmap_page(page_index - region->first_page_index());
+        }
+        m_physical_pages[page_index] = nullptr;
+        ++count;
+    }
+    return count;
+}
+
 u32 InodeVMObject::writable_mappings() const
 {
     u32 count = 0;
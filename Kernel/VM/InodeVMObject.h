@@ -47,6 +47,11 @@ public:
 
     int release_all_clean_pages();
 
+    // Drops up to max_count clean pages that haven't been accessed since the previous call, continuing where it left off.
+    size_t release_unused_clean_pages(size_t max_count);
+
+    void set_page_dirty(size_t page_index) { m_dirty_pages.set(page_index, true); }
+
     u32 writable_mappings() const;
     u32 executable_mappings() const;
 
@@ -64,6 +69,7 @@ protected:
 
     NonnullRefPtr<Inode> m_inode;
     Bitmap m_dirty_pages;
+    size_t m_clock_hand { 0 };
 };
 
 }
@@ -34,6 +34,7 @@
 #include <Kernel/Multiboot.h>
 #include <Kernel/Process.h>
 #include <Kernel/StdLib.h>
+#include <Kernel/Tasks/PageoutTask.h>
 #include <Kernel/VM/AnonymousVMObject.h>
 #include <Kernel/VM/ContiguousVMObject.h>
 #include <Kernel/VM/MemoryManager.h>
@@ -75,8 +76,14 @@ MemoryManager::MemoryManager()
     ScopedSpinLock lock(s_mm_lock);
     m_kernel_page_directory = PageDirectory::create_kernel_page_directory();
     parse_memory_map();
+
+    // Keep up to 1/64 of memory zeroed ahead of time, but no more than 4 MiB.
+    m_zeroed_pages_target = min<size_t>(m_user_physical_pages / 64, 1024);
+    m_zeroed_pages.ensure_capacity(m_zeroed_pages_target);
+
     write_cr3(kernel_page_directory().cr3());
     protect_kernel_image();
+    map_kernel_heap_with_huge_pages();
 
     m_shared_zero_page = allocate_user_physical_page();
 }
@@ -107,6 +114,29 @@ void MemoryManager::protect_kernel_image()
     }
 }
 
+void MemoryManager::map_kernel_heap_with_huge_pages()
+{
+    // boot.S maps the kernel with 4 KiB pages, since the kernel image needs different protections
+    // for text and data. The kmalloc range behind it is uniformly read/write and never changes,
+    // so map every 2 MiB entirely inside of it with a single huge page, and save on TLB entries.
+    ScopedSpinLock page_lock(kernel_page_directory().get_lock());
+    FlatPtr first_huge_page = (FlatPtr(kmalloc_start) + huge_page_size - 1) & ~(huge_page_size - 1);
+    for (FlatPtr vaddr = first_huge_page; vaddr + huge_page_size <= FlatPtr(kmalloc_end); vaddr += huge_page_size) {
+        auto& pde = *ensure_huge_pde(kernel_page_directory(), VirtualAddress(vaddr));
+        pde.set_huge_page_base(virtual_to_low_physical(vaddr));
+        pde.set_huge(true);
+        pde.set_writable(true);
+        pde.set_global(true);
+        if (Processor::current().has_feature(CPUFeature::NX))
+            pde.set_execute_disabled(true);
+        pde.set_present(true);
+        flush_tlb_local(VirtualAddress(vaddr), huge_page_size / PAGE_SIZE);
+#ifdef MM_DEBUG
+        dbg() << "MM: Mapped kernel heap at " << VirtualAddress(vaddr) << " with a huge page";
+#endif
+    }
+}
+
 void MemoryManager::parse_memory_map()
 {
     RefPtr<PhysicalRegion> region;
@@ -197,7 +227,6 @@ void MemoryManager::parse_memory_map()
 PageTableEntry* MemoryManager::pte(PageDirectory& page_directory, VirtualAddress vaddr)
 {
     ASSERT_INTERRUPTS_DISABLED();
-    ASSERT(s_mm_lock.own_lock());
     ASSERT(page_directory.get_lock().own_lock());
     u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
     u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
@@ -205,7 +234,7 @@ PageTableEntry* MemoryManager::pte(PageDirectory& page_directory, VirtualAddress
 
     auto* pd = quickmap_pd(const_cast<PageDirectory&>(page_directory), page_directory_table_index);
     const PageDirectoryEntry& pde = pd[page_directory_index];
-    if (!pde.is_present())
+    if (!pde.is_present() || pde.is_huge())
         return nullptr;
 
     return &quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()))[page_table_index];
@@ -214,7 +243,6 @@ PageTableEntry* MemoryManager::pte(PageDirectory& page_directory, VirtualAddress
 PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, VirtualAddress vaddr)
 {
     ASSERT_INTERRUPTS_DISABLED();
-    ASSERT(s_mm_lock.own_lock());
     ASSERT(page_directory.get_lock().own_lock());
     u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
     u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
@@ -222,12 +250,17 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     PageDirectoryEntry& pde = pd[page_directory_index];
-    if (!pde.is_present()) {
+    if (!pde.is_present() || pde.is_huge()) {
 #ifdef MM_DEBUG
-        dbg() << "MM: PDE " << page_directory_index << " not present (requested for " << vaddr << "), allocating";
+        dbg() << "MM: PDE " << page_directory_index << " not present or huge (requested for " << vaddr << "), allocating";
 #endif
+        // If these 2 MiB are mapped by a huge page, we're splitting it up to change part of it.
+        const PageDirectoryEntry old_pde = pde;
         bool did_purge = false;
-        auto page_table = allocate_user_physical_page(ShouldZeroFill::Yes, &did_purge);
+        // Purging remaps regions in other address spaces, taking their page directory locks.
+        // We may only do that while holding this one if we also hold s_mm_lock, which comes first.
+        auto should_purge = s_mm_lock.own_lock() ? ShouldPurge::Yes : ShouldPurge::No;
+        auto page_table = allocate_user_physical_page(ShouldZeroFill::Yes, &did_purge, should_purge);
         if (!page_table) {
             dbg() << "MM: Unable to allocate page table to map " << vaddr;
             return nullptr;
@@ -239,11 +272,27 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
             pd = quickmap_pd(page_directory, page_directory_table_index);
             ASSERT(&pde == &pd[page_directory_index]); // Sanity check
 
-            ASSERT(!pde.is_present()); // Should have not changed
+            ASSERT(pde.raw() == old_pde.raw()); // Should have not changed
         }
 #ifdef MM_DEBUG
         dbg() << "MM: PD K" << &page_directory << " (" << (&page_directory == m_kernel_page_directory ? "Kernel" : "User") << ") at " << PhysicalAddress(page_directory.cr3()) << " allocated page table #" << page_directory_index << " (for " << vaddr << ") at " << page_table->paddr();
 #endif
+        if (old_pde.is_present()) {
+            // Make the new page table map exactly what the huge page did, so only the caller's page changes.
+            auto* ptes = quickmap_pt(page_table->paddr());
+            for (size_t i = 0; i < huge_page_size / PAGE_SIZE; ++i) {
+                auto& pte = ptes[i];
+                pte.set_physical_page_base(old_pde.huge_page_base() + i * PAGE_SIZE);
+                pte.set_writable(old_pde.is_writable());
+                pte.set_user_allowed(old_pde.is_user_allowed());
+                pte.set_write_through(old_pde.is_write_through());
+                pte.set_cache_disabled(old_pde.is_cache_disabled());
+                pte.set_global(old_pde.is_global());
+                pte.set_execute_disabled(old_pde.is_execute_disabled());
+                pte.set_present(true);
+            }
+            pde.clear();
+        }
         pde.set_page_table_base(page_table->paddr().get());
         pde.set_user_allowed(true);
         pde.set_present(true);
@@ -258,10 +307,28 @@ PageTableEntry* MemoryManager::ensure_pte(PageDirectory& page_directory, Virtual
     return &quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()))[page_table_index];
 }
 
+PageDirectoryEntry* MemoryManager::ensure_huge_pde(PageDirectory& page_directory, VirtualAddress vaddr)
+{
+    ASSERT_INTERRUPTS_DISABLED();
+    ASSERT(page_directory.get_lock().own_lock());
+    ASSERT(!(vaddr.get() % huge_page_size));
+    u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
+    u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
+
+    auto* pd = quickmap_pd(page_directory, page_directory_table_index);
+    PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && !pde.is_huge()) {
+        // The huge page replaces everything this page table maps, so we don't need it anymore.
+        // NOTE: The page tables set up by boot.S aren't tracked here, and simply stay unused.
+        page_directory.m_page_tables.remove(vaddr.get());
+    }
+    pde.clear();
+    return &pde;
+}
+
 void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress vaddr, bool is_last_release)
 {
     ASSERT_INTERRUPTS_DISABLED();
-    ASSERT(s_mm_lock.own_lock());
     ASSERT(page_directory.get_lock().own_lock());
     u32 page_directory_table_index = (vaddr.get() >> 30) & 0x3;
     u32 page_directory_index = (vaddr.get() >> 21) & 0x1ff;
@@ -269,6 +336,11 @@ void MemoryManager::release_pte(PageDirectory& page_directory, VirtualAddress va
 
     auto* pd = quickmap_pd(page_directory, page_directory_table_index);
     PageDirectoryEntry& pde = pd[page_directory_index];
+    if (pde.is_present() && pde.is_huge()) {
+        // Huge pages are only used for 2 MiB that belong to a single region, so all of it goes away.
+        pde.clear();
+        return;
+    }
     if (pde.is_present()) {
         auto* page_table = quickmap_pt(PhysicalAddress((FlatPtr)pde.page_table_base()));
         auto& pte = page_table[page_table_index];
@@ -323,12 +395,11 @@ Region* MemoryManager::kernel_region_from_vaddr(VirtualAddress vaddr)
 
 Region* MemoryManager::user_region_from_vaddr(Process& process, VirtualAddress vaddr)
 {
-    ScopedSpinLock lock(s_mm_lock);
-    // FIXME: Use a binary search tree (maybe red/black?) or some other more appropriate data structure!
-    for (auto& region : process.m_regions) {
-        if (region.contains(vaddr))
-            return &region;
-    }
+    ScopedSpinLock lock(process.address_space_lock());
+    // Regions don't overlap, so the only candidate is the one with the highest base address not above vaddr.
+    auto* region = process.m_regions.find_largest_not_above(vaddr.get());
+    if (region && (*region)->contains(vaddr))
+        return region->ptr();
 #ifdef MM_DEBUG
     dbg() << process << " Couldn't find user region for " << vaddr;
 #endif
@@ -337,7 +408,6 @@ Region* MemoryManager::user_region_from_vaddr(Process& process, VirtualAddress v
 
 Region* MemoryManager::find_region_from_vaddr(Process& process, VirtualAddress vaddr)
 {
-    ScopedSpinLock lock(s_mm_lock);
     if (auto* region = user_region_from_vaddr(process, vaddr))
         return region;
     return kernel_region_from_vaddr(vaddr);
@@ -345,7 +415,6 @@ Region* MemoryManager::find_region_from_vaddr(Process& process, VirtualAddress v
 
 const Region* MemoryManager::find_region_from_vaddr(const Process& process, VirtualAddress vaddr)
 {
-    ScopedSpinLock lock(s_mm_lock);
     if (auto* region = user_region_from_vaddr(const_cast<Process&>(process), vaddr))
         return region;
     return kernel_region_from_vaddr(vaddr);
@@ -353,7 +422,6 @@ const Region* MemoryManager::find_region_from_vaddr(const Process& process, Virt
 
 Region* MemoryManager::find_region_from_vaddr(VirtualAddress vaddr)
 {
-    ScopedSpinLock lock(s_mm_lock);
     if (auto* region = kernel_region_from_vaddr(vaddr))
         return region;
     auto page_directory = PageDirectory::find_by_cr3(read_cr3());
@@ -367,7 +435,6 @@ PageFaultResponse MemoryManager::handle_page_fault(const PageFault& fault)
 {
     ASSERT_INTERRUPTS_DISABLED();
     ASSERT(Thread::current() != nullptr);
-    ScopedSpinLock lock(s_mm_lock);
     if (Processor::current().in_irq()) {
         dbg() << "CPU[" << Processor::current().id() << "] BUG! Page fault while handling IRQ! code=" << fault.code() << ", vaddr=" << fault.vaddr() << ", irq level: " << Processor::current().in_irq();
         dump_kernel_regions();
@@ -376,7 +443,20 @@ PageFaultResponse MemoryManager::handle_page_fault(const PageFault& fault)
 #ifdef PAGE_FAULT_DEBUG
     dbgln("MM: CPU[{}] handle_page_fault({:#04x}) at {}", Processor::current().id(), fault.code(), fault.vaddr());
 #endif
-    auto* region = find_region_from_vaddr(fault.vaddr());
+
+    if (is_user_address(fault.vaddr())) {
+        // Faults in user memory only need the faulting address space to be locked.
+        auto page_directory = PageDirectory::find_by_cr3(read_cr3());
+        if (page_directory && page_directory->process()) {
+            auto& process = *page_directory->process();
+            ScopedSpinLock lock(process.address_space_lock());
+            if (auto* region = user_region_from_vaddr(process, fault.vaddr()))
+                return region->handle_fault(fault);
+        }
+    }
+
+    ScopedSpinLock lock(s_mm_lock);
+    auto* region = kernel_region_from_vaddr(fault.vaddr());
     if (!region) {
         klog() << "CPU[" << Processor::current().id() << "] NP(error) fault at invalid address " << fault.vaddr();
         return PageFaultResponse::ShouldCrash;
@@ -419,7 +499,11 @@ OwnPtr<Region> MemoryManager::allocate_kernel_region(PhysicalAddress paddr, size
 {
     ASSERT(!(size % PAGE_SIZE));
     ScopedSpinLock lock(s_mm_lock);
-    auto range = kernel_page_directory().range_allocator().allocate_anywhere(size);
+    // Large physical ranges (like framebuffers) can be mapped with huge pages if the virtual range is aligned the same way.
+    size_t alignment = PAGE_SIZE;
+    if (size >= huge_page_size && !(paddr.get() % huge_page_size))
+        alignment = huge_page_size;
+    auto range = kernel_page_directory().range_allocator().allocate_anywhere(size, alignment);
     if (!range.is_valid())
         return nullptr;
     auto vmobject = AnonymousVMObject::create_for_physical_range(paddr, size);
@@ -449,6 +533,8 @@ OwnPtr<Region> MemoryManager::allocate_user_accessible_kernel_region(size_t size
 OwnPtr<Region> MemoryManager::allocate_kernel_region_with_vmobject(const Range& range, VMObject& vmobject, const StringView& name, u8 access, bool user_accessible, bool cacheable)
 {
     ScopedSpinLock lock(s_mm_lock);
+    if (vmobject.is_anonymous())
+        static_cast<AnonymousVMObject&>(vmobject).set_mapped_into_kernel({});
     OwnPtr<Region> region;
     if (user_accessible)
         region = Region::create_user_accessible(range, vmobject, 0, name, access, cacheable);
@@ -469,69 +555,177 @@ OwnPtr<Region> MemoryManager::allocate_kernel_region_with_vmobject(VMObject& vmo
     return allocate_kernel_region_with_vmobject(range, vmobject, name, access, user_accessible, cacheable);
 }
 
-void MemoryManager::deallocate_user_physical_page(const PhysicalPage& page)
+void MemoryManager::return_user_physical_page(PhysicalAddress paddr)
 {
-    ScopedSpinLock lock(s_mm_lock);
+    ASSERT(m_physical_page_lock.own_lock());
     for (auto& region : m_user_physical_regions) {
-        if (!region.contains(page)) {
-            klog() << "MM: deallocate_user_physical_page: " << page.paddr() << " not in " << region.lower() << " -> " << region.upper();
-            continue;
+        if (region.contains(paddr)) {
+            region.return_page(paddr);
+            return;
         }
+    }
 
-        region.return_page(page);
-        --m_user_physical_pages_used;
+    klog() << "MM: return_user_physical_page couldn't figure out region for user page @ " << paddr;
+    ASSERT_NOT_REACHED();
+}
 
-        return;
+void MemoryManager::deallocate_user_physical_page(const PhysicalPage& page)
+{
+    --m_user_physical_pages_used;
+
+    auto& mm_data = get_data();
+    ScopedSpinLock lock(mm_data.m_free_page_cache_lock);
+    if (mm_data.m_free_page_cache_count == free_page_cache_size) {
+        // Give back the pages that were freed first, and keep the ones that are most likely still in the CPU cache.
+        ScopedSpinLock physical_page_lock(m_physical_page_lock);
+        for (size_t i = 0; i < free_page_cache_batch_size; ++i)
+            return_user_physical_page(mm_data.m_free_page_cache[i]);
+        mm_data.m_free_page_cache_count -= free_page_cache_batch_size;
+        for (size_t i = 0; i < mm_data.m_free_page_cache_count; ++i)
+            mm_data.m_free_page_cache[i] = mm_data.m_free_page_cache[i + free_page_cache_batch_size];
     }
+    mm_data.m_free_page_cache[mm_data.m_free_page_cache_count++] = page.paddr();
+}
 
-    klog() << "MM: deallocate_user_physical_page couldn't figure out region for user page @ " << page.paddr();
-    ASSERT_NOT_REACHED();
+PhysicalAddress MemoryManager::take_page_from_free_page_cache()
+{
+    auto& mm_data = get_data();
+    ScopedSpinLock lock(mm_data.m_free_page_cache_lock);
+    if (!mm_data.m_free_page_cache_count) {
+        ScopedSpinLock physical_page_lock(m_physical_page_lock);
+        for (auto& region : m_user_physical_regions) {
+            auto& count = mm_data.m_free_page_cache_count;
+            count += region.take_free_pages(mm_data.m_free_page_cache + count, free_page_cache_batch_size - count);
+            if (count == free_page_cache_batch_size)
+                break;
+        }
+        if (!mm_data.m_free_page_cache_count)
+            return {};
+    }
+    return mm_data.m_free_page_cache[--mm_data.m_free_page_cache_count];
+}
+
+void MemoryManager::drain_free_page_caches()
+{
+    Processor::for_each([&](Processor& processor) {
+        if (!processor.has_mm_data())
+            return IterationDecision::Continue;
+        auto& mm_data = processor.get_mm_data();
+        ScopedSpinLock lock(mm_data.m_free_page_cache_lock);
+        ScopedSpinLock physical_page_lock(m_physical_page_lock);
+        for (size_t i = 0; i < mm_data.m_free_page_cache_count; ++i)
+            return_user_physical_page(mm_data.m_free_page_cache[i]);
+        mm_data.m_free_page_cache_count = 0;
+        return IterationDecision::Continue;
+    });
 }
 
 RefPtr<PhysicalPage> MemoryManager::find_free_user_physical_page()
 {
-    ASSERT(s_mm_lock.is_locked());
+    auto paddr = take_page_from_free_page_cache();
+    if (paddr.is_null()) {
+        // The pages we're looking for may be sitting in the caches of other processors.
+        drain_free_page_caches();
+        paddr = take_page_from_free_page_cache();
+    }
+
     RefPtr<PhysicalPage> page;
-    for (auto& region : m_user_physical_regions) {
-        page = region.take_free_page(false);
-        if (!page.is_null())
-            break;
+    if (!paddr.is_null()) {
+        ++m_user_physical_pages_used;
+        page = PhysicalPage::create(paddr, false);
+    } else {
+        // Zeroed pages are just as good as any other.
+        page = take_zeroed_page();
     }
+
+    // The pageout task looks at memory once a second anyway, but when we get down to the last
+    // 1/16 of it, that may be too late.
+    if (m_user_physical_pages - m_user_physical_pages_used < m_user_physical_pages / 16)
+        PageoutTask::wake();
     return page;
 }
 
-RefPtr<PhysicalPage> MemoryManager::allocate_user_physical_page(ShouldZeroFill should_zero_fill, bool* did_purge)
+RefPtr<PhysicalPage> MemoryManager::take_zeroed_page()
 {
-    ScopedSpinLock lock(s_mm_lock);
-    auto page = find_free_user_physical_page();
+    ScopedSpinLock lock(m_zeroed_pages_lock);
+    if (m_zeroed_pages.is_empty())
+        return nullptr;
+    ++m_user_physical_pages_used;
+    return m_zeroed_pages.take_last();
+}
+
+void MemoryManager::refill_zeroed_pages()
+{
+    // Just a few at a time, so whatever the idle loop is waiting for doesn't have to wait on us.
+    for (size_t i = 0; i < 8; ++i) {
+        if (m_zeroed_pages.size() >= m_zeroed_pages_target)
+            return;
+        // When memory is getting low, it's better spent elsewhere.
+        if (m_user_physical_pages - m_user_physical_pages_used < m_user_physical_pages / 8)
+            return;
+        auto page = find_free_user_physical_page();
+        if (!page)
+            return;
+        {
+            InterruptDisabler disabler;
+            memset(quickmap_page(*page), 0, PAGE_SIZE);
+            unquickmap_page();
+        }
+        ScopedSpinLock lock(m_zeroed_pages_lock);
+        // Another processor may have filled it up in the meantime. Then the page just goes back.
+        if (m_zeroed_pages.size() < m_zeroed_pages_target) {
+            m_zeroed_pages.append(page.release_nonnull());
+            --m_user_physical_pages_used;
+        }
+    }
+}
+
+RefPtr<PhysicalPage> MemoryManager::allocate_user_physical_page(ShouldZeroFill should_zero_fill, bool* did_purge, ShouldPurge should_purge)
+{
+    RefPtr<PhysicalPage> page;
+    bool is_zeroed = false;
+    if (should_zero_fill == ShouldZeroFill::Yes) {
+        page = take_zeroed_page();
+        is_zeroed = !page.is_null();
+    }
+    if (!page)
+        page = find_free_user_physical_page();
     bool purged_pages = false;
 
-    if (!page) {
+    if (!page && should_purge == ShouldPurge::Yes) {
         // We didn't have a single free physical page. Let's try to free something up!
         // First, we look for a purgeable VMObject in the volatile state.
+        ScopedSpinLock lock(s_mm_lock);
         for_each_vmobject_of_type<PurgeableVMObject>([&](auto& vmobject) {
             int purged_page_count = vmobject.purge_with_interrupts_disabled({});
             if (purged_page_count) {
                 klog() << "MM: Purge saved the day! Purged " << purged_page_count << " pages from PurgeableVMObject{" << &vmobject << "}";
-                page = find_free_user_physical_page();
                 purged_pages = true;
-                ASSERT(page);
-                return IterationDecision::Break;
+                // Other processors don't need s_mm_lock to allocate, so they may beat us to the purged pages.
+                page = find_free_user_physical_page();
+                if (page)
+                    return IterationDecision::Break;
             }
             return IterationDecision::Continue;
         });
+    }
 
-        if (!page) {
-            klog() << "MM: no user physical pages available";
-            return {};
-        }
+    if (!page) {
+        // Before giving up, let the pageout task (or, if we can't wait for it, the page cache) free something up.
+        PageoutTask::wait_for_reclaim();
+        page = find_free_user_physical_page();
+    }
+
+    if (!page) {
+        klog() << "MM: no user physical pages available";
+        return {};
     }
 
 #ifdef MM_DEBUG
     dbg() << "MM: allocate_user_physical_page vending " << page->paddr();
 #endif
 
-    if (should_zero_fill == ShouldZeroFill::Yes) {
+    if (should_zero_fill == ShouldZeroFill::Yes && !is_zeroed) {
         auto* ptr = quickmap_page(*page);
         memset(ptr, 0, PAGE_SIZE);
         unquickmap_page();
@@ -540,13 +734,12 @@ RefPtr<PhysicalPage> MemoryManager::allocate_user_physical_page(ShouldZeroFill s
     if (did_purge)
         *did_purge = purged_pages;
 
-    ++m_user_physical_pages_used;
     return page;
 }
 
 void MemoryManager::deallocate_supervisor_physical_page(const PhysicalPage& page)
 {
-    ScopedSpinLock lock(s_mm_lock);
+    ScopedSpinLock lock(m_physical_page_lock);
     for (auto& region : m_super_physical_regions) {
         if (!region.contains(page)) {
             klog() << "MM: deallocate_supervisor_physical_page: " << page.paddr() << " not in " << region.lower() << " -> " << region.upper();
@@ -565,7 +758,7 @@ void MemoryManager::deallocate_supervisor_physical_page(const PhysicalPage& page
 NonnullRefPtrVector<PhysicalPage> MemoryManager::allocate_contiguous_supervisor_physical_pages(size_t size)
 {
     ASSERT(!(size % PAGE_SIZE));
-    ScopedSpinLock lock(s_mm_lock);
+    ScopedSpinLock lock(m_physical_page_lock);
     size_t count = ceil_div(size, PAGE_SIZE);
     NonnullRefPtrVector<PhysicalPage> physical_pages;
 
@@ -584,16 +777,46 @@ NonnullRefPtrVector<PhysicalPage> MemoryManager::allocate_contiguous_supervisor_
         ASSERT_NOT_REACHED();
         return {};
     }
+    m_super_physical_pages_used += count;
+    lock.unlock();
 
     auto cleanup_region = MM.allocate_kernel_region(physical_pages[0].paddr(), PAGE_SIZE * count, "MemoryManager Allocation Sanitization", Region::Access::Read | Region::Access::Write);
     fast_u32_fill((u32*)cleanup_region->vaddr().as_ptr(), 0, (PAGE_SIZE * count) / sizeof(u32));
-    m_super_physical_pages_used += count;
+    return physical_pages;
+}
+
+NonnullRefPtrVector<PhysicalPage> MemoryManager::allocate_contiguous_user_physical_pages(size_t size, size_t physical_alignment)
+{
+    ASSERT(!(size % PAGE_SIZE));
+    ScopedSpinLock lock(m_physical_page_lock);
+    size_t count = ceil_div(size, PAGE_SIZE);
+    NonnullRefPtrVector<PhysicalPage> physical_pages;
+
+    for (auto& region : m_user_physical_regions) {
+        if (region.free() < count)
+            continue;
+        physical_pages = region.take_contiguous_free_pages(count, false, physical_alignment);
+        if (!physical_pages.is_empty())
+            break;
+    }
+
+    // Unlike single pages, it's fine for this to fail. Callers can fall back to individual pages.
+    if (physical_pages.is_empty())
+        return {};
+    m_user_physical_pages_used += count;
+    lock.unlock();
+
+    for (auto& page : physical_pages) {
+        auto* ptr = quickmap_page(page);
+        memset(ptr, 0, PAGE_SIZE);
+        unquickmap_page();
+    }
     return physical_pages;
 }
 
 RefPtr<PhysicalPage> MemoryManager::allocate_supervisor_physical_page()
 {
-    ScopedSpinLock lock(s_mm_lock);
+    ScopedSpinLock lock(m_physical_page_lock);
     RefPtr<PhysicalPage> page;
 
     for (auto& region : m_super_physical_regions) {
@@ -616,8 +839,10 @@ RefPtr<PhysicalPage> MemoryManager::allocate_supervisor_physical_page()
     dbg() << "MM: allocate_supervisor_physical_page vending " << page->paddr();
 #endif
 
-    fast_u32_fill((u32*)page->paddr().offset(0xc0000000).as_ptr(), 0, PAGE_SIZE / sizeof(u32));
     ++m_super_physical_pages_used;
+    lock.unlock();
+
+    fast_u32_fill((u32*)page->paddr().offset(0xc0000000).as_ptr(), 0, PAGE_SIZE / sizeof(u32));
     return page;
 }
 
@@ -649,61 +874,46 @@ void MemoryManager::flush_tlb(VirtualAddress vaddr, size_t page_count)
 
 extern "C" PageTableEntry boot_pd3_pt1023[1024];
 
-PageDirectoryEntry* MemoryManager::quickmap_pd(PageDirectory& directory, size_t pdpt_index)
-{
-    ASSERT(s_mm_lock.own_lock());
-    auto& mm_data = get_data();
-    auto& pte = boot_pd3_pt1023[4];
-    auto pd_paddr = directory.m_directory_pages[pdpt_index]->paddr();
-    if (pte.physical_page_base() != pd_paddr.as_ptr()) {
+// The top 2 MiB of the address space are mapped by boot_pd3_pt1023, and used to temporarily map
+// physical pages. Every processor has its own slots, so they never have to wait for each other.
+static constexpr FlatPtr quickmap_base = 0xffe00000;
+static constexpr size_t quickmap_max_processors = 64;
+static constexpr size_t quickmap_page_slot = 8;
+static constexpr size_t quickmap_pd_slot = quickmap_page_slot + quickmap_max_processors;
+static constexpr size_t quickmap_pt_slot = quickmap_pd_slot + quickmap_max_processors;
+static_assert(quickmap_pt_slot + quickmap_max_processors <= 512);
+
+static VirtualAddress quickmap_slot(size_t first_slot, PhysicalAddress paddr)
+{
+    u32 cpu = Processor::current().id();
+    ASSERT(cpu < quickmap_max_processors);
+    auto& pte = boot_pd3_pt1023[first_slot + cpu];
+    VirtualAddress vaddr(quickmap_base + (first_slot + cpu) * PAGE_SIZE);
+    if (pte.physical_page_base() != paddr.as_ptr()) {
 #ifdef MM_DEBUG
-        dbg() << "quickmap_pd: Mapping P" << (void*)directory.m_directory_pages[pdpt_index]->paddr().as_ptr() << " at 0xffe04000 in pte @ " << &pte;
+        dbg() << "quickmap: Mapping P" << (void*)paddr.as_ptr() << " at " << vaddr << " in pte @ " << &pte;
 #endif
-        pte.set_physical_page_base(pd_paddr.get());
+        pte.set_physical_page_base(paddr.get());
         pte.set_present(true);
         pte.set_writable(true);
         pte.set_user_allowed(false);
-        // Because we must continue to hold the MM lock while we use this
-        // mapping, it is sufficient to only flush on the current CPU. Other
-        // CPUs trying to use this API must wait on the MM lock anyway
-        flush_tlb_local(VirtualAddress(0xffe04000));
-    } else {
-        // Even though we don't allow this to be called concurrently, it's
-        // possible that this PD was mapped on a different CPU and we don't
-        // broadcast the flush. If so, we still need to flush the TLB.
-        if (mm_data.m_last_quickmap_pd != pd_paddr)
-            flush_tlb_local(VirtualAddress(0xffe04000));
+        // Nobody else uses this slot, so there's no need to flush on other processors.
+        Processor::flush_tlb_local(vaddr, 1);
     }
-    mm_data.m_last_quickmap_pd = pd_paddr;
-    return (PageDirectoryEntry*)0xffe04000;
+    return vaddr;
+}
+
+PageDirectoryEntry* MemoryManager::quickmap_pd(PageDirectory& directory, size_t pdpt_index)
+{
+    // The mapping is only valid on this processor, so we can't be moved to another one while using it.
+    ASSERT(Processor::current().in_critical());
+    return (PageDirectoryEntry*)quickmap_slot(quickmap_pd_slot, directory.m_directory_pages[pdpt_index]->paddr()).as_ptr();
 }
 
 PageTableEntry* MemoryManager::quickmap_pt(PhysicalAddress pt_paddr)
 {
-    ASSERT(s_mm_lock.own_lock());
-    auto& mm_data = get_data();
-    auto& pte = boot_pd3_pt1023[0];
-    if (pte.physical_page_base() != pt_paddr.as_ptr()) {
-#ifdef MM_DEBUG
-        dbg() << "quickmap_pt: Mapping P" << (void*)pt_paddr.as_ptr() << " at 0xffe00000 in pte @ " << &pte;
-#endif
-        pte.set_physical_page_base(pt_paddr.get());
-        pte.set_present(true);
-        pte.set_writable(true);
-        pte.set_user_allowed(false);
-        // Because we must continue to hold the MM lock while we use this
-        // mapping, it is sufficient to only flush on the current CPU. Other
-        // CPUs trying to use this API must wait on the MM lock anyway
-        flush_tlb_local(VirtualAddress(0xffe00000));
-    } else {
-        // Even though we don't allow this to be called concurrently, it's
-        // possible that this PT was mapped on a different CPU and we don't
-        // broadcast the flush. If so, we still need to flush the TLB.
-        if (mm_data.m_last_quickmap_pt != pt_paddr)
-            flush_tlb_local(VirtualAddress(0xffe00000));
-    }
-    mm_data.m_last_quickmap_pt = pt_paddr;
-    return (PageTableEntry*)0xffe00000;
+    ASSERT(Processor::current().in_critical());
+    return (PageTableEntry*)quickmap_slot(quickmap_pt_slot, pt_paddr).as_ptr();
 }
 
 u8* MemoryManager::quickmap_page(PhysicalPage& physical_page)
@@ -711,35 +921,17 @@ u8* MemoryManager::quickmap_page(PhysicalPage& physical_page)
     ASSERT_INTERRUPTS_DISABLED();
     auto& mm_data = get_data();
     mm_data.m_quickmap_prev_flags = mm_data.m_quickmap_in_use.lock();
-    ScopedSpinLock lock(s_mm_lock);
-
-    u32 pte_idx = 8 + Processor::current().id();
-    VirtualAddress vaddr(0xffe00000 + pte_idx * PAGE_SIZE);
-
-    auto& pte = boot_pd3_pt1023[pte_idx];
-    if (pte.physical_page_base() != physical_page.paddr().as_ptr()) {
-#ifdef MM_DEBUG
-        dbg() << "quickmap_page: Mapping P" << (void*)physical_page.paddr().as_ptr() << " at 0xffe08000 in pte @ " << &pte;
-#endif
-        pte.set_physical_page_base(physical_page.paddr().get());
-        pte.set_present(true);
-        pte.set_writable(true);
-        pte.set_user_allowed(false);
-        flush_tlb_local(vaddr);
-    }
-    return vaddr.as_ptr();
+    return quickmap_slot(quickmap_page_slot, physical_page.paddr()).as_ptr();
 }
 
 void MemoryManager::unquickmap_page()
 {
     ASSERT_INTERRUPTS_DISABLED();
-    ScopedSpinLock lock(s_mm_lock);
     auto& mm_data = get_data();
     ASSERT(mm_data.m_quickmap_in_use.is_locked());
-    u32 pte_idx = 8 + Processor::current().id();
-    VirtualAddress vaddr(0xffe00000 + pte_idx * PAGE_SIZE);
-    auto& pte = boot_pd3_pt1023[pte_idx];
-    pte.clear();
+    u32 slot = quickmap_page_slot + Processor::current().id();
+    VirtualAddress vaddr(quickmap_base + slot * PAGE_SIZE);
+    boot_pd3_pt1023[slot].clear();
     flush_tlb_local(vaddr);
     mm_data.m_quickmap_in_use.unlock(mm_data.m_quickmap_prev_flags);
 }
@@ -747,7 +939,7 @@ void MemoryManager::unquickmap_page()
 template<MemoryManager::AccessSpace space, MemoryManager::AccessType access_type>
 bool MemoryManager::validate_range(const Process& process, VirtualAddress base_vaddr, size_t size) const
 {
-    ASSERT(s_mm_lock.is_locked());
+    ASSERT(process.address_space_lock().own_lock());
     ASSERT(size);
     if (base_vaddr > base_vaddr.offset(size)) {
         dbg() << "Shenanigans! Asked to validate wrappy " << base_vaddr << " size=" << size;
@@ -783,7 +975,7 @@ bool MemoryManager::validate_user_stack(const Process& process, VirtualAddress v
 {
     if (!is_user_address(vaddr))
         return false;
-    ScopedSpinLock lock(s_mm_lock);
+    ScopedSpinLock lock(process.address_space_lock());
     auto* region = user_region_from_vaddr(const_cast<Process&>(process), vaddr);
     return region && region->is_user_accessible() && region->is_stack();
 }
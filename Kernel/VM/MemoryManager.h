@@ -40,6 +40,9 @@ namespace Kernel {
 
 #define PAGE_ROUND_UP(x) ((((u32)(x)) + PAGE_SIZE - 1) & (~(PAGE_SIZE - 1)))
 
+// The size of a page mapped directly by a page directory entry (with PAE).
+constexpr size_t huge_page_size = 2 * MiB;
+
 template<typename T>
 inline T* low_physical_to_virtual(T* physical)
 {
@@ -67,22 +70,35 @@ class SynthFSInode;
 
 #define MM Kernel::MemoryManager::the()
 
+// How many free user physical pages each processor keeps around, and how many of them it gets or gives back at once.
+constexpr size_t free_page_cache_size = 64;
+constexpr size_t free_page_cache_batch_size = 32;
+
 struct MemoryManagerData {
     SpinLock<u8> m_quickmap_in_use;
     u32 m_quickmap_prev_flags;
 
-    PhysicalAddress m_last_quickmap_pd;
-    PhysicalAddress m_last_quickmap_pt;
+    // Lets most page allocations and deallocations get by without taking m_physical_page_lock.
+    // Another processor may end up using it (after a migration, or to drain it), hence the lock.
+    SpinLock<u8> m_free_page_cache_lock;
+    size_t m_free_page_cache_count { 0 };
+    PhysicalAddress m_free_page_cache[free_page_cache_size];
 };
 
+// Locking order: Process::address_space_lock() -> s_mm_lock -> PageDirectory::get_lock() -> MemoryManagerData::m_free_page_cache_lock -> MemoryManager::m_physical_page_lock
+// s_mm_lock covers the kernel regions and page tables, and the lists of all regions and VMObjects.
+// User regions and page tables are covered by the per-process locks instead, so page faults in
+// different processes can be handled at the same time.
 extern RecursiveSpinLock s_mm_lock;
 
 class MemoryManager {
     AK_MAKE_ETERNAL
+    friend class PageCache;
     friend class PageDirectory;
     friend class PhysicalPage;
     friend class PhysicalRegion;
     friend class Region;
+    friend class SwapDevice;
     friend class VMObject;
     friend OwnPtr<KBuffer> procfs$mm(InodeIdentifier);
     friend OwnPtr<KBuffer> procfs$memstat(InodeIdentifier);
@@ -109,9 +125,15 @@ public:
         Yes
     };
 
-    RefPtr<PhysicalPage> allocate_user_physical_page(ShouldZeroFill = ShouldZeroFill::Yes, bool* did_purge = nullptr);
+    enum class ShouldPurge {
+        No,
+        Yes
+    };
+
+    RefPtr<PhysicalPage> allocate_user_physical_page(ShouldZeroFill = ShouldZeroFill::Yes, bool* did_purge = nullptr, ShouldPurge = ShouldPurge::Yes);
     RefPtr<PhysicalPage> allocate_supervisor_physical_page();
     NonnullRefPtrVector<PhysicalPage> allocate_contiguous_supervisor_physical_pages(size_t size);
+    NonnullRefPtrVector<PhysicalPage> allocate_contiguous_user_physical_pages(size_t size, size_t physical_alignment = PAGE_SIZE);
     void deallocate_user_physical_page(const PhysicalPage&);
     void deallocate_supervisor_physical_page(const PhysicalPage&);
 
@@ -128,6 +150,12 @@ public:
     unsigned super_physical_pages() const { return m_super_physical_pages; }
     unsigned super_physical_pages_used() const { return m_super_physical_pages_used; }
 
+    u32 physical_page_lock_contention_count() const { return m_physical_page_lock.contention_count(); }
+
+    // Called from the idle loop, to zero some pages before anybody has to wait for it.
+    void refill_zeroed_pages();
+    size_t zeroed_page_count() const { return m_zeroed_pages.size(); }
+
     template<typename Callback>
     static void for_each_vmobject(Callback callback)
     {
@@ -175,6 +203,7 @@ private:
 
     void detect_cpu_features();
     void protect_kernel_image();
+    void map_kernel_heap_with_huge_pages();
     void parse_memory_map();
     static void flush_tlb_local(VirtualAddress, size_t page_count = 1);
     static void flush_tlb(VirtualAddress, size_t page_count = 1);
@@ -185,6 +214,10 @@ private:
     static Region* find_region_from_vaddr(VirtualAddress);
 
     RefPtr<PhysicalPage> find_free_user_physical_page();
+    PhysicalAddress take_page_from_free_page_cache();
+    void drain_free_page_caches();
+    void return_user_physical_page(PhysicalAddress);
+    RefPtr<PhysicalPage> take_zeroed_page();
     u8* quickmap_page(PhysicalPage&);
     void unquickmap_page();
 
@@ -193,6 +226,7 @@ private:
 
     PageTableEntry* pte(PageDirectory&, VirtualAddress);
     PageTableEntry* ensure_pte(PageDirectory&, VirtualAddress);
+    PageDirectoryEntry* ensure_huge_pde(PageDirectory&, VirtualAddress);
     void release_pte(PageDirectory&, VirtualAddress, bool);
 
     RefPtr<PageDirectory> m_kernel_page_directory;
@@ -201,13 +235,20 @@ private:
     RefPtr<PhysicalPage> m_shared_zero_page;
 
     unsigned m_user_physical_pages { 0 };
-    unsigned m_user_physical_pages_used { 0 };
+    Atomic<unsigned> m_user_physical_pages_used { 0 };
     unsigned m_super_physical_pages { 0 };
     unsigned m_super_physical_pages_used { 0 };
 
+    // Protects the physical regions and page counts. Nothing else is locked while holding it.
+    RecursiveSpinLock m_physical_page_lock;
     NonnullRefPtrVector<PhysicalRegion> m_user_physical_regions;
     NonnullRefPtrVector<PhysicalRegion> m_super_physical_regions;
 
+    // These count as free memory, and are handed out when there's nothing else left.
+    SpinLock<u8> m_zeroed_pages_lock;
+    NonnullRefPtrVector<PhysicalPage> m_zeroed_pages;
+    size_t m_zeroed_pages_target { 0 };
+
     InlineLinkedList<Region> m_user_regions;
     InlineLinkedList<Region> m_kernel_regions;
 
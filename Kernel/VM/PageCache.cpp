@@ -0,0 +1,210 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <AK/NonnullRefPtrVector.h>
+#include <Kernel/Arch/i386/CPU.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/StdLib.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VM/PageCache.h>
+
+namespace Kernel {
+
+static constexpr size_t min_read_ahead_pages = 2;
+static constexpr size_t max_read_ahead_pages = 16;
+
+static SpinLock<u8> s_all_page_caches_lock;
+static IntrusiveList<PageCache, &PageCache::m_list_node>* s_all_page_caches;
+
+static IntrusiveList<PageCache, &PageCache::m_list_node>& all_page_caches()
+{
+    ASSERT(s_all_page_caches_lock.is_locked());
+    if (!s_all_page_caches)
+        s_all_page_caches = new IntrusiveList<PageCache, &PageCache::m_list_node>;
+    return *s_all_page_caches;
+}
+
+PageCache::PageCache(Inode& inode)
+    : m_inode(inode)
+{
+    ScopedSpinLock all_lock(s_all_page_caches_lock);
+    all_page_caches().append(*this);
+}
+
+PageCache::~PageCache()
+{
+    ScopedSpinLock all_lock(s_all_page_caches_lock);
+    all_page_caches().remove(*this);
+}
+
+RefPtr<PhysicalPage> PageCache::find(size_t page_index) const
+{
+    ScopedSpinLock lock(m_lock);
+    auto it = m_pages.find(page_index);
+    if (it == m_pages.end())
+        return nullptr;
+    return it->value;
+}
+
+void PageCache::add(size_t page_index, NonnullRefPtr<PhysicalPage> page)
+{
+    ScopedSpinLock lock(m_lock);
+    m_pages.set(page_index, move(page));
+}
+
+void PageCache::invalidate(size_t offset, size_t size)
+{
+    if (!size)
+        return;
+    size_t first_page_index = offset / PAGE_SIZE;
+    size_t last_page_index = (offset + size - 1) / PAGE_SIZE;
+    ScopedSpinLock lock(m_lock);
+    for (size_t page_index = first_page_index; page_index <= last_page_index; ++page_index) {
+        m_pages.remove(page_index);
+        m_dirty_pages.remove(page_index);
+    }
+}
+
+void PageCache::invalidate_from(size_t offset)
+{
+    size_t first_page_index = offset / PAGE_SIZE;
+    ScopedSpinLock lock(m_lock);
+    Vector<size_t> doomed_page_indices;
+    for (auto& it : m_pages) {
+        if (it.key >= first_page_index)
+            doomed_page_indices.append(it.key);
+    }
+    for (auto page_index : doomed_page_indices) {
+        m_pages.remove(page_index);
+        m_dirty_pages.remove(page_index);
+    }
+}
+
+void PageCache::set_dirty(size_t page_index, const PhysicalPage& page)
+{
+    ScopedSpinLock lock(m_lock);
+    auto it = m_pages.find(page_index);
+    if (it != m_pages.end() && it->value.ptr() == &page)
+        m_dirty_pages.set(page_index);
+}
+
+bool PageCache::has_dirty_pages() const
+{
+    ScopedSpinLock lock(m_lock);
+    return !m_dirty_pages.is_empty();
+}
+
+Vector<size_t> PageCache::take_dirty_pages()
+{
+    ScopedSpinLock lock(m_lock);
+    Vector<size_t> page_indices;
+    for (auto page_index : m_dirty_pages)
+        page_indices.append(page_index);
+    m_dirty_pages.clear();
+    return page_indices;
+}
+
+size_t PageCache::read_ahead_for(size_t page_index)
+{
+    ScopedSpinLock lock(m_lock);
+    if (page_index == m_next_sequential_page)
+        m_read_ahead_window = min(max(m_read_ahead_window * 2, min_read_ahead_pages), max_read_ahead_pages);
+    else
+        m_read_ahead_window = 0;
+    m_next_sequential_page = page_index + 1 + m_read_ahead_window;
+    return m_read_ahead_window;
+}
+
+size_t PageCache::evict_unused_pages()
+{
+    // Drop the pages only after letting go of our lock, since freeing them takes the MM lock.
+    NonnullRefPtrVector<PhysicalPage> unused_pages;
+    {
+        ScopedSpinLock lock(m_lock);
+        Vector<size_t> unused_page_indices;
+        for (auto& it : m_pages) {
+            // If we hold the only reference, the page isn't mapped anywhere.
+            // Dirty pages have to be written back first, which the inode does when its file system is flushed.
+            if (it.value->ref_count() == 1 && !m_dirty_pages.contains(it.key))
+                unused_page_indices.append(it.key);
+        }
+        for (auto page_index : unused_page_indices) {
+            auto it = m_pages.find(page_index);
+            unused_pages.append(move(it->value));
+            m_pages.remove(it);
+        }
+    }
+    return unused_pages.size();
+}
+
+void PageCache::copy_from_page(PhysicalPage& page, size_t offset_in_page, u8* destination, size_t size)
+{
+    ASSERT(offset_in_page + size <= PAGE_SIZE);
+    InterruptDisabler disabler;
+    memcpy(destination, MM.quickmap_page(page) + offset_in_page, size);
+    MM.unquickmap_page();
+}
+
+void PageCache::copy_to_page(PhysicalPage& page, const u8* source)
+{
+    InterruptDisabler disabler;
+    memcpy(MM.quickmap_page(page), source, PAGE_SIZE);
+    MM.unquickmap_page();
+}
+
+bool PageCache::memory_is_low()
+{
+    auto total_pages = MM.user_physical_pages();
+    return total_pages - MM.user_physical_pages_used() < total_pages / 8;
+}
+
+size_t PageCache::evict_unused_pages_everywhere()
+{
+    // Evicting can take a while, so only hold the list lock long enough to keep the caches alive.
+    NonnullRefPtrVector<Inode> inodes;
+    {
+        ScopedSpinLock all_lock(s_all_page_caches_lock);
+        for (auto& page_cache : all_page_caches()) {
+            ScopedSpinLock lock(page_cache.m_lock);
+            if (!page_cache.m_pages.is_empty())
+                inodes.append(page_cache.m_inode);
+        }
+    }
+
+    size_t count = 0;
+    for (auto& inode : inodes) {
+        auto* page_cache = inode.page_cache();
+        ASSERT(page_cache);
+        count += page_cache->evict_unused_pages();
+        if (!memory_is_low())
+            break;
+    }
+    if (count)
+        dbg() << "PageCache: Evicted " << count << " unused pages";
+    return count;
+}
+
+}
@@ -0,0 +1,92 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/HashMap.h>
+#include <AK/HashTable.h>
+#include <AK/IntrusiveList.h>
+#include <AK/Noncopyable.h>
+#include <AK/RefPtr.h>
+#include <AK/Vector.h>
+#include <Kernel/SpinLock.h>
+#include <Kernel/VM/PhysicalPage.h>
+
+namespace Kernel {
+
+class Inode;
+
+// PageCache: The physical pages holding the contents of a single inode.
+//
+// read() fills the page cache, and page faults in file mappings map the very
+// same physical pages, so a file that is both read and mapped is only kept in
+// memory once. Pages that nobody else holds a reference to can be evicted at
+// any time, and will be read back from disk when needed. The exception are
+// pages written to through shared mappings, which stay until the inode has
+// written them back.
+class PageCache {
+    AK_MAKE_NONCOPYABLE(PageCache);
+    AK_MAKE_NONMOVABLE(PageCache);
+
+public:
+    explicit PageCache(Inode&);
+    ~PageCache();
+
+    RefPtr<PhysicalPage> find(size_t page_index) const;
+    void add(size_t page_index, NonnullRefPtr<PhysicalPage>);
+
+    // Forget about any pages overlapping the given byte range, or everything past an offset.
+    void invalidate(size_t offset, size_t size);
+    void invalidate_from(size_t offset);
+
+    // Pages written to through a shared mapping. set_dirty() is ignored unless the given page is the one we have cached.
+    void set_dirty(size_t page_index, const PhysicalPage&);
+    bool has_dirty_pages() const;
+    Vector<size_t> take_dirty_pages();
+
+    // How many pages past the given one to read in as well.
+    size_t read_ahead_for(size_t page_index);
+
+    size_t evict_unused_pages();
+
+    static void copy_from_page(PhysicalPage&, size_t offset_in_page, u8* destination, size_t);
+    static void copy_to_page(PhysicalPage&, const u8* source);
+
+    static bool memory_is_low();
+    static size_t evict_unused_pages_everywhere();
+
+    IntrusiveListNode m_list_node;
+
+private:
+    Inode& m_inode;
+    mutable RecursiveSpinLock m_lock;
+    HashMap<size_t, NonnullRefPtr<PhysicalPage>> m_pages;
+    HashTable<size_t> m_dirty_pages;
+    size_t m_next_sequential_page { 0 };
+    size_t m_read_ahead_window { 0 };
+};
+
+}
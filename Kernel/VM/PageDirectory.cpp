@@ -40,18 +40,28 @@ static const FlatPtr kernelspace_range_base = 0xc0800000;
 
 static AK::Singleton<HashMap<u32, PageDirectory*>> s_cr3_map;
 
+static SpinLock<u8> s_cr3_map_lock;
+
 static HashMap<u32, PageDirectory*>& cr3_map()
 {
     ASSERT_INTERRUPTS_DISABLED();
+    ASSERT(s_cr3_map_lock.is_locked());
     return *s_cr3_map;
 }
 
 RefPtr<PageDirectory> PageDirectory::find_by_cr3(u32 cr3)
 {
-    ScopedSpinLock lock(s_mm_lock);
+    ScopedSpinLock lock(s_cr3_map_lock);
     return cr3_map().get(cr3).value_or({});
 }
 
+RecursiveSpinLock& PageDirectory::get_lock()
+{
+    if (!m_process)
+        return s_mm_lock;
+    return m_lock;
+}
+
 extern "C" PageDirectoryEntry* boot_pdpt[4];
 extern "C" PageDirectoryEntry boot_pd0[1024];
 extern "C" PageDirectoryEntry boot_pd3[1024];
@@ -135,6 +145,7 @@ PageDirectory::PageDirectory(Process& process, const RangeAllocator* parent_rang
     auto* new_pd = MM.quickmap_pd(*this, 0);
     memcpy(new_pd, &buffer, sizeof(PageDirectoryEntry));
 
+    ScopedSpinLock cr3_map_lock(s_cr3_map_lock);
     cr3_map().set(cr3(), this);
 }
 
@@ -143,7 +154,7 @@ PageDirectory::~PageDirectory()
 #ifdef MM_DEBUG
     dbg() << "MM: ~PageDirectory K" << this;
 #endif
-    ScopedSpinLock lock(s_mm_lock);
+    ScopedSpinLock lock(s_cr3_map_lock);
     cr3_map().remove(cr3());
 }
 
@@ -57,7 +57,9 @@ public:
     Process* process() { return m_process; }
     const Process* process() const { return m_process; }
 
-    RecursiveSpinLock& get_lock() { return m_lock; }
+    // Protects the page tables. For user page directories this is a per-address-space lock,
+    // but the kernel page tables are shared by everyone, so they're covered by s_mm_lock.
+    RecursiveSpinLock& get_lock();
 
 private:
     PageDirectory(Process&, const RangeAllocator* parent_range_allocator);
@@ -65,30 +65,27 @@ unsigned PhysicalRegion::finalize_capacity()
     return size();
 }
 
-NonnullRefPtrVector<PhysicalPage> PhysicalRegion::take_contiguous_free_pages(size_t count, bool supervisor)
+NonnullRefPtrVector<PhysicalPage> PhysicalRegion::take_contiguous_free_pages(size_t count, bool supervisor, size_t physical_alignment)
 {
     ASSERT(m_pages);
-    ASSERT(m_used != m_pages);
+
+    Optional<unsigned> range;
+    if (physical_alignment == PAGE_SIZE)
+        range = find_and_allocate_contiguous_range(count);
+    else
+        range = find_and_allocate_aligned_contiguous_range(count, physical_alignment);
+    if (!range.has_value())
+        return {};
+    auto first_contiguous_page = range.value();
 
     NonnullRefPtrVector<PhysicalPage> physical_pages;
     physical_pages.ensure_capacity(count);
 
-    auto first_contiguous_page = find_contiguous_free_pages(count);
-
     for (size_t index = 0; index < count; index++)
         physical_pages.append(PhysicalPage::create(m_lower.offset(PAGE_SIZE * (index + first_contiguous_page)), supervisor));
     return physical_pages;
 }
 
-unsigned PhysicalRegion::find_contiguous_free_pages(size_t count)
-{
-    ASSERT(count != 0);
-    // search from the last page we allocated
-    auto range = find_and_allocate_contiguous_range(count);
-    ASSERT(range.has_value());
-    return range.value();
-}
-
 Optional<unsigned> PhysicalRegion::find_one_free_page()
 {
     if (m_used == m_pages) {
@@ -138,6 +135,27 @@ Optional<unsigned> PhysicalRegion::find_and_allocate_contiguous_range(size_t cou
     return {};
 }
 
+Optional<unsigned> PhysicalRegion::find_and_allocate_aligned_contiguous_range(size_t count, size_t physical_alignment)
+{
+    ASSERT(count != 0);
+    ASSERT((physical_alignment & (physical_alignment - 1)) == 0);
+    ASSERT(physical_alignment > PAGE_SIZE);
+    if (m_used + count > m_pages)
+        return {};
+
+    // Only look at ranges starting at a suitably aligned physical address.
+    size_t alignment_in_pages = physical_alignment / PAGE_SIZE;
+    size_t first_aligned_page = ((physical_alignment - (m_lower.get() & (physical_alignment - 1))) & (physical_alignment - 1)) / PAGE_SIZE;
+    for (size_t page = first_aligned_page; page + count <= m_pages; page += alignment_in_pages) {
+        if (m_bitmap.count_in_range(page, count, true) != 0)
+            continue;
+        m_bitmap.set_range<true>(page, count);
+        m_used += count;
+        return page;
+    }
+    return {};
+}
+
 RefPtr<PhysicalPage> PhysicalRegion::take_free_page(bool supervisor)
 {
     ASSERT(m_pages);
@@ -149,6 +167,20 @@ RefPtr<PhysicalPage> PhysicalRegion::take_free_page(bool supervisor)
     return PhysicalPage::create(m_lower.offset(free_index.value() * PAGE_SIZE), supervisor);
 }
 
+size_t PhysicalRegion::take_free_pages(PhysicalAddress* pages, size_t count)
+{
+    ASSERT(m_pages);
+
+    size_t taken = 0;
+    while (taken < count) {
+        auto free_index = find_one_free_page();
+        if (!free_index.has_value())
+            break;
+        pages[taken++] = m_lower.offset(free_index.value() * PAGE_SIZE);
+    }
+    return taken;
+}
+
 void PhysicalRegion::free_page_at(PhysicalAddress addr)
 {
     ASSERT(m_pages);
@@ -168,7 +200,7 @@ void PhysicalRegion::free_page_at(PhysicalAddress addr)
     m_used--;
 }
 
-void PhysicalRegion::return_page(const PhysicalPage& page)
+void PhysicalRegion::return_page(PhysicalAddress paddr)
 {
     auto returned_count = m_recently_returned.size();
     if (returned_count >= m_recently_returned.capacity()) {
@@ -176,10 +208,10 @@ void PhysicalRegion::return_page(const PhysicalPage& page)
         // and replace the entry with this page
         auto& entry = m_recently_returned[get_fast_random<u8>()];
         free_page_at(entry);
-        entry = page.paddr();
+        entry = paddr;
     } else {
         // Still filling the return queue, just append it
-        m_recently_returned.append(page.paddr());
+        m_recently_returned.append(paddr);
     }
 }
 
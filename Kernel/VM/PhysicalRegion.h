@@ -49,15 +49,20 @@ public:
     unsigned size() const { return m_pages; }
     unsigned used() const { return m_used - m_recently_returned.size(); }
     unsigned free() const { return m_pages - m_used + m_recently_returned.size(); }
-    bool contains(const PhysicalPage& page) const { return page.paddr() >= m_lower && page.paddr() <= m_upper; }
+    bool contains(PhysicalAddress paddr) const { return paddr >= m_lower && paddr <= m_upper; }
+    bool contains(const PhysicalPage& page) const { return contains(page.paddr()); }
 
     RefPtr<PhysicalPage> take_free_page(bool supervisor);
-    NonnullRefPtrVector<PhysicalPage> take_contiguous_free_pages(size_t count, bool supervisor);
-    void return_page(const PhysicalPage& page);
+    NonnullRefPtrVector<PhysicalPage> take_contiguous_free_pages(size_t count, bool supervisor, size_t physical_alignment = PAGE_SIZE);
+    void return_page(const PhysicalPage& page) { return_page(page.paddr()); }
+
+    // Pages handed out by address only, for the per-processor page caches in MemoryManager.
+    size_t take_free_pages(PhysicalAddress* pages, size_t count);
+    void return_page(PhysicalAddress);
 
 private:
-    unsigned find_contiguous_free_pages(size_t count);
     Optional<unsigned> find_and_allocate_contiguous_range(size_t count);
+    Optional<unsigned> find_and_allocate_aligned_contiguous_range(size_t count, size_t physical_alignment);
     Optional<unsigned> find_one_free_page();
     void free_page_at(PhysicalAddress addr);
 
@@ -24,8 +24,6 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
-#include <AK/BinarySearch.h>
-#include <AK/QuickSort.h>
 #include <Kernel/Random.h>
 #include <Kernel/Thread.h>
 #include <Kernel/VM/RangeAllocator.h>
@@ -42,7 +40,7 @@ RangeAllocator::RangeAllocator()
 void RangeAllocator::initialize_with_range(VirtualAddress base, size_t size)
 {
     m_total_range = { base, size };
-    m_available_ranges.append({ base, size });
+    insert_available_range({ base, size });
 #ifdef VRA_DEBUG
     ScopedSpinLock lock(m_lock);
     dump();
@@ -54,6 +52,7 @@ void RangeAllocator::initialize_from_parent(const RangeAllocator& parent_allocat
     ScopedSpinLock lock(parent_allocator.m_lock);
     m_total_range = parent_allocator.m_total_range;
     m_available_ranges = parent_allocator.m_available_ranges;
+    m_available_ranges_by_size = parent_allocator.m_available_ranges_by_size;
 }
 
 RangeAllocator::~RangeAllocator()
@@ -86,14 +85,33 @@ Vector<Range, 2> Range::carve(const Range& taken)
     return parts;
 }
 
-void RangeAllocator::carve_at_index(int index, const Range& range)
+static u64 size_index_key(const Range& range)
+{
+    static_assert(sizeof(FlatPtr) == sizeof(u32));
+    return ((u64)range.size() << 32) | range.base().get();
+}
+
+void RangeAllocator::insert_available_range(const Range& range)
+{
+    m_available_ranges.insert(range.base().get(), range);
+    m_available_ranges_by_size.insert(size_index_key(range), range);
+}
+
+void RangeAllocator::remove_available_range(Range range)
+{
+    bool removed = m_available_ranges.remove(range.base().get());
+    ASSERT(removed);
+    removed = m_available_ranges_by_size.remove(size_index_key(range));
+    ASSERT(removed);
+}
+
+void RangeAllocator::carve_from_available_range(Range available_range, const Range& taken)
 {
     ASSERT(m_lock.is_locked());
-    auto remaining_parts = m_available_ranges[index].carve(range);
-    ASSERT(remaining_parts.size() >= 1);
-    m_available_ranges[index] = remaining_parts[0];
-    if (remaining_parts.size() == 2)
-        m_available_ranges.insert(index + 1, move(remaining_parts[1]));
+    auto remaining_parts = available_range.carve(taken);
+    remove_available_range(available_range);
+    for (auto& part : remaining_parts)
+        insert_available_range(part);
 }
 
 Range RangeAllocator::allocate_anywhere(size_t size, size_t alignment)
@@ -111,32 +129,27 @@ Range RangeAllocator::allocate_anywhere(size_t size, size_t alignment)
 #endif
 
     ScopedSpinLock lock(m_lock);
-    for (size_t i = 0; i < m_available_ranges.size(); ++i) {
-        auto& available_range = m_available_ranges[i];
-        // FIXME: This check is probably excluding some valid candidates when using a large alignment.
-        if (available_range.size() < (effective_size + alignment))
-            continue;
 
-        FlatPtr initial_base = available_range.base().offset(offset_from_effective_base).get();
-        FlatPtr aligned_base = round_up_to_power_of_two(initial_base, alignment);
+    // Pick the smallest free range that is large enough. Keys are ordered by size first, so this is a single lookup.
+    // FIXME: This check is probably excluding some valid candidates when using a large alignment.
+    u64 minimum_size = (u64)effective_size + alignment;
+    auto* candidate = m_available_ranges_by_size.find_smallest_not_below(minimum_size << 32);
+    if (!candidate) {
+        klog() << "VRA: Failed to allocate anywhere: " << size << ", " << alignment;
+        return {};
+    }
 
-        Range allocated_range(VirtualAddress(aligned_base), size);
-        if (available_range == allocated_range) {
-#ifdef VRA_DEBUG
-            dbg() << "VRA: Allocated perfect-fit anywhere(" << String::format("%zu", size) << ", " << String::format("%zu", alignment) << "): " << String::format("%x", allocated_range.base().get());
-#endif
-            m_available_ranges.remove(i);
-            return allocated_range;
-        }
-        carve_at_index(i, allocated_range);
+    Range available_range = *candidate;
+    FlatPtr initial_base = available_range.base().offset(offset_from_effective_base).get();
+    FlatPtr aligned_base = round_up_to_power_of_two(initial_base, alignment);
+
+    Range allocated_range(VirtualAddress(aligned_base), size);
+    carve_from_available_range(available_range, allocated_range);
 #ifdef VRA_DEBUG
-        dbg() << "VRA: Allocated anywhere(" << String::format("%zu", size) << ", " << String::format("%zu", alignment) << "): " << String::format("%x", allocated_range.base().get());
-        dump();
+    dbg() << "VRA: Allocated anywhere(" << String::format("%zu", size) << ", " << String::format("%zu", alignment) << "): " << String::format("%x", allocated_range.base().get());
+    dump();
 #endif
-        return allocated_range;
-    }
-    klog() << "VRA: Failed to allocate anywhere: " << size << ", " << alignment;
-    return {};
+    return allocated_range;
 }
 
 Range RangeAllocator::allocate_specific(VirtualAddress base, size_t size)
@@ -146,23 +159,17 @@ Range RangeAllocator::allocate_specific(VirtualAddress base, size_t size)
 
     Range allocated_range(base, size);
     ScopedSpinLock lock(m_lock);
-    for (size_t i = 0; i < m_available_ranges.size(); ++i) {
-        auto& available_range = m_available_ranges[i];
-        if (!available_range.contains(base, size))
-            continue;
-        if (available_range == allocated_range) {
-            m_available_ranges.remove(i);
-            return allocated_range;
-        }
-        carve_at_index(i, allocated_range);
+    auto* candidate = m_available_ranges.find_largest_not_above(base.get());
+    if (!candidate || !candidate->contains(base, size)) {
+        dbg() << "VRA: Failed to allocate specific range: " << base << "(" << size << ")";
+        return {};
+    }
+    carve_from_available_range(*candidate, allocated_range);
 #ifdef VRA_DEBUG
-        dbg() << "VRA: Allocated specific(" << size << "): " << String::format("%x", available_range.base().get());
-        dump();
+    dbg() << "VRA: Allocated specific(" << size << "): " << String::format("%x", allocated_range.base().get());
+    dump();
 #endif
-        return allocated_range;
-    }
-    dbg() << "VRA: Failed to allocate specific range: " << base << "(" << size << ")";
-    return {};
+    return allocated_range;
 }
 
 void RangeAllocator::deallocate(Range range)
@@ -177,37 +184,20 @@ void RangeAllocator::deallocate(Range range)
     dump();
 #endif
 
-    ASSERT(!m_available_ranges.is_empty());
-
-    size_t nearby_index = 0;
-    auto* existing_range = binary_search(
-        m_available_ranges.span(),
-        range,
-        &nearby_index,
-        [](auto& a, auto& b) { return a.base().get() - b.end().get(); });
-
-    size_t inserted_index = 0;
-    if (existing_range) {
-        existing_range->m_size += range.size();
-        inserted_index = nearby_index;
-    } else {
-        m_available_ranges.insert_before_matching(
-            Range(range), [&](auto& entry) {
-                return entry.base() >= range.end();
-            },
-            nearby_index, &inserted_index);
-    }
-
-    if (inserted_index < (m_available_ranges.size() - 1)) {
-        // We already merged with previous. Try to merge with next.
-        auto& inserted_range = m_available_ranges[inserted_index];
-        auto& next_range = m_available_ranges[inserted_index + 1];
-        if (inserted_range.end() == next_range.base()) {
-            inserted_range.m_size += next_range.size();
-            m_available_ranges.remove(inserted_index + 1);
-            return;
+    Range merged_range = range;
+    if (auto* previous_range = m_available_ranges.find_largest_not_above(range.base().get())) {
+        ASSERT(previous_range->end() <= range.base());
+        if (previous_range->end() == range.base()) {
+            merged_range = { previous_range->base(), previous_range->size() + range.size() };
+            remove_available_range(*previous_range);
         }
     }
+    if (auto* next_range = m_available_ranges.find(range.end().get())) {
+        merged_range.m_size += next_range->size();
+        remove_available_range(*next_range);
+    }
+    insert_available_range(merged_range);
+
 #ifdef VRA_DEBUG
     dbg() << "VRA: After deallocate";
     dump();
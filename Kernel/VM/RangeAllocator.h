@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <AK/RedBlackTree.h>
 #include <AK/String.h>
 #include <AK/Traits.h>
 #include <AK/Vector.h>
@@ -98,9 +99,14 @@ public:
     }
 
 private:
-    void carve_at_index(int, const Range&);
-
-    Vector<Range> m_available_ranges;
+    void insert_available_range(const Range&);
+    void remove_available_range(Range);
+    void carve_from_available_range(Range available_range, const Range& taken);
+
+    // The free ranges are indexed twice: by base address, to find neighbors when carving and merging,
+    // and by (size, base), to find the smallest free range that fits an allocation.
+    RedBlackTree<FlatPtr, Range> m_available_ranges;
+    RedBlackTree<u64, Range> m_available_ranges_by_size;
     Range m_total_range;
     mutable SpinLock<u8> m_lock;
 };
@@ -31,6 +31,7 @@
 #include <Kernel/Thread.h>
 #include <Kernel/VM/AnonymousVMObject.h>
 #include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VM/PageCache.h>
 #include <Kernel/VM/PageDirectory.h>
 #include <Kernel/VM/Region.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
@@ -227,6 +228,92 @@ Bitmap& Region::ensure_cow_map() const
     return *m_cow_map;
 }
 
+bool Region::is_mapped_with_huge_page(size_t page_index)
+{
+    size_t pages_into_huge_page = (vaddr_from_page_index(page_index).get() % huge_page_size) / PAGE_SIZE;
+    if (pages_into_huge_page > page_index)
+        return false;
+    return can_map_with_huge_page(page_index - pages_into_huge_page);
+}
+
+PageTableEntry* Region::pte_for_page(size_t page_index)
+{
+    ASSERT(m_page_directory->get_lock().own_lock());
+    auto* pte = MM.pte(*m_page_directory, vaddr_from_page_index(page_index));
+    if (!pte || !pte->is_present())
+        return nullptr;
+    return pte;
+}
+
+bool Region::test_and_clear_accessed(size_t page_index)
+{
+    if (is_mapped_with_huge_page(page_index))
+        return true;
+    if (!m_page_directory)
+        return false;
+    ScopedSpinLock page_lock(m_page_directory->get_lock());
+    auto* pte = pte_for_page(page_index);
+    if (!pte || !pte->is_accessed())
+        return false;
+    // We don't flush the TLB here. The CPU won't set the bit again while it still has the old entry cached,
+    // so at worst a page in use looks unused and gets faulted back in.
+    pte->set_accessed(false);
+    return true;
+}
+
+bool Region::is_page_dirty(size_t page_index)
+{
+    if (!m_page_directory)
+        return false;
+    ScopedSpinLock page_lock(m_page_directory->get_lock());
+    auto* pte = pte_for_page(page_index);
+    return pte && pte->is_dirty();
+}
+
+bool Region::test_and_clear_dirty(size_t page_index)
+{
+    if (is_mapped_with_huge_page(page_index))
+        return true;
+    if (!m_page_directory)
+        return false;
+    ScopedSpinLock page_lock(m_page_directory->get_lock());
+    auto* pte = pte_for_page(page_index);
+    if (!pte || !pte->is_dirty())
+        return false;
+    pte->set_dirty(false);
+    // Unlike the accessed bit, this one has to be flushed, or writes through the old TLB entry wouldn't set it again.
+    MM.flush_tlb(vaddr_from_page_index(page_index));
+    return true;
+}
+
+bool Region::is_page_mapped(size_t page_index)
+{
+    if (!m_page_directory)
+        return false;
+    ScopedSpinLock page_lock(m_page_directory->get_lock());
+    return pte_for_page(page_index) != nullptr;
+}
+
+bool Region::is_page_mapped_writable(size_t page_index)
+{
+    if (!m_page_directory)
+        return false;
+    ScopedSpinLock page_lock(m_page_directory->get_lock());
+    auto* pte = pte_for_page(page_index);
+    return pte && pte->is_writable();
+}
+
+void Region::unmap_page(size_t page_index)
+{
+    ASSERT(!is_mapped_with_huge_page(page_index));
+    if (!m_page_directory)
+        return;
+    ScopedSpinLock page_lock(m_page_directory->get_lock());
+    if (auto* pte = pte_for_page(page_index))
+        pte->clear();
+    MM.flush_tlb(vaddr_from_page_index(page_index));
+}
+
 bool Region::map_individual_page_impl(size_t page_index)
 {
     ASSERT(m_page_directory->get_lock().own_lock());
@@ -259,9 +346,54 @@ bool Region::map_individual_page_impl(size_t page_index)
     return true;
 }
 
+bool Region::can_map_with_huge_page(size_t page_index) const
+{
+    // A huge page maps 2 MiB of physically contiguous memory, and both the virtual and physical
+    // address have to be aligned to that. All of it must belong to this region, and there must
+    // be nothing about any of the pages that would need a 4 KiB page of its own (like CoW).
+    // If any of this changes, map_individual_page_impl() will split the huge page up again.
+    constexpr size_t pages_per_huge_page = huge_page_size / PAGE_SIZE;
+    if (vaddr_from_page_index(page_index).get() % huge_page_size)
+        return false;
+    if (page_index + pages_per_huge_page > page_count())
+        return false;
+    if (!vmobject().is_anonymous())
+        return false;
+    if (!is_readable() && !is_writable())
+        return false;
+    auto* first_page = physical_page(page_index);
+    if (!first_page || first_page->paddr().get() % huge_page_size)
+        return false;
+    for (size_t i = 0; i < pages_per_huge_page; ++i) {
+        auto* page = physical_page(page_index + i);
+        if (!page || page->paddr() != first_page->paddr().offset(i * PAGE_SIZE))
+            return false;
+        if (should_cow(page_index + i))
+            return false;
+    }
+    return true;
+}
+
+void Region::map_huge_page_impl(size_t page_index)
+{
+    ASSERT(m_page_directory->get_lock().own_lock());
+    auto page_vaddr = vaddr_from_page_index(page_index);
+    auto& pde = *MM.ensure_huge_pde(*m_page_directory, page_vaddr);
+    pde.set_huge_page_base(physical_page(page_index)->paddr().get());
+    pde.set_huge(true);
+    pde.set_cache_disabled(!m_cacheable);
+    pde.set_writable(is_writable());
+    if (Processor::current().has_feature(CPUFeature::NX))
+        pde.set_execute_disabled(!is_executable());
+    pde.set_user_allowed(is_user_accessible());
+    pde.set_present(true);
+#ifdef MM_DEBUG
+    dbg() << "MM: >> region map (PD=" << m_page_directory->cr3() << ", PDE=" << (void*)pde.raw() << ") " << name() << " " << page_vaddr << " => " << physical_page(page_index)->paddr() << " (huge)";
+#endif
+}
+
 bool Region::remap_page(size_t page_index, bool with_flush)
 {
-    ScopedSpinLock lock(s_mm_lock);
     ASSERT(m_page_directory);
     ScopedSpinLock page_lock(m_page_directory->get_lock());
     ASSERT(physical_page(page_index));
@@ -273,10 +405,20 @@ bool Region::remap_page(size_t page_index, bool with_flush)
 
 void Region::unmap(ShouldDeallocateVirtualMemoryRange deallocate_range)
 {
-    ScopedSpinLock lock(s_mm_lock);
     ASSERT(m_page_directory);
     ScopedSpinLock page_lock(m_page_directory->get_lock());
     size_t count = page_count();
+    if (m_shared && vmobject().is_shared_inode()) {
+        // Whatever was written through this mapping still has to make it to the inode after we're gone.
+        if (auto* page_cache = static_cast<SharedInodeVMObject&>(vmobject()).inode().page_cache()) {
+            for (size_t i = 0; i < count; ++i) {
+                auto* pte = pte_for_page(i);
+                auto* page = physical_page(i);
+                if (pte && pte->is_dirty() && page)
+                    page_cache->set_dirty(first_page_index() + i, *page);
+            }
+        }
+    }
     for (size_t i = 0; i < count; ++i) {
         auto vaddr = vaddr_from_page_index(i);
         MM.release_pte(*m_page_directory, vaddr, i == count - 1);
@@ -298,13 +440,12 @@ void Region::unmap(ShouldDeallocateVirtualMemoryRange deallocate_range)
 void Region::set_page_directory(PageDirectory& page_directory)
 {
     ASSERT(!m_page_directory || m_page_directory == &page_directory);
-    ASSERT(s_mm_lock.own_lock());
+    ASSERT(page_directory.get_lock().own_lock());
     m_page_directory = page_directory;
 }
 
 bool Region::map(PageDirectory& page_directory)
 {
-    ScopedSpinLock lock(s_mm_lock);
     ScopedSpinLock page_lock(page_directory.get_lock());
     set_page_directory(page_directory);
 #ifdef MM_DEBUG
@@ -312,6 +453,11 @@ bool Region::map(PageDirectory& page_directory)
 #endif
     size_t page_index = 0;
     while (page_index < page_count()) {
+        if (can_map_with_huge_page(page_index)) {
+            map_huge_page_impl(page_index);
+            page_index += huge_page_size / PAGE_SIZE;
+            continue;
+        }
         if (!map_individual_page_impl(page_index))
             break;
         ++page_index;
@@ -347,6 +493,15 @@ PageFaultResponse Region::handle_fault(const PageFault& fault)
 #endif
             return handle_inode_fault(page_index_in_region);
         }
+        if (vmobject().is_anonymous()) {
+            auto& anonymous_vmobject = static_cast<AnonymousVMObject&>(vmobject());
+            if (physical_page(page_index_in_region) || anonymous_vmobject.is_swapped_out(first_page_index() + page_index_in_region)) {
+#ifdef PAGE_FAULT_DEBUG
+                dbg() << "NP(swap) fault in Region{" << this << "}[" << page_index_in_region << "]";
+#endif
+                return handle_swap_fault(page_index_in_region);
+            }
+        }
 #ifdef MAP_SHARED_ZERO_PAGE_LAZILY
         if (fault.is_read()) {
             physical_page_slot(page_index_in_region) = MM.shared_zero_page();
@@ -418,6 +573,13 @@ PageFaultResponse Region::handle_zero_fault(size_t page_index_in_region)
 PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
 {
     ASSERT_INTERRUPTS_DISABLED();
+
+    LOCKER(vmobject().m_paging_lock);
+
+    // Once written to, a private file mapping no longer matches the file, and must not be thrown away.
+    if (vmobject().is_inode())
+        static_cast<InodeVMObject&>(vmobject()).set_page_dirty(first_page_index() + page_index_in_region);
+
     auto& page_slot = physical_page_slot(page_index_in_region);
     if (page_slot->ref_count() == 1) {
 #ifdef PAGE_FAULT_DEBUG
@@ -467,6 +629,41 @@ PageFaultResponse Region::handle_cow_fault(size_t page_index_in_region)
     return PageFaultResponse::Continue;
 }
 
+PageFaultResponse Region::handle_swap_fault(size_t page_index_in_region)
+{
+    ASSERT_INTERRUPTS_DISABLED();
+    ASSERT(vmobject().is_anonymous());
+
+    LOCKER(vmobject().m_paging_lock);
+
+    // The pageout task unmaps pages before writing them out, so the page may well still be here.
+    if (physical_page(page_index_in_region)) {
+        if (!remap_page(page_index_in_region))
+            return PageFaultResponse::OutOfMemory;
+        return PageFaultResponse::Continue;
+    }
+
+    auto current_thread = Thread::current();
+    if (current_thread)
+        current_thread->did_swap_fault();
+
+    auto page = MM.allocate_user_physical_page(MemoryManager::ShouldZeroFill::No);
+    if (page.is_null()) {
+        klog() << "MM: handle_swap_fault was unable to allocate a physical page";
+        return PageFaultResponse::OutOfMemory;
+    }
+
+    auto result = static_cast<AnonymousVMObject&>(vmobject()).swap_in_page(first_page_index() + page_index_in_region, *page);
+    if (result.is_error()) {
+        klog() << "MM: handle_swap_fault had error (" << result.error() << ") while reading!";
+        return PageFaultResponse::ShouldCrash;
+    }
+
+    if (!remap_page(page_index_in_region))
+        return PageFaultResponse::OutOfMemory;
+    return PageFaultResponse::Continue;
+}
+
 PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
 {
     ASSERT_INTERRUPTS_DISABLED();
@@ -495,12 +692,27 @@ PageFaultResponse Region::handle_inode_fault(size_t page_index_in_region)
     if (current_thread)
         current_thread->did_inode_fault();
 
+    auto& inode = inode_vmobject.inode();
+    if (inode.has_page_cache()) {
+        auto page_or_error = inode.page_cache_page(first_page_index() + page_index_in_region);
+        if (page_or_error.is_error()) {
+            klog() << "MM: handle_inode_fault had error (" << page_or_error.error() << ") while reading!";
+            return page_or_error.error() == -ENOMEM ? PageFaultResponse::OutOfMemory : PageFaultResponse::ShouldCrash;
+        }
+        vmobject_physical_page_entry = page_or_error.release_value();
+        // The page is shared with the page cache, so private mappings have to copy it before writing to it.
+        if (!m_shared)
+            set_should_cow(page_index_in_region, true);
+        if (!remap_page(page_index_in_region))
+            return PageFaultResponse::OutOfMemory;
+        return PageFaultResponse::Continue;
+    }
+
 #ifdef MM_DEBUG
     dbg() << "MM: page_in_from_inode ready to read from inode";
 #endif
 
     u8 page_buffer[PAGE_SIZE];
-    auto& inode = inode_vmobject.inode();
     auto buffer = UserOrKernelBuffer::for_kernel_buffer(page_buffer);
     auto nread = inode.read_bytes((first_page_index() + page_index_in_region) * PAGE_SIZE, PAGE_SIZE, buffer, nullptr);
     if (nread < 0) {
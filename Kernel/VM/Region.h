@@ -167,6 +167,20 @@ public:
 
     u32 cow_pages() const;
 
+    // These let the pageout task find out how a page has been used since it last looked.
+    // Pages mapped with a huge page always count as accessed, since we never split those up to reclaim memory.
+    bool test_and_clear_accessed(size_t page_index);
+    bool is_page_dirty(size_t page_index);
+    bool test_and_clear_dirty(size_t page_index);
+    bool is_page_mapped(size_t page_index);
+    bool is_page_mapped_writable(size_t page_index);
+    void unmap_page(size_t page_index);
+
+    bool maps_vmobject_page(size_t vmobject_page_index) const
+    {
+        return vmobject_page_index >= first_page_index() && vmobject_page_index <= last_page_index();
+    }
+
     void set_readable(bool b) { set_access_bit(Access::Read, b); }
     void set_writable(bool b) { set_access_bit(Access::Write, b); }
     void set_executable(bool b) { set_access_bit(Access::Execute, b); }
@@ -207,8 +221,13 @@ private:
     PageFaultResponse handle_cow_fault(size_t page_index);
     PageFaultResponse handle_inode_fault(size_t page_index);
     PageFaultResponse handle_zero_fault(size_t page_index);
+    PageFaultResponse handle_swap_fault(size_t page_index);
 
     bool map_individual_page_impl(size_t page_index);
+    bool can_map_with_huge_page(size_t page_index) const;
+    bool is_mapped_with_huge_page(size_t page_index);
+    PageTableEntry* pte_for_page(size_t page_index);
+    void map_huge_page_impl(size_t page_index);
 
     RefPtr<PageDirectory> m_page_directory;
     Range m_range;
@@ -26,6 +26,7 @@
 
 #include <Kernel/FileSystem/Inode.h>
 #include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VM/PageCache.h>
 #include <Kernel/VM/Region.h>
 #include <Kernel/VM/SharedInodeVMObject.h>
 
@@ -46,6 +47,24 @@ NonnullRefPtr<VMObject> SharedInodeVMObject::clone()
     return adopt(*new SharedInodeVMObject(*this));
 }
 
+void SharedInodeVMObject::collect_dirty_pages(PageCache& page_cache)
+{
+    ScopedSpinLock lock(s_mm_lock);
+    for (size_t page_index = 0; page_index < page_count(); ++page_index) {
+        auto& page = m_physical_pages[page_index];
+        if (!page)
+            continue;
+        // Every mapping gets its dirty bit cleared, so the page isn't written back again until someone writes to it.
+        bool dirty = false;
+        for_each_region([&](auto& region) {
+            if (region.maps_vmobject_page(page_index) && region.test_and_clear_dirty(page_index - region.first_page_index()))
+                dirty = true;
+        });
+        if (dirty)
+            page_cache.set_dirty(page_index, *page);
+    }
+}
+
 SharedInodeVMObject::SharedInodeVMObject(Inode& inode, size_t size)
     : InodeVMObject(inode, size)
 {
@@ -39,6 +39,9 @@ public:
     static NonnullRefPtr<SharedInodeVMObject> create_with_inode(Inode&);
     virtual NonnullRefPtr<VMObject> clone() override;
 
+    // Tells the page cache about every page that was written to through one of our mappings since the last call.
+    void collect_dirty_pages(PageCache&);
+
 private:
     virtual bool is_shared_inode() const override { return true; }
 
@@ -0,0 +1,216 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <Kernel/FileSystem/FileBackedFileSystem.h>
+#include <Kernel/FileSystem/FileDescription.h>
+#include <Kernel/FileSystem/Inode.h>
+#include <Kernel/VM/MemoryManager.h>
+#include <Kernel/VM/Region.h>
+#include <Kernel/VM/SwapDevice.h>
+
+namespace Kernel {
+
+static SwapDevice* s_the;
+static SpinLock<u8> s_the_lock;
+
+SwapDevice* SwapDevice::the()
+{
+    return s_the;
+}
+
+KResult SwapDevice::enable(FileDescription& description, size_t size)
+{
+    if (!description.is_readable() || !description.is_writable())
+        return KResult(-EBADF);
+
+    RefPtr<FileDescription> device_description;
+    Vector<u32> block_map;
+    size_t block_size = 0;
+    if (auto* inode = description.inode()) {
+        if (!inode->metadata().is_regular_file())
+            return KResult(-EINVAL);
+        size_t file_size = inode->metadata().size;
+        if (!size)
+            size = file_size;
+        // Writing into holes would have the file system allocate blocks while we're trying to free memory.
+        if (size > file_size)
+            return KResult(-EINVAL);
+
+        auto& fs = inode->fs();
+        if (!fs.is_file_backed())
+            return KResult(-EINVAL);
+        device_description = static_cast<FileBackedFS&>(fs).file_description();
+        if (!device_description->file().is_block_device())
+            return KResult(-EINVAL);
+
+        auto block_map_or_error = inode->block_map();
+        if (block_map_or_error.is_error())
+            return block_map_or_error.error();
+        block_map = block_map_or_error.release_value();
+        block_size = fs.block_size();
+        size_t blocks_needed = ceil_div(size, block_size);
+        if (block_map.size() < blocks_needed)
+            return KResult(-EINVAL);
+        block_map.shrink(blocks_needed);
+        for (auto block : block_map) {
+            if (!block)
+                return KResult(-EINVAL);
+        }
+
+        // We write behind the file system's back from now on, so don't let
+        // anything still in its cache land on top of swapped out pages later.
+        fs.flush_writes();
+    } else if (!description.file().is_block_device() || !size) {
+        return KResult(-EINVAL);
+    } else {
+        device_description = description;
+    }
+
+    size_t slot_count = size / PAGE_SIZE;
+    if (!slot_count)
+        return KResult(-EINVAL);
+
+    auto io_buffer = MM.allocate_kernel_region(PAGE_SIZE, "Swap I/O buffer", Region::Access::Read | Region::Access::Write, false, true);
+    if (!io_buffer)
+        return KResult(-ENOMEM);
+
+    auto* swap_device = new SwapDevice(description, *device_description, move(block_map), block_size, io_buffer.release_nonnull(), slot_count);
+    {
+        ScopedSpinLock lock(s_the_lock);
+        if (!s_the) {
+            s_the = swap_device;
+            swap_device = nullptr;
+        }
+    }
+    if (swap_device) {
+        delete swap_device;
+        return KResult(-EBUSY);
+    }
+    klog() << "SwapDevice: Swapping to " << description.absolute_path() << ", " << slot_count << " pages";
+    return KSuccess;
+}
+
+SwapDevice::SwapDevice(FileDescription& description, FileDescription& device_description, Vector<u32>&& block_map, size_t block_size, NonnullOwnPtr<Region>&& io_buffer, size_t slot_count)
+    : m_description(description)
+    , m_device_description(device_description)
+    , m_block_map(move(block_map))
+    , m_block_size(block_size)
+    , m_io_buffer(move(io_buffer))
+{
+    m_slot_ref_counts.resize(slot_count);
+    for (auto& ref_count : m_slot_ref_counts)
+        ref_count = 0;
+}
+
+Optional<u32> SwapDevice::allocate_slot()
+{
+    ScopedSpinLock lock(m_lock);
+    for (size_t i = 0; i < slot_count(); ++i) {
+        size_t slot = (m_next_slot + i) % slot_count();
+        if (m_slot_ref_counts[slot])
+            continue;
+        m_slot_ref_counts[slot] = 1;
+        ++m_used_slot_count;
+        m_next_slot = (slot + 1) % slot_count();
+        return slot;
+    }
+    return {};
+}
+
+void SwapDevice::ref_slot(u32 slot)
+{
+    ScopedSpinLock lock(m_lock);
+    ASSERT(m_slot_ref_counts[slot]);
+    ++m_slot_ref_counts[slot];
+}
+
+void SwapDevice::unref_slot(u32 slot)
+{
+    ScopedSpinLock lock(m_lock);
+    ASSERT(m_slot_ref_counts[slot]);
+    if (--m_slot_ref_counts[slot] == 0)
+        --m_used_slot_count;
+}
+
+KResult SwapDevice::do_io(u32 slot, Direction direction)
+{
+    ASSERT(m_io_lock.is_locked());
+    auto& device = m_device_description->file();
+    size_t offset = (size_t)slot * PAGE_SIZE;
+    size_t done = 0;
+    while (done < PAGE_SIZE) {
+        size_t device_offset = offset + done;
+        size_t chunk_size = PAGE_SIZE - done;
+        if (!m_block_map.is_empty()) {
+            // Transfer as many physically contiguous blocks of the file as we can at once.
+            size_t block = device_offset / m_block_size;
+            size_t offset_in_block = device_offset % m_block_size;
+            chunk_size = min(m_block_size - offset_in_block, PAGE_SIZE - done);
+            while (done + chunk_size < PAGE_SIZE && m_block_map[block + 1] == m_block_map[block] + 1) {
+                ++block;
+                chunk_size += min(m_block_size, PAGE_SIZE - done - chunk_size);
+            }
+            device_offset = (size_t)m_block_map[device_offset / m_block_size] * m_block_size + offset_in_block;
+        }
+
+        auto buffer = UserOrKernelBuffer::for_kernel_buffer(m_io_buffer->vaddr().as_ptr() + done);
+        // Block devices don't cache anything, so once a write returns, the data is on disk.
+        auto result = direction == Direction::Write
+            ? device.write(*m_device_description, device_offset, buffer, chunk_size)
+            : device.read(*m_device_description, device_offset, buffer, chunk_size);
+        if (result.is_error())
+            return result.error();
+        if (result.value() != chunk_size)
+            return KResult(-EIO);
+        done += chunk_size;
+    }
+    return KSuccess;
+}
+
+KResult SwapDevice::write_page(u32 slot, PhysicalPage& page)
+{
+    LOCKER(m_io_lock);
+    {
+        InterruptDisabler disabler;
+        memcpy(m_io_buffer->vaddr().as_ptr(), MM.quickmap_page(page), PAGE_SIZE);
+        MM.unquickmap_page();
+    }
+    return do_io(slot, Direction::Write);
+}
+
+KResult SwapDevice::read_page(u32 slot, PhysicalPage& page)
+{
+    LOCKER(m_io_lock);
+    auto result = do_io(slot, Direction::Read);
+    if (result.is_error())
+        return result;
+    InterruptDisabler disabler;
+    memcpy(MM.quickmap_page(page), m_io_buffer->vaddr().as_ptr(), PAGE_SIZE);
+    MM.unquickmap_page();
+    return KSuccess;
+}
+
+}
@@ -0,0 +1,96 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Noncopyable.h>
+#include <AK/NonnullOwnPtr.h>
+#include <AK/NonnullRefPtr.h>
+#include <AK/Optional.h>
+#include <AK/Vector.h>
+#include <Kernel/KResult.h>
+#include <Kernel/Lock.h>
+#include <Kernel/SpinLock.h>
+
+namespace Kernel {
+
+class FileDescription;
+class PhysicalPage;
+class Region;
+
+// SwapDevice: A file or block device that anonymous memory can be paged out to.
+//
+// The space is divided into page-sized slots. A slot is reference counted, since a
+// forked process shares its parent's swapped out pages just like its resident ones.
+//
+// I/O always goes straight to the block device. For a swap file, the blocks backing it
+// are looked up once when swapping is enabled, so that paging never goes through the
+// file system and its caches, which would need memory at the worst possible time.
+class SwapDevice {
+    AK_MAKE_NONCOPYABLE(SwapDevice);
+    AK_MAKE_NONMOVABLE(SwapDevice);
+
+public:
+    // Returns nullptr until swapping has been enabled.
+    static SwapDevice* the();
+    static KResult enable(FileDescription&, size_t size);
+
+    size_t slot_count() const { return m_slot_ref_counts.size(); }
+    size_t used_slot_count() const { return m_used_slot_count; }
+
+    Optional<u32> allocate_slot();
+    void ref_slot(u32);
+    void unref_slot(u32);
+
+    KResult write_page(u32 slot, PhysicalPage&);
+    KResult read_page(u32 slot, PhysicalPage&);
+
+private:
+    SwapDevice(FileDescription&, FileDescription& device_description, Vector<u32>&& block_map, size_t block_size, NonnullOwnPtr<Region>&& io_buffer, size_t slot_count);
+
+    enum class Direction {
+        Read,
+        Write,
+    };
+    KResult do_io(u32 slot, Direction);
+
+    NonnullRefPtr<FileDescription> m_description;
+    NonnullRefPtr<FileDescription> m_device_description;
+    // Empty when swapping to a block device directly.
+    Vector<u32> m_block_map;
+    size_t m_block_size { 0 };
+
+    // Pages are bounced through here, since the device can't do I/O on a PhysicalPage.
+    Lock m_io_lock { "SwapDevice" };
+    NonnullOwnPtr<Region> m_io_buffer;
+
+    mutable SpinLock<u8> m_lock;
+    Vector<u32> m_slot_ref_counts;
+    size_t m_used_slot_count { 0 };
+    size_t m_next_slot { 0 };
+};
+
+}
@@ -36,6 +36,7 @@
 #include <Kernel/Devices/I8042Controller.h>
 #include <Kernel/Devices/MBVGADevice.h>
 #include <Kernel/Devices/NullDevice.h>
+#include <Kernel/Devices/PerformanceCounterDevice.h>
 #include <Kernel/Devices/RandomDevice.h>
 #include <Kernel/Devices/SB16.h>
 #include <Kernel/Devices/SerialDevice.h>
@@ -65,6 +66,7 @@
 #include <Kernel/TTY/PTYMultiplexer.h>
 #include <Kernel/TTY/VirtualConsole.h>
 #include <Kernel/Tasks/FinalizerTask.h>
+#include <Kernel/Tasks/PageoutTask.h>
 #include <Kernel/Tasks/SyncTask.h>
 #include <Kernel/Time/TimeManagement.h>
 #include <Kernel/VM/MemoryManager.h>
@@ -216,6 +218,7 @@ void init_stage2(void*)
     }
 
     SyncTask::spawn();
+    PageoutTask::spawn();
     FinalizerTask::spawn();
 
     PCI::initialize();
@@ -258,6 +261,7 @@ void init_stage2(void*)
     new ZeroDevice;
     new FullDevice;
     new RandomDevice;
+    PerformanceCounterDevice::initialize();
     PTYMultiplexer::initialize();
     new SB16;
     VMWareBackdoor::the(); // don't wait until first mouse packet
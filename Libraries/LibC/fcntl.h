@@ -37,6 +37,11 @@ __BEGIN_DECLS
 #define F_GETFL 3
 #define F_SETFL 4
 #define F_ISTTY 5
+#define F_GETPIPE_SZ 6
+#define F_SETPIPE_SZ 7
+
+#define SPLICE_F_MOVE 1
+#define SPLICE_F_NONBLOCK 2
 
 #define FD_CLOEXEC 1
 
@@ -93,6 +98,7 @@ int openat_with_path_length(int dirfd, const char* path, size_t path_length, int
 
 int fcntl(int fd, int cmd, ...);
 int watch_file(const char* path, size_t path_length);
+ssize_t splice(int fd_in, int fd_out, size_t length, unsigned flags);
 
 #define F_RDLCK 0
 #define F_WRLCK 1
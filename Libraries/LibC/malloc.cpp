@@ -24,6 +24,7 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <AK/Atomic.h>
 #include <AK/InlineLinkedList.h>
 #include <AK/LogStream.h>
 #include <AK/ScopedValueRollback.h>
@@ -38,8 +39,6 @@
 #include <sys/internals.h>
 #include <sys/mman.h>
 
-// FIXME: Thread safety.
-
 //#define MALLOC_DEBUG
 #define RECYCLE_BIG_ALLOCATIONS
 
@@ -60,42 +59,45 @@ ALWAYS_INLINE static void ue_notify_realloc(const void* ptr, size_t size)
     send_secret_data_to_userspace_emulator(3, size, (FlatPtr)ptr);
 }
 
-static LibThread::Lock& malloc_lock()
-{
-    static u32 lock_storage[sizeof(LibThread::Lock) / sizeof(u32)];
-    return *reinterpret_cast<LibThread::Lock*>(&lock_storage);
-}
-
 constexpr size_t number_of_chunked_blocks_to_keep_around_per_size_class = 4;
 constexpr size_t number_of_big_blocks_to_keep_around_per_size_class = 8;
 
+// Chunks of the smallest size classes are handed out from a per-thread cache,
+// so the common malloc() and free() paths don't have to take any lock.
+// The cache is refilled from (and drained back into) the size class's
+// blocks in batches.
+constexpr size_t number_of_thread_cached_size_classes = 8;
+constexpr size_t thread_cache_batch_size = 16;
+constexpr size_t max_thread_cached_chunks_per_size_class = 2 * thread_cache_batch_size;
+static_assert(size_classes[number_of_thread_cached_size_classes - 1] == 1016);
+
 static bool s_log_malloc = false;
 static bool s_scrub_malloc = true;
 static bool s_scrub_free = true;
 static bool s_profiling = false;
 
 struct MallocStats {
-    size_t number_of_malloc_calls;
+    Atomic<size_t> number_of_malloc_calls;
 
-    size_t number_of_big_allocator_hits;
-    size_t number_of_big_allocator_purge_hits;
-    size_t number_of_big_allocs;
+    Atomic<size_t> number_of_big_allocator_hits;
+    Atomic<size_t> number_of_big_allocator_purge_hits;
+    Atomic<size_t> number_of_big_allocs;
 
-    size_t number_of_empty_block_hits;
-    size_t number_of_empty_block_purge_hits;
-    size_t number_of_block_allocs;
-    size_t number_of_blocks_full;
+    Atomic<size_t> number_of_empty_block_hits;
+    Atomic<size_t> number_of_empty_block_purge_hits;
+    Atomic<size_t> number_of_block_allocs;
+    Atomic<size_t> number_of_blocks_full;
 
-    size_t number_of_free_calls;
+    Atomic<size_t> number_of_free_calls;
 
-    size_t number_of_big_allocator_keeps;
-    size_t number_of_big_allocator_frees;
+    Atomic<size_t> number_of_big_allocator_keeps;
+    Atomic<size_t> number_of_big_allocator_frees;
 
-    size_t number_of_freed_full_blocks;
-    size_t number_of_keeps;
-    size_t number_of_frees;
+    Atomic<size_t> number_of_freed_full_blocks;
+    Atomic<size_t> number_of_keeps;
+    Atomic<size_t> number_of_frees;
 };
-static MallocStats g_malloc_stats = {};
+static MallocStats g_malloc_stats;
 
 struct Allocator {
     size_t size { 0 };
@@ -104,12 +106,30 @@ struct Allocator {
     ChunkedBlock* empty_blocks[number_of_chunked_blocks_to_keep_around_per_size_class] { nullptr };
     InlineLinkedList<ChunkedBlock> usable_blocks;
     InlineLinkedList<ChunkedBlock> full_blocks;
+    LibThread::Lock lock;
 };
 
 struct BigAllocator {
     Vector<BigAllocationBlock*, number_of_big_blocks_to_keep_around_per_size_class> blocks;
+    LibThread::Lock lock;
+};
+
+struct ThreadCache {
+    FreelistEntry* freelists[number_of_thread_cached_size_classes];
+    size_t chunk_counts[number_of_thread_cached_size_classes];
+
+    // These are folded into g_malloc_stats whenever the thread touches the shared allocators.
+    size_t number_of_malloc_calls;
+    size_t number_of_free_calls;
 };
 
+// The dynamic loader is single-threaded and can't use TLS.
+#ifdef NO_TLS
+static ThreadCache s_thread_cache;
+#else
+static __thread ThreadCache s_thread_cache;
+#endif
+
 // Allocators will be initialized in __malloc_init.
 // We can not rely on global constructors to initialize them,
 // because they must be initialized before other global constructors
@@ -119,6 +139,9 @@ struct BigAllocator {
 static u8 g_allocators_storage[sizeof(Allocator) * num_size_classes];
 static u8 g_big_allocators_storage[sizeof(BigAllocator)];
 
+// Maps (size + 7) / 8 to the first size class that fits some size in that 8-byte granule.
+static u8 s_size_class_for_granule[size_classes[num_size_classes - 1] / 8 + 1];
+
 static inline Allocator (&allocators())[num_size_classes]
 {
     return reinterpret_cast<Allocator(&)[num_size_classes]>(g_allocators_storage);
@@ -131,14 +154,22 @@ static inline BigAllocator (&big_allocators())[1]
 
 static Allocator* allocator_for_size(size_t size, size_t& good_size)
 {
-    for (size_t i = 0; size_classes[i]; ++i) {
-        if (size <= size_classes[i]) {
-            good_size = size_classes[i];
-            return &allocators()[i];
-        }
+    size_t granule = (size + 7) / 8;
+    if (granule >= sizeof(s_size_class_for_granule)) {
+        good_size = PAGE_ROUND_UP(size);
+        return nullptr;
     }
-    good_size = PAGE_ROUND_UP(size);
-    return nullptr;
+    size_t index = s_size_class_for_granule[granule];
+    // Not all size classes are multiples of 8, so a granule may straddle two of them.
+    if (size > size_classes[index])
+        ++index;
+    good_size = size_classes[index];
+    return &allocators()[index];
+}
+
+static inline size_t size_class_index(const Allocator& allocator)
+{
+    return &allocator - &allocators()[0];
 }
 
 #ifdef RECYCLE_BIG_ALLOCATIONS
@@ -165,25 +196,161 @@ static void os_free(void* ptr, size_t size)
     assert(rc == 0);
 }
 
-static void* malloc_impl(size_t size)
+static void flush_thread_cache_stats()
+{
+    g_malloc_stats.number_of_malloc_calls += s_thread_cache.number_of_malloc_calls;
+    g_malloc_stats.number_of_free_calls += s_thread_cache.number_of_free_calls;
+    s_thread_cache.number_of_malloc_calls = 0;
+    s_thread_cache.number_of_free_calls = 0;
+}
+
+// Must be called with allocator.lock held.
+static void* allocate_chunk(Allocator& allocator)
+{
+    ChunkedBlock* block = nullptr;
+
+    for (block = allocator.usable_blocks.head(); block; block = block->next()) {
+        if (block->free_chunks())
+            break;
+    }
+
+    if (!block && allocator.empty_block_count) {
+        g_malloc_stats.number_of_empty_block_hits++;
+        block = allocator.empty_blocks[--allocator.empty_block_count];
+        int rc = madvise(block, ChunkedBlock::block_size, MADV_SET_NONVOLATILE);
+        bool this_block_was_purged = rc == 1;
+        if (rc < 0) {
+            perror("madvise");
+            ASSERT_NOT_REACHED();
+        }
+        rc = mprotect(block, ChunkedBlock::block_size, PROT_READ | PROT_WRITE);
+        if (rc < 0) {
+            perror("mprotect");
+            ASSERT_NOT_REACHED();
+        }
+        if (this_block_was_purged) {
+            g_malloc_stats.number_of_empty_block_purge_hits++;
+            new (block) ChunkedBlock(allocator.size);
+        }
+        allocator.usable_blocks.append(block);
+    }
+
+    if (!block) {
+        g_malloc_stats.number_of_block_allocs++;
+        char buffer[64];
+        snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", allocator.size);
+        block = (ChunkedBlock*)os_alloc(ChunkedBlock::block_size, buffer);
+        new (block) ChunkedBlock(allocator.size);
+        allocator.usable_blocks.append(block);
+        ++allocator.block_count;
+    }
+
+    --block->m_free_chunks;
+    void* ptr = block->m_freelist;
+    ASSERT(ptr);
+    block->m_freelist = block->m_freelist->next;
+    if (block->is_full()) {
+        g_malloc_stats.number_of_blocks_full++;
+#ifdef MALLOC_DEBUG
+        dbgprintf("Block %p is now full in size class %zu\n", block, allocator.size);
+#endif
+        allocator.usable_blocks.remove(block);
+        allocator.full_blocks.append(block);
+    }
+#ifdef MALLOC_DEBUG
+    dbgprintf("LibC: allocated %p (chunk in block %p, size %zu)\n", ptr, block, block->bytes_per_chunk());
+#endif
+    return ptr;
+}
+
+// Must be called with allocator.lock held.
+static void free_chunk(Allocator& allocator, ChunkedBlock* block, void* ptr)
 {
-    LOCKER(malloc_lock());
+    auto* entry = (FreelistEntry*)ptr;
+    entry->next = block->m_freelist;
+    block->m_freelist = entry;
+
+    if (block->is_full()) {
+#ifdef MALLOC_DEBUG
+        dbgprintf("Block %p no longer full in size class %zu\n", block, allocator.size);
+#endif
+        g_malloc_stats.number_of_freed_full_blocks++;
+        allocator.full_blocks.remove(block);
+        allocator.usable_blocks.prepend(block);
+    }
+
+    ++block->m_free_chunks;
 
+    if (!block->used_chunks()) {
+        if (allocator.block_count < number_of_chunked_blocks_to_keep_around_per_size_class) {
+#ifdef MALLOC_DEBUG
+            dbgprintf("Keeping block %p around for size class %zu\n", block, allocator.size);
+#endif
+            g_malloc_stats.number_of_keeps++;
+            allocator.usable_blocks.remove(block);
+            allocator.empty_blocks[allocator.empty_block_count++] = block;
+            mprotect(block, ChunkedBlock::block_size, PROT_NONE);
+            madvise(block, ChunkedBlock::block_size, MADV_SET_VOLATILE);
+            return;
+        }
+#ifdef MALLOC_DEBUG
+        dbgprintf("Releasing block %p for size class %zu\n", block, allocator.size);
+#endif
+        g_malloc_stats.number_of_frees++;
+        allocator.usable_blocks.remove(block);
+        --allocator.block_count;
+        os_free(block, ChunkedBlock::block_size);
+    }
+}
+
+static void refill_thread_cache(Allocator& allocator)
+{
+    size_t index = size_class_index(allocator);
+    flush_thread_cache_stats();
+
+    LOCKER(allocator.lock);
+    auto*& freelist = s_thread_cache.freelists[index];
+    for (size_t i = 0; i < thread_cache_batch_size; ++i) {
+        auto* entry = (FreelistEntry*)allocate_chunk(allocator);
+        entry->next = freelist;
+        freelist = entry;
+    }
+    s_thread_cache.chunk_counts[index] += thread_cache_batch_size;
+}
+
+static void drain_thread_cache(Allocator& allocator, size_t count)
+{
+    size_t index = size_class_index(allocator);
+    flush_thread_cache_stats();
+
+    LOCKER(allocator.lock);
+    auto*& freelist = s_thread_cache.freelists[index];
+    for (size_t i = 0; i < count; ++i) {
+        auto* entry = freelist;
+        freelist = entry->next;
+        auto* block = (ChunkedBlock*)((FlatPtr)entry & ChunkedBlock::block_mask);
+        free_chunk(allocator, block, entry);
+    }
+    s_thread_cache.chunk_counts[index] -= count;
+}
+
+static void* malloc_impl(size_t size)
+{
     if (s_log_malloc)
         dbgprintf("LibC: malloc(%zu)\n", size);
 
     if (!size)
         return nullptr;
 
-    g_malloc_stats.number_of_malloc_calls++;
-
     size_t good_size;
     auto* allocator = allocator_for_size(size, good_size);
 
     if (!allocator) {
+        g_malloc_stats.number_of_malloc_calls++;
         size_t real_size = round_up_to_power_of_two(sizeof(BigAllocationBlock) + size, ChunkedBlock::block_size);
 #ifdef RECYCLE_BIG_ALLOCATIONS
         if (auto* allocator = big_allocator_for_size(real_size)) {
+            LOCKER(allocator->lock);
             if (!allocator->blocks.is_empty()) {
                 g_malloc_stats.number_of_big_allocator_hits++;
                 auto* block = allocator->blocks.take_last();
@@ -214,62 +381,24 @@ static void* malloc_impl(size_t size)
         return &block->m_slot[0];
     }
 
-    ChunkedBlock* block = nullptr;
-
-    for (block = allocator->usable_blocks.head(); block; block = block->next()) {
-        if (block->free_chunks())
-            break;
-    }
-
-    if (!block && allocator->empty_block_count) {
-        g_malloc_stats.number_of_empty_block_hits++;
-        block = allocator->empty_blocks[--allocator->empty_block_count];
-        int rc = madvise(block, ChunkedBlock::block_size, MADV_SET_NONVOLATILE);
-        bool this_block_was_purged = rc == 1;
-        if (rc < 0) {
-            perror("madvise");
-            ASSERT_NOT_REACHED();
-        }
-        rc = mprotect(block, ChunkedBlock::block_size, PROT_READ | PROT_WRITE);
-        if (rc < 0) {
-            perror("mprotect");
-            ASSERT_NOT_REACHED();
-        }
-        if (this_block_was_purged) {
-            g_malloc_stats.number_of_empty_block_purge_hits++;
-            new (block) ChunkedBlock(good_size);
-        }
-        allocator->usable_blocks.append(block);
-    }
-
-    if (!block) {
-        g_malloc_stats.number_of_block_allocs++;
-        char buffer[64];
-        snprintf(buffer, sizeof(buffer), "malloc: ChunkedBlock(%zu)", good_size);
-        block = (ChunkedBlock*)os_alloc(ChunkedBlock::block_size, buffer);
-        new (block) ChunkedBlock(good_size);
-        allocator->usable_blocks.append(block);
-        ++allocator->block_count;
+    void* ptr = nullptr;
+    size_t index = size_class_index(*allocator);
+    if (index < number_of_thread_cached_size_classes) {
+        s_thread_cache.number_of_malloc_calls++;
+        if (!s_thread_cache.chunk_counts[index])
+            refill_thread_cache(*allocator);
+        auto*& freelist = s_thread_cache.freelists[index];
+        ptr = freelist;
+        freelist = freelist->next;
+        --s_thread_cache.chunk_counts[index];
+    } else {
+        g_malloc_stats.number_of_malloc_calls++;
+        LOCKER(allocator->lock);
+        ptr = allocate_chunk(*allocator);
     }
 
-    --block->m_free_chunks;
-    void* ptr = block->m_freelist;
-    ASSERT(ptr);
-    block->m_freelist = block->m_freelist->next;
-    if (block->is_full()) {
-        g_malloc_stats.number_of_blocks_full++;
-#ifdef MALLOC_DEBUG
-        dbgprintf("Block %p is now full in size class %zu\n", block, good_size);
-#endif
-        allocator->usable_blocks.remove(block);
-        allocator->full_blocks.append(block);
-    }
-#ifdef MALLOC_DEBUG
-    dbgprintf("LibC: allocated %p (chunk in block %p, size %zu)\n", ptr, block, block->bytes_per_chunk());
-#endif
-
     if (s_scrub_malloc)
-        memset(ptr, MALLOC_SCRUB_BYTE, block->m_size);
+        memset(ptr, MALLOC_SCRUB_BYTE, good_size);
 
     ue_notify_malloc(ptr, size);
     return ptr;
@@ -282,17 +411,15 @@ static void free_impl(void* ptr)
     if (!ptr)
         return;
 
-    g_malloc_stats.number_of_free_calls++;
-
-    LOCKER(malloc_lock());
-
     void* block_base = (void*)((FlatPtr)ptr & ChunkedBlock::ChunkedBlock::block_mask);
     size_t magic = *(size_t*)block_base;
 
     if (magic == MAGIC_BIGALLOC_HEADER) {
+        g_malloc_stats.number_of_free_calls++;
         auto* block = (BigAllocationBlock*)block_base;
 #ifdef RECYCLE_BIG_ALLOCATIONS
         if (auto* allocator = big_allocator_for_size(block->m_size)) {
+            LOCKER(allocator->lock);
             if (allocator->blocks.size() < number_of_big_blocks_to_keep_around_per_size_class) {
                 g_malloc_stats.number_of_big_allocator_keeps++;
                 allocator->blocks.append(block);
@@ -324,45 +451,22 @@ static void free_impl(void* ptr)
     if (s_scrub_free)
         memset(ptr, FREE_SCRUB_BYTE, block->bytes_per_chunk());
 
-    auto* entry = (FreelistEntry*)ptr;
-    entry->next = block->m_freelist;
-    block->m_freelist = entry;
-
-    if (block->is_full()) {
-        size_t good_size;
-        auto* allocator = allocator_for_size(block->m_size, good_size);
-#ifdef MALLOC_DEBUG
-        dbgprintf("Block %p no longer full in size class %zu\n", block, good_size);
-#endif
-        g_malloc_stats.number_of_freed_full_blocks++;
-        allocator->full_blocks.remove(block);
-        allocator->usable_blocks.prepend(block);
+    size_t good_size;
+    auto* allocator = allocator_for_size(block->m_size, good_size);
+    size_t index = size_class_index(*allocator);
+    if (index < number_of_thread_cached_size_classes) {
+        s_thread_cache.number_of_free_calls++;
+        auto* entry = (FreelistEntry*)ptr;
+        entry->next = s_thread_cache.freelists[index];
+        s_thread_cache.freelists[index] = entry;
+        if (++s_thread_cache.chunk_counts[index] > max_thread_cached_chunks_per_size_class)
+            drain_thread_cache(*allocator, thread_cache_batch_size);
+        return;
     }
 
-    ++block->m_free_chunks;
-
-    if (!block->used_chunks()) {
-        size_t good_size;
-        auto* allocator = allocator_for_size(block->m_size, good_size);
-        if (allocator->block_count < number_of_chunked_blocks_to_keep_around_per_size_class) {
-#ifdef MALLOC_DEBUG
-            dbgprintf("Keeping block %p around for size class %zu\n", block, good_size);
-#endif
-            g_malloc_stats.number_of_keeps++;
-            allocator->usable_blocks.remove(block);
-            allocator->empty_blocks[allocator->empty_block_count++] = block;
-            mprotect(block, ChunkedBlock::block_size, PROT_NONE);
-            madvise(block, ChunkedBlock::block_size, MADV_SET_VOLATILE);
-            return;
-        }
-#ifdef MALLOC_DEBUG
-        dbgprintf("Releasing block %p for size class %zu\n", block, good_size);
-#endif
-        g_malloc_stats.number_of_frees++;
-        allocator->usable_blocks.remove(block);
-        --allocator->block_count;
-        os_free(block, ChunkedBlock::block_size);
-    }
+    g_malloc_stats.number_of_free_calls++;
+    LOCKER(allocator->lock);
+    free_chunk(*allocator, block, ptr);
 }
 
 [[gnu::flatten]] void* malloc(size_t size)
@@ -394,7 +498,7 @@ size_t malloc_size(void* ptr)
 {
     if (!ptr)
         return 0;
-    LOCKER(malloc_lock());
+    // The header of a block doesn't change while it has live allocations, so no lock is needed.
     void* page_base = (void*)((FlatPtr)ptr & ChunkedBlock::block_mask);
     auto* header = (const CommonHeader*)page_base;
     auto size = header->m_size;
@@ -412,7 +516,6 @@ void* realloc(void* ptr, size_t size)
     if (!size)
         return nullptr;
 
-    LOCKER(malloc_lock());
     auto existing_allocation_size = malloc_size(ptr);
 
     if (size <= existing_allocation_size) {
@@ -429,7 +532,6 @@ void* realloc(void* ptr, size_t size)
 
 void __malloc_init()
 {
-    new (&malloc_lock()) LibThread::Lock();
     if (getenv("LIBC_NOSCRUB_MALLOC"))
         s_scrub_malloc = false;
     if (getenv("LIBC_NOSCRUB_FREE"))
@@ -444,29 +546,48 @@ void __malloc_init()
         allocators()[i].size = size_classes[i];
     }
 
+    for (size_t granule = 0, index = 0; granule < sizeof(s_size_class_for_granule); ++granule) {
+        size_t smallest_size_in_granule = granule ? granule * 8 - 7 : 0;
+        while (size_classes[index] < smallest_size_in_granule)
+            ++index;
+        s_size_class_for_granule[granule] = index;
+    }
+
     new (&big_allocators()[0])(BigAllocator);
 }
 
+// Called by LibPthread before a thread exits, so its cached chunks aren't leaked.
+[[gnu::flatten]] void __malloc_thread_exit()
+{
+    for (size_t i = 0; i < number_of_thread_cached_size_classes; ++i) {
+        if (s_thread_cache.chunk_counts[i])
+            drain_thread_cache(allocators()[i], s_thread_cache.chunk_counts[i]);
+    }
+    flush_thread_cache_stats();
+}
+
 void serenity_dump_malloc_stats()
 {
-    dbg() << "# malloc() calls: " << g_malloc_stats.number_of_malloc_calls;
+    flush_thread_cache_stats();
+
+    dbg() << "# malloc() calls: " << g_malloc_stats.number_of_malloc_calls.load();
     dbg();
-    dbg() << "big alloc hits: " << g_malloc_stats.number_of_big_allocator_hits;
-    dbg() << "big alloc hits that were purged: " << g_malloc_stats.number_of_big_allocator_purge_hits;
-    dbg() << "big allocs: " << g_malloc_stats.number_of_big_allocs;
+    dbg() << "big alloc hits: " << g_malloc_stats.number_of_big_allocator_hits.load();
+    dbg() << "big alloc hits that were purged: " << g_malloc_stats.number_of_big_allocator_purge_hits.load();
+    dbg() << "big allocs: " << g_malloc_stats.number_of_big_allocs.load();
     dbg();
-    dbg() << "empty block hits: " << g_malloc_stats.number_of_empty_block_hits;
-    dbg() << "empty block hits that were purged: " << g_malloc_stats.number_of_empty_block_purge_hits;
-    dbg() << "block allocs: " << g_malloc_stats.number_of_block_allocs;
-    dbg() << "filled blocks: " << g_malloc_stats.number_of_blocks_full;
+    dbg() << "empty block hits: " << g_malloc_stats.number_of_empty_block_hits.load();
+    dbg() << "empty block hits that were purged: " << g_malloc_stats.number_of_empty_block_purge_hits.load();
+    dbg() << "block allocs: " << g_malloc_stats.number_of_block_allocs.load();
+    dbg() << "filled blocks: " << g_malloc_stats.number_of_blocks_full.load();
     dbg();
-    dbg() << "# free() calls: " << g_malloc_stats.number_of_free_calls;
+    dbg() << "# free() calls: " << g_malloc_stats.number_of_free_calls.load();
     dbg();
-    dbg() << "big alloc keeps: " << g_malloc_stats.number_of_big_allocator_keeps;
-    dbg() << "big alloc frees: " << g_malloc_stats.number_of_big_allocator_frees;
+    dbg() << "big alloc keeps: " << g_malloc_stats.number_of_big_allocator_keeps.load();
+    dbg() << "big alloc frees: " << g_malloc_stats.number_of_big_allocator_frees.load();
     dbg();
-    dbg() << "full block frees: " << g_malloc_stats.number_of_freed_full_blocks;
-    dbg() << "number of keeps: " << g_malloc_stats.number_of_keeps;
-    dbg() << "number of frees: " << g_malloc_stats.number_of_frees;
+    dbg() << "full block frees: " << g_malloc_stats.number_of_freed_full_blocks.load();
+    dbg() << "number of keeps: " << g_malloc_stats.number_of_keeps.load();
+    dbg() << "number of frees: " << g_malloc_stats.number_of_frees.load();
 }
 }
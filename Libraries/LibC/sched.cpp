@@ -57,4 +57,16 @@ int sched_getparam(pid_t pid, struct sched_param* param)
     int rc = syscall(SC_sched_getparam, pid, param);
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
+
+int sched_setaffinity(pid_t tid, size_t cpusetsize, const cpu_set_t* mask)
+{
+    int rc = syscall(SC_sched_setaffinity, tid, cpusetsize, mask);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+int sched_getaffinity(pid_t tid, size_t cpusetsize, cpu_set_t* mask)
+{
+    int rc = syscall(SC_sched_getaffinity, tid, cpusetsize, mask);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
 }
@@ -47,4 +47,19 @@ int sched_get_priority_max(int policy);
 int sched_setparam(pid_t pid, const struct sched_param* param);
 int sched_getparam(pid_t pid, struct sched_param* param);
 
+#define CPU_SETSIZE 32
+
+typedef struct {
+    uint32_t __bits[CPU_SETSIZE / 32];
+} cpu_set_t;
+
+#define CPU_ZERO(set) __builtin_memset((set), 0, sizeof(cpu_set_t))
+#define CPU_SET(cpu, set) ((cpu) < CPU_SETSIZE ? (void)((set)->__bits[(cpu) / 32] |= (1u << ((cpu) % 32))) : (void)0)
+#define CPU_CLR(cpu, set) ((cpu) < CPU_SETSIZE ? (void)((set)->__bits[(cpu) / 32] &= ~(1u << ((cpu) % 32))) : (void)0)
+#define CPU_ISSET(cpu, set) ((cpu) < CPU_SETSIZE && ((set)->__bits[(cpu) / 32] & (1u << ((cpu) % 32))) != 0)
+#define CPU_COUNT(set) __builtin_popcount((set)->__bits[0])
+
+int sched_setaffinity(pid_t tid, size_t cpusetsize, const cpu_set_t* mask);
+int sched_getaffinity(pid_t tid, size_t cpusetsize, cpu_set_t* mask);
+
 __END_DECLS
@@ -72,9 +72,9 @@ int set_process_boost(pid_t tid, int amount)
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
-int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout)
+int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout, int32_t* userspace_address2, int32_t value3)
 {
-    Syscall::SC_futex_params params { userspace_address, futex_op, value, timeout };
+    Syscall::SC_futex_params params { userspace_address, futex_op, value, timeout, userspace_address2, value3 };
     int rc = syscall(SC_futex, &params);
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
@@ -85,6 +85,19 @@ int purge(int mode)
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
 
+int swapon(int fd, size_t size)
+{
+    int rc = syscall(SC_swapon, fd, size);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
+ssize_t get_process_statistics(uint32_t since_generation, void* buffer, size_t buffer_size)
+{
+    Syscall::SC_get_process_statistics_params params { since_generation, buffer, buffer_size };
+    int rc = syscall(SC_get_process_statistics, &params);
+    __RETURN_WITH_ERRNO(rc, rc, -1);
+}
+
 int perf_event(int type, uintptr_t arg1, FlatPtr arg2)
 {
     int rc = syscall(SC_perf_event, type, arg1, arg2);
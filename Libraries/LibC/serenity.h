@@ -57,14 +57,32 @@ int set_process_boost(pid_t, int amount);
 
 #define FUTEX_WAIT 1
 #define FUTEX_WAKE 2
+#define FUTEX_REQUEUE 3
+#define FUTEX_CMP_REQUEUE 4
+#define FUTEX_WAIT_BITSET 5
+#define FUTEX_WAKE_BITSET 6
+#define FUTEX_LOCK_PI 7
+#define FUTEX_UNLOCK_PI 8
 
-int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout);
+#define FUTEX_CLOCK_REALTIME 0x100
+#define FUTEX_CMD_MASK ~(FUTEX_CLOCK_REALTIME)
+
+#define FUTEX_BITSET_MATCH_ANY 0xffffffff
+
+#define FUTEX_WAITERS 0x80000000
+#define FUTEX_TID_MASK 0x3fffffff
+
+int futex(int32_t* userspace_address, int futex_op, int32_t value, const struct timespec* timeout, int32_t* userspace_address2, int32_t value3);
 
 #define PURGE_ALL_VOLATILE 0x1
 #define PURGE_ALL_CLEAN_INODE 0x2
 
 int purge(int mode);
 
+int swapon(int fd, size_t size);
+
+ssize_t get_process_statistics(uint32_t since_generation, void* buffer, size_t buffer_size);
+
 #define PERF_EVENT_MALLOC 1
 #define PERF_EVENT_FREE 2
 
@@ -67,7 +67,10 @@ enum IOCtlNumber {
     SIOCGIFHWADDR,
     SIOCSIFNETMASK,
     SIOCADDRT,
-    SIOCDELRT
+    SIOCDELRT,
+    PERFCOUNTERS_IOCTL_GET_PROCESSOR_COUNT,
+    PERFCOUNTERS_IOCTL_START,
+    PERFCOUNTERS_IOCTL_STOP
 };
 
 #define TIOCGPGRP TIOCGPGRP
@@ -92,3 +95,6 @@ enum IOCtlNumber {
 #define SIOCSIFNETMASK SIOCSIFNETMASK
 #define SIOCADDRT SIOCADDRT
 #define SIOCDELRT SIOCDELRT
+#define PERFCOUNTERS_IOCTL_GET_PROCESSOR_COUNT PERFCOUNTERS_IOCTL_GET_PROCESSOR_COUNT
+#define PERFCOUNTERS_IOCTL_START PERFCOUNTERS_IOCTL_START
+#define PERFCOUNTERS_IOCTL_STOP PERFCOUNTERS_IOCTL_STOP
@@ -85,17 +85,21 @@ typedef struct __pthread_mutex_t {
     pthread_t owner;
     int level;
     int type;
+    int protocol;
 } pthread_mutex_t;
 
 typedef void* pthread_attr_t;
 typedef struct __pthread_mutexattr_t {
     int type;
+    int protocol;
 } pthread_mutexattr_t;
 
 typedef struct __pthread_cond_t {
     int32_t value;
     uint32_t previous;
     int clockid; // clockid_t
+    pthread_mutex_t* mutex; // The mutex of the most recent waiter, for requeueing on broadcast
+    uint32_t waiters;       // Only while there are any is the mutex above known to be alive
 } pthread_cond_t;
 
 typedef void* pthread_rwlock_t;
@@ -28,16 +28,121 @@
 #include <AK/StringBuilder.h>
 #include <AK/Time.h>
 #include <Kernel/API/Syscall.h>
+#include <Kernel/API/TimePage.h>
+#include <LibELF/AuxiliaryVector.h>
 #include <assert.h>
 #include <errno.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/internals.h>
 #include <sys/time.h>
 #include <sys/times.h>
 #include <time.h>
+#include <unistd.h>
+
+static const volatile TimePage* s_time_page;
+
+static u64 read_hpet_main_counter(FlatPtr address)
+{
+    // Like the kernel, only use 32-bit reads, and retry if the high half changed under us.
+    auto* counter = (const volatile u32*)address;
+    u32 low, high = counter[1];
+    for (;;) {
+        low = counter[0];
+        u32 new_high = counter[1];
+        if (new_high == high)
+            break;
+        high = new_high;
+    }
+    return ((u64)high << 32) | (u64)low;
+}
+
+// Computes the time the same way the kernel's clock_gettime() does, but from the time page.
+// Returns false if the caller has to ask the kernel instead.
+static bool read_clock_from_time_page(clockid_t clock_id, timespec& ts)
+{
+    auto* page = s_time_page;
+    if (!page)
+        return false;
+
+    bool is_realtime;
+    bool is_precise = false;
+    switch (clock_id) {
+    case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_RAW:
+        is_realtime = false;
+        is_precise = true;
+        break;
+    case CLOCK_MONOTONIC_COARSE:
+        is_realtime = false;
+        break;
+    case CLOCK_REALTIME:
+    case CLOCK_REALTIME_COARSE:
+        is_realtime = true;
+        break;
+    default:
+        return false;
+    }
+
+    i64 seconds;
+    i64 nanoseconds;
+    for (;;) {
+        // The kernel bumps update1 before it touches anything else and sets update2 last, so we read them
+        // the other way around: if update1 still matches update2 afterwards, nothing changed in between.
+        u32 update_iteration = AK::atomic_load(&page->update2, AK::memory_order_acquire);
+        if (is_realtime) {
+            seconds = page->epoch_seconds;
+            nanoseconds = page->epoch_nanoseconds;
+        } else {
+            u64 ticks_per_second = page->ticks_per_second;
+            if (ticks_per_second == 0)
+                return false;
+            u64 whole_seconds = page->seconds_since_boot;
+            u64 ticks = page->ticks_this_second;
+            if (is_precise && page->hpet_main_counter_address) {
+                u64 main_counter = read_hpet_main_counter(page->hpet_main_counter_address);
+                u64 last_read = page->hpet_main_counter_last_read;
+                // The kernel resets the counter whenever it reprograms the periodic
+                // comparator, and only catches up on the next timer interrupt.
+                if (main_counter < last_read)
+                    return false;
+                ticks += page->hpet_main_counter_drift + (main_counter - last_read);
+                whole_seconds += ticks / ticks_per_second;
+                ticks %= ticks_per_second;
+            }
+            seconds = whole_seconds;
+            nanoseconds = (ticks * 1000000000ull) / ticks_per_second;
+        }
+        // Keep the reads above from moving past the check.
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (update_iteration == AK::atomic_load(&page->update1, AK::memory_order_relaxed))
+            break;
+    }
+
+    ts.tv_sec = seconds;
+    ts.tv_nsec = nanoseconds;
+    return true;
+}
 
 extern "C" {
 
+void __time_init()
+{
+    if (!environ)
+        return;
+
+    // The auxiliary vector follows the terminating null pointer of the initial environment.
+    char** env = environ;
+    while (*env)
+        ++env;
+    for (auto* auxvp = (const auxv_t*)(env + 1); auxvp->a_type != AT_NULL; ++auxvp) {
+        if (auxvp->a_type == AT_TIME_PAGE) {
+            s_time_page = (const volatile TimePage*)auxvp->a_un.a_ptr;
+            break;
+        }
+    }
+}
+
 time_t time(time_t* tloc)
 {
     struct timeval tv;
@@ -57,6 +162,12 @@ int adjtime(const struct timeval* delta, struct timeval* old_delta)
 
 int gettimeofday(struct timeval* __restrict__ tv, void* __restrict__)
 {
+    timespec ts;
+    if (tv && read_clock_from_time_page(CLOCK_REALTIME, ts)) {
+        TIMESPEC_TO_TIMEVAL(tv, &ts);
+        return 0;
+    }
+
     int rc = syscall(SC_gettimeofday, tv);
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
@@ -342,6 +453,9 @@ clock_t clock()
 
 int clock_gettime(clockid_t clock_id, struct timespec* ts)
 {
+    if (ts && read_clock_from_time_page(clock_id, *ts))
+        return 0;
+
     int rc = syscall(SC_clock_gettime, clock_id, ts);
     __RETURN_WITH_ERRNO(rc, rc, -1);
 }
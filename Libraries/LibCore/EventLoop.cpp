@@ -53,6 +53,11 @@
 #include <time.h>
 #include <unistd.h>
 
+#if defined(__serenity__) || defined(__linux__)
+#    define EVENTLOOP_USE_EPOLL
+#    include <sys/epoll.h>
+#endif
+
 //#define EVENTLOOP_DEBUG
 //#define DEFERRED_INVOKE_DEBUG
 
@@ -81,6 +86,16 @@ static Vector<EventLoop*>* s_event_loop_stack;
 static NeverDestroyed<IDAllocator> s_id_allocator;
 static HashMap<int, NonnullOwnPtr<EventLoopTimer>>* s_timers;
 static HashTable<Notifier*>* s_notifiers;
+#ifdef EVENTLOOP_USE_EPOLL
+// The kernel keeps track of which fds we're interested in, so we don't have to
+// hand it every notifier each time we wait. There can be more than one notifier per fd.
+static int s_epoll_fd = -1;
+static HashMap<int, Vector<Notifier*, 1>>* s_notifiers_by_fd;
+// epoll refuses to watch regular files (and some other kinds of fds) with EPERM. select() would always
+// report those as ready, so we do the same, and don't sleep while there are any.
+static HashTable<int>* s_always_ready_fds;
+static constexpr int max_epoll_events = 64;
+#endif
 int EventLoop::s_wake_pipe_fds[2];
 HashMap<int, EventLoop::SignalHandlers> EventLoop::s_signal_handlers;
 int EventLoop::s_handling_signal = 0;
@@ -228,6 +243,10 @@ EventLoop::EventLoop()
         s_event_loop_stack = new Vector<EventLoop*>;
         s_timers = new HashMap<int, NonnullOwnPtr<EventLoopTimer>>;
         s_notifiers = new HashTable<Notifier*>;
+#ifdef EVENTLOOP_USE_EPOLL
+        s_notifiers_by_fd = new HashMap<int, Vector<Notifier*, 1>>;
+        s_always_ready_fds = new HashTable<int>;
+#endif
     }
 
     if (!s_main_event_loop) {
@@ -242,6 +261,15 @@ EventLoop::EventLoop()
 
 #endif
         ASSERT(rc == 0);
+#ifdef EVENTLOOP_USE_EPOLL
+        s_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        ASSERT(s_epoll_fd >= 0);
+        epoll_event wake_event {};
+        wake_event.events = EPOLLIN;
+        wake_event.data.fd = s_wake_pipe_fds[0];
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, s_wake_pipe_fds[0], &wake_event);
+        ASSERT(rc == 0);
+#endif
         s_event_loop_stack->append(this);
 
         if (!s_rpc_server) {
@@ -528,6 +556,13 @@ void EventLoop::notify_forked(ForkEvent event)
         s_event_loop_stack->clear();
         s_timers->clear();
         s_notifiers->clear();
+#ifdef EVENTLOOP_USE_EPOLL
+        // The epoll instance is shared with the parent, so the child's main loop makes a new one.
+        s_notifiers_by_fd->clear();
+        s_always_ready_fds->clear();
+        close(s_epoll_fd);
+        s_epoll_fd = -1;
+#endif
         s_signal_handlers.clear();
         s_handling_signal = 0;
         s_next_signal_id = 0;
@@ -542,6 +577,9 @@ void EventLoop::notify_forked(ForkEvent event)
 
 void EventLoop::wait_for_event(WaitMode mode)
 {
+#ifdef EVENTLOOP_USE_EPOLL
+retry:
+#else
     fd_set rfds;
     fd_set wfds;
 retry:
@@ -566,6 +604,7 @@ retry:
         if (notifier->event_mask() & Notifier::Exceptional)
             ASSERT_NOT_REACHED();
     }
+#endif
 
     bool queued_events_is_empty;
     {
@@ -593,14 +632,24 @@ retry:
         }
     }
 
-try_select_again:
+#ifdef EVENTLOOP_USE_EPOLL
+    epoll_event events[max_epoll_events];
+    // Round up, so we don't wake up just before the next timer is due.
+    int timeout_ms = should_wait_forever ? -1 : timeout.tv_sec * 1000 + (timeout.tv_usec + 999) / 1000;
+    if (!s_always_ready_fds->is_empty())
+        timeout_ms = 0;
+try_wait_again:
+    int marked_fd_count = epoll_wait(s_epoll_fd, events, max_epoll_events, timeout_ms);
+#else
+try_wait_again:
     int marked_fd_count = select(max_fd + 1, &rfds, &wfds, nullptr, should_wait_forever ? nullptr : &timeout);
+#endif
     if (marked_fd_count < 0) {
         int saved_errno = errno;
         if (saved_errno == EINTR) {
             if (m_exit_requested)
                 return;
-            goto try_select_again;
+            goto try_wait_again;
         }
 #ifdef EVENTLOOP_DEBUG
         dbgln("Core::EventLoop::wait_for_event: {} ({}: {})", marked_fd_count, saved_errno, strerror(saved_errno));
@@ -608,7 +657,16 @@ try_select_again:
         // Blow up, similar to Core::safe_syscall.
         ASSERT_NOT_REACHED();
     }
-    if (FD_ISSET(s_wake_pipe_fds[0], &rfds)) {
+#ifdef EVENTLOOP_USE_EPOLL
+    bool wake_pipe_is_readable = false;
+    for (int i = 0; i < marked_fd_count; ++i) {
+        if (events[i].data.fd == s_wake_pipe_fds[0])
+            wake_pipe_is_readable = true;
+    }
+#else
+    bool wake_pipe_is_readable = FD_ISSET(s_wake_pipe_fds[0], &rfds);
+#endif
+    if (wake_pipe_is_readable) {
         int wake_events[8];
         auto nread = read(s_wake_pipe_fds[0], wake_events, sizeof(wake_events));
         if (nread < 0) {
@@ -658,9 +716,40 @@ try_select_again:
         }
     }
 
+#ifdef EVENTLOOP_USE_EPOLL
+    for (int fd : *s_always_ready_fds) {
+        auto it = s_notifiers_by_fd->find(fd);
+        if (it == s_notifiers_by_fd->end())
+            continue;
+        for (auto* notifier : it->value) {
+            if (notifier->event_mask() & Notifier::Event::Read)
+                post_event(*notifier, make<NotifierReadEvent>(notifier->fd()));
+            if (notifier->event_mask() & Notifier::Event::Write)
+                post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
+        }
+    }
+#endif
+
     if (!marked_fd_count)
         return;
 
+#ifdef EVENTLOOP_USE_EPOLL
+    for (int i = 0; i < marked_fd_count; ++i) {
+        auto& event = events[i];
+        auto it = s_notifiers_by_fd->find(event.data.fd);
+        if (it == s_notifiers_by_fd->end())
+            continue;
+        // Like select(), report errors and hangups as readable and writable, so the owner gets to see them.
+        bool readable = event.events & (EPOLLIN | EPOLLHUP | EPOLLERR);
+        bool writable = event.events & (EPOLLOUT | EPOLLHUP | EPOLLERR);
+        for (auto* notifier : it->value) {
+            if (readable && (notifier->event_mask() & Notifier::Event::Read))
+                post_event(*notifier, make<NotifierReadEvent>(notifier->fd()));
+            if (writable && (notifier->event_mask() & Notifier::Event::Write))
+                post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
+        }
+    }
+#else
     for (auto& notifier : *s_notifiers) {
         if (FD_ISSET(notifier->fd(), &rfds)) {
             if (notifier->event_mask() & Notifier::Event::Read)
@@ -671,6 +760,7 @@ try_select_again:
                 post_event(*notifier, make<NotifierWriteEvent>(notifier->fd()));
         }
     }
+#endif
 }
 
 bool EventLoopTimer::has_expired(const timeval& now) const
@@ -731,14 +821,79 @@ bool EventLoop::unregister_timer(int timer_id)
     return true;
 }
 
+#ifdef EVENTLOOP_USE_EPOLL
+static void update_epoll_interest(int fd)
+{
+    auto it = s_notifiers_by_fd->find(fd);
+    if (it == s_notifiers_by_fd->end()) {
+        if (s_always_ready_fds->remove(fd))
+            return;
+        // This fails if the fd has already been closed, but then the kernel has forgotten about it anyway.
+        epoll_ctl(s_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+        return;
+    }
+
+    epoll_event event {};
+    event.data.fd = fd;
+    for (auto* notifier : it->value) {
+        if (notifier->event_mask() & Notifier::Read)
+            event.events |= EPOLLIN;
+        if (notifier->event_mask() & Notifier::Write)
+            event.events |= EPOLLOUT;
+        if (notifier->event_mask() & Notifier::Exceptional)
+            ASSERT_NOT_REACHED();
+    }
+
+    if (s_always_ready_fds->contains(fd)) {
+        // Don't keep the event loop from sleeping for an fd nobody is waiting on at the moment.
+        if (!event.events)
+            s_always_ready_fds->remove(fd);
+        return;
+    }
+    int rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_MOD, fd, &event);
+    if (rc < 0 && errno == ENOENT)
+        rc = epoll_ctl(s_epoll_fd, EPOLL_CTL_ADD, fd, &event);
+    if (rc < 0 && errno == EPERM) {
+        if (event.events)
+            s_always_ready_fds->set(fd);
+        return;
+    }
+    if (rc < 0)
+        dbgln("Core::EventLoop: Failed to watch fd {}: {}", fd, strerror(errno));
+}
+#endif
+
 void EventLoop::register_notifier(Badge<Notifier>, Notifier& notifier)
 {
     s_notifiers->set(&notifier);
+#ifdef EVENTLOOP_USE_EPOLL
+    auto& notifiers = s_notifiers_by_fd->ensure(notifier.fd());
+    if (!notifiers.contains_slow(&notifier))
+        notifiers.append(&notifier);
+    update_epoll_interest(notifier.fd());
+#endif
 }
 
 void EventLoop::unregister_notifier(Badge<Notifier>, Notifier& notifier)
 {
     s_notifiers->remove(&notifier);
+#ifdef EVENTLOOP_USE_EPOLL
+    auto it = s_notifiers_by_fd->find(notifier.fd());
+    if (it == s_notifiers_by_fd->end())
+        return;
+    it->value.remove_first_matching([&](auto* entry) { return entry == &notifier; });
+    if (it->value.is_empty())
+        s_notifiers_by_fd->remove(it);
+    update_epoll_interest(notifier.fd());
+#endif
+}
+
+void EventLoop::notifier_event_mask_changed(Badge<Notifier>, [[maybe_unused]] Notifier& notifier)
+{
+#ifdef EVENTLOOP_USE_EPOLL
+    if (s_notifiers->contains(&notifier))
+        update_epoll_interest(notifier.fd());
+#endif
 }
 
 void EventLoop::wake()
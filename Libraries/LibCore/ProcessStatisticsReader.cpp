@@ -25,90 +25,212 @@
  */
 
 #include <AK/ByteBuffer.h>
-#include <AK/JsonArray.h>
-#include <AK/JsonObject.h>
-#include <AK/JsonValue.h>
-#include <LibCore/File.h>
+#include <Kernel/API/ProcessStatistics.h>
 #include <LibCore/ProcessStatisticsReader.h>
+#include <errno.h>
 #include <pwd.h>
 #include <stdio.h>
+#include <string.h>
+
+#ifdef __serenity__
+#    include <serenity.h>
+#endif
 
 namespace Core {
 
 HashMap<uid_t, String> ProcessStatisticsReader::s_usernames;
+HashMap<pid_t, Core::ProcessStatistics> ProcessStatisticsReader::s_previous_snapshot;
+u32 ProcessStatisticsReader::s_previous_generation { 0 };
+
+#ifdef __serenity__
+
+class SnapshotReader {
+public:
+    explicit SnapshotReader(ReadonlyBytes bytes)
+        : m_bytes(bytes)
+    {
+    }
+
+    template<typename T>
+    bool read(T& value)
+    {
+        if (m_bytes.size() - m_offset < sizeof(T))
+            return false;
+        memcpy(&value, m_bytes.data() + m_offset, sizeof(T));
+        m_offset += sizeof(T);
+        return true;
+    }
+
+    bool read_string(String& string)
+    {
+        u16 length;
+        if (!read(length) || m_bytes.size() - m_offset < length)
+            return false;
+        string = String((const char*)m_bytes.data() + m_offset, length);
+        m_offset += length;
+        return true;
+    }
+
+private:
+    ReadonlyBytes m_bytes;
+    size_t m_offset { 0 };
+};
+
+static ByteBuffer read_snapshot(u32 since_generation)
+{
+    static size_t s_buffer_size = 64 * KiB;
+    for (;;) {
+        auto buffer = ByteBuffer::create_uninitialized(s_buffer_size);
+        ssize_t nread = get_process_statistics(since_generation, buffer.data(), buffer.size());
+        if (nread >= 0) {
+            buffer.trim(nread);
+            return buffer;
+        }
+        if (errno != ERANGE) {
+            perror("get_process_statistics");
+            return {};
+        }
+        s_buffer_size *= 2;
+    }
+}
+
+#endif
 
 HashMap<pid_t, Core::ProcessStatistics> ProcessStatisticsReader::get_all()
 {
-    auto file = Core::File::construct("/proc/all");
-    if (!file->open(Core::IODevice::ReadOnly)) {
-        fprintf(stderr, "ProcessStatisticsReader: Failed to open /proc/all: %s\n", file->error_string());
+#ifdef __serenity__
+    auto snapshot = read_snapshot(s_previous_generation);
+    if (snapshot.is_null())
         return {};
-    }
 
+    bool incomplete = false;
     HashMap<pid_t, Core::ProcessStatistics> map;
+    SnapshotReader reader(snapshot.bytes());
+    ProcessStatisticsHeader header;
+    if (!reader.read(header)) {
+        fprintf(stderr, "ProcessStatisticsReader: Truncated snapshot\n");
+        return {};
+    }
+    map.ensure_capacity(header.process_count);
+
+    for (u32 i = 0; i < header.process_count; ++i) {
+        ProcessStatisticsEntry entry;
+        if (!reader.read(entry)) {
+            fprintf(stderr, "ProcessStatisticsReader: Truncated snapshot\n");
+            return {};
+        }
 
-    auto file_contents = file->read_all();
-    auto json = JsonValue::from_string(file_contents);
-    ASSERT(json.has_value());
-    json.value().as_array().for_each([&](auto& value) {
-        const JsonObject& process_object = value.as_object();
         Core::ProcessStatistics process;
+        auto previous_it = s_previous_snapshot.find(entry.pid);
+        auto* previous_process = previous_it != s_previous_snapshot.end() ? &previous_it->value : nullptr;
 
         // kernel data first
-        process.pid = process_object.get("pid").to_u32();
-        process.pgid = process_object.get("pgid").to_u32();
-        process.pgp = process_object.get("pgp").to_u32();
-        process.sid = process_object.get("sid").to_u32();
-        process.uid = process_object.get("uid").to_u32();
-        process.gid = process_object.get("gid").to_u32();
-        process.ppid = process_object.get("ppid").to_u32();
-        process.nfds = process_object.get("nfds").to_u32();
-        process.name = process_object.get("name").to_string();
-        process.executable = process_object.get("executable").to_string();
-        process.tty = process_object.get("tty").to_string();
-        process.pledge = process_object.get("pledge").to_string();
-        process.veil = process_object.get("veil").to_string();
-        process.amount_virtual = process_object.get("amount_virtual").to_u32();
-        process.amount_resident = process_object.get("amount_resident").to_u32();
-        process.amount_shared = process_object.get("amount_shared").to_u32();
-        process.amount_dirty_private = process_object.get("amount_dirty_private").to_u32();
-        process.amount_clean_inode = process_object.get("amount_clean_inode").to_u32();
-        process.amount_purgeable_volatile = process_object.get("amount_purgeable_volatile").to_u32();
-        process.amount_purgeable_nonvolatile = process_object.get("amount_purgeable_nonvolatile").to_u32();
-
-        auto& thread_array = process_object.get_ptr("threads")->as_array();
-        process.threads.ensure_capacity(thread_array.size());
-        thread_array.for_each([&](auto& value) {
-            auto& thread_object = value.as_object();
+        process.pid = entry.pid;
+        process.pgid = entry.pgid;
+        process.pgp = entry.pgp;
+        process.sid = entry.sid;
+        process.uid = entry.uid;
+        process.gid = entry.gid;
+        process.ppid = entry.ppid;
+        process.nfds = entry.nfds;
+        if (entry.flags & ProcessStatisticsEntry::HasStrings) {
+            if (!reader.read_string(process.name)
+                || !reader.read_string(process.executable)
+                || !reader.read_string(process.tty)
+                || !reader.read_string(process.pledge)
+                || !reader.read_string(process.veil)) {
+                fprintf(stderr, "ProcessStatisticsReader: Truncated snapshot\n");
+                return {};
+            }
+        } else if (previous_process) {
+            process.name = previous_process->name;
+            process.executable = previous_process->executable;
+            process.tty = previous_process->tty;
+            process.pledge = previous_process->pledge;
+            process.veil = previous_process->veil;
+        } else {
+            incomplete = true;
+        }
+        process.amount_virtual = entry.amount_virtual;
+        process.amount_resident = entry.amount_resident;
+        process.amount_shared = entry.amount_shared;
+        process.amount_dirty_private = entry.amount_dirty_private;
+        process.amount_clean_inode = entry.amount_clean_inode;
+        process.amount_purgeable_volatile = entry.amount_purgeable_volatile;
+        process.amount_purgeable_nonvolatile = entry.amount_purgeable_nonvolatile;
+
+        process.threads.ensure_capacity(entry.thread_count);
+        for (u32 j = 0; j < entry.thread_count; ++j) {
+            ThreadStatisticsEntry thread_entry;
+            if (!reader.read(thread_entry)) {
+                fprintf(stderr, "ProcessStatisticsReader: Truncated snapshot\n");
+                return {};
+            }
+
             Core::ThreadStatistics thread;
-            thread.tid = thread_object.get("tid").to_u32();
-            thread.times_scheduled = thread_object.get("times_scheduled").to_u32();
-            thread.name = thread_object.get("name").to_string();
-            thread.state = thread_object.get("state").to_string();
-            thread.ticks_user = thread_object.get("ticks_user").to_u32();
-            thread.ticks_kernel = thread_object.get("ticks_kernel").to_u32();
-            thread.cpu = thread_object.get("cpu").to_u32();
-            thread.priority = thread_object.get("priority").to_u32();
-            thread.effective_priority = thread_object.get("effective_priority").to_u32();
-            thread.syscall_count = thread_object.get("syscall_count").to_u32();
-            thread.inode_faults = thread_object.get("inode_faults").to_u32();
-            thread.zero_faults = thread_object.get("zero_faults").to_u32();
-            thread.cow_faults = thread_object.get("cow_faults").to_u32();
-            thread.unix_socket_read_bytes = thread_object.get("unix_socket_read_bytes").to_u32();
-            thread.unix_socket_write_bytes = thread_object.get("unix_socket_write_bytes").to_u32();
-            thread.ipv4_socket_read_bytes = thread_object.get("ipv4_socket_read_bytes").to_u32();
-            thread.ipv4_socket_write_bytes = thread_object.get("ipv4_socket_write_bytes").to_u32();
-            thread.file_read_bytes = thread_object.get("file_read_bytes").to_u32();
-            thread.file_write_bytes = thread_object.get("file_write_bytes").to_u32();
+            thread.tid = thread_entry.tid;
+            thread.times_scheduled = thread_entry.times_scheduled;
+            if (thread_entry.flags & ThreadStatisticsEntry::HasStrings) {
+                if (!reader.read_string(thread.name)) {
+                    fprintf(stderr, "ProcessStatisticsReader: Truncated snapshot\n");
+                    return {};
+                }
+            } else {
+                bool found = false;
+                if (previous_process) {
+                    for (auto& previous_thread : previous_process->threads) {
+                        if (previous_thread.tid == thread.tid) {
+                            thread.name = previous_thread.name;
+                            found = true;
+                            break;
+                        }
+                    }
+                }
+                if (!found)
+                    incomplete = true;
+            }
+            thread.state = String(thread_entry.state, strnlen(thread_entry.state, sizeof(thread_entry.state)));
+            thread.ticks_user = thread_entry.ticks_user;
+            thread.ticks_kernel = thread_entry.ticks_kernel;
+            thread.cpu = thread_entry.cpu;
+            thread.affinity = thread_entry.affinity;
+            thread.priority = thread_entry.priority;
+            thread.effective_priority = thread_entry.effective_priority;
+            thread.syscall_count = thread_entry.syscall_count;
+            thread.inode_faults = thread_entry.inode_faults;
+            thread.zero_faults = thread_entry.zero_faults;
+            thread.cow_faults = thread_entry.cow_faults;
+            thread.swap_faults = thread_entry.swap_faults;
+            thread.unix_socket_read_bytes = thread_entry.unix_socket_read_bytes;
+            thread.unix_socket_write_bytes = thread_entry.unix_socket_write_bytes;
+            thread.ipv4_socket_read_bytes = thread_entry.ipv4_socket_read_bytes;
+            thread.ipv4_socket_write_bytes = thread_entry.ipv4_socket_write_bytes;
+            thread.file_read_bytes = thread_entry.file_read_bytes;
+            thread.file_write_bytes = thread_entry.file_write_bytes;
             process.threads.append(move(thread));
-        });
+        }
 
         // and synthetic data last
         process.username = username_from_uid(process.uid);
-        map.set(process.pid, process);
-    });
+        map.set(process.pid, move(process));
+    }
+
+    if (incomplete) {
+        // Something changed right around the previous snapshot, so we don't have all the
+        // strings the kernel left out. Start over with a full snapshot.
+        if (s_previous_generation == 0)
+            return map;
+        s_previous_generation = 0;
+        s_previous_snapshot.clear();
+        return get_all();
+    }
 
+    s_previous_generation = header.generation;
+    s_previous_snapshot = map;
     return map;
+#else
+    return {};
+#endif
 }
 
 String ProcessStatisticsReader::username_from_uid(uid_t uid)
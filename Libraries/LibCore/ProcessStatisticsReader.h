@@ -41,6 +41,7 @@ struct ThreadStatistics {
     unsigned inode_faults;
     unsigned zero_faults;
     unsigned cow_faults;
+    unsigned swap_faults;
     unsigned unix_socket_read_bytes;
     unsigned unix_socket_write_bytes;
     unsigned ipv4_socket_read_bytes;
@@ -49,13 +50,14 @@ struct ThreadStatistics {
     unsigned file_write_bytes;
     String state;
     u32 cpu;
+    u32 affinity;
     u32 priority;
     u32 effective_priority;
     String name;
 };
 
 struct ProcessStatistics {
-    // Keep this in sync with /proc/all.
+    // Keep this in sync with Kernel/API/ProcessStatistics.h.
     // From the kernel side:
     pid_t pid;
     pid_t pgid;
@@ -91,6 +93,10 @@ public:
 private:
     static String username_from_uid(uid_t);
     static HashMap<uid_t, String> s_usernames;
+
+    // The previous snapshot, so that we only have to get the strings that changed since.
+    static HashMap<pid_t, Core::ProcessStatistics> s_previous_snapshot;
+    static u32 s_previous_generation;
 };
 
 }
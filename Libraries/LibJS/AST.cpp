@@ -32,6 +32,8 @@
 #include <AK/TemporaryChange.h>
 #include <LibCrypto/BigInt/SignedBigInteger.h>
 #include <LibJS/AST.h>
+#include <LibJS/Bytecode/Executable.h>
+#include <LibJS/Bytecode/Generator.h>
 #include <LibJS/Interpreter.h>
 #include <LibJS/Runtime/Accessor.h>
 #include <LibJS/Runtime/Array.h>
@@ -2234,6 +2236,24 @@ Value DebuggerStatement::execute(Interpreter& interpreter, GlobalObject&) const
     return js_undefined();
 }
 
+ScopeNode::ScopeNode(SourceRange source_range)
+    : Statement(move(source_range))
+{
+}
+
+ScopeNode::~ScopeNode()
+{
+}
+
+const Bytecode::Executable* ScopeNode::bytecode_executable() const
+{
+    if (!m_did_try_generating_bytecode) {
+        m_did_try_generating_bytecode = true;
+        m_bytecode_executable = Bytecode::Generator::generate(*this);
+    }
+    return m_bytecode_executable.ptr();
+}
+
 void ScopeNode::add_variables(NonnullRefPtrVector<VariableDeclaration> variables)
 {
     m_variables.append(move(variables));
@@ -30,9 +30,12 @@
 #include <AK/FlyString.h>
 #include <AK/HashMap.h>
 #include <AK/NonnullRefPtrVector.h>
+#include <AK/Optional.h>
+#include <AK/OwnPtr.h>
 #include <AK/RefPtr.h>
 #include <AK/String.h>
 #include <AK/Vector.h>
+#include <LibJS/Bytecode/Register.h>
 #include <LibJS/Forward.h>
 #include <LibJS/Runtime/PropertyName.h>
 #include <LibJS/Runtime/Value.h>
@@ -55,6 +58,7 @@ public:
     virtual ~ASTNode() { }
     virtual const char* class_name() const = 0;
     virtual Value execute(Interpreter&, GlobalObject&) const = 0;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const;
     virtual void dump(int indent) const;
     virtual bool is_identifier() const { return false; }
     virtual bool is_spread_expression() const { return false; }
@@ -102,6 +106,7 @@ public:
     {
     }
     Value execute(Interpreter&, GlobalObject&) const override { return js_undefined(); }
+    Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     const char* class_name() const override { return "EmptyStatement"; }
 };
 
@@ -124,6 +129,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
     virtual bool is_expression_statement() const override { return true; }
 
@@ -151,6 +157,7 @@ public:
 
     const NonnullRefPtrVector<Statement>& children() const { return m_children; }
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     void add_variables(NonnullRefPtrVector<VariableDeclaration>);
@@ -158,17 +165,21 @@ public:
     const NonnullRefPtrVector<VariableDeclaration>& variables() const { return m_variables; }
     const NonnullRefPtrVector<FunctionDeclaration>& functions() const { return m_functions; }
 
+    // Compiles the program or function body on first use. Returns nullptr if it can't be compiled.
+    const Bytecode::Executable* bytecode_executable() const;
+
 protected:
-    ScopeNode(SourceRange source_range)
-        : Statement(move(source_range))
-    {
-    }
+    ScopeNode(SourceRange source_range);
+    virtual ~ScopeNode() override;
 
 private:
     virtual bool is_scope_node() const final { return true; }
     NonnullRefPtrVector<Statement> m_children;
     NonnullRefPtrVector<VariableDeclaration> m_variables;
     NonnullRefPtrVector<FunctionDeclaration> m_functions;
+
+    mutable OwnPtr<Bytecode::Executable> m_bytecode_executable;
+    mutable bool m_did_try_generating_bytecode { false };
 };
 
 class Program final : public ScopeNode {
@@ -279,6 +290,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -299,8 +311,11 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
+    bool is_arrow_function() const { return m_is_arrow_function; }
+
 private:
     virtual const char* class_name() const override { return "FunctionExpression"; }
 
@@ -329,6 +344,7 @@ public:
     const Expression* argument() const { return m_argument; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -352,6 +368,7 @@ public:
     const Statement* alternate() const { return m_alternate; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -375,6 +392,7 @@ public:
     const Statement& body() const { return *m_body; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -397,6 +415,7 @@ public:
     const Statement& body() const { return *m_body; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -445,6 +464,7 @@ public:
     const Statement& body() const { return *m_body; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -542,6 +562,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -569,6 +590,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -599,6 +621,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -618,6 +641,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     virtual const char* class_name() const override { return "SequenceExpression"; }
@@ -642,6 +666,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -659,6 +684,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -676,6 +702,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -694,6 +721,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
     virtual bool is_string_literal() const override { return true; };
 
@@ -715,6 +743,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -731,6 +760,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     const String& content() const { return m_content; }
@@ -754,6 +784,7 @@ public:
     const FlyString& string() const { return m_string; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
     virtual bool is_identifier() const override { return true; }
     virtual Reference to_reference(Interpreter&, GlobalObject&) const override;
@@ -878,6 +909,7 @@ public:
     {
     }
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -899,6 +931,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -958,6 +991,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -984,6 +1018,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -1041,6 +1076,7 @@ public:
     DeclarationKind declaration_kind() const { return m_declaration_kind; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     const NonnullRefPtrVector<VariableDeclarator>& declarations() const { return m_declarations; }
@@ -1101,6 +1137,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -1120,6 +1157,7 @@ public:
     const Vector<RefPtr<Expression>>& elements() const { return m_elements; }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
 private:
@@ -1144,6 +1182,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
 
     const NonnullRefPtrVector<Expression>& expressions() const { return m_expressions; }
@@ -1186,6 +1225,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
     virtual void dump(int indent) const override;
     virtual Reference to_reference(Interpreter&, GlobalObject&) const override;
 
@@ -1240,6 +1280,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     virtual const char* class_name() const override { return "ConditionalExpression"; }
@@ -1308,6 +1349,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     virtual const char* class_name() const override { return "ThrowStatement"; }
@@ -1348,6 +1390,7 @@ public:
 
     virtual void dump(int indent) const override;
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     virtual const char* class_name() const override { return "SwitchStatement"; }
@@ -1365,6 +1408,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
     const FlyString& target_label() const { return m_target_label; }
 
@@ -1383,6 +1427,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
     const FlyString& target_label() const { return m_target_label; }
 
@@ -1400,6 +1445,7 @@ public:
     }
 
     virtual Value execute(Interpreter&, GlobalObject&) const override;
+    virtual Optional<Bytecode::Register> generate_bytecode(Bytecode::Generator&) const override;
 
 private:
     virtual const char* class_name() const override { return "DebuggerStatement"; }
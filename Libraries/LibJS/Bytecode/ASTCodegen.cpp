@@ -0,0 +1,783 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Generator.h>
+#include <LibJS/Bytecode/Op.h>
+
+namespace JS {
+
+using Bytecode::Generator;
+using Bytecode::Register;
+
+Optional<Register> ASTNode::generate_bytecode(Generator& generator) const
+{
+    generator.fail(*this);
+    return {};
+}
+
+Optional<Register> EmptyStatement::generate_bytecode(Generator&) const
+{
+    return {};
+}
+
+Optional<Register> ExpressionStatement::generate_bytecode(Generator& generator) const
+{
+    generator.generate_expression(m_expression);
+    return {};
+}
+
+Optional<Register> ScopeNode::generate_bytecode(Generator& generator) const
+{
+    // Programs and function bodies are compiled by Generator::generate(), so this is a nested block.
+    ASSERT(!is_program());
+
+    bool is_labelled = !m_label.is_null();
+    if (is_labelled)
+        generator.begin_breakable_scope(m_label, false);
+    bool did_enter_scope = generator.enter_scope(*this, ScopeType::Block);
+    for (auto& child : children())
+        generator.generate_statement(child);
+    if (did_enter_scope)
+        generator.exit_scope(*this);
+    if (is_labelled)
+        generator.end_breakable_scope(generator.make_label());
+    return {};
+}
+
+Optional<Register> FunctionDeclaration::generate_bytecode(Generator&) const
+{
+    // Function declarations are hoisted when the enclosing scope is entered.
+    return {};
+}
+
+Optional<Register> FunctionExpression::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    auto& function_name = name().is_empty() ? generator.inferred_function_name() : name();
+    generator.emit<Bytecode::Op::NewFunction>(dst, *this, generator.add_identifier(function_name));
+    return dst;
+}
+
+Optional<Register> ReturnStatement::generate_bytecode(Generator& generator) const
+{
+    auto value = m_argument ? generator.generate_expression(*m_argument) : generator.load_constant(js_undefined());
+    generator.emit<Bytecode::Op::Return>(value);
+    return {};
+}
+
+Optional<Register> IfStatement::generate_bytecode(Generator& generator) const
+{
+    auto predicate = generator.generate_expression(m_predicate);
+    auto jump_to_alternate = generator.emit<Bytecode::Op::JumpIfFalse>(predicate);
+    generator.generate_statement(m_consequent);
+    if (!m_alternate) {
+        generator.link_jump(jump_to_alternate, generator.make_label());
+        return {};
+    }
+    auto jump_to_end = generator.emit<Bytecode::Op::Jump>();
+    generator.link_jump(jump_to_alternate, generator.make_label());
+    generator.generate_statement(*m_alternate);
+    generator.link_jump(jump_to_end, generator.make_label());
+    return {};
+}
+
+Optional<Register> WhileStatement::generate_bytecode(Generator& generator) const
+{
+    generator.begin_breakable_scope(m_label, true);
+    auto test_label = generator.make_label();
+    auto test = generator.generate_expression(m_test);
+    auto jump_to_end = generator.emit<Bytecode::Op::JumpIfFalse>(test);
+    generator.generate_statement(m_body);
+    generator.emit<Bytecode::Op::Jump>(test_label);
+    auto end_label = generator.make_label();
+    generator.link_jump(jump_to_end, end_label);
+    generator.end_breakable_scope(end_label, test_label);
+    return {};
+}
+
+Optional<Register> DoWhileStatement::generate_bytecode(Generator& generator) const
+{
+    generator.begin_breakable_scope(m_label, true);
+    auto body_label = generator.make_label();
+    generator.generate_statement(m_body);
+    auto test_label = generator.make_label();
+    auto test = generator.generate_expression(m_test);
+    generator.emit<Bytecode::Op::JumpIfTrue>(test, body_label);
+    generator.end_breakable_scope(generator.make_label(), test_label);
+    return {};
+}
+
+Optional<Register> ForStatement::generate_bytecode(Generator& generator) const
+{
+    // Like the AST interpreter, let and const declarations in the init get a scope of their own.
+    RefPtr<BlockStatement> wrapper;
+    bool did_enter_wrapper = false;
+    if (m_init && m_init->is_variable_declaration() && static_cast<const VariableDeclaration*>(m_init.ptr())->declaration_kind() != DeclarationKind::Var) {
+        wrapper = create_ast_node<BlockStatement>(source_range());
+        NonnullRefPtrVector<VariableDeclaration> decls;
+        decls.append(*static_cast<const VariableDeclaration*>(m_init.ptr()));
+        wrapper->add_variables(decls);
+        generator.adopt_synthesized_scope_node(*wrapper);
+        did_enter_wrapper = generator.enter_scope(*wrapper, ScopeType::Block);
+    }
+
+    if (m_init) {
+        if (m_init->is_variable_declaration())
+            generator.generate_statement(static_cast<const VariableDeclaration&>(*m_init));
+        else
+            generator.generate_expression(static_cast<const Expression&>(*m_init));
+    }
+
+    generator.begin_breakable_scope(m_label, true);
+    auto test_label = generator.make_label();
+    Optional<size_t> jump_to_end;
+    if (m_test) {
+        auto test = generator.generate_expression(*m_test);
+        jump_to_end = generator.emit<Bytecode::Op::JumpIfFalse>(test);
+    }
+    generator.generate_statement(m_body);
+    auto update_label = generator.make_label();
+    if (m_update)
+        generator.generate_expression(*m_update);
+    generator.emit<Bytecode::Op::Jump>(test_label);
+    auto end_label = generator.make_label();
+    if (jump_to_end.has_value())
+        generator.link_jump(jump_to_end.value(), end_label);
+    generator.end_breakable_scope(end_label, update_label);
+
+    if (did_enter_wrapper)
+        generator.exit_scope(*wrapper);
+    return {};
+}
+
+Optional<Register> BinaryExpression::generate_bytecode(Generator& generator) const
+{
+    auto lhs = generator.generate_expression(m_lhs);
+    auto rhs = generator.generate_expression(m_rhs);
+    auto dst = generator.allocate_register();
+    switch (m_op) {
+    case BinaryOp::Addition:
+        generator.emit<Bytecode::Op::Add>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Subtraction:
+        generator.emit<Bytecode::Op::Sub>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Multiplication:
+        generator.emit<Bytecode::Op::Mul>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Division:
+        generator.emit<Bytecode::Op::Div>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Modulo:
+        generator.emit<Bytecode::Op::Mod>(dst, lhs, rhs);
+        break;
+    case BinaryOp::Exponentiation:
+        generator.emit<Bytecode::Op::Exp>(dst, lhs, rhs);
+        break;
+    case BinaryOp::TypedEquals:
+        generator.emit<Bytecode::Op::TypedEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::TypedInequals:
+        generator.emit<Bytecode::Op::TypedInequals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::AbstractEquals:
+        generator.emit<Bytecode::Op::AbstractEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::AbstractInequals:
+        generator.emit<Bytecode::Op::AbstractInequals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::GreaterThan:
+        generator.emit<Bytecode::Op::GreaterThan>(dst, lhs, rhs);
+        break;
+    case BinaryOp::GreaterThanEquals:
+        generator.emit<Bytecode::Op::GreaterThanEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::LessThan:
+        generator.emit<Bytecode::Op::LessThan>(dst, lhs, rhs);
+        break;
+    case BinaryOp::LessThanEquals:
+        generator.emit<Bytecode::Op::LessThanEquals>(dst, lhs, rhs);
+        break;
+    case BinaryOp::BitwiseAnd:
+        generator.emit<Bytecode::Op::BitwiseAnd>(dst, lhs, rhs);
+        break;
+    case BinaryOp::BitwiseOr:
+        generator.emit<Bytecode::Op::BitwiseOr>(dst, lhs, rhs);
+        break;
+    case BinaryOp::BitwiseXor:
+        generator.emit<Bytecode::Op::BitwiseXor>(dst, lhs, rhs);
+        break;
+    case BinaryOp::LeftShift:
+        generator.emit<Bytecode::Op::LeftShift>(dst, lhs, rhs);
+        break;
+    case BinaryOp::RightShift:
+        generator.emit<Bytecode::Op::RightShift>(dst, lhs, rhs);
+        break;
+    case BinaryOp::UnsignedRightShift:
+        generator.emit<Bytecode::Op::UnsignedRightShift>(dst, lhs, rhs);
+        break;
+    case BinaryOp::In:
+        generator.emit<Bytecode::Op::In>(dst, lhs, rhs);
+        break;
+    case BinaryOp::InstanceOf:
+        generator.emit<Bytecode::Op::InstanceOf>(dst, lhs, rhs);
+        break;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+    return dst;
+}
+
+// Emits a jump that is taken when a logical operator short-circuits on the value in the given register.
+static size_t emit_short_circuit_jump(Generator& generator, LogicalOp op, Register value)
+{
+    switch (op) {
+    case LogicalOp::And:
+        return generator.emit<Bytecode::Op::JumpIfFalse>(value);
+    case LogicalOp::Or:
+        return generator.emit<Bytecode::Op::JumpIfTrue>(value);
+    case LogicalOp::NullishCoalescing:
+        return generator.emit<Bytecode::Op::JumpIfNotNullish>(value);
+    }
+    ASSERT_NOT_REACHED();
+}
+
+Optional<Register> LogicalExpression::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    auto lhs = generator.generate_expression(m_lhs);
+    generator.emit<Bytecode::Op::Move>(dst, lhs);
+    auto jump_to_end = emit_short_circuit_jump(generator, m_op, dst);
+    auto rhs = generator.generate_expression(m_rhs);
+    generator.emit<Bytecode::Op::Move>(dst, rhs);
+    generator.link_jump(jump_to_end, generator.make_label());
+    return dst;
+}
+
+Optional<Register> UnaryExpression::generate_bytecode(Generator& generator) const
+{
+    if (m_op == UnaryOp::Delete) {
+        generator.fail(*this);
+        return {};
+    }
+
+    auto dst = generator.allocate_register();
+    if (m_op == UnaryOp::Typeof && m_lhs->is_identifier()) {
+        auto& name = static_cast<const Identifier&>(*m_lhs).string();
+        generator.emit<Bytecode::Op::TypeofVariable>(dst, generator.add_identifier(name));
+        return dst;
+    }
+
+    auto src = generator.generate_expression(m_lhs);
+    switch (m_op) {
+    case UnaryOp::BitwiseNot:
+        generator.emit<Bytecode::Op::BitwiseNot>(dst, src);
+        break;
+    case UnaryOp::Not:
+        generator.emit<Bytecode::Op::Not>(dst, src);
+        break;
+    case UnaryOp::Plus:
+        generator.emit<Bytecode::Op::UnaryPlus>(dst, src);
+        break;
+    case UnaryOp::Minus:
+        generator.emit<Bytecode::Op::UnaryMinus>(dst, src);
+        break;
+    case UnaryOp::Typeof:
+        generator.emit<Bytecode::Op::Typeof>(dst, src);
+        break;
+    case UnaryOp::Void:
+        generator.emit<Bytecode::Op::LoadConstant>(dst, generator.add_constant(js_undefined()));
+        break;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+    return dst;
+}
+
+Optional<Register> SequenceExpression::generate_bytecode(Generator& generator) const
+{
+    Optional<Register> last_value;
+    for (auto& expression : m_expressions)
+        last_value = generator.generate_expression(expression);
+    return last_value;
+}
+
+Optional<Register> BooleanLiteral::generate_bytecode(Generator& generator) const
+{
+    return generator.load_constant(Value(m_value));
+}
+
+Optional<Register> NumericLiteral::generate_bytecode(Generator& generator) const
+{
+    return generator.load_constant(Value(m_value));
+}
+
+Optional<Register> BigIntLiteral::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewBigInt>(dst, generator.add_string(m_value.substring(0, m_value.length() - 1)));
+    return dst;
+}
+
+Optional<Register> StringLiteral::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewString>(dst, generator.add_string(m_value));
+    return dst;
+}
+
+Optional<Register> NullLiteral::generate_bytecode(Generator& generator) const
+{
+    return generator.load_constant(js_null());
+}
+
+Optional<Register> RegExpLiteral::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewRegExp>(dst, generator.add_string(m_content), generator.add_string(m_flags));
+    return dst;
+}
+
+Optional<Register> Identifier::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::GetVariable>(dst, generator.add_identifier(m_string));
+    return dst;
+}
+
+Optional<Register> ThisExpression::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::LoadThis>(dst);
+    return dst;
+}
+
+Optional<Register> CallExpression::generate_bytecode(Generator& generator) const
+{
+    if (m_callee->is_super_expression()) {
+        generator.fail(*this);
+        return {};
+    }
+    for (auto& argument : m_arguments) {
+        if (argument.is_spread) {
+            generator.fail(*this);
+            return {};
+        }
+    }
+
+    Optional<Register> this_value;
+    Optional<Register> callee;
+    if (!is_new_expression() && m_callee->is_member_expression()) {
+        auto& member_expression = static_cast<const MemberExpression&>(*m_callee);
+        if (member_expression.object().is_super_expression()) {
+            generator.fail(*this);
+            return {};
+        }
+        auto base = generator.generate_expression(member_expression.object());
+        this_value = generator.allocate_register();
+        generator.emit<Bytecode::Op::ToObject>(*this_value, base);
+        callee = generator.allocate_register();
+        if (member_expression.is_computed()) {
+            auto property = generator.generate_expression(member_expression.property());
+            generator.emit<Bytecode::Op::GetByValue>(*callee, *this_value, property);
+        } else {
+            auto& name = static_cast<const Identifier&>(member_expression.property()).string();
+            generator.emit<Bytecode::Op::GetById>(*callee, *this_value, generator.add_identifier(name));
+        }
+    } else {
+        callee = generator.generate_expression(m_callee);
+    }
+
+    auto first_argument = generator.allocate_registers(m_arguments.size());
+    for (size_t i = 0; i < m_arguments.size(); ++i) {
+        auto value = generator.generate_expression(m_arguments[i].value);
+        generator.emit<Bytecode::Op::Move>(Register { first_argument.index() + static_cast<u32>(i) }, value);
+    }
+
+    // Used to describe the callee in the error thrown if it's not a function.
+    String callee_description;
+    if (m_callee->is_identifier())
+        callee_description = static_cast<const Identifier&>(*m_callee).string();
+    else if (m_callee->is_member_expression())
+        callee_description = static_cast<const MemberExpression&>(*m_callee).to_string_approximation();
+    else
+        callee_description = String::empty();
+    auto callee_description_index = generator.add_string(callee_description);
+
+    auto dst = generator.allocate_register();
+    if (is_new_expression())
+        generator.emit<Bytecode::Op::New>(dst, *callee, first_argument, m_arguments.size(), callee_description_index);
+    else
+        generator.emit<Bytecode::Op::Call>(dst, *callee, this_value, first_argument, m_arguments.size(), callee_description_index);
+    return dst;
+}
+
+namespace {
+
+// The target of an assignment or update expression. Its base and computed property
+// are evaluated once, and can then be read and written any number of times.
+class AssignmentTarget {
+public:
+    static Optional<AssignmentTarget> generate(Generator& generator, const Expression& expression)
+    {
+        if (expression.is_identifier()) {
+            auto& name = static_cast<const Identifier&>(expression).string();
+            return AssignmentTarget { Kind::Variable, generator.add_identifier(name), {}, {}, name };
+        }
+        if (expression.is_member_expression()) {
+            auto& member_expression = static_cast<const MemberExpression&>(expression);
+            if (!member_expression.object().is_super_expression()) {
+                auto base = generator.generate_expression(member_expression.object());
+                if (member_expression.is_computed()) {
+                    auto property = generator.generate_expression(member_expression.property());
+                    return AssignmentTarget { Kind::ComputedProperty, 0, base, property, {} };
+                }
+                auto& name = static_cast<const Identifier&>(member_expression.property()).string();
+                return AssignmentTarget { Kind::NamedProperty, generator.add_identifier(name), base, {}, name };
+            }
+        }
+        generator.fail(expression);
+        return {};
+    }
+
+    // Anonymous functions assigned to this target are named after it.
+    const FlyString& inferred_function_name() const { return m_name; }
+
+    void emit_load(Generator& generator, Register dst) const
+    {
+        switch (m_kind) {
+        case Kind::Variable:
+            generator.emit<Bytecode::Op::GetVariable>(dst, m_identifier_index);
+            break;
+        case Kind::NamedProperty:
+            generator.emit<Bytecode::Op::GetById>(dst, *m_base, m_identifier_index);
+            break;
+        case Kind::ComputedProperty:
+            generator.emit<Bytecode::Op::GetByValue>(dst, *m_base, *m_property);
+            break;
+        }
+    }
+
+    void emit_store(Generator& generator, Register src) const
+    {
+        switch (m_kind) {
+        case Kind::Variable:
+            generator.emit<Bytecode::Op::SetVariable>(m_identifier_index, src);
+            break;
+        case Kind::NamedProperty:
+            generator.emit<Bytecode::Op::PutById>(*m_base, m_identifier_index, src);
+            break;
+        case Kind::ComputedProperty:
+            generator.emit<Bytecode::Op::PutByValue>(*m_base, *m_property, src);
+            break;
+        }
+    }
+
+private:
+    enum class Kind {
+        Variable,
+        NamedProperty,
+        ComputedProperty,
+    };
+
+    AssignmentTarget(Kind kind, u32 identifier_index, Optional<Register> base, Optional<Register> property, FlyString name)
+        : m_kind(kind)
+        , m_identifier_index(identifier_index)
+        , m_base(base)
+        , m_property(property)
+        , m_name(move(name))
+    {
+    }
+
+    Kind m_kind;
+    u32 m_identifier_index { 0 };
+    Optional<Register> m_base;
+    Optional<Register> m_property;
+    FlyString m_name;
+};
+
+}
+
+Optional<Register> AssignmentExpression::generate_bytecode(Generator& generator) const
+{
+    auto target = AssignmentTarget::generate(generator, m_lhs);
+    if (!target.has_value())
+        return {};
+
+    if (m_op == AssignmentOp::Assignment) {
+        auto value = generator.generate_expression(m_rhs, target->inferred_function_name());
+        target->emit_store(generator, value);
+        return value;
+    }
+
+    auto dst = generator.allocate_register();
+    target->emit_load(generator, dst);
+
+    if (m_op == AssignmentOp::AndAssignment || m_op == AssignmentOp::OrAssignment || m_op == AssignmentOp::NullishAssignment) {
+        auto logical_op = m_op == AssignmentOp::AndAssignment ? LogicalOp::And : m_op == AssignmentOp::OrAssignment ? LogicalOp::Or : LogicalOp::NullishCoalescing;
+        auto jump_to_end = emit_short_circuit_jump(generator, logical_op, dst);
+        auto value = generator.generate_expression(m_rhs, target->inferred_function_name());
+        generator.emit<Bytecode::Op::Move>(dst, value);
+        target->emit_store(generator, dst);
+        generator.link_jump(jump_to_end, generator.make_label());
+        return dst;
+    }
+
+    auto rhs = generator.generate_expression(m_rhs);
+    switch (m_op) {
+    case AssignmentOp::AdditionAssignment:
+        generator.emit<Bytecode::Op::Add>(dst, dst, rhs);
+        break;
+    case AssignmentOp::SubtractionAssignment:
+        generator.emit<Bytecode::Op::Sub>(dst, dst, rhs);
+        break;
+    case AssignmentOp::MultiplicationAssignment:
+        generator.emit<Bytecode::Op::Mul>(dst, dst, rhs);
+        break;
+    case AssignmentOp::DivisionAssignment:
+        generator.emit<Bytecode::Op::Div>(dst, dst, rhs);
+        break;
+    case AssignmentOp::ModuloAssignment:
+        generator.emit<Bytecode::Op::Mod>(dst, dst, rhs);
+        break;
+    case AssignmentOp::ExponentiationAssignment:
+        generator.emit<Bytecode::Op::Exp>(dst, dst, rhs);
+        break;
+    case AssignmentOp::BitwiseAndAssignment:
+        generator.emit<Bytecode::Op::BitwiseAnd>(dst, dst, rhs);
+        break;
+    case AssignmentOp::BitwiseOrAssignment:
+        generator.emit<Bytecode::Op::BitwiseOr>(dst, dst, rhs);
+        break;
+    case AssignmentOp::BitwiseXorAssignment:
+        generator.emit<Bytecode::Op::BitwiseXor>(dst, dst, rhs);
+        break;
+    case AssignmentOp::LeftShiftAssignment:
+        generator.emit<Bytecode::Op::LeftShift>(dst, dst, rhs);
+        break;
+    case AssignmentOp::RightShiftAssignment:
+        generator.emit<Bytecode::Op::RightShift>(dst, dst, rhs);
+        break;
+    case AssignmentOp::UnsignedRightShiftAssignment:
+        generator.emit<Bytecode::Op::UnsignedRightShift>(dst, dst, rhs);
+        break;
+    default:
+        ASSERT_NOT_REACHED();
+    }
+    target->emit_store(generator, dst);
+    return dst;
+}
+
+Optional<Register> UpdateExpression::generate_bytecode(Generator& generator) const
+{
+    auto target = AssignmentTarget::generate(generator, m_argument);
+    if (!target.has_value())
+        return {};
+
+    auto old_value = generator.allocate_register();
+    target->emit_load(generator, old_value);
+    generator.emit<Bytecode::Op::ToNumeric>(old_value, old_value);
+
+    auto new_value = generator.allocate_register();
+    if (m_op == UpdateOp::Increment)
+        generator.emit<Bytecode::Op::Increment>(new_value, old_value);
+    else
+        generator.emit<Bytecode::Op::Decrement>(new_value, old_value);
+    target->emit_store(generator, new_value);
+
+    return m_prefixed ? new_value : old_value;
+}
+
+Optional<Register> VariableDeclaration::generate_bytecode(Generator& generator) const
+{
+    for (auto& declarator : m_declarations) {
+        if (!declarator.init())
+            continue;
+        auto& name = declarator.id().string();
+        auto value = generator.generate_expression(*declarator.init(), name);
+        generator.emit<Bytecode::Op::SetVariable>(generator.add_identifier(name), value, true);
+    }
+    return {};
+}
+
+Optional<Register> ObjectExpression::generate_bytecode(Generator& generator) const
+{
+    auto object = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewObject>(object);
+    for (auto& property : m_properties) {
+        if (property.type() != ObjectProperty::Type::KeyValue || property.is_method()) {
+            generator.fail(property);
+            return {};
+        }
+        auto key = generator.generate_expression(property.key());
+        FlyString inferred_function_name;
+        if (property.key().is_string_literal())
+            inferred_function_name = static_cast<const StringLiteral&>(property.key()).value();
+        auto value = generator.generate_expression(property.value(), inferred_function_name);
+        generator.emit<Bytecode::Op::DefineProperty>(object, key, value);
+    }
+    return object;
+}
+
+Optional<Register> ArrayExpression::generate_bytecode(Generator& generator) const
+{
+    for (auto& element : m_elements) {
+        if (element && element->is_spread_expression()) {
+            generator.fail(*element);
+            return {};
+        }
+    }
+
+    // Like the AST interpreter, anonymous functions in an array are named after the array's target.
+    FlyString inferred_function_name = generator.inferred_function_name();
+
+    auto first_element = generator.allocate_registers(m_elements.size());
+    for (size_t i = 0; i < m_elements.size(); ++i) {
+        Register element_register { first_element.index() + static_cast<u32>(i) };
+        if (m_elements[i]) {
+            auto value = generator.generate_expression(*m_elements[i], inferred_function_name);
+            generator.emit<Bytecode::Op::Move>(element_register, value);
+        } else {
+            // Holes are represented by empty values, just like in the AST interpreter.
+            generator.emit<Bytecode::Op::LoadConstant>(element_register, generator.add_constant({}));
+        }
+    }
+
+    auto dst = generator.allocate_register();
+    generator.emit<Bytecode::Op::NewArray>(dst, first_element, m_elements.size());
+    return dst;
+}
+
+Optional<Register> TemplateLiteral::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    if (m_expressions.is_empty()) {
+        generator.emit<Bytecode::Op::NewString>(dst, generator.add_string(String::empty()));
+        return dst;
+    }
+    for (size_t i = 0; i < m_expressions.size(); ++i) {
+        auto value = generator.generate_expression(m_expressions[i]);
+        if (i == 0) {
+            generator.emit<Bytecode::Op::ToString>(dst, value);
+            continue;
+        }
+        auto string = generator.allocate_register();
+        generator.emit<Bytecode::Op::ToString>(string, value);
+        generator.emit<Bytecode::Op::Add>(dst, dst, string);
+    }
+    return dst;
+}
+
+Optional<Register> MemberExpression::generate_bytecode(Generator& generator) const
+{
+    if (m_object->is_super_expression()) {
+        generator.fail(*this);
+        return {};
+    }
+    auto base = generator.generate_expression(m_object);
+    auto dst = generator.allocate_register();
+    if (m_computed) {
+        auto property = generator.generate_expression(m_property);
+        generator.emit<Bytecode::Op::GetByValue>(dst, base, property);
+    } else {
+        auto& name = static_cast<const Identifier&>(*m_property).string();
+        generator.emit<Bytecode::Op::GetById>(dst, base, generator.add_identifier(name));
+    }
+    return dst;
+}
+
+Optional<Register> ConditionalExpression::generate_bytecode(Generator& generator) const
+{
+    auto dst = generator.allocate_register();
+    auto test = generator.generate_expression(m_test);
+    auto jump_to_alternate = generator.emit<Bytecode::Op::JumpIfFalse>(test);
+    auto consequent = generator.generate_expression(m_consequent);
+    generator.emit<Bytecode::Op::Move>(dst, consequent);
+    auto jump_to_end = generator.emit<Bytecode::Op::Jump>();
+    generator.link_jump(jump_to_alternate, generator.make_label());
+    auto alternate = generator.generate_expression(m_alternate);
+    generator.emit<Bytecode::Op::Move>(dst, alternate);
+    generator.link_jump(jump_to_end, generator.make_label());
+    return dst;
+}
+
+Optional<Register> ThrowStatement::generate_bytecode(Generator& generator) const
+{
+    auto value = generator.generate_expression(m_argument);
+    generator.emit<Bytecode::Op::Throw>(value);
+    return {};
+}
+
+Optional<Register> SwitchStatement::generate_bytecode(Generator& generator) const
+{
+    auto discriminant = generator.generate_expression(m_discriminant);
+    generator.begin_breakable_scope(m_label, false);
+
+    Vector<size_t> jumps_to_cases;
+    for (auto& switch_case : m_cases) {
+        if (!switch_case.test()) {
+            // Like the AST interpreter, we take the default clause as soon as we reach it.
+            jumps_to_cases.append(generator.emit<Bytecode::Op::Jump>());
+            continue;
+        }
+        auto test = generator.generate_expression(*switch_case.test());
+        auto is_match = generator.allocate_register();
+        generator.emit<Bytecode::Op::TypedEquals>(is_match, discriminant, test);
+        jumps_to_cases.append(generator.emit<Bytecode::Op::JumpIfTrue>(is_match));
+    }
+    auto jump_to_end = generator.emit<Bytecode::Op::Jump>();
+
+    for (size_t i = 0; i < m_cases.size(); ++i) {
+        generator.link_jump(jumps_to_cases[i], generator.make_label());
+        for (auto& statement : m_cases[i].consequent())
+            generator.generate_statement(statement);
+    }
+
+    auto end_label = generator.make_label();
+    generator.link_jump(jump_to_end, end_label);
+    generator.end_breakable_scope(end_label);
+    return {};
+}
+
+Optional<Register> BreakStatement::generate_bytecode(Generator& generator) const
+{
+    generator.generate_break(m_target_label);
+    return {};
+}
+
+Optional<Register> ContinueStatement::generate_bytecode(Generator& generator) const
+{
+    generator.generate_continue(m_target_label);
+    return {};
+}
+
+Optional<Register> DebuggerStatement::generate_bytecode(Generator&) const
+{
+    return {};
+}
+
+}
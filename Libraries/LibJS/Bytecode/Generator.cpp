@@ -0,0 +1,248 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Generator.h>
+#include <LibJS/Bytecode/Op.h>
+
+//#define BYTECODE_DEBUG
+
+namespace JS::Bytecode {
+
+Generator::Generator()
+    : m_executable(make<Executable>())
+{
+}
+
+OwnPtr<Executable> Generator::generate(const ScopeNode& node)
+{
+    Generator generator;
+    if (node.is_program())
+        generator.generate_program(static_cast<const Program&>(node));
+    else
+        generator.generate_function_body(node);
+
+    if (generator.has_failed())
+        return nullptr;
+    return move(generator.m_executable);
+}
+
+void Generator::generate_program(const Program& program)
+{
+    // The completion value of the program is the value of the last expression statement that was executed.
+    auto completion = load_constant(js_undefined());
+    bool did_enter_scope = enter_scope(program, ScopeType::Block);
+    for (auto& child : program.children()) {
+        if (m_has_failed)
+            return;
+        if (child.is_expression_statement()) {
+            auto saved_next_register = m_next_register;
+            auto value = generate_expression(static_cast<const ExpressionStatement&>(child).expression());
+            emit<Op::Move>(completion, value);
+            m_next_register = saved_next_register;
+        } else {
+            generate_statement(child);
+            emit<Op::LoadConstant>(completion, add_constant(js_undefined()));
+        }
+    }
+    if (did_enter_scope)
+        exit_scope(program);
+    emit<Op::Return>(completion);
+}
+
+void Generator::generate_function_body(const ScopeNode& body)
+{
+    bool did_enter_scope = enter_scope(body, ScopeType::Function);
+    for (auto& child : body.children())
+        generate_statement(child);
+    if (did_enter_scope)
+        exit_scope(body);
+    emit<Op::Return>(load_constant(js_undefined()));
+}
+
+Register Generator::allocate_register()
+{
+    return allocate_registers(1);
+}
+
+Register Generator::allocate_registers(u32 count)
+{
+    Register first { m_next_register };
+    m_next_register += count;
+    m_executable->number_of_registers = max(m_executable->number_of_registers, m_next_register);
+    return first;
+}
+
+Register Generator::generate_expression(const Expression& expression, const FlyString& inferred_function_name)
+{
+    m_inferred_function_name = inferred_function_name;
+    auto result = expression.generate_bytecode(*this);
+    m_inferred_function_name = {};
+    if (!result.has_value()) {
+        // Expressions always produce a value, so this only happens if code generation failed.
+        ASSERT(m_has_failed);
+        return allocate_register();
+    }
+    return result.value();
+}
+
+void Generator::generate_statement(const Statement& statement)
+{
+    if (m_has_failed)
+        return;
+    // Nothing a statement leaves in registers is needed afterwards, so its registers can be reused.
+    auto saved_next_register = m_next_register;
+    (void)statement.generate_bytecode(*this);
+    m_next_register = saved_next_register;
+}
+
+void Generator::link_jump(size_t jump_offset, Label target)
+{
+    auto* jump = reinterpret_cast<Op::JumpInstruction*>(m_executable->bytecode.data() + jump_offset);
+    jump->set_target(target);
+}
+
+Register Generator::load_constant(Value value)
+{
+    auto dst = allocate_register();
+    emit<Op::LoadConstant>(dst, add_constant(value));
+    return dst;
+}
+
+u32 Generator::add_constant(Value value)
+{
+    ASSERT(!value.is_cell());
+    m_executable->constants.append(value);
+    return m_executable->constants.size() - 1;
+}
+
+u32 Generator::add_string(const String& string)
+{
+    if (auto it = m_string_indices.find(string); it != m_string_indices.end())
+        return it->value;
+    u32 index = m_executable->strings.size();
+    m_executable->strings.append(string);
+    m_string_indices.set(string, index);
+    return index;
+}
+
+u32 Generator::add_identifier(const FlyString& identifier)
+{
+    if (auto it = m_identifier_indices.find(identifier); it != m_identifier_indices.end())
+        return it->value;
+    u32 index = m_executable->identifiers.size();
+    m_executable->identifiers.append(identifier);
+    m_identifier_indices.set(identifier, index);
+    return index;
+}
+
+void Generator::adopt_synthesized_scope_node(NonnullRefPtr<ScopeNode> scope_node)
+{
+    m_executable->synthesized_scope_nodes.append(move(scope_node));
+}
+
+bool Generator::enter_scope(const ScopeNode& scope_node, ScopeType scope_type)
+{
+    // Entering a scope that doesn't declare anything has no observable effect.
+    if (scope_node.functions().is_empty() && (scope_type == ScopeType::Function || scope_node.variables().is_empty()))
+        return false;
+    emit<Op::EnterScope>(scope_node, scope_type);
+    m_lexical_scopes.append(&scope_node);
+    return true;
+}
+
+void Generator::exit_scope(const ScopeNode& scope_node)
+{
+    ASSERT(!m_lexical_scopes.is_empty() && m_lexical_scopes.last() == &scope_node);
+    emit<Op::ExitScope>(scope_node);
+    m_lexical_scopes.take_last();
+}
+
+void Generator::begin_breakable_scope(const FlyString& label, bool is_continuable)
+{
+    m_breakable_scopes.append({ label, is_continuable, m_lexical_scopes.size(), {}, {} });
+}
+
+void Generator::end_breakable_scope(Label break_target, Label continue_target)
+{
+    auto scope = m_breakable_scopes.take_last();
+    for (auto jump : scope.break_jumps)
+        link_jump(jump, break_target);
+    for (auto jump : scope.continue_jumps)
+        link_jump(jump, continue_target);
+}
+
+Generator::BreakableScope* Generator::find_breakable_scope(const FlyString& target_label, bool must_be_continuable)
+{
+    for (ssize_t i = m_breakable_scopes.size() - 1; i >= 0; --i) {
+        auto& scope = m_breakable_scopes[i];
+        if (must_be_continuable && !scope.is_continuable)
+            continue;
+        if (target_label.is_null() || target_label == scope.label)
+            return &scope;
+    }
+    return nullptr;
+}
+
+void Generator::exit_lexical_scopes_for(const BreakableScope& scope)
+{
+    if (m_lexical_scopes.size() > scope.lexical_scope_depth)
+        emit<Op::ExitScope>(*m_lexical_scopes[scope.lexical_scope_depth]);
+}
+
+void Generator::generate_break(const FlyString& target_label)
+{
+    auto* scope = find_breakable_scope(target_label, false);
+    if (!scope) {
+        m_has_failed = true;
+        return;
+    }
+    exit_lexical_scopes_for(*scope);
+    scope->break_jumps.append(emit<Op::Jump>());
+}
+
+void Generator::generate_continue(const FlyString& target_label)
+{
+    auto* scope = find_breakable_scope(target_label, true);
+    if (!scope) {
+        m_has_failed = true;
+        return;
+    }
+    exit_lexical_scopes_for(*scope);
+    scope->continue_jumps.append(emit<Op::Jump>());
+}
+
+void Generator::fail(const ASTNode& node)
+{
+#ifdef BYTECODE_DEBUG
+    dbgln("Bytecode::Generator: Can't generate code for {}", node.class_name());
+#else
+    (void)node;
+#endif
+    m_has_failed = true;
+}
+
+}
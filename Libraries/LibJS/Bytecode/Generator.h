@@ -0,0 +1,122 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/FlyString.h>
+#include <AK/HashMap.h>
+#include <AK/OwnPtr.h>
+#include <AK/String.h>
+#include <AK/Vector.h>
+#include <LibJS/Bytecode/Executable.h>
+#include <LibJS/Bytecode/Label.h>
+#include <LibJS/Bytecode/Op.h>
+#include <LibJS/Bytecode/Register.h>
+#include <LibJS/Forward.h>
+
+namespace JS::Bytecode {
+
+class Generator {
+public:
+    // Compiles a program, or the body of a function. Returns nullptr if the node contains
+    // anything the generator doesn't support yet, in which case the AST interpreter has to be used.
+    static OwnPtr<Executable> generate(const ScopeNode&);
+
+    Register allocate_register();
+
+    // Allocates count registers with consecutive indices, e.g. for call arguments.
+    Register allocate_registers(u32 count);
+
+    // The inferred name is given to an anonymous function expression, e.g. in "var f = function() {}".
+    Register generate_expression(const Expression&, const FlyString& inferred_function_name = {});
+    void generate_statement(const Statement&);
+    const FlyString& inferred_function_name() const { return m_inferred_function_name; }
+
+    template<typename OpType, typename... Args>
+    size_t emit(Args&&... args)
+    {
+        static_assert(sizeof(OpType) % alignof(Instruction) == 0);
+        size_t offset = m_executable->bytecode.size();
+        m_executable->bytecode.resize(offset + sizeof(OpType));
+        new (m_executable->bytecode.data() + offset) OpType(forward<Args>(args)...);
+        return offset;
+    }
+
+    Label make_label() const { return Label { m_executable->bytecode.size() }; }
+    void link_jump(size_t jump_offset, Label target);
+
+    Register load_constant(Value);
+
+    u32 add_constant(Value);
+    u32 add_string(const String&);
+    u32 add_identifier(const FlyString&);
+
+    void adopt_synthesized_scope_node(NonnullRefPtr<ScopeNode>);
+
+    // Only scopes that declare something are actually entered, see enter_scope().
+    bool enter_scope(const ScopeNode&, ScopeType);
+    void exit_scope(const ScopeNode&);
+
+    void begin_breakable_scope(const FlyString& label, bool is_continuable);
+    void end_breakable_scope(Label break_target, Label continue_target = {});
+
+    void generate_break(const FlyString& target_label);
+    void generate_continue(const FlyString& target_label);
+
+    void fail(const ASTNode&);
+    bool has_failed() const { return m_has_failed; }
+
+private:
+    Generator();
+
+    void generate_program(const Program&);
+    void generate_function_body(const ScopeNode&);
+
+    struct BreakableScope {
+        FlyString label;
+        bool is_continuable { false };
+        size_t lexical_scope_depth { 0 };
+        Vector<size_t> break_jumps;
+        Vector<size_t> continue_jumps;
+    };
+    BreakableScope* find_breakable_scope(const FlyString& target_label, bool must_be_continuable);
+    void exit_lexical_scopes_for(const BreakableScope&);
+
+    OwnPtr<Executable> m_executable;
+    u32 m_next_register { 0 };
+
+    HashMap<String, u32> m_string_indices;
+    HashMap<FlyString, u32> m_identifier_indices;
+
+    Vector<const ScopeNode*> m_lexical_scopes;
+    Vector<BreakableScope> m_breakable_scopes;
+
+    FlyString m_inferred_function_name;
+
+    bool m_has_failed { false };
+};
+
+}
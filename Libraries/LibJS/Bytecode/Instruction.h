@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Forward.h>
+#include <AK/Types.h>
+#include <LibJS/Forward.h>
+
+#define JS_ENUMERATE_BYTECODE_BINARY_OPS(O)     \
+    O(Add, add)                                 \
+    O(Sub, sub)                                 \
+    O(Mul, mul)                                 \
+    O(Div, div)                                 \
+    O(Mod, mod)                                 \
+    O(Exp, exp)                                 \
+    O(TypedEquals, typed_equals)                \
+    O(TypedInequals, typed_inequals)            \
+    O(AbstractEquals, abstract_equals)          \
+    O(AbstractInequals, abstract_inequals)      \
+    O(GreaterThan, greater_than)                \
+    O(GreaterThanEquals, greater_than_equals)   \
+    O(LessThan, less_than)                      \
+    O(LessThanEquals, less_than_equals)         \
+    O(BitwiseAnd, bitwise_and)                  \
+    O(BitwiseOr, bitwise_or)                    \
+    O(BitwiseXor, bitwise_xor)                  \
+    O(LeftShift, left_shift)                    \
+    O(RightShift, right_shift)                  \
+    O(UnsignedRightShift, unsigned_right_shift) \
+    O(In, in)                                   \
+    O(InstanceOf, instance_of)
+
+#define JS_ENUMERATE_BYTECODE_UNARY_OPS(O) \
+    O(BitwiseNot, bitwise_not)             \
+    O(Not, not_)                           \
+    O(UnaryPlus, unary_plus)               \
+    O(UnaryMinus, unary_minus)             \
+    O(Typeof, typeof_)                     \
+    O(ToNumeric, value_to_numeric)         \
+    O(ToObject, value_to_object)           \
+    O(ToString, value_to_string)           \
+    O(Increment, increment)                \
+    O(Decrement, decrement)
+
+#define JS_ENUMERATE_BYTECODE_OPS(O) \
+    O(LoadConstant)                  \
+    O(NewString)                     \
+    O(NewBigInt)                     \
+    O(NewRegExp)                     \
+    O(NewObject)                     \
+    O(NewArray)                      \
+    O(NewFunction)                   \
+    O(Move)                          \
+    O(LoadThis)                      \
+    O(GetVariable)                   \
+    O(TypeofVariable)                \
+    O(SetVariable)                   \
+    O(GetById)                       \
+    O(GetByValue)                    \
+    O(PutById)                       \
+    O(PutByValue)                    \
+    O(DefineProperty)                \
+    O(Jump)                          \
+    O(JumpIfTrue)                    \
+    O(JumpIfFalse)                   \
+    O(JumpIfNotNullish)              \
+    O(Call)                          \
+    O(New)                           \
+    O(Throw)                         \
+    O(Return)                        \
+    O(EnterScope)                    \
+    O(ExitScope)
+
+namespace JS::Bytecode {
+
+// Instructions are laid out back to back in an executable's bytecode, so they must
+// not have a vtable. Dispatch happens on type() in Bytecode::Interpreter instead.
+class alignas(alignof(void*)) Instruction {
+public:
+    enum class Type : u8 {
+#define __BYTECODE_OP(op) op,
+#define __BYTECODE_BINARY_OR_UNARY_OP(op, _) op,
+        JS_ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+            JS_ENUMERATE_BYTECODE_BINARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+                JS_ENUMERATE_BYTECODE_UNARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+#undef __BYTECODE_OP
+#undef __BYTECODE_BINARY_OR_UNARY_OP
+    };
+
+    Type type() const { return m_type; }
+    size_t length() const;
+    String to_string(const Executable&) const;
+
+protected:
+    explicit Instruction(Type type)
+        : m_type(type)
+    {
+    }
+
+private:
+    Type m_type;
+};
+
+}
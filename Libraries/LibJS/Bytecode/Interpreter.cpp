@@ -0,0 +1,105 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Executable.h>
+#include <LibJS/Bytecode/Instruction.h>
+#include <LibJS/Bytecode/Interpreter.h>
+#include <LibJS/Bytecode/Op.h>
+#include <LibJS/Interpreter.h>
+
+namespace JS::Bytecode {
+
+Interpreter::Interpreter(JS::Interpreter& interpreter, GlobalObject& global_object, const Executable& executable)
+    : m_interpreter(interpreter)
+    , m_vm(interpreter.vm())
+    , m_global_object(global_object)
+    , m_executable(executable)
+    , m_registers(interpreter.heap())
+    , m_return_value(js_undefined())
+{
+    m_registers.resize(executable.number_of_registers);
+}
+
+Value Interpreter::run()
+{
+    auto* bytecode = m_executable.bytecode.data();
+    auto bytecode_size = m_executable.bytecode.size();
+
+    while (m_pc < bytecode_size) {
+        auto& instruction = *reinterpret_cast<const Instruction*>(bytecode + m_pc);
+        // The program counter is advanced before executing, so jumps can simply overwrite it.
+        switch (instruction.type()) {
+#define __BYTECODE_OP(op)                                       \
+    case Instruction::Type::op:                                 \
+        m_pc += sizeof(Op::op);                                 \
+        static_cast<const Op::op&>(instruction).execute(*this); \
+        break;
+#define __BYTECODE_BINARY_OR_UNARY_OP(op, _) __BYTECODE_OP(op)
+            JS_ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+            JS_ENUMERATE_BYTECODE_BINARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+            JS_ENUMERATE_BYTECODE_UNARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+#undef __BYTECODE_OP
+#undef __BYTECODE_BINARY_OR_UNARY_OP
+        }
+        if (m_did_return || m_vm.exception())
+            break;
+    }
+
+    // There's no try/catch in bytecode yet, so an exception leaves every scope we entered.
+    if (!m_entered_scopes.is_empty())
+        exit_scope(*m_entered_scopes.first());
+
+    if (m_vm.exception())
+        return {};
+    return m_return_value;
+}
+
+void Interpreter::do_return(Value value)
+{
+    m_return_value = value;
+    m_did_return = true;
+}
+
+void Interpreter::enter_scope(const ScopeNode& scope_node, ScopeType scope_type)
+{
+    m_interpreter.enter_scope(scope_node, scope_type, m_global_object);
+    // If hoisting a declaration threw, the scope was never pushed.
+    if (m_vm.exception())
+        return;
+    m_entered_scopes.append(&scope_node);
+}
+
+void Interpreter::exit_scope(const ScopeNode& scope_node)
+{
+    m_interpreter.exit_scope(scope_node);
+    while (!m_entered_scopes.is_empty()) {
+        if (m_entered_scopes.take_last() == &scope_node)
+            break;
+    }
+}
+
+}
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Vector.h>
+#include <LibJS/Bytecode/Label.h>
+#include <LibJS/Bytecode/Register.h>
+#include <LibJS/Forward.h>
+#include <LibJS/Runtime/MarkedValueList.h>
+#include <LibJS/Runtime/VM.h>
+
+namespace JS::Bytecode {
+
+// Runs a single executable, i.e. one program or one function call. Each run has its own registers.
+class Interpreter {
+public:
+    Interpreter(JS::Interpreter&, GlobalObject&, const Executable&);
+
+    // Returns the value passed to the Return op, or an empty value if an exception was thrown.
+    Value run();
+
+    VM& vm() { return m_vm; }
+    GlobalObject& global_object() { return m_global_object; }
+    const Executable& executable() const { return m_executable; }
+
+    Value& reg(Register reg) { return m_registers[reg.index()]; }
+
+    void jump(Label target) { m_pc = target.address(); }
+    void do_return(Value);
+
+    void enter_scope(const ScopeNode&, ScopeType);
+    void exit_scope(const ScopeNode&);
+
+private:
+    JS::Interpreter& m_interpreter;
+    VM& m_vm;
+    GlobalObject& m_global_object;
+    const Executable& m_executable;
+
+    MarkedValueList m_registers;
+    size_t m_pc { 0 };
+
+    Vector<const ScopeNode*> m_entered_scopes;
+
+    Value m_return_value;
+    bool m_did_return { false };
+};
+
+}
@@ -0,0 +1,571 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <LibCrypto/BigInt/SignedBigInteger.h>
+#include <LibJS/AST.h>
+#include <LibJS/Bytecode/Executable.h>
+#include <LibJS/Bytecode/Interpreter.h>
+#include <LibJS/Bytecode/Op.h>
+#include <LibJS/Runtime/Array.h>
+#include <LibJS/Runtime/BigInt.h>
+#include <LibJS/Runtime/Error.h>
+#include <LibJS/Runtime/GlobalObject.h>
+#include <LibJS/Runtime/MarkedValueList.h>
+#include <LibJS/Runtime/NativeFunction.h>
+#include <LibJS/Runtime/RegExpObject.h>
+#include <LibJS/Runtime/ScriptFunction.h>
+
+namespace JS::Bytecode {
+
+size_t Instruction::length() const
+{
+    switch (type()) {
+#define __BYTECODE_OP(op)      \
+    case Type::op:             \
+        return sizeof(Op::op);
+#define __BYTECODE_BINARY_OR_UNARY_OP(op, _) __BYTECODE_OP(op)
+        JS_ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+        JS_ENUMERATE_BYTECODE_BINARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+        JS_ENUMERATE_BYTECODE_UNARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+#undef __BYTECODE_OP
+#undef __BYTECODE_BINARY_OR_UNARY_OP
+    }
+    ASSERT_NOT_REACHED();
+}
+
+String Instruction::to_string(const Executable& executable) const
+{
+    switch (type()) {
+#define __BYTECODE_OP(op)                                               \
+    case Type::op:                                                      \
+        return static_cast<const Op::op&>(*this).to_string(executable);
+#define __BYTECODE_BINARY_OR_UNARY_OP(op, _) __BYTECODE_OP(op)
+        JS_ENUMERATE_BYTECODE_OPS(__BYTECODE_OP)
+        JS_ENUMERATE_BYTECODE_BINARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+        JS_ENUMERATE_BYTECODE_UNARY_OPS(__BYTECODE_BINARY_OR_UNARY_OP)
+#undef __BYTECODE_OP
+#undef __BYTECODE_BINARY_OR_UNARY_OP
+    }
+    ASSERT_NOT_REACHED();
+}
+
+}
+
+namespace JS::Bytecode::Op {
+
+static Value typed_equals(GlobalObject&, Value lhs, Value rhs)
+{
+    return Value(strict_eq(lhs, rhs));
+}
+
+static Value typed_inequals(GlobalObject&, Value lhs, Value rhs)
+{
+    return Value(!strict_eq(lhs, rhs));
+}
+
+static Value abstract_equals(GlobalObject& global_object, Value lhs, Value rhs)
+{
+    return Value(abstract_eq(global_object, lhs, rhs));
+}
+
+static Value abstract_inequals(GlobalObject& global_object, Value lhs, Value rhs)
+{
+    return Value(!abstract_eq(global_object, lhs, rhs));
+}
+
+static Value not_(GlobalObject&, Value value)
+{
+    return Value(!value.to_boolean());
+}
+
+static Value typeof_(GlobalObject& global_object, Value value)
+{
+    auto& vm = global_object.vm();
+    switch (value.type()) {
+    case Value::Type::Undefined:
+        return js_string(vm, "undefined");
+    case Value::Type::Null:
+        return js_string(vm, "object");
+    case Value::Type::Number:
+        return js_string(vm, "number");
+    case Value::Type::String:
+        return js_string(vm, "string");
+    case Value::Type::Object:
+        if (value.is_function())
+            return js_string(vm, "function");
+        return js_string(vm, "object");
+    case Value::Type::Boolean:
+        return js_string(vm, "boolean");
+    case Value::Type::Symbol:
+        return js_string(vm, "symbol");
+    case Value::Type::BigInt:
+        return js_string(vm, "bigint");
+    default:
+        ASSERT_NOT_REACHED();
+    }
+}
+
+static Value value_to_numeric(GlobalObject& global_object, Value value)
+{
+    return value.to_numeric(global_object);
+}
+
+static Value value_to_object(GlobalObject& global_object, Value value)
+{
+    auto* object = value.to_object(global_object);
+    if (!object)
+        return {};
+    return object;
+}
+
+static Value value_to_string(GlobalObject& global_object, Value value)
+{
+    auto string = value.to_string(global_object);
+    if (global_object.vm().exception())
+        return {};
+    return js_string(global_object.vm(), string);
+}
+
+// The operand has already been converted with ToNumeric.
+static Value increment(GlobalObject& global_object, Value value)
+{
+    if (value.is_number())
+        return Value(value.as_double() + 1);
+    return js_bigint(global_object.heap(), value.as_bigint().big_integer().plus(Crypto::SignedBigInteger { 1 }));
+}
+
+static Value decrement(GlobalObject& global_object, Value value)
+{
+    if (value.is_number())
+        return Value(value.as_double() - 1);
+    return js_bigint(global_object.heap(), value.as_bigint().big_integer().minus(Crypto::SignedBigInteger { 1 }));
+}
+
+static void put(Bytecode::Interpreter& interpreter, Value base, const PropertyName& property_name, Value value)
+{
+    auto& vm = interpreter.vm();
+    auto& global_object = interpreter.global_object();
+    if (!base.is_object() && vm.in_strict_mode()) {
+        vm.throw_exception<TypeError>(global_object, ErrorType::ReferencePrimitiveAssignment, property_name.to_value(vm).to_string_without_side_effects());
+        return;
+    }
+    auto* object = base.to_object(global_object);
+    if (!object)
+        return;
+    object->put(property_name, value);
+}
+
+static void throw_not_a_function_error(Bytecode::Interpreter& interpreter, Value callee, const char* call_type, u32 callee_description_index)
+{
+    auto& vm = interpreter.vm();
+    auto& global_object = interpreter.global_object();
+    auto& callee_description = interpreter.executable().strings[callee_description_index];
+    if (callee_description.is_empty())
+        vm.throw_exception<TypeError>(global_object, ErrorType::IsNotA, callee.to_string_without_side_effects(), call_type);
+    else
+        vm.throw_exception<TypeError>(global_object, ErrorType::IsNotAEvaluatedFrom, callee.to_string_without_side_effects(), call_type, callee_description);
+}
+
+static void collect_arguments(Bytecode::Interpreter& interpreter, MarkedValueList& arguments, Register first_argument, u32 argument_count)
+{
+    arguments.ensure_capacity(argument_count);
+    for (u32 i = 0; i < argument_count; ++i)
+        arguments.append(interpreter.reg(Register { first_argument.index() + i }));
+}
+
+static String format_register_range(Register first, u32 count)
+{
+    if (count == 0)
+        return "[]";
+    return String::formatted("[{}..${}]", first.to_string(), first.index() + count - 1);
+}
+
+void LoadConstant::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = interpreter.executable().constants[m_constant_index];
+}
+
+String LoadConstant::to_string(const Executable& executable) const
+{
+    auto& constant = executable.constants[m_constant_index];
+    return String::formatted("LoadConstant {}, {}", m_dst.to_string(), constant.is_empty() ? "<empty>" : constant.to_string_without_side_effects());
+}
+
+void NewString::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = js_string(interpreter.vm(), interpreter.executable().strings[m_string_index]);
+}
+
+String NewString::to_string(const Executable& executable) const
+{
+    return String::formatted("NewString {}, \"{}\"", m_dst.to_string(), executable.strings[m_string_index]);
+}
+
+void NewBigInt::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& digits = interpreter.executable().strings[m_string_index];
+    interpreter.reg(m_dst) = js_bigint(interpreter.vm().heap(), Crypto::SignedBigInteger::from_base10(digits));
+}
+
+String NewBigInt::to_string(const Executable& executable) const
+{
+    return String::formatted("NewBigInt {}, {}n", m_dst.to_string(), executable.strings[m_string_index]);
+}
+
+void NewRegExp::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& executable = interpreter.executable();
+    interpreter.reg(m_dst) = RegExpObject::create(interpreter.global_object(), executable.strings[m_pattern_index], executable.strings[m_flags_index]);
+}
+
+String NewRegExp::to_string(const Executable& executable) const
+{
+    return String::formatted("NewRegExp {}, /{}/{}", m_dst.to_string(), executable.strings[m_pattern_index], executable.strings[m_flags_index]);
+}
+
+void NewObject::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = Object::create_empty(interpreter.global_object());
+}
+
+String NewObject::to_string(const Executable&) const
+{
+    return String::formatted("NewObject {}", m_dst.to_string());
+}
+
+void NewArray::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto* array = Array::create(interpreter.global_object());
+    for (u32 i = 0; i < m_element_count; ++i)
+        array->indexed_properties().append(interpreter.reg(Register { m_first_element.index() + i }));
+    interpreter.reg(m_dst) = array;
+}
+
+String NewArray::to_string(const Executable&) const
+{
+    return String::formatted("NewArray {}, {}", m_dst.to_string(), format_register_range(m_first_element, m_element_count));
+}
+
+void NewFunction::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto& name = interpreter.executable().identifiers[m_name_index];
+    interpreter.reg(m_dst) = ScriptFunction::create(
+        interpreter.global_object(),
+        name,
+        m_function_node.body(),
+        m_function_node.parameters(),
+        m_function_node.function_length(),
+        vm.current_scope(),
+        m_function_node.is_strict_mode() || vm.in_strict_mode(),
+        m_function_node.is_arrow_function());
+}
+
+String NewFunction::to_string(const Executable& executable) const
+{
+    return String::formatted("NewFunction {}, \"{}\"", m_dst.to_string(), executable.identifiers[m_name_index]);
+}
+
+void Move::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = interpreter.reg(m_src);
+}
+
+String Move::to_string(const Executable&) const
+{
+    return String::formatted("Move {}, {}", m_dst.to_string(), m_src.to_string());
+}
+
+void LoadThis::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.reg(m_dst) = interpreter.vm().resolve_this_binding(interpreter.global_object());
+}
+
+String LoadThis::to_string(const Executable&) const
+{
+    return String::formatted("LoadThis {}", m_dst.to_string());
+}
+
+void GetVariable::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto& name = interpreter.executable().identifiers[m_identifier_index];
+    auto value = vm.get_variable(name, interpreter.global_object());
+    if (value.is_empty()) {
+        vm.throw_exception<ReferenceError>(interpreter.global_object(), ErrorType::UnknownIdentifier, name);
+        return;
+    }
+    interpreter.reg(m_dst) = value;
+}
+
+String GetVariable::to_string(const Executable& executable) const
+{
+    return String::formatted("GetVariable {}, {}", m_dst.to_string(), executable.identifiers[m_identifier_index]);
+}
+
+void TypeofVariable::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& name = interpreter.executable().identifiers[m_identifier_index];
+    auto value = interpreter.vm().get_variable(name, interpreter.global_object()).value_or(js_undefined());
+    interpreter.reg(m_dst) = typeof_(interpreter.global_object(), value);
+}
+
+String TypeofVariable::to_string(const Executable& executable) const
+{
+    return String::formatted("TypeofVariable {}, {}", m_dst.to_string(), executable.identifiers[m_identifier_index]);
+}
+
+void SetVariable::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& name = interpreter.executable().identifiers[m_identifier_index];
+    interpreter.vm().set_variable(name, interpreter.reg(m_src), interpreter.global_object(), m_is_first_assignment);
+}
+
+String SetVariable::to_string(const Executable& executable) const
+{
+    return String::formatted("SetVariable {}, {}{}", executable.identifiers[m_identifier_index], m_src.to_string(), m_is_first_assignment ? " (first assignment)" : "");
+}
+
+void GetById::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto* object = interpreter.reg(m_base).to_object(interpreter.global_object());
+    if (!object)
+        return;
+    interpreter.reg(m_dst) = object->get(interpreter.executable().identifiers[m_identifier_index]).value_or(js_undefined());
+}
+
+String GetById::to_string(const Executable& executable) const
+{
+    return String::formatted("GetById {}, {}, {}", m_dst.to_string(), m_base.to_string(), executable.identifiers[m_identifier_index]);
+}
+
+void GetByValue::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& global_object = interpreter.global_object();
+    auto* object = interpreter.reg(m_base).to_object(global_object);
+    if (!object)
+        return;
+    auto property_name = PropertyName::from_value(global_object, interpreter.reg(m_property));
+    if (interpreter.vm().exception())
+        return;
+    interpreter.reg(m_dst) = object->get(property_name).value_or(js_undefined());
+}
+
+String GetByValue::to_string(const Executable&) const
+{
+    return String::formatted("GetByValue {}, {}, {}", m_dst.to_string(), m_base.to_string(), m_property.to_string());
+}
+
+void PutById::execute(Bytecode::Interpreter& interpreter) const
+{
+    put(interpreter, interpreter.reg(m_base), interpreter.executable().identifiers[m_identifier_index], interpreter.reg(m_src));
+}
+
+String PutById::to_string(const Executable& executable) const
+{
+    return String::formatted("PutById {}, {}, {}", m_base.to_string(), executable.identifiers[m_identifier_index], m_src.to_string());
+}
+
+void PutByValue::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto property_name = PropertyName::from_value(interpreter.global_object(), interpreter.reg(m_property));
+    if (interpreter.vm().exception())
+        return;
+    put(interpreter, interpreter.reg(m_base), property_name, interpreter.reg(m_src));
+}
+
+String PutByValue::to_string(const Executable&) const
+{
+    return String::formatted("PutByValue {}, {}, {}", m_base.to_string(), m_property.to_string(), m_src.to_string());
+}
+
+void DefineProperty::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto property_name = PropertyName::from_value(interpreter.global_object(), interpreter.reg(m_property));
+    if (interpreter.vm().exception())
+        return;
+    interpreter.reg(m_object).as_object().define_property(property_name, interpreter.reg(m_src));
+}
+
+String DefineProperty::to_string(const Executable&) const
+{
+    return String::formatted("DefineProperty {}, {}, {}", m_object.to_string(), m_property.to_string(), m_src.to_string());
+}
+
+#define JS_DEFINE_BYTECODE_BINARY_OP(OpTitleCase, op_snake_case)                                                             \
+    void OpTitleCase::execute(Bytecode::Interpreter& interpreter) const                                                      \
+    {                                                                                                                        \
+        interpreter.reg(m_dst) = op_snake_case(interpreter.global_object(), interpreter.reg(m_lhs), interpreter.reg(m_rhs)); \
+    }                                                                                                                        \
+                                                                                                                             \
+    String OpTitleCase::to_string(const Executable&) const                                                                   \
+    {                                                                                                                        \
+        return String::formatted(#OpTitleCase " {}, {}, {}", m_dst.to_string(), m_lhs.to_string(), m_rhs.to_string());       \
+    }
+
+JS_ENUMERATE_BYTECODE_BINARY_OPS(JS_DEFINE_BYTECODE_BINARY_OP)
+#undef JS_DEFINE_BYTECODE_BINARY_OP
+
+#define JS_DEFINE_BYTECODE_UNARY_OP(OpTitleCase, op_snake_case)                                      \
+    void OpTitleCase::execute(Bytecode::Interpreter& interpreter) const                              \
+    {                                                                                                \
+        interpreter.reg(m_dst) = op_snake_case(interpreter.global_object(), interpreter.reg(m_src)); \
+    }                                                                                                \
+                                                                                                     \
+    String OpTitleCase::to_string(const Executable&) const                                           \
+    {                                                                                                \
+        return String::formatted(#OpTitleCase " {}, {}", m_dst.to_string(), m_src.to_string());      \
+    }
+
+JS_ENUMERATE_BYTECODE_UNARY_OPS(JS_DEFINE_BYTECODE_UNARY_OP)
+#undef JS_DEFINE_BYTECODE_UNARY_OP
+
+void Jump::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.jump(m_target);
+}
+
+String Jump::to_string(const Executable&) const
+{
+    return String::formatted("Jump {}", m_target.to_string());
+}
+
+void JumpIfTrue::execute(Bytecode::Interpreter& interpreter) const
+{
+    if (interpreter.reg(m_condition).to_boolean())
+        interpreter.jump(m_target);
+}
+
+String JumpIfTrue::to_string(const Executable&) const
+{
+    return String::formatted("JumpIfTrue {}, {}", m_condition.to_string(), m_target.to_string());
+}
+
+void JumpIfFalse::execute(Bytecode::Interpreter& interpreter) const
+{
+    if (!interpreter.reg(m_condition).to_boolean())
+        interpreter.jump(m_target);
+}
+
+String JumpIfFalse::to_string(const Executable&) const
+{
+    return String::formatted("JumpIfFalse {}, {}", m_condition.to_string(), m_target.to_string());
+}
+
+void JumpIfNotNullish::execute(Bytecode::Interpreter& interpreter) const
+{
+    if (!interpreter.reg(m_condition).is_nullish())
+        interpreter.jump(m_target);
+}
+
+String JumpIfNotNullish::to_string(const Executable&) const
+{
+    return String::formatted("JumpIfNotNullish {}, {}", m_condition.to_string(), m_target.to_string());
+}
+
+void Call::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto callee = interpreter.reg(m_callee);
+    if (!callee.is_function()) {
+        throw_not_a_function_error(interpreter, callee, "function", m_callee_description_index);
+        return;
+    }
+
+    auto this_value = m_has_this_value ? interpreter.reg(m_this_value) : Value(&interpreter.global_object());
+    MarkedValueList arguments(vm.heap());
+    collect_arguments(interpreter, arguments, m_first_argument, m_argument_count);
+    interpreter.reg(m_dst) = vm.call(callee.as_function(), this_value, move(arguments));
+}
+
+String Call::to_string(const Executable&) const
+{
+    if (m_has_this_value)
+        return String::formatted("Call {}, {}, this={}, {}", m_dst.to_string(), m_callee.to_string(), m_this_value.to_string(), format_register_range(m_first_argument, m_argument_count));
+    return String::formatted("Call {}, {}, {}", m_dst.to_string(), m_callee.to_string(), format_register_range(m_first_argument, m_argument_count));
+}
+
+void New::execute(Bytecode::Interpreter& interpreter) const
+{
+    auto& vm = interpreter.vm();
+    auto callee = interpreter.reg(m_callee);
+    if (!callee.is_function() || (callee.as_object().is_native_function() && !static_cast<NativeFunction&>(callee.as_object()).has_constructor())) {
+        throw_not_a_function_error(interpreter, callee, "constructor", m_callee_description_index);
+        return;
+    }
+
+    auto& function = callee.as_function();
+    MarkedValueList arguments(vm.heap());
+    collect_arguments(interpreter, arguments, m_first_argument, m_argument_count);
+    interpreter.reg(m_dst) = vm.construct(function, function, move(arguments), interpreter.global_object());
+}
+
+String New::to_string(const Executable&) const
+{
+    return String::formatted("New {}, {}, {}", m_dst.to_string(), m_callee.to_string(), format_register_range(m_first_argument, m_argument_count));
+}
+
+void Throw::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.vm().throw_exception(interpreter.global_object(), interpreter.reg(m_src));
+}
+
+String Throw::to_string(const Executable&) const
+{
+    return String::formatted("Throw {}", m_src.to_string());
+}
+
+void Return::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.do_return(interpreter.reg(m_src));
+}
+
+String Return::to_string(const Executable&) const
+{
+    return String::formatted("Return {}", m_src.to_string());
+}
+
+void EnterScope::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.enter_scope(m_scope_node, m_scope_type);
+}
+
+String EnterScope::to_string(const Executable&) const
+{
+    return String::formatted("EnterScope {} {}", m_scope_type == ScopeType::Function ? "Function" : "Block", m_scope_node.class_name());
+}
+
+void ExitScope::execute(Bytecode::Interpreter& interpreter) const
+{
+    interpreter.exit_scope(m_scope_node);
+}
+
+String ExitScope::to_string(const Executable&) const
+{
+    return String::formatted("ExitScope {}", m_scope_node.class_name());
+}
+
+}
@@ -0,0 +1,550 @@
+/*
+ * Copyright (c) 2020, the SerenityOS developers.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice, this
+ *    list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ *    this list of conditions and the following disclaimer in the documentation
+ *    and/or other materials provided with the distribution.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS"
+ * AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE
+ * IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE
+ * DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE
+ * FOR ANY DIRECT, INDIRECT, INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL
+ * DAMAGES (INCLUDING, BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR
+ * SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ * CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT LIABILITY,
+ * OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE
+ * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#pragma once
+
+#include <AK/Optional.h>
+#include <LibJS/Bytecode/Instruction.h>
+#include <LibJS/Bytecode/Label.h>
+#include <LibJS/Bytecode/Register.h>
+#include <LibJS/Runtime/VM.h>
+
+namespace JS::Bytecode::Op {
+
+class LoadConstant final : public Instruction {
+public:
+    LoadConstant(Register dst, u32 constant_index)
+        : Instruction(Type::LoadConstant)
+        , m_dst(dst)
+        , m_constant_index(constant_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_constant_index { 0 };
+};
+
+class NewString final : public Instruction {
+public:
+    NewString(Register dst, u32 string_index)
+        : Instruction(Type::NewString)
+        , m_dst(dst)
+        , m_string_index(string_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_string_index { 0 };
+};
+
+class NewBigInt final : public Instruction {
+public:
+    NewBigInt(Register dst, u32 string_index)
+        : Instruction(Type::NewBigInt)
+        , m_dst(dst)
+        , m_string_index(string_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_string_index { 0 };
+};
+
+class NewRegExp final : public Instruction {
+public:
+    NewRegExp(Register dst, u32 pattern_index, u32 flags_index)
+        : Instruction(Type::NewRegExp)
+        , m_dst(dst)
+        , m_pattern_index(pattern_index)
+        , m_flags_index(flags_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_pattern_index { 0 };
+    u32 m_flags_index { 0 };
+};
+
+class NewObject final : public Instruction {
+public:
+    explicit NewObject(Register dst)
+        : Instruction(Type::NewObject)
+        , m_dst(dst)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+};
+
+// The elements are taken from the consecutive registers starting at first_element.
+class NewArray final : public Instruction {
+public:
+    NewArray(Register dst, Register first_element, u32 element_count)
+        : Instruction(Type::NewArray)
+        , m_dst(dst)
+        , m_first_element(first_element)
+        , m_element_count(element_count)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    Register m_first_element;
+    u32 m_element_count { 0 };
+};
+
+class NewFunction final : public Instruction {
+public:
+    NewFunction(Register dst, const FunctionExpression& function_node, u32 name_index)
+        : Instruction(Type::NewFunction)
+        , m_dst(dst)
+        , m_name_index(name_index)
+        , m_function_node(function_node)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_name_index { 0 };
+    const FunctionExpression& m_function_node;
+};
+
+class Move final : public Instruction {
+public:
+    Move(Register dst, Register src)
+        : Instruction(Type::Move)
+        , m_dst(dst)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    Register m_src;
+};
+
+class LoadThis final : public Instruction {
+public:
+    explicit LoadThis(Register dst)
+        : Instruction(Type::LoadThis)
+        , m_dst(dst)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+};
+
+class GetVariable final : public Instruction {
+public:
+    GetVariable(Register dst, u32 identifier_index)
+        : Instruction(Type::GetVariable)
+        , m_dst(dst)
+        , m_identifier_index(identifier_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_identifier_index { 0 };
+};
+
+// Like GetVariable followed by Typeof, except that unresolvable names produce "undefined".
+class TypeofVariable final : public Instruction {
+public:
+    TypeofVariable(Register dst, u32 identifier_index)
+        : Instruction(Type::TypeofVariable)
+        , m_dst(dst)
+        , m_identifier_index(identifier_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    u32 m_identifier_index { 0 };
+};
+
+class SetVariable final : public Instruction {
+public:
+    SetVariable(u32 identifier_index, Register src, bool is_first_assignment = false)
+        : Instruction(Type::SetVariable)
+        , m_identifier_index(identifier_index)
+        , m_src(src)
+        , m_is_first_assignment(is_first_assignment)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    u32 m_identifier_index { 0 };
+    Register m_src;
+    bool m_is_first_assignment { false };
+};
+
+class GetById final : public Instruction {
+public:
+    GetById(Register dst, Register base, u32 identifier_index)
+        : Instruction(Type::GetById)
+        , m_dst(dst)
+        , m_base(base)
+        , m_identifier_index(identifier_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    Register m_base;
+    u32 m_identifier_index { 0 };
+};
+
+class GetByValue final : public Instruction {
+public:
+    GetByValue(Register dst, Register base, Register property)
+        : Instruction(Type::GetByValue)
+        , m_dst(dst)
+        , m_base(base)
+        , m_property(property)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    Register m_base;
+    Register m_property;
+};
+
+class PutById final : public Instruction {
+public:
+    PutById(Register base, u32 identifier_index, Register src)
+        : Instruction(Type::PutById)
+        , m_base(base)
+        , m_identifier_index(identifier_index)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_base;
+    u32 m_identifier_index { 0 };
+    Register m_src;
+};
+
+class PutByValue final : public Instruction {
+public:
+    PutByValue(Register base, Register property, Register src)
+        : Instruction(Type::PutByValue)
+        , m_base(base)
+        , m_property(property)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_base;
+    Register m_property;
+    Register m_src;
+};
+
+// Used for object literals, where properties are defined rather than assigned.
+class DefineProperty final : public Instruction {
+public:
+    DefineProperty(Register object, Register property, Register src)
+        : Instruction(Type::DefineProperty)
+        , m_object(object)
+        , m_property(property)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_object;
+    Register m_property;
+    Register m_src;
+};
+
+#define JS_DECLARE_BYTECODE_BINARY_OP(OpTitleCase, op_snake_case) \
+    class OpTitleCase final : public Instruction {                \
+    public:                                                       \
+        OpTitleCase(Register dst, Register lhs, Register rhs)     \
+            : Instruction(Type::OpTitleCase)                      \
+            , m_dst(dst)                                          \
+            , m_lhs(lhs)                                          \
+            , m_rhs(rhs)                                          \
+        {                                                         \
+        }                                                         \
+                                                                  \
+        void execute(Bytecode::Interpreter&) const;               \
+        String to_string(const Executable&) const;                \
+                                                                  \
+    private:                                                      \
+        Register m_dst;                                           \
+        Register m_lhs;                                           \
+        Register m_rhs;                                           \
+    };
+
+JS_ENUMERATE_BYTECODE_BINARY_OPS(JS_DECLARE_BYTECODE_BINARY_OP)
+#undef JS_DECLARE_BYTECODE_BINARY_OP
+
+#define JS_DECLARE_BYTECODE_UNARY_OP(OpTitleCase, op_snake_case) \
+    class OpTitleCase final : public Instruction {               \
+    public:                                                      \
+        OpTitleCase(Register dst, Register src)                  \
+            : Instruction(Type::OpTitleCase)                     \
+            , m_dst(dst)                                         \
+            , m_src(src)                                         \
+        {                                                        \
+        }                                                        \
+                                                                 \
+        void execute(Bytecode::Interpreter&) const;              \
+        String to_string(const Executable&) const;               \
+                                                                 \
+    private:                                                     \
+        Register m_dst;                                          \
+        Register m_src;                                          \
+    };
+
+JS_ENUMERATE_BYTECODE_UNARY_OPS(JS_DECLARE_BYTECODE_UNARY_OP)
+#undef JS_DECLARE_BYTECODE_UNARY_OP
+
+// All jumps share this layout, so forward jumps can be linked without knowing their exact type.
+class JumpInstruction : public Instruction {
+public:
+    Label target() const { return m_target; }
+    void set_target(Label target) { m_target = target; }
+
+protected:
+    JumpInstruction(Type type, Label target)
+        : Instruction(type)
+        , m_target(target)
+    {
+    }
+
+    Label m_target;
+};
+
+class Jump final : public JumpInstruction {
+public:
+    explicit Jump(Label target = {})
+        : JumpInstruction(Type::Jump, target)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+};
+
+#define JS_DECLARE_BYTECODE_CONDITIONAL_JUMP(OpTitleCase)           \
+    class OpTitleCase final : public JumpInstruction {              \
+    public:                                                         \
+        explicit OpTitleCase(Register condition, Label target = {}) \
+            : JumpInstruction(Type::OpTitleCase, target)            \
+            , m_condition(condition)                                \
+        {                                                           \
+        }                                                           \
+                                                                    \
+        void execute(Bytecode::Interpreter&) const;                 \
+        String to_string(const Executable&) const;                  \
+                                                                    \
+    private:                                                        \
+        Register m_condition;                                       \
+    };
+
+JS_DECLARE_BYTECODE_CONDITIONAL_JUMP(JumpIfTrue)
+JS_DECLARE_BYTECODE_CONDITIONAL_JUMP(JumpIfFalse)
+JS_DECLARE_BYTECODE_CONDITIONAL_JUMP(JumpIfNotNullish)
+#undef JS_DECLARE_BYTECODE_CONDITIONAL_JUMP
+
+// The arguments are taken from the consecutive registers starting at first_argument.
+// If there is no this_value, the global object is used.
+class Call final : public Instruction {
+public:
+    Call(Register dst, Register callee, Optional<Register> this_value, Register first_argument, u32 argument_count, u32 callee_description_index)
+        : Instruction(Type::Call)
+        , m_dst(dst)
+        , m_callee(callee)
+        , m_this_value(this_value.value_or(callee))
+        , m_has_this_value(this_value.has_value())
+        , m_first_argument(first_argument)
+        , m_argument_count(argument_count)
+        , m_callee_description_index(callee_description_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    Register m_callee;
+    Register m_this_value;
+    bool m_has_this_value { false };
+    Register m_first_argument;
+    u32 m_argument_count { 0 };
+    u32 m_callee_description_index { 0 };
+};
+
+class New final : public Instruction {
+public:
+    New(Register dst, Register callee, Register first_argument, u32 argument_count, u32 callee_description_index)
+        : Instruction(Type::New)
+        , m_dst(dst)
+        , m_callee(callee)
+        , m_first_argument(first_argument)
+        , m_argument_count(argument_count)
+        , m_callee_description_index(callee_description_index)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_dst;
+    Register m_callee;
+    Register m_first_argument;
+    u32 m_argument_count { 0 };
+    u32 m_callee_description_index { 0 };
+};
+
+class Throw final : public Instruction {
+public:
+    explicit Throw(Register src)
+        : Instruction(Type::Throw)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_src;
+};
+
+class Return final : public Instruction {
+public:
+    explicit Return(Register src)
+        : Instruction(Type::Return)
+        , m_src(src)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    Register m_src;
+};
+
+class EnterScope final : public Instruction {
+public:
+    EnterScope(const ScopeNode& scope_node, ScopeType scope_type)
+        : Instruction(Type::EnterScope)
+        , m_scope_type(scope_type)
+        , m_scope_node(scope_node)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    ScopeType m_scope_type;
+    const ScopeNode& m_scope_node;
+};
+
+// Leaves the given scope and every scope that was entered after it.
+class ExitScope final : public Instruction {
+public:
+    explicit ExitScope(const ScopeNode& scope_node)
+        : Instruction(Type::ExitScope)
+        , m_scope_node(scope_node)
+    {
+    }
+
+    void execute(Bytecode::Interpreter&) const;
+    String to_string(const Executable&) const;
+
+private:
+    const ScopeNode& m_scope_node;
+};
+
+}
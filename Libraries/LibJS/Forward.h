@@ -169,4 +169,12 @@ JS_ENUMERATE_TYPED_ARRAYS
 template<class T>
 class Handle;
 
+namespace Bytecode {
+struct Executable;
+class Generator;
+class Instruction;
+class Interpreter;
+class Register;
+}
+
 }
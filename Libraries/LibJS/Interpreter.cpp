@@ -27,6 +27,7 @@
 #include <AK/Badge.h>
 #include <AK/StringBuilder.h>
 #include <LibJS/AST.h>
+#include <LibJS/Bytecode/Interpreter.h>
 #include <LibJS/Interpreter.h>
 #include <LibJS/Runtime/Error.h>
 #include <LibJS/Runtime/GlobalObject.h>
@@ -75,7 +76,17 @@ Value Interpreter::run(GlobalObject& global_object, const Program& program)
     global_call_frame.is_strict_mode = program.is_strict_mode();
     vm.push_call_frame(global_call_frame, global_object);
     ASSERT(!vm.exception());
-    auto result = program.execute(*this, global_object);
+    Value result;
+    auto* executable = vm.should_run_bytecode() ? program.bytecode_executable() : nullptr;
+    if (executable) {
+        // Like Program::execute(), the completion value is only made available through last_value().
+        auto completion_value = Bytecode::Interpreter(*this, global_object, *executable).run();
+        if (!vm.exception())
+            vm.set_last_value({}, completion_value);
+        result = js_undefined();
+    } else {
+        result = program.execute(*this, global_object);
+    }
     vm.pop_call_frame();
     return result;
 }
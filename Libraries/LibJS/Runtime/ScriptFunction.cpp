@@ -26,6 +26,7 @@
 
 #include <AK/Function.h>
 #include <LibJS/AST.h>
+#include <LibJS/Bytecode/Interpreter.h>
 #include <LibJS/Interpreter.h>
 #include <LibJS/Runtime/Array.h>
 #include <LibJS/Runtime/Error.h>
@@ -147,6 +148,11 @@ Value ScriptFunction::execute_function_body()
         vm.current_scope()->put_to_scope(parameter.name, { argument_value, DeclarationKind::Var });
     }
 
+    if (vm.should_run_bytecode() && m_body->is_scope_node()) {
+        if (auto* executable = static_cast<const ScopeNode&>(*m_body).bytecode_executable())
+            return Bytecode::Interpreter(*interpreter, global_object(), *executable).run();
+    }
+
     return interpreter->execute_statement(global_object(), m_body, ScopeType::Function);
 }
 
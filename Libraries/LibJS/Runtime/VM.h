@@ -179,6 +179,11 @@ public:
     bool underscore_is_last_value() const { return m_underscore_is_last_value; }
     void set_underscore_is_last_value(bool b) { m_underscore_is_last_value = b; }
 
+    // If set, programs and function bodies are compiled to bytecode and run by Bytecode::Interpreter.
+    // Anything the bytecode generator doesn't support yet still runs in the AST interpreter.
+    bool should_run_bytecode() const { return m_should_run_bytecode; }
+    void set_should_run_bytecode(bool b) { m_should_run_bytecode = b; }
+
     void unwind(ScopeType type, FlyString label = {})
     {
         m_unwind_until = type;
@@ -262,6 +267,7 @@ private:
     StackInfo m_stack_info;
 
     bool m_underscore_is_last_value { false };
+    bool m_should_run_bytecode { false };
 
     HashMap<String, Symbol*> m_global_symbol_map;
 
@@ -28,12 +28,14 @@
 #include <AK/Atomic.h>
 #include <AK/StdLibExtras.h>
 #include <Kernel/API/Syscall.h>
+#include <errno.h>
 #include <limits.h>
 #include <pthread.h>
 #include <serenity.h>
 #include <signal.h>
 #include <stdio.h>
 #include <string.h>
+#include <sys/internals.h>
 #include <sys/mman.h>
 #include <time.h>
 #include <unistd.h>
@@ -91,6 +93,7 @@ static int create_thread(pthread_t* thread, void* (*entry)(void*), void* argumen
 
 [[noreturn]] static void exit_thread(void* code)
 {
+    __malloc_thread_exit();
     syscall(SC_exit_thread, code);
     ASSERT_NOT_REACHED();
 }
@@ -163,6 +166,7 @@ int pthread_mutex_init(pthread_mutex_t* mutex, const pthread_mutexattr_t* attrib
     mutex->owner = 0;
     mutex->level = 0;
     mutex->type = attributes ? attributes->type : PTHREAD_MUTEX_NORMAL;
+    mutex->protocol = attributes ? attributes->protocol : PTHREAD_PRIO_NONE;
     return 0;
 }
 
@@ -171,38 +175,59 @@ int pthread_mutex_destroy(pthread_mutex_t*)
     return 0;
 }
 
+// A normal mutex is 0 when unlocked, 1 when locked, and 2 when locked and someone may
+// be waiting for it. A priority inheritance mutex holds the owner's tid instead, and the
+// kernel takes care of waiting for it, handing it over and lending priorities.
+static constexpr u32 mutex_locked = 1;
+static constexpr u32 mutex_locked_with_waiters = 2;
+
+static void mutex_lock_contended(pthread_mutex_t* mutex)
+{
+    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    while (atomic.exchange(mutex_locked_with_waiters, AK::memory_order_acquire) != 0)
+        futex(reinterpret_cast<int32_t*>(&mutex->lock), FUTEX_WAIT, mutex_locked_with_waiters, nullptr, nullptr, 0);
+}
+
+static void mutex_lock_pi(pthread_mutex_t* mutex)
+{
+    while (futex(reinterpret_cast<int32_t*>(&mutex->lock), FUTEX_LOCK_PI, 0, nullptr, nullptr, 0) < 0)
+        ASSERT(errno == EINTR);
+}
+
 int pthread_mutex_lock(pthread_mutex_t* mutex)
 {
     auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
     pthread_t this_thread = pthread_self();
-    for (;;) {
-        u32 expected = false;
-        if (!atomic.compare_exchange_strong(expected, true, AK::memory_order_acq_rel)) {
-            if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
-                mutex->level++;
-                return 0;
-            }
-            sched_yield();
-            continue;
+    bool is_pi = mutex->protocol == PTHREAD_PRIO_INHERIT;
+    u32 expected = 0;
+    if (!atomic.compare_exchange_strong(expected, is_pi ? this_thread : mutex_locked, AK::memory_order_acq_rel)) {
+        if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
+            mutex->level++;
+            return 0;
         }
-        mutex->owner = this_thread;
-        mutex->level = 0;
-        return 0;
+        if (is_pi)
+            mutex_lock_pi(mutex);
+        else
+            mutex_lock_contended(mutex);
     }
+    mutex->owner = this_thread;
+    mutex->level = 0;
+    return 0;
 }
 
 int pthread_mutex_trylock(pthread_mutex_t* mutex)
 {
     auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
-    u32 expected = false;
-    if (!atomic.compare_exchange_strong(expected, true, AK::memory_order_acq_rel)) {
-        if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == pthread_self()) {
+    pthread_t this_thread = pthread_self();
+    u32 expected = 0;
+    if (!atomic.compare_exchange_strong(expected, mutex->protocol == PTHREAD_PRIO_INHERIT ? this_thread : mutex_locked, AK::memory_order_acq_rel)) {
+        if (mutex->type == PTHREAD_MUTEX_RECURSIVE && mutex->owner == this_thread) {
             mutex->level++;
             return 0;
         }
         return EBUSY;
     }
-    mutex->owner = pthread_self();
+    mutex->owner = this_thread;
     mutex->level = 0;
     return 0;
 }
@@ -213,14 +238,27 @@ int pthread_mutex_unlock(pthread_mutex_t* mutex)
         mutex->level--;
         return 0;
     }
+    auto& atomic = reinterpret_cast<Atomic<u32>&>(mutex->lock);
+    pthread_t this_thread = mutex->owner;
     mutex->owner = 0;
-    mutex->lock = 0;
+    if (mutex->protocol == PTHREAD_PRIO_INHERIT) {
+        u32 expected = this_thread;
+        if (!atomic.compare_exchange_strong(expected, 0, AK::memory_order_release)) {
+            // There are waiters, let the kernel pick who gets it next.
+            int rc = futex(reinterpret_cast<int32_t*>(&mutex->lock), FUTEX_UNLOCK_PI, 0, nullptr, nullptr, 0);
+            ASSERT(rc == 0);
+        }
+        return 0;
+    }
+    if (atomic.exchange(0, AK::memory_order_release) == mutex_locked_with_waiters)
+        futex(reinterpret_cast<int32_t*>(&mutex->lock), FUTEX_WAKE, 1, nullptr, nullptr, 0);
     return 0;
 }
 
 int pthread_mutexattr_init(pthread_mutexattr_t* attr)
 {
     attr->type = PTHREAD_MUTEX_NORMAL;
+    attr->protocol = PTHREAD_PRIO_NONE;
     return 0;
 }
 
@@ -239,6 +277,24 @@ int pthread_mutexattr_settype(pthread_mutexattr_t* attr, int type)
     return 0;
 }
 
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t* attr, int protocol)
+{
+    if (!attr)
+        return EINVAL;
+    if (protocol != PTHREAD_PRIO_NONE && protocol != PTHREAD_PRIO_INHERIT)
+        return EINVAL;
+    attr->protocol = protocol;
+    return 0;
+}
+
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t* attr, int* protocol)
+{
+    if (!attr || !protocol)
+        return EINVAL;
+    *protocol = attr->protocol;
+    return 0;
+}
+
 int pthread_attr_init(pthread_attr_t* attributes)
 {
     auto* impl = new PthreadAttrImpl {};
@@ -475,6 +531,8 @@ int pthread_cond_init(pthread_cond_t* cond, const pthread_condattr_t* attr)
     cond->value = 0;
     cond->previous = 0;
     cond->clockid = attr ? attr->clockid : CLOCK_MONOTONIC_COARSE;
+    cond->mutex = nullptr;
+    cond->waiters = 0;
     return 0;
 }
 
@@ -487,10 +545,29 @@ static int cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex, const struct
 {
     i32 value = cond->value;
     cond->previous = value;
+    cond->mutex = mutex;
+    AK::atomic_fetch_add(&cond->waiters, 1u, AK::memory_order_relaxed);
     pthread_mutex_unlock(mutex);
-    int rc = futex(&cond->value, FUTEX_WAIT, value, abstime);
-    pthread_mutex_lock(mutex);
-    return rc;
+    int futex_op = FUTEX_WAIT_BITSET;
+    if (cond->clockid == CLOCK_REALTIME || cond->clockid == CLOCK_REALTIME_COARSE)
+        futex_op |= FUTEX_CLOCK_REALTIME;
+    int rc = futex(&cond->value, futex_op, value, abstime, nullptr, FUTEX_BITSET_MATCH_ANY);
+    bool timed_out = rc < 0 && errno == ETIMEDOUT;
+    if (mutex->protocol == PTHREAD_PRIO_INHERIT || mutex->type == PTHREAD_MUTEX_RECURSIVE) {
+        pthread_mutex_lock(mutex);
+    } else {
+        // A broadcast may have moved us over to the mutex's futex, in which case we were
+        // woken by an unlock (or will be). Since there may be more of us waiting there,
+        // take the mutex as contended so our unlock wakes up the next one.
+        mutex_lock_contended(mutex);
+        mutex->owner = pthread_self();
+        mutex->level = 0;
+    }
+    // The mutex may be gone once the last of us has returned, so don't leave it behind for a later broadcast.
+    // We're holding the mutex again, so nobody can start waiting with a different one in the meantime.
+    if (AK::atomic_fetch_sub(&cond->waiters, 1u, AK::memory_order_acq_rel) == 1)
+        cond->mutex = nullptr;
+    return timed_out ? ETIMEDOUT : 0;
 }
 
 int pthread_cond_wait(pthread_cond_t* cond, pthread_mutex_t* mutex)
@@ -526,8 +603,8 @@ int pthread_cond_signal(pthread_cond_t* cond)
 {
     u32 value = cond->previous + 1;
     cond->value = value;
-    int rc = futex(&cond->value, FUTEX_WAKE, 1, nullptr);
-    ASSERT(rc == 0);
+    int rc = futex(&cond->value, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+    ASSERT(rc >= 0);
     return 0;
 }
 
@@ -535,8 +612,20 @@ int pthread_cond_broadcast(pthread_cond_t* cond)
 {
     u32 value = cond->previous + 1;
     cond->value = value;
-    int rc = futex(&cond->value, FUTEX_WAKE, INT32_MAX, nullptr);
-    ASSERT(rc == 0);
+
+    // Only wake up one waiter and move the rest over to the mutex. They'd just
+    // fight over it otherwise, so let the mutex wake them one by one instead.
+    pthread_mutex_t* mutex = AK::atomic_load(&cond->waiters, AK::memory_order_acquire) ? cond->mutex : nullptr;
+    if (mutex && mutex->protocol != PTHREAD_PRIO_INHERIT && mutex->type != PTHREAD_MUTEX_RECURSIVE) {
+        auto* requeue_count = reinterpret_cast<const struct timespec*>((uintptr_t)INT32_MAX);
+        int rc = futex(&cond->value, FUTEX_CMP_REQUEUE, 1, requeue_count, reinterpret_cast<int32_t*>(&mutex->lock), value);
+        if (rc >= 0)
+            return 0;
+        ASSERT(errno == EAGAIN);
+    }
+
+    int rc = futex(&cond->value, FUTEX_WAKE, INT32_MAX, nullptr, nullptr, 0);
+    ASSERT(rc >= 0);
     return 0;
 }
 
@@ -78,13 +78,15 @@ int pthread_setschedparam(pthread_t thread, int policy, const struct sched_param
 #define PTHREAD_MUTEX_NORMAL 0
 #define PTHREAD_MUTEX_RECURSIVE 1
 #define PTHREAD_MUTEX_DEFAULT PTHREAD_MUTEX_NORMAL
-#define PTHREAD_MUTEX_INITIALIZER      \
-    {                                  \
-        0, 0, 0, PTHREAD_MUTEX_DEFAULT \
+#define PTHREAD_PRIO_NONE 0
+#define PTHREAD_PRIO_INHERIT 1
+#define PTHREAD_MUTEX_INITIALIZER                         \
+    {                                                     \
+        0, 0, 0, PTHREAD_MUTEX_DEFAULT, PTHREAD_PRIO_NONE \
     }
-#define PTHREAD_COND_INITIALIZER     \
-    {                                \
-        0, 0, CLOCK_MONOTONIC_COARSE \
+#define PTHREAD_COND_INITIALIZER        \
+    {                                   \
+        0, 0, CLOCK_MONOTONIC_COARSE, 0, 0 \
     }
 
 int pthread_key_create(pthread_key_t* key, void (*destructor)(void*));
@@ -112,6 +114,8 @@ int pthread_detach(pthread_t);
 int pthread_equal(pthread_t, pthread_t);
 int pthread_mutexattr_init(pthread_mutexattr_t*);
 int pthread_mutexattr_settype(pthread_mutexattr_t*, int);
+int pthread_mutexattr_setprotocol(pthread_mutexattr_t*, int);
+int pthread_mutexattr_getprotocol(const pthread_mutexattr_t*, int*);
 int pthread_mutexattr_destroy(pthread_mutexattr_t*);
 
 int pthread_setname_np(pthread_t, const char*);
@@ -34,6 +34,7 @@
 #include <LibJS/Parser.h>
 #include <LibJS/Runtime/Function.h>
 #include <LibWeb/Bindings/DocumentWrapper.h>
+#include <LibWeb/Bindings/MainThreadVM.h>
 #include <LibWeb/Bindings/WindowObject.h>
 #include <LibWeb/CSS/StyleResolver.h>
 #include <LibWeb/DOM/Comment.h>
@@ -528,20 +529,10 @@ Color Document::visited_link_color() const
     return page()->palette().visited_link();
 }
 
-static JS::VM& main_thread_vm()
-{
-    static RefPtr<JS::VM> vm;
-    if (!vm) {
-        vm = JS::VM::create();
-        vm->set_should_log_exceptions(true);
-    }
-    return *vm;
-}
-
 JS::Interpreter& Document::interpreter()
 {
     if (!m_interpreter)
-        m_interpreter = JS::Interpreter::create<Bindings::WindowObject>(main_thread_vm(), *m_window);
+        m_interpreter = JS::Interpreter::create<Bindings::WindowObject>(Bindings::main_thread_vm(), *m_window);
     return *m_interpreter;
 }
 
@@ -24,13 +24,24 @@
  * OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <LibCore/ArgsParser.h>
 #include <LibCore/EventLoop.h>
 #include <LibCore/LocalServer.h>
 #include <LibIPC/ClientConnection.h>
+#include <LibJS/Runtime/VM.h>
+#include <LibWeb/Bindings/MainThreadVM.h>
 #include <WebContent/ClientConnection.h>
 
-int main(int, char**)
+int main(int argc, char** argv)
 {
+    bool use_bytecode = false;
+
+    Core::ArgsParser args_parser;
+    args_parser.add_option(use_bytecode, "Run JavaScript with the bytecode interpreter", "bytecode", 'b');
+    args_parser.parse(argc, argv);
+
+    Web::Bindings::main_thread_vm().set_should_run_bytecode(use_bytecode);
+
     Core::EventLoop event_loop;
     if (pledge("stdio shared_buffer accept unix rpath recvfd", nullptr) < 0) {
         perror("pledge");
@@ -35,7 +35,10 @@
 #include <LibCore/File.h>
 #include <LibCore/MimeData.h>
 #include <LibHTTP/HttpRequest.h>
+#include <errno.h>
+#include <poll.h>
 #include <stdio.h>
+#include <sys/sendfile.h>
 #include <sys/stat.h>
 #include <time.h>
 #include <unistd.h>
@@ -125,10 +128,10 @@ void Client::handle_request(ReadonlyBytes raw_request)
         return;
     }
 
-    send_response(file->read_all(), request, Core::guess_mime_type_based_on_filename(real_path));
+    send_file(*file, request, Core::guess_mime_type_based_on_filename(real_path));
 }
 
-void Client::send_response(StringView response, const HTTP::HttpRequest& request, const String& content_type)
+void Client::send_response_header(const String& content_type, size_t content_length)
 {
     StringBuilder builder;
     builder.append("HTTP/1.0 200 OK\r\n");
@@ -136,14 +139,56 @@ void Client::send_response(StringView response, const HTTP::HttpRequest& request
     builder.append("Content-Type: ");
     builder.append(content_type);
     builder.append("\r\n");
+    builder.appendf("Content-Length: %zu\r\n", content_length);
     builder.append("\r\n");
 
     m_socket->write(builder.to_string());
+}
+
+void Client::send_response(StringView response, const HTTP::HttpRequest& request, const String& content_type)
+{
+    send_response_header(content_type, response.length());
     m_socket->write(response);
 
     log_response(200, request);
 }
 
+void Client::send_file(Core::File& file, const HTTP::HttpRequest& request, const String& content_type)
+{
+    struct stat st;
+    if (fstat(file.fd(), &st) < 0 || !S_ISREG(st.st_mode)) {
+        send_response(file.read_all(), request, content_type);
+        return;
+    }
+
+    send_response_header(content_type, st.st_size);
+
+    // Let the kernel copy the file contents straight to the socket, instead of reading them in and writing them back out.
+    off_t offset = 0;
+    while (offset < st.st_size) {
+        ssize_t nsent = sendfile(m_socket->fd(), file.fd(), &offset, st.st_size - offset);
+        if (nsent < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN) {
+                // The socket's send buffer is full. We've promised the whole file, so wait for room instead of giving up.
+                pollfd socket_pollfd { m_socket->fd(), POLLOUT, 0 };
+                if (poll(&socket_pollfd, 1, -1) < 0 && errno != EINTR) {
+                    perror("poll");
+                    break;
+                }
+                continue;
+            }
+            perror("sendfile");
+            break;
+        }
+        if (nsent == 0)
+            break;
+    }
+
+    log_response(200, request);
+}
+
 void Client::send_redirect(StringView redirect_path, const HTTP::HttpRequest& request)
 {
     StringBuilder builder;
@@ -26,6 +26,7 @@
 
 #pragma once
 
+#include <LibCore/Forward.h>
 #include <LibCore/Object.h>
 #include <LibCore/TCPSocket.h>
 #include <LibHTTP/Forward.h>
@@ -42,7 +43,9 @@ private:
     Client(NonnullRefPtr<Core::TCPSocket>, const String&, Core::Object* parent);
 
     void handle_request(ReadonlyBytes);
+    void send_response_header(const String& content_type, size_t content_length);
     void send_response(StringView, const HTTP::HttpRequest&, const String& content_type);
+    void send_file(Core::File&, const HTTP::HttpRequest&, const String& content_type);
     void send_redirect(StringView redirect, const HTTP::HttpRequest& request);
     void send_error_response(unsigned code, const StringView& message, const HTTP::HttpRequest&);
     void die();